@@ -21,12 +21,32 @@ pub fn build(b: *std.Build) !void {
     // set a preferred release mode, allowing the user to decide how to optimize.
     const optimize = b.standardOptimizeOption(.{});
 
+    // `zig build -Dcapture=true` routes the app's wgpu calls through the
+    // capture layer so `--capture FILE.fcap` can record them for `replay`.
+    const capture = b.option(bool, "capture", "Build the app with wgpu call capture (--capture)") orelse false;
+
+    // The app's window surface goes through X11 on Linux unless `-Dwayland=true`.
+    // `-Dheadless-only=true` leaves the native window code out entirely, for
+    // machines without X11 or Wayland headers; the app then always runs
+    // --headless.
+    const wayland = b.option(bool, "wayland", "Create the app's window surface through Wayland instead of X11") orelse false;
+    const headless_only = b.option(bool, "headless-only", "Build the app without native window support (implies --headless)") orelse false;
+
     const exe = b.addExecutable(.{
         .name = "wgpu-test",
         //.root_source_file = .{ .path = "src/main.zig" },
         .target = target,
         .optimize = optimize,
     });
+    if (capture) {
+        exe.defineCMacro("FRMWRK_CAPTURE", null);
+    }
+    if (wayland) {
+        exe.defineCMacro("FRMWRK_WAYLAND", null);
+    }
+    if (headless_only) {
+        exe.defineCMacro("FRMWRK_HEADLESS_ONLY", null);
+    }
 
     exe.linkLibC();
     exe.linkLibCpp();
@@ -51,9 +71,42 @@ pub fn build(b: *std.Build) !void {
 
     exe.addIncludePath("src");
     exe.addCSourceFile("src/framework.c", &cflags);
-    exe.addCSourceFile("src/Program.c", &cflags);
+    exe.addCSourceFile("src/headless.c", &cflags);
+    exe.addCSourceFile("src/frame_profiler.c", &cflags);
+    exe.addCSourceFile("src/gpu_profiler.c", &cflags);
+    exe.addCSourceFile("src/resource_telemetry.c", &cflags);
+    exe.addCSourceFile("src/async_logger.c", &cflags);
+    exe.addCSourceFile("src/threading.c", &cflags);
+    exe.addCSourceFile("src/job_system.c", &cflags);
+    exe.addCSourceFile("src/texture_loader.c", &cflags);
+    exe.addCSourceFile("src/texture_container.c", &cflags);
+    exe.addCSourceFile("src/block_compress.c", &cflags);
+    exe.addCSourceFile("src/upload_ring.c", &cflags);
+    exe.addCSourceFile("src/pixel_convert.c", &cflags);
+    exe.addCSourceFile("src/mipmap.c", &cflags);
+    exe.addCSourceFile("src/atlas.c", &cflags);
+    exe.addCSourceFile("src/buffer_arena.c", &cflags);
+    exe.addCSourceFile("src/capture.c", &cflags);
+    exe.addCSourceFile("src/sprite_batch.c", &cflags);
+    exe.addCSourceFile("src/render_bundle.c", &cflags);
+    exe.addCSourceFile("src/uniform_ring.c", &cflags);
+    exe.addCSourceFile("src/texture_table.c", &cflags);
+    exe.addCSourceFile("src/resources.c", &cflags);
+    exe.addCSourceFile("src/object_cache.c", &cflags);
+    exe.addCSourceFile("src/shader_preprocessor.c", &cflags);
+    exe.addCSourceFile("src/shader_reloader.c", &cflags);
+    // The macOS surface is created through a CAMetalLayer, in Objective-C.
+    const macos_surface = target.isDarwin() and !headless_only;
+    const program_cflags: []const []const u8 = if (macos_surface) &(cflags ++ [_][]const u8{"-ObjC"}) else &cflags;
+    exe.addCSourceFile("src/Program.c", program_cflags);
+    if (macos_surface) {
+        exe.linkFramework("Metal");
+        exe.linkFramework("QuartzCore");
+    }
 
     b.installFile("src/shader.wgsl", "bin/shader.wgsl");
+    b.installFile("src/sprite_streams.wgsl", "bin/sprite_streams.wgsl");
+    b.installFile("src/mipmap.wgsl", "bin/mipmap.wgsl");
 
     exe.want_lto = false;
     //exe.linkSystemLibrary("glfw3");
@@ -85,4 +138,129 @@ pub fn build(b: *std.Build) !void {
     // This will evaluate the `run` step rather than the default, which is "install".
     const run_step = b.step("run", "Run the app");
     run_step.dependOn(&run_cmd.step);
+
+    // Offline texture cooker. `zig build cook` converts the demo's images into
+    // .ftex containers next to the executable, which it then loads instead.
+    const cook = b.addExecutable(.{
+        .name = "cook",
+        .target = target,
+        .optimize = optimize,
+    });
+    cook.linkLibC();
+    cook.addLibraryPath("include");
+    cook.linkSystemLibrary("wgpu_native");
+    cook.addIncludePath("include");
+    cook.addIncludePath("src");
+    cook.addCSourceFile("src/cook.c", &cflags);
+    cook.addCSourceFile("src/framework.c", &cflags);
+    cook.addCSourceFile("src/texture_container.c", &cflags);
+    cook.addCSourceFile("src/pixel_convert.c", &cflags);
+    cook.addCSourceFile("src/mipmap.c", &cflags);
+    cook.addCSourceFile("src/upload_ring.c", &cflags);
+    cook.addCSourceFile("src/block_compress.c", &cflags);
+    cook.addCSourceFile("src/threading.c", &cflags);
+    b.installArtifact(cook);
+
+    const texture_dir = b.option([]const u8, "texture-dir", "Directory holding the source images to cook") orelse "zig-out/bin";
+    const cook_step = b.step("cook", "Cook the demo's textures into .ftex containers");
+    const cooked_textures = [_][]const u8{ "tbh", "tbhslime" };
+    for (cooked_textures) |name| {
+        const cook_cmd = b.addRunArtifact(cook);
+        cook_cmd.addArg("--checksum");
+        cook_cmd.addFileSourceArg(.{ .path = b.pathJoin(&.{ texture_dir, b.fmt("{s}.png", .{name}) }) });
+        const cooked = cook_cmd.addOutputFileArg(b.fmt("{s}.ftex", .{name}));
+        const install_cooked = b.addInstallFileWithDir(cooked, .bin, b.fmt("{s}.ftex", .{name}));
+        cook_step.dependOn(&install_cooked.step);
+    }
+
+    // Job system scaling benchmark. `zig build bench-jobs -- --threads 16` runs
+    // it on 1 to 16 threads.
+    const bench_jobs = b.addExecutable(.{
+        .name = "bench-jobs",
+        .target = target,
+        .optimize = optimize,
+    });
+    bench_jobs.linkLibC();
+    bench_jobs.addLibraryPath("include");
+    bench_jobs.linkSystemLibrary("wgpu_native");
+    bench_jobs.addIncludePath("include");
+    bench_jobs.addIncludePath("src");
+    bench_jobs.addCSourceFile("src/bench_jobs.c", &cflags);
+    bench_jobs.addCSourceFile("src/job_system.c", &cflags);
+    bench_jobs.addCSourceFile("src/threading.c", &cflags);
+    bench_jobs.addCSourceFile("src/framework.c", &cflags);
+    bench_jobs.addCSourceFile("src/pixel_convert.c", &cflags);
+    bench_jobs.addCSourceFile("src/mipmap.c", &cflags);
+    bench_jobs.addCSourceFile("src/upload_ring.c", &cflags);
+    bench_jobs.addCSourceFile("src/block_compress.c", &cflags);
+    b.installArtifact(bench_jobs);
+
+    const bench_jobs_cmd = b.addRunArtifact(bench_jobs);
+    if (b.args) |args| {
+        bench_jobs_cmd.addArgs(args);
+    }
+    const bench_jobs_step = b.step("bench-jobs", "Run the job system scaling benchmark");
+    bench_jobs_step.dependOn(&bench_jobs_cmd.step);
+
+    // Microbenchmarks. `zig build bench -- --json results.json` writes the
+    // samples and their summary; `--baseline old.json` compares against an
+    // earlier run. It runs from the install directory next to the demo's
+    // images and shaders, and times the demo's own headless frame loop.
+    const bench = b.addExecutable(.{
+        .name = "bench",
+        .target = target,
+        .optimize = optimize,
+    });
+    bench.linkLibC();
+    bench.addLibraryPath("include");
+    bench.linkSystemLibrary("wgpu_native");
+    bench.addIncludePath("include");
+    bench.addIncludePath("src");
+    bench.addCSourceFile("src/bench.c", &cflags);
+    bench.addCSourceFile("src/framework.c", &cflags);
+    bench.addCSourceFile("src/threading.c", &cflags);
+    bench.addCSourceFile("src/pixel_convert.c", &cflags);
+    bench.addCSourceFile("src/mipmap.c", &cflags);
+    bench.addCSourceFile("src/upload_ring.c", &cflags);
+    bench.addCSourceFile("src/block_compress.c", &cflags);
+    b.installArtifact(bench);
+
+    const bench_cmd = b.addRunArtifact(bench);
+    bench_cmd.step.dependOn(b.getInstallStep());
+    bench_cmd.cwd = b.getInstallPath(.bin, "");
+    bench_cmd.addArg("--app");
+    bench_cmd.addArtifactArg(exe);
+    if (b.args) |args| {
+        bench_cmd.addArgs(args);
+    }
+    const bench_step = b.step("bench", "Run the microbenchmarks");
+    bench_step.dependOn(&bench_cmd.step);
+
+    // Trace replay. `zig build replay -- trace.fcap --loops 20` re-issues a
+    // trace recorded with --capture on a headless device and times it.
+    const replay = b.addExecutable(.{
+        .name = "replay",
+        .target = target,
+        .optimize = optimize,
+    });
+    replay.linkLibC();
+    replay.addLibraryPath("include");
+    replay.linkSystemLibrary("wgpu_native");
+    replay.addIncludePath("include");
+    replay.addIncludePath("src");
+    replay.addCSourceFile("src/replay.c", &cflags);
+    replay.addCSourceFile("src/framework.c", &cflags);
+    replay.addCSourceFile("src/threading.c", &cflags);
+    replay.addCSourceFile("src/pixel_convert.c", &cflags);
+    replay.addCSourceFile("src/mipmap.c", &cflags);
+    replay.addCSourceFile("src/upload_ring.c", &cflags);
+    replay.addCSourceFile("src/block_compress.c", &cflags);
+    b.installArtifact(replay);
+
+    const replay_cmd = b.addRunArtifact(replay);
+    if (b.args) |args| {
+        replay_cmd.addArgs(args);
+    }
+    const replay_step = b.step("replay", "Replay a captured trace on a headless device");
+    replay_step.dependOn(&replay_cmd.step);
 }
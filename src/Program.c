@@ -1,16 +1,83 @@
+// The window system surfaces are created for. Linux uses X11 unless built with
+// `zig build -Dwayland=true`. Builds with `-Dheadless-only=true` have no
+// surface at all and need none of the native window headers.
+#if defined(FRMWRK_HEADLESS_ONLY)
+#elif defined(_WIN32)
+#define WGPU_TARGET_WINDOWS 1
 #define GLFW_EXPOSE_NATIVE_WIN32
+#elif defined(__APPLE__)
+#define WGPU_TARGET_MACOS 1
+#define GLFW_EXPOSE_NATIVE_COCOA
+#elif defined(__linux__) && defined(FRMWRK_WAYLAND)
+#define WGPU_TARGET_LINUX_WAYLAND 1
+#define GLFW_EXPOSE_NATIVE_WAYLAND
+#elif defined(__linux__)
+#define WGPU_TARGET_LINUX_X11 1
+#define GLFW_EXPOSE_NATIVE_X11
+#else
+#error "Unsupported WGPU_TARGET"
+#endif
 
 #include "assert.h"
 #include "stdio.h"
+#include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "GLFW/glfw3.h"
+#if !defined(FRMWRK_HEADLESS_ONLY)
 #include "GLFW/glfw3native.h"
+#endif
+#if defined(WGPU_TARGET_MACOS)
+#include <QuartzCore/CAMetalLayer.h>
+#endif
 #include "webgpu-headers/webgpu.h"
 #include "wgpu.h"
 #include "framework.h"
+#include "async_logger.h"
+#include "atlas.h"
+#include "block_compress.h"
+#include "buffer_arena.h"
+#include "capture.h"
+#include "headless.h"
+#include "job_system.h"
+#include "frame_profiler.h"
+#include "gpu_profiler.h"
+#include "mipmap.h"
+#include "object_cache.h"
+#include "render_bundle.h"
+#include "resource_telemetry.h"
+#include "resources.h"
+#include "shader_reloader.h"
+#include "sprite_batch.h"
+#include "texture_table.h"
+#include "texture_loader.h"
+#include "uniform_ring.h"
+#include "upload_ring.h"
 
 #define LOG_PREFIX "[triangle]"
-#define WGPU_TARGET_WINDOWS 1
+// Decoded texture bytes uploaded per frame by the texture loader.
+#define TEXTURE_UPLOAD_BUDGET_BYTES (4u << 20)
+#define UPLOAD_RING_PAGE_SIZE (8u << 20)
+// Texels repeated around each image packed by --atlas.
+#define ATLAS_GUTTER 2
+// Sprites each fill job writes.
+#define SPRITE_FILL_CHUNK 4096
+// Copies, then the main pass, submitted together.
+#define FRAME_COMMAND_BUFFERS 2
+// Per-draw data each frame can allocate from the uniform ring.
+#define UNIFORM_RING_SEGMENT_SIZE (64u << 10)
+// Frames the sprites take to fade in, driven through the per-draw tint.
+#define FADE_IN_FRAMES 30
+// Backing block size of the vertex, index and storage arena.
+#define BUFFER_ARENA_BLOCK_SIZE (4u << 20)
+
+typedef struct FrameJobs FrameJobs;
+
+typedef struct SpriteFillJob {
+  FrameJobs *frame;
+  uint32_t begin;
+  uint32_t end;
+} SpriteFillJob;
 
 struct demo {
   WGPUInstance instance;
@@ -20,19 +87,91 @@ struct demo {
   WGPUSwapChainDescriptor config;
   WGPUSwapChain swapchain;
 
-  WGPUBindGroup bindGroup;
-  WGPUBindGroupLayout bindGroupLayout;
-  Texture2D tbh;
-  Texture2D tbhSlime;
+  ResourceRegistry *resources;
+  ObjectCache *objectCache;
+  ShaderReloader *shaderReloader;
+  // Variant of shaderPath the current pipeline was built from.
+  uint32_t shader;
+  TextureTable *textureTable;
+  uint32_t tbhSlot;
+  uint32_t tbhSlimeSlot;
+  // Rectangles of the slots' views the sprites sample, which only differ from
+  // the whole view for images packed into the atlas.
+  float tbhUv[4];
+  float tbhSlimeUv[4];
+  UploadRing *uploadRing;
+  MipmapGenerator *mipmapGenerator;
+  TextureLoader *textureLoader;
+  TextureHandle tbh;
+  TextureHandle tbhSlime;
+  const char *tbhSlimePath;
+  // --atlas PAGE packs decoded images that fit a PAGE x PAGE layer into one
+  // array texture. Off by default: packed images are sampled without mips.
+  Atlas *atlas;
+  uint32_t atlasPageSize;
+  // --texture-budget in MiB, 0 for no limit; textures not drawn in a frame
+  // may be evicted to stay under it
+  uint32_t textureBudgetMiB;
+  // Index and sprite stream ranges; D defragments it between frames
+  BufferArena *bufferArena;
+  bool defragRequested;
+  SpriteBatch *spriteBatch;
+  uint32_t spriteCount;
+  // The sprite pass's commands, re-recorded only when their inputs change.
+  // One per uniform ring segment, since each bakes in its dynamic offset.
+  StaticBundle *spriteBundles[UNIFORM_RING_FRAMES];
+  // Fills, stages and records each frame; --threads sets its size
+  JobSystem *jobs;
+  uint32_t threadCount;
+  SpriteFillJob *spriteFillJobs;
+  uint32_t spriteFillJobCount;
 
   //WGPUTexture wgpuTexture;
   //WGPUTextureView wgpuTextureView;
   WGPUSampler sampler;
-  WGPUBuffer indexBuffer;
-  WGPUBuffer uniformBuffer;
+  // Per-draw uniforms, bound at group 2 with dynamic offsets
+  UniformRing *uniformRing;
 
+  // Which image the first slot shows; W toggles it.
   int currentTexture;
-  WGPUTextureView *textureViews;
+
+  // --headless renders into an offscreen texture instead of a window
+  bool headless;
+  const char *shaderPath;
+  // --hot-reload recompiles shaderPath whenever it or an include changes
+  bool hotReload;
+  // --alpha-test builds the shader variant that discards transparent texels
+  bool alphaTest;
+  // --compress picks the block format the loader encodes images into, when
+  // the adapter can sample BC textures. Off by default: encoding is lossy, and
+  // uncompressed output stays bit-exact for --headless --output comparisons.
+  bool compress;
+  BlockFormat blockFormat;
+  // --no-bundles encodes the sprite pass directly every frame
+  bool noBundles;
+  uint32_t headlessFrames;
+  const char *headlessOutput;
+  HeadlessTarget offscreen;
+
+  FrameProfiler *profiler;
+  GpuProfiler *gpuProfiler;
+  const char *profileOutput;
+  // Samples wgpu's object counts every --telemetry-interval frames and
+  // writes them to --telemetry FILE.json at exit
+  ResourceTelemetry *telemetry;
+  uint32_t telemetryInterval;
+  const char *telemetryOutput;
+  // wgpu's log messages go through a flush thread unless --sync-log; the
+  // level comes from --log-level and --log-binary adds a FILE.flog copy
+  AsyncLogger *logger;
+  WGPULogLevel logLevel;
+  bool syncLog;
+  uint32_t logRateLimit;
+  const char *logBinaryOutput;
+  // --capture FILE.fcap records every frame's wgpu calls for the replay tool,
+  // in builds made with -Dcapture=true
+  Capture *capture;
+  const char *captureOutput;
 };
 
 static void handle_request_adapter(WGPURequestAdapterStatus status,
@@ -67,35 +206,81 @@ static void handle_uncaptured_error(WGPUErrorType type, char const *message,
   UNUSED(userdata)
   printf(LOG_PREFIX " uncaptured_error type=%#.8x message=%s\n", type, message);
 }
+// Points the slots at whatever the loader currently has, placeholders
+// included. The table only rebuilds its bind group if a view changed.
+static void update_texture_slots(struct demo *demo) {
+  TextureHandle first =
+      demo->currentTexture == 0 ? demo->tbh : demo->tbhSlime;
+  frmwrk_texture_table_set(
+      demo->textureTable, demo->tbhSlot,
+      frmwrk_texture_loader_view(demo->textureLoader, first));
+  frmwrk_texture_table_set(
+      demo->textureTable, demo->tbhSlimeSlot,
+      frmwrk_texture_loader_view(demo->textureLoader, demo->tbhSlime));
+  frmwrk_texture_loader_uv_rect(demo->textureLoader, first, demo->tbhUv);
+  frmwrk_texture_loader_uv_rect(demo->textureLoader, demo->tbhSlime,
+                                demo->tbhSlimeUv);
+}
+
 static void handle_glfw_key(GLFWwindow *window, int key, int scancode,
                             int action, int mods) {
   UNUSED(scancode)
   UNUSED(mods)
   if (key == GLFW_KEY_W && action == GLFW_PRESS) {
     struct demo *demo = glfwGetWindowUserPointer(window);
-    if (!demo || !demo->instance)
+    if (!demo || !demo->textureTable)
       return;
-    
-    if (demo->currentTexture == 0)
-    {
-      demo->textureViews[0] = demo->tbhSlime.view;
-      demo->currentTexture = 1;
-    }
-    else
-    {
-      demo->textureViews[0] = demo->tbh.view;
-      demo->currentTexture = 0;
-    }
+
+    demo->currentTexture = !demo->currentTexture;
+    update_texture_slots(demo);
     printf("Switching texture\n");
   }
+  if (key == GLFW_KEY_U && action == GLFW_PRESS) {
+    struct demo *demo = glfwGetWindowUserPointer(window);
+    if (!demo || !demo->textureLoader)
+      return;
+
+    // Streams the slime texture out and back in; the old one is dropped once
+    // the frames still sampling it have retired.
+    TextureLoadState state =
+        frmwrk_texture_loader_state(demo->textureLoader, demo->tbhSlime);
+    if (state == TextureLoadState_Ready || state == TextureLoadState_Evicted) {
+      frmwrk_texture_loader_unload(demo->textureLoader, demo->tbhSlime);
+      printf("Unloading %s\n", demo->tbhSlimePath);
+    } else if (state == TextureLoadState_Unloaded &&
+               frmwrk_texture_loader_reload(demo->textureLoader,
+                                            demo->tbhSlime)) {
+      printf("Reloading %s\n", demo->tbhSlimePath);
+    }
+    update_texture_slots(demo);
+  }
   if (key == GLFW_KEY_R && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
     struct demo *demo = glfwGetWindowUserPointer(window);
-    if (!demo || !demo->instance)
+    if (!demo || !demo->telemetry)
       return;
 
-    WGPUGlobalReport report;
-    wgpuGenerateReport(demo->instance, &report);
-    frmwrk_print_global_report(report);
+    // Keyed by the frames profiled so far, the frame the key press lands in.
+    frmwrk_resource_telemetry_sample(
+        demo->telemetry, demo->profiler ? demo->profiler->frameCount : 0);
+    frmwrk_resource_telemetry_print(demo->telemetry);
+  }
+  if (key == GLFW_KEY_D && action == GLFW_PRESS) {
+    struct demo *demo = glfwGetWindowUserPointer(window);
+    if (!demo || !demo->bufferArena)
+      return;
+
+    // Runs at the start of the next frame, before anything is staged into
+    // the arena's ranges.
+    demo->defragRequested = true;
+  }
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    struct demo *demo = glfwGetWindowUserPointer(window);
+    if (!demo || !demo->profiler)
+      return;
+
+    frmwrk_frame_profiler_print_summary(demo->profiler);
+    if (demo->gpuProfiler)
+      frmwrk_gpu_profiler_print(demo->gpuProfiler);
   }
 }
 static void handle_glfw_framebuffer_size(GLFWwindow *window, int width,
@@ -118,136 +303,584 @@ static void handle_glfw_framebuffer_size(GLFWwindow *window, int width,
   assert(demo->swapchain);
 }
 
+static bool create_pipeline(struct demo *demo,
+                            WGPUPipelineLayout *pipeline_layout,
+                            WGPURenderPipeline *render_pipeline) {
+  // The binding array is sized to the table, so a grown table selects (and on
+  // first use compiles) another variant.
+  char table_size[16];
+  snprintf(table_size, sizeof(table_size), "%u", demo->textureTable->capacity);
+  ShaderDefine defines[] = {
+    {.name = "TEXTURE_TABLE_SIZE", .value = table_size},
+    {.name = "ALPHA_TEST", .value = demo->alphaTest ? "1" : "0"}
+  };
+  demo->shader = frmwrk_shader_reloader_variant(
+      demo->shaderReloader, demo->shaderPath, defines,
+      sizeof(defines) / sizeof(defines[0]));
+  if (demo->shader == SHADER_RELOADER_INVALID)
+    return false;
+  WGPUShaderModule shader_module =
+      frmwrk_shader_reloader_module(demo->shaderReloader, demo->shader);
+
+  WGPUBlendState blendState = (WGPUBlendState){
+    .color = (WGPUBlendComponent){
+      .srcFactor = WGPUBlendFactor_SrcAlpha,
+      .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+      .operation = WGPUBlendOperation_Add
+    },
+    .alpha = (WGPUBlendComponent){
+      .srcFactor = WGPUBlendFactor_SrcAlpha,
+      .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
+      .operation = WGPUBlendOperation_Add
+    }
+  };
+
+  // Group 0 holds the texture table, group 1 the sprite streams and group 2
+  // the per-draw parameters.
+  WGPUBindGroupLayout bindGroupLayouts[] = {
+    demo->textureTable->bindGroupLayout,
+    demo->spriteBatch->bindGroupLayout,
+    demo->uniformRing->bindGroupLayout
+  };
+  *pipeline_layout = frmwrk_object_cache_pipeline_layout(
+      demo->objectCache, &(const WGPUPipelineLayoutDescriptor){
+                        .label = "pipeline_layout",
+                        .bindGroupLayoutCount = 3,
+                        .bindGroupLayouts = bindGroupLayouts
+                    });
+  if (!*pipeline_layout)
+    return false;
+
+  *render_pipeline = frmwrk_object_cache_render_pipeline(
+      demo->objectCache, &(const WGPURenderPipelineDescriptor){
+                        .label = "render_pipeline",
+                        .layout = *pipeline_layout,
+                        .vertex =
+                            (const WGPUVertexState){
+                                .module = shader_module,
+                                .entryPoint = "vs_main",
+                            },
+                        .fragment =
+                            &(const WGPUFragmentState){
+                                .module = shader_module,
+                                .entryPoint = "fs_main",
+                                .targetCount = 1,
+                                .targets =
+                                    (const WGPUColorTargetState[]){
+                                        (const WGPUColorTargetState){
+                                            .format = demo->config.format,
+                                            .blend = &blendState,
+                                            .writeMask = WGPUColorWriteMask_All,
+                                        },
+                                    },
+                            },
+                        .primitive =
+                            (const WGPUPrimitiveState){
+                                .topology = WGPUPrimitiveTopology_TriangleList,
+                            },
+                        .multisample =
+                            (const WGPUMultisampleState){
+                                .count = 1,
+                                .mask = 0xFFFFFFFF,
+                            },
+                    });
+  return *render_pipeline != NULL;
+}
+
+// Matches DrawParams in shader.wgsl.
+typedef struct DrawParams {
+  float tint[4];
+} DrawParams;
+
+// What the sprite pass binds, passed to record_sprite_pass.
+typedef struct SpritePassInputs {
+  WGPURenderPipeline pipeline;
+  WGPUBindGroup tableBindGroup;
+  SpriteBatch *batch;
+  WGPUBindGroup drawBindGroup;
+  uint32_t drawOffset;
+} SpritePassInputs;
+
+static void record_sprite_pass(WGPURenderBundleEncoder encoder,
+                               void *userdata) {
+  const SpritePassInputs *inputs = userdata;
+  wgpuRenderBundleEncoderSetPipeline(encoder, inputs->pipeline);
+  wgpuRenderBundleEncoderSetBindGroup(encoder, 0, inputs->tableBindGroup, 0,
+                                      NULL);
+  wgpuRenderBundleEncoderSetBindGroup(encoder, 2, inputs->drawBindGroup, 1,
+                                      &inputs->drawOffset);
+  frmwrk_sprite_batch_record(inputs->batch, encoder, 1);
+}
+
+// Everything that changes the recorded commands, apart from the pipeline,
+// which invalidates the bundle when it is replaced. Sprite positions live in
+// buffers and do not count, nor does the draw parameters' content.
+static uint64_t sprite_pass_key(const struct demo *demo, uint32_t drawOffset) {
+  const uint32_t inputs[] = {
+    demo->textureTable->rebuilds,
+    demo->spriteBatch->bindGroupGeneration,
+    demo->spriteBatch->uploadedCount,
+    drawOffset
+  };
+  return frmwrk_hash_bytes(inputs, sizeof(inputs), FRMWRK_HASH_SEED);
+}
+
+// State the frame's jobs share. Each job writes only its own fields, and
+// readers wait on the counter of the job that wrote them.
+struct FrameJobs {
+  struct demo *demo;
+  uint32_t frame;
+  uint32_t firstSprite;
+  WGPURenderPipeline pipeline;
+  WGPUTextureView target;
+  // The frame's DrawParams in the uniform ring.
+  uint32_t drawOffset;
+  bool staged;
+  // NULL where recording failed.
+  WGPUCommandBuffer commandBuffers[FRAME_COMMAND_BUFFERS];
+  JobCounter filledCounter;
+  JobCounter stagedCounter;
+  JobCounter recordedCounter;
+};
+
+// Empties the batch and reserves the frame's sprites for the fill jobs.
+// Returns the first one, or UINT32_MAX on failure.
+static uint32_t begin_sprites(struct demo *demo) {
+  frmwrk_sprite_batch_begin(demo->spriteBatch, demo->config.width,
+                            demo->config.height);
+  if (demo->spriteCount == 0)
+    return 0;
+  return frmwrk_sprite_batch_alloc(demo->spriteBatch, demo->spriteCount);
+}
+
+// Lays sprites [begin, end) out on a grid over the target, alternating the
+// two textures and spinning them a little each frame.
+static void fill_sprites(struct demo *demo, uint32_t frame, uint32_t first,
+                         uint32_t begin, uint32_t end) {
+  SpriteBatch *batch = demo->spriteBatch;
+  float width = (float)demo->config.width;
+  float height = (float)demo->config.height;
+  uint32_t count = demo->spriteCount;
+
+  uint32_t columns = (uint32_t)ceilf(sqrtf(count * width / height));
+  uint32_t rows = (count + columns - 1) / columns;
+  float cell_w = width / columns;
+  float cell_h = height / rows;
+  float size = fminf(cell_w, cell_h) * 0.9f;
+
+  // Filled stream by stream, which is what the SoA layout is for.
+  for (uint32_t i = begin; i < end; i++) {
+    float *transform = &batch->transforms[(first + i) * 4];
+    transform[0] = ((i % columns) + 0.5f) * cell_w;
+    transform[1] = ((i / columns) + 0.5f) * cell_h;
+    transform[2] = size;
+    transform[3] = size;
+  }
+  for (uint32_t i = begin; i < end; i++)
+    batch->rotations[first + i] = (frame + i * 16) * 0.01f;
+  for (uint32_t i = begin; i < end; i++)
+    memcpy(&batch->uvRects[(first + i) * 4],
+           i % 2 ? demo->tbhSlimeUv : demo->tbhUv, sizeof(float) * 4);
+  for (uint32_t i = begin; i < end; i++) {
+    batch->textureIndices[first + i] =
+        i % 2 ? demo->tbhSlimeSlot : demo->tbhSlot;
+    batch->tints[first + i] = SPRITE_TINT_WHITE;
+  }
+}
+
+static void fill_sprites_job(void *userdata) {
+  SpriteFillJob *job = userdata;
+  FrameJobs *frame = job->frame;
+  fill_sprites(frame->demo, frame->frame, frame->firstSprite, job->begin,
+               job->end);
+}
+
+// Staged ahead of both recording jobs so the ring records the copies.
+static void stage_sprites_job(void *userdata) {
+  FrameJobs *frame = userdata;
+  frame->staged = frmwrk_sprite_batch_upload(frame->demo->spriteBatch);
+}
+
+// Staged uploads and queued mip chains, submitted ahead of the main pass so
+// it already sees them.
+static void record_copies_job(void *userdata) {
+  FrameJobs *frame = userdata;
+  struct demo *demo = frame->demo;
+  if (!frame->staged)
+    return;
+
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
+      demo->device, &(const WGPUCommandEncoderDescriptor){
+                        .label = "copy_encoder",
+                    });
+  if (!encoder)
+    return;
+  // Defragmentation copies go first; the staged uploads target the ranges
+  // allocations were moved to.
+  frmwrk_buffer_arena_record(demo->bufferArena, encoder);
+  frmwrk_upload_ring_record(demo->uploadRing, encoder);
+  if (demo->mipmapGenerator)
+    frmwrk_mipmap_generator_record(demo->mipmapGenerator, encoder);
+  frame->commandBuffers[0] = wgpuCommandEncoderFinish(
+      encoder, &(const WGPUCommandBufferDescriptor){
+                   .label = "copy_command_buffer",
+               });
+  // wgpuCommandEncoderFinish() drops encoder
+}
+
+static void record_main_pass_job(void *userdata) {
+  FrameJobs *frame = userdata;
+  struct demo *demo = frame->demo;
+  if (!frame->staged)
+    return;
+
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
+      demo->device, &(const WGPUCommandEncoderDescriptor){
+                        .label = "command_encoder",
+                    });
+  if (!encoder)
+    return;
+  uint32_t main_pass =
+      frmwrk_gpu_profiler_begin_pass(demo->gpuProfiler, encoder, "main_pass");
+  WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(
+      encoder, &(const WGPURenderPassDescriptor){
+                   .label = "render_pass_encoder",
+                   .colorAttachmentCount = 1,
+                   .colorAttachments =
+                       (const WGPURenderPassColorAttachment[]){
+                           (const WGPURenderPassColorAttachment){
+                               .view = frame->target,
+                               .loadOp = WGPULoadOp_Clear,
+                               .storeOp = WGPUStoreOp_Store,
+                               .clearValue =
+                                   (const WGPUColor){
+                                       .r = 0.0,
+                                       .g = 0.0,
+                                       .b = 0.0,
+                                       .a = 1.0,
+                                   },
+                           },
+                       },
+               });
+  if (!pass) {
+    wgpuCommandEncoderDrop(encoder);
+    return;
+  }
+
+  // Fetched first: a rebuild bumps the table's count the key reads.
+  WGPUBindGroup table_bind_group =
+      frmwrk_texture_table_bind_group(demo->textureTable);
+  bool bundled = false;
+  StaticBundle *bundle = demo->spriteBundles[demo->uniformRing->current];
+  if (bundle) {
+    SpritePassInputs inputs = {frame->pipeline, table_bind_group,
+                               demo->spriteBatch, demo->uniformRing->bindGroup,
+                               frame->drawOffset};
+    bundled = frmwrk_static_bundle_execute(
+        bundle, pass, sprite_pass_key(demo, frame->drawOffset),
+        record_sprite_pass, &inputs);
+  }
+  if (!bundled) {
+    wgpuRenderPassEncoderSetPipeline(pass, frame->pipeline);
+    wgpuRenderPassEncoderSetBindGroup(pass, 0, table_bind_group, 0, NULL);
+    wgpuRenderPassEncoderSetBindGroup(pass, 2, demo->uniformRing->bindGroup, 1,
+                                      &frame->drawOffset);
+    frmwrk_sprite_batch_draw(demo->spriteBatch, pass, 1);
+  }
+  wgpuRenderPassEncoderEnd(pass);
+  // wgpuRenderPassEncoderEnd() drops pass
+  frmwrk_gpu_profiler_end_pass(demo->gpuProfiler, encoder, main_pass);
+  frmwrk_gpu_profiler_resolve(demo->gpuProfiler, encoder);
+
+  frame->commandBuffers[1] = wgpuCommandEncoderFinish(
+      encoder, &(const WGPUCommandBufferDescriptor){
+                   .label = "command_buffer",
+               });
+  // wgpuCommandEncoderFinish() drops encoder
+}
+
+// Prefers the container `zig build cook` writes, which is mapped and uploaded
+// without decoding, over the source image.
+static const char *texture_path(const char *cooked, const char *source) {
+  FILE *file = fopen(cooked, "rb");
+  if (!file)
+    return source;
+  fclose(file);
+  return cooked;
+}
+
+static void print_usage(const char *program) {
+  printf("usage: %s [--headless] [--size WIDTHxHEIGHT] [--frames N] "
+         "[--output FILE.ppm] [--profile FILE.csv|FILE.json] "
+         "[--sprites N] [--shader FILE.wgsl] [--hot-reload] "
+         "[--alpha-test] [--compress bc1|bc3|bc7|none] [--no-bundles] "
+         "[--threads N] [--telemetry FILE.json] [--telemetry-interval N] "
+         "[--log-level error|warn|info|debug|trace] [--log-binary FILE.flog] "
+         "[--log-rate N] [--sync-log] [--texture-budget MIB] "
+         "[--capture FILE.fcap] [--atlas PAGE]\n",
+         program);
+}
+
+static bool parse_args(struct demo *demo, int argc, char *argv[]) {
+  demo->config.width = 640;
+  demo->config.height = 480;
+  demo->headlessFrames = 600;
+  demo->spriteCount = 2;
+  demo->shaderPath = "shader.wgsl";
+  demo->blockFormat = BlockFormat_BC7;
+  demo->logLevel = WGPULogLevel_Warn;
+#if defined(FRMWRK_HEADLESS_ONLY)
+  // Built without a window surface, so --headless is implied.
+  demo->headless = true;
+#endif
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if (strcmp(arg, "--headless") == 0) {
+      demo->headless = true;
+    } else if (strcmp(arg, "--size") == 0 && value) {
+      if (sscanf(value, "%ux%u", &demo->config.width, &demo->config.height) !=
+              2 ||
+          demo->config.width == 0 || demo->config.height == 0) {
+        printf(LOG_PREFIX " invalid --size '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--frames") == 0 && value) {
+      demo->headlessFrames = (uint32_t)strtoul(value, NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--output") == 0 && value) {
+      demo->headlessOutput = value;
+      i++;
+    } else if (strcmp(arg, "--profile") == 0 && value) {
+      demo->profileOutput = value;
+      i++;
+    } else if (strcmp(arg, "--sprites") == 0 && value) {
+      demo->spriteCount = (uint32_t)strtoul(value, NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--shader") == 0 && value) {
+      demo->shaderPath = value;
+      i++;
+    } else if (strcmp(arg, "--hot-reload") == 0) {
+      demo->hotReload = true;
+    } else if (strcmp(arg, "--alpha-test") == 0) {
+      demo->alphaTest = true;
+    } else if (strcmp(arg, "--telemetry") == 0 && value) {
+      demo->telemetryOutput = value;
+      i++;
+    } else if (strcmp(arg, "--telemetry-interval") == 0 && value) {
+      demo->telemetryInterval = (uint32_t)strtoul(value, NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--threads") == 0 && value) {
+      demo->threadCount = (uint32_t)strtoul(value, NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--log-level") == 0 && value) {
+      static const WGPULogLevel levels[] = {
+          WGPULogLevel_Error, WGPULogLevel_Warn, WGPULogLevel_Info,
+          WGPULogLevel_Debug, WGPULogLevel_Trace};
+      bool found = false;
+      for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++) {
+        if (strcmp(value, frmwrk_log_level_name(levels[l])) == 0) {
+          demo->logLevel = levels[l];
+          found = true;
+        }
+      }
+      if (!found) {
+        printf(LOG_PREFIX " unknown --log-level '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--log-binary") == 0 && value) {
+      demo->logBinaryOutput = value;
+      i++;
+    } else if (strcmp(arg, "--log-rate") == 0 && value) {
+      demo->logRateLimit = (uint32_t)strtoul(value, NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--sync-log") == 0) {
+      demo->syncLog = true;
+    } else if (strcmp(arg, "--texture-budget") == 0 && value) {
+      demo->textureBudgetMiB = (uint32_t)strtoul(value, NULL, 10);
+      i++;
+    } else if (strcmp(arg, "--capture") == 0 && value) {
+      demo->captureOutput = value;
+      i++;
+    } else if (strcmp(arg, "--atlas") == 0 && value) {
+      demo->atlasPageSize = (uint32_t)strtoul(value, NULL, 10);
+      if (demo->atlasPageSize <= ATLAS_GUTTER * 2) {
+        printf(LOG_PREFIX " invalid --atlas '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--no-bundles") == 0) {
+      demo->noBundles = true;
+    } else if (strcmp(arg, "--compress") == 0 && value) {
+      demo->compress = true;
+      if (strcmp(value, "bc1") == 0) {
+        demo->blockFormat = BlockFormat_BC1;
+      } else if (strcmp(value, "bc3") == 0) {
+        demo->blockFormat = BlockFormat_BC3;
+      } else if (strcmp(value, "bc7") == 0) {
+        demo->blockFormat = BlockFormat_BC7;
+      } else if (strcmp(value, "none") == 0) {
+        demo->compress = false;
+      } else {
+        printf(LOG_PREFIX " unknown --compress format '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strncmp(arg, "--", 2) == 0) {
+      printf(LOG_PREFIX " unknown option '%s'\n", arg);
+      print_usage(argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
 int main(int argc, char *argv[]) {
-  UNUSED(argc)
-  UNUSED(argv)
   struct demo demo = {0};
   GLFWwindow *window = NULL;
   WGPUQueue queue = NULL;
-  WGPUShaderModule shader_module = NULL;
   WGPUPipelineLayout pipeline_layout = NULL;
   WGPURenderPipeline render_pipeline = NULL;
+  uint32_t pipeline_generation = 0;
   WGPUTextureView next_texture = NULL;
-  WGPUCommandEncoder command_encoder = NULL;
-  WGPURenderPassEncoder render_pass_encoder = NULL;
-  WGPUCommandBuffer command_buffer = NULL;
+  FrameJobs frame_jobs = {0};
+  uint32_t frame = 0;
   int ret = EXIT_SUCCESS;
 
 #define ASSERT_CHECK(expr)                                                     \
   do {                                                                         \
     if (!(expr)) {                                                             \
-      int ret = EXIT_SUCCESS;                                                  \
+      ret = EXIT_FAILURE;                                                      \
       printf(LOG_PREFIX " assert failed %s: %s:%d\n", #expr, __FILE__,         \
              __LINE__);                                                        \
       goto cleanup_and_exit;                                                   \
     }                                                                          \
   } while (0)
 
-  frmwrk_setup_logging(WGPULogLevel_Warn);
-
-#if defined(WGPU_TARGET_LINUX_WAYLAND)
-  glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
-#endif
+  if (!parse_args(&demo, argc, argv))
+    return EXIT_FAILURE;
 
-  ASSERT_CHECK(glfwInit());
+  if (demo.syncLog) {
+    frmwrk_setup_logging(demo.logLevel);
+  } else {
+    demo.logger = frmwrk_create_async_logger(stderr, demo.logBinaryOutput,
+                                             demo.logRateLimit);
+    ASSERT_CHECK(demo.logger);
+    frmwrk_async_logger_attach_wgpu(demo.logger, demo.logLevel);
+  }
 
   demo.instance = wgpuCreateInstance(&(const WGPUInstanceDescriptor){0});
   ASSERT_CHECK(demo.instance);
+  demo.telemetry =
+      frmwrk_create_resource_telemetry(demo.instance, demo.telemetryInterval);
+  ASSERT_CHECK(demo.telemetry);
+
+#if !defined(FRMWRK_HEADLESS_ONLY)
+  if (!demo.headless) {
+#if defined(WGPU_TARGET_LINUX_WAYLAND)
+    glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_WAYLAND);
+#endif
+
+    ASSERT_CHECK(glfwInit());
 
-  glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-  window =
-      glfwCreateWindow(640, 480, "triangle [wgpu-native + glfw]", NULL, NULL);
-  ASSERT_CHECK(window);
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    window = glfwCreateWindow(demo.config.width, demo.config.height,
+                              "triangle [wgpu-native + glfw]", NULL, NULL);
+    ASSERT_CHECK(window);
 
-  glfwSetWindowUserPointer(window, (void *)&demo);
-  glfwSetKeyCallback(window, handle_glfw_key);
-  glfwSetFramebufferSizeCallback(window, handle_glfw_framebuffer_size);
+    glfwSetWindowUserPointer(window, (void *)&demo);
+    glfwSetKeyCallback(window, handle_glfw_key);
+    glfwSetFramebufferSizeCallback(window, handle_glfw_framebuffer_size);
 
 #if defined(WGPU_TARGET_MACOS)
-  {
-    id metal_layer = NULL;
-    NSWindow *ns_window = glfwGetCocoaWindow(window);
-    [ns_window.contentView setWantsLayer:YES];
-    metal_layer = [CAMetalLayer layer];
-    [ns_window.contentView setLayer:metal_layer];
-    demo.surface = wgpuInstanceCreateSurface(
-        demo.instance,
-        &(const WGPUSurfaceDescriptor){
-            .nextInChain =
-                (const WGPUChainedStruct *)&(
-                    const WGPUSurfaceDescriptorFromMetalLayer){
-                    .chain =
-                        (const WGPUChainedStruct){
-                            .sType = WGPUSType_SurfaceDescriptorFromMetalLayer,
-                        },
-                    .layer = metal_layer,
-                },
-        });
-    ASSERT_CHECK(demo.surface);
-  }
+    {
+      id metal_layer = NULL;
+      NSWindow *ns_window = glfwGetCocoaWindow(window);
+      [ns_window.contentView setWantsLayer:YES];
+      metal_layer = [CAMetalLayer layer];
+      [ns_window.contentView setLayer:metal_layer];
+      demo.surface = wgpuInstanceCreateSurface(
+          demo.instance,
+          &(const WGPUSurfaceDescriptor){
+              .nextInChain =
+                  (const WGPUChainedStruct *)&(
+                      const WGPUSurfaceDescriptorFromMetalLayer){
+                      .chain =
+                          (const WGPUChainedStruct){
+                              .sType = WGPUSType_SurfaceDescriptorFromMetalLayer,
+                          },
+                      .layer = metal_layer,
+                  },
+          });
+      ASSERT_CHECK(demo.surface);
+    }
 #elif defined(WGPU_TARGET_LINUX_X11)
-  {
-    Display *x11_display = glfwGetX11Display();
-    Window x11_window = glfwGetX11Window(window);
-    demo.surface = wgpuInstanceCreateSurface(
-        demo.instance,
-        &(const WGPUSurfaceDescriptor){
-            .nextInChain =
-                (const WGPUChainedStruct *)&(
-                    const WGPUSurfaceDescriptorFromXlibWindow){
-                    .chain =
-                        (const WGPUChainedStruct){
-                            .sType = WGPUSType_SurfaceDescriptorFromXlibWindow,
-                        },
-                    .display = x11_display,
-                    .window = x11_window,
-                },
-        });
-    ASSERT_CHECK(demo.surface);
-  }
+    {
+      Display *x11_display = glfwGetX11Display();
+      Window x11_window = glfwGetX11Window(window);
+      demo.surface = wgpuInstanceCreateSurface(
+          demo.instance,
+          &(const WGPUSurfaceDescriptor){
+              .nextInChain =
+                  (const WGPUChainedStruct *)&(
+                      const WGPUSurfaceDescriptorFromXlibWindow){
+                      .chain =
+                          (const WGPUChainedStruct){
+                              .sType = WGPUSType_SurfaceDescriptorFromXlibWindow,
+                          },
+                      .display = x11_display,
+                      .window = x11_window,
+                  },
+          });
+      ASSERT_CHECK(demo.surface);
+    }
 #elif defined(WGPU_TARGET_LINUX_WAYLAND)
-  {
-    struct wl_display *wayland_display = glfwGetWaylandDisplay();
-    struct wl_surface *wayland_surface = glfwGetWaylandWindow(window);
-    demo.surface = wgpuInstanceCreateSurface(
-        demo.instance,
-        &(const WGPUSurfaceDescriptor){
-            .nextInChain =
-                (const WGPUChainedStruct *)&(
-                    const WGPUSurfaceDescriptorFromWaylandSurface){
-                    .chain =
-                        (const WGPUChainedStruct){
-                            .sType =
-                                WGPUSType_SurfaceDescriptorFromWaylandSurface,
-                        },
-                    .display = wayland_display,
-                    .surface = wayland_surface,
-                },
-        });
-    ASSERT_CHECK(demo.surface);
-  }
+    {
+      struct wl_display *wayland_display = glfwGetWaylandDisplay();
+      struct wl_surface *wayland_surface = glfwGetWaylandWindow(window);
+      demo.surface = wgpuInstanceCreateSurface(
+          demo.instance,
+          &(const WGPUSurfaceDescriptor){
+              .nextInChain =
+                  (const WGPUChainedStruct *)&(
+                      const WGPUSurfaceDescriptorFromWaylandSurface){
+                      .chain =
+                          (const WGPUChainedStruct){
+                              .sType =
+                                  WGPUSType_SurfaceDescriptorFromWaylandSurface,
+                          },
+                      .display = wayland_display,
+                      .surface = wayland_surface,
+                  },
+          });
+      ASSERT_CHECK(demo.surface);
+    }
 #elif defined(WGPU_TARGET_WINDOWS)
-  {
-    HWND hwnd = glfwGetWin32Window(window);
-    HINSTANCE hinstance = GetModuleHandle(NULL);
-    demo.surface = wgpuInstanceCreateSurface(
-        demo.instance,
-        &(const WGPUSurfaceDescriptor){
-            .nextInChain =
-                (const WGPUChainedStruct *)&(
-                    const WGPUSurfaceDescriptorFromWindowsHWND){
-                    .chain =
-                        (const WGPUChainedStruct){
-                            .sType = WGPUSType_SurfaceDescriptorFromWindowsHWND
-                        },
-                    .hinstance = hinstance,
-                    .hwnd = hwnd,
-                },
-        });
-    ASSERT_CHECK(demo.surface);
+    {
+      HWND hwnd = glfwGetWin32Window(window);
+      HINSTANCE hinstance = GetModuleHandle(NULL);
+      demo.surface = wgpuInstanceCreateSurface(
+          demo.instance,
+          &(const WGPUSurfaceDescriptor){
+              .nextInChain =
+                  (const WGPUChainedStruct *)&(
+                      const WGPUSurfaceDescriptorFromWindowsHWND){
+                      .chain =
+                          (const WGPUChainedStruct){
+                              .sType = WGPUSType_SurfaceDescriptorFromWindowsHWND
+                          },
+                      .hinstance = hinstance,
+                      .hwnd = hwnd,
+                  },
+          });
+      ASSERT_CHECK(demo.surface);
+    }
+#endif
   }
-#else
-#error "Unsupported WGPU_TARGET"
 #endif
 
   wgpuInstanceRequestAdapter(demo.instance,
@@ -257,11 +890,37 @@ int main(int argc, char *argv[]) {
                              handle_request_adapter, &demo);
   ASSERT_CHECK(demo.adapter);
 
-  WGPUNativeFeature requiredFeatures[] = {WGPUNativeFeature_TextureBindingArray, WGPUNativeFeature_SampledTextureAndStorageBufferArrayNonUniformIndexing};
+  WGPUFeatureName requiredFeatures[4] = {
+    (WGPUFeatureName)WGPUNativeFeature_TextureBindingArray,
+    (WGPUFeatureName)WGPUNativeFeature_SampledTextureAndStorageBufferArrayNonUniformIndexing
+  };
+  uint32_t requiredFeaturesCount = 2;
+  // Optional: the GPU profiler falls back to CPU timing without it.
+  if (wgpuAdapterHasFeature(demo.adapter, WGPUFeatureName_TimestampQuery))
+    requiredFeatures[requiredFeaturesCount++] = WGPUFeatureName_TimestampQuery;
+  // Optional: images are uploaded as RGBA8 without it.
+  if (demo.compress) {
+    if (wgpuAdapterHasFeature(demo.adapter,
+                              WGPUFeatureName_TextureCompressionBC)) {
+      requiredFeatures[requiredFeaturesCount++] =
+          WGPUFeatureName_TextureCompressionBC;
+    } else {
+      printf(LOG_PREFIX " adapter cannot sample BC textures, loading RGBA8\n");
+      demo.compress = false;
+    }
+  }
+
+  // Ask for everything the adapter supports, chiefly so the texture table can
+  // grow to its sampled-texture limit.
+  WGPUSupportedLimits adapterLimits = {0};
+  ASSERT_CHECK(wgpuAdapterGetLimits(demo.adapter, &adapterLimits));
 
   wgpuAdapterRequestDevice(demo.adapter, &(WGPUDeviceDescriptor){
-    .requiredFeaturesCount = 2,
-    .requiredFeatures = &requiredFeatures
+    .requiredFeaturesCount = requiredFeaturesCount,
+    .requiredFeatures = requiredFeatures,
+    .requiredLimits = &(const WGPURequiredLimits){
+      .limits = adapterLimits.limits
+    }
   }, handle_request_device, &demo);
   ASSERT_CHECK(demo.device);
 
@@ -272,319 +931,419 @@ int main(int argc, char *argv[]) {
                                        NULL);
   wgpuDeviceSetDeviceLostCallback(demo.device, handle_device_lost, NULL);
 
-  shader_module = frmwrk_load_shader_module(demo.device, "shader.wgsl");
-  ASSERT_CHECK(shader_module);
+  // Started before anything else is created so the trace holds every object
+  // the frames use.
+  if (demo.captureOutput) {
+    demo.capture = frmwrk_create_capture(demo.device, demo.captureOutput);
+    ASSERT_CHECK(demo.capture);
+  }
+
+  demo.shaderReloader = frmwrk_create_shader_reloader(demo.device);
+  ASSERT_CHECK(demo.shaderReloader);
+  if (demo.hotReload)
+    ASSERT_CHECK(frmwrk_shader_reloader_start(demo.shaderReloader));
 
   #pragma region swapchain
+  // Headless runs render into an RGBA8 texture so the readback needs no swizzle.
   WGPUTextureFormat surface_preferred_format =
-      wgpuSurfaceGetPreferredFormat(demo.surface, demo.adapter);
+      demo.headless ? WGPUTextureFormat_RGBA8Unorm
+                    : wgpuSurfaceGetPreferredFormat(demo.surface, demo.adapter);
   ASSERT_CHECK(surface_preferred_format != WGPUTextureFormat_Undefined);
 
-  demo.config = (WGPUSwapChainDescriptor){
-      .usage = WGPUTextureUsage_RenderAttachment,
-      .format = surface_preferred_format,
-      .presentMode = WGPUPresentMode_Fifo,
-  };
+  demo.config.usage = WGPUTextureUsage_RenderAttachment;
+  demo.config.format = surface_preferred_format;
+  demo.config.presentMode = WGPUPresentMode_Fifo;
 
-  {
+  if (demo.headless) {
+    demo.offscreen = frmwrk_create_headless_target(
+        demo.device, demo.config.width, demo.config.height,
+        surface_preferred_format);
+    ASSERT_CHECK(demo.offscreen.texture);
+    ASSERT_CHECK(demo.offscreen.readbackBuffer);
+  } else {
     int width, height;
     glfwGetWindowSize(window, &width, &height);
     demo.config.width = width;
     demo.config.height = height;
-  }
 
-  demo.swapchain =
-      wgpuDeviceCreateSwapChain(demo.device, demo.surface, &demo.config);
-  ASSERT_CHECK(demo.swapchain);
+    demo.swapchain =
+        wgpuDeviceCreateSwapChain(demo.device, demo.surface, &demo.config);
+    ASSERT_CHECK(demo.swapchain);
+  }
   #pragma endregion
 
   #pragma region load textures
-  demo.tbh = frmwrk_load_texture2D(demo.device, "tbh.png");
-  demo.tbhSlime = frmwrk_load_texture2D(demo.device, "tbhslime.png");
+  demo.resources = frmwrk_create_resource_registry(demo.device);
+  ASSERT_CHECK(demo.resources);
+  demo.objectCache = frmwrk_create_object_cache(demo.device);
+  ASSERT_CHECK(demo.objectCache);
+
+  demo.uploadRing = frmwrk_create_upload_ring(demo.device, UPLOAD_RING_PAGE_SIZE);
+  ASSERT_CHECK(demo.uploadRing);
+
+  // Optional: without it the loader filters mip chains on its workers.
+  demo.mipmapGenerator =
+      frmwrk_create_mipmap_generator(demo.device, "mipmap.wgsl");
 
-  ASSERT_CHECK(demo.tbh.view);
-  ASSERT_CHECK(demo.tbhSlime.view);
+  demo.textureLoader = frmwrk_create_texture_loader(
+      demo.device, demo.resources, demo.uploadRing, demo.mipmapGenerator, 0);
+  ASSERT_CHECK(demo.textureLoader);
+  if (demo.compress)
+    frmwrk_texture_loader_compress(demo.textureLoader, demo.blockFormat,
+                                   BlockQuality_Normal);
+  frmwrk_texture_loader_set_residency_budget(
+      demo.textureLoader, (uint64_t)demo.textureBudgetMiB << 20);
+  if (demo.atlasPageSize) {
+    demo.atlas = frmwrk_create_atlas(demo.device, demo.uploadRing,
+                                     demo.atlasPageSize, ATLAS_GUTTER, 1);
+    ASSERT_CHECK(demo.atlas);
+    frmwrk_texture_loader_use_atlas(demo.textureLoader, demo.atlas,
+                                    demo.atlasPageSize - ATLAS_GUTTER * 2);
+  }
+
+  demo.tbh = frmwrk_texture_loader_load(demo.textureLoader,
+                                        texture_path("tbh.ftex", "tbh.png"));
+  demo.tbhSlimePath = texture_path("tbhslime.ftex", "tbhslime.png");
+  demo.tbhSlime =
+      frmwrk_texture_loader_load(demo.textureLoader, demo.tbhSlimePath);
+
+  ASSERT_CHECK(demo.tbh);
+  ASSERT_CHECK(demo.tbhSlime);
+
+  demo.bufferArena = frmwrk_create_buffer_arena(
+      demo.device, BUFFER_ARENA_BLOCK_SIZE,
+      WGPUBufferUsage_Vertex | WGPUBufferUsage_Index |
+          WGPUBufferUsage_Storage);
+  ASSERT_CHECK(demo.bufferArena);
+  demo.spriteBatch = frmwrk_create_sprite_batch(
+      demo.device, demo.uploadRing, demo.bufferArena, demo.spriteCount);
+  ASSERT_CHECK(demo.spriteBatch);
+
+  demo.jobs = frmwrk_create_job_system(demo.threadCount);
+  ASSERT_CHECK(demo.jobs);
+  demo.spriteFillJobCount =
+      (demo.spriteCount + SPRITE_FILL_CHUNK - 1) / SPRITE_FILL_CHUNK;
+  demo.spriteFillJobs = calloc(demo.spriteFillJobCount + 1,
+                               sizeof(SpriteFillJob));
+  ASSERT_CHECK(demo.spriteFillJobs);
+  for (uint32_t i = 0; i < demo.spriteFillJobCount; i++) {
+    uint32_t begin = i * SPRITE_FILL_CHUNK;
+    uint32_t end = begin + SPRITE_FILL_CHUNK;
+    demo.spriteFillJobs[i] = (SpriteFillJob){
+      .frame = &frame_jobs,
+      .begin = begin,
+      .end = end < demo.spriteCount ? end : demo.spriteCount
+    };
+  }
 #pragma endregion
 
 #pragma region create sampler
   {
     WGPUSamplerDescriptor samplerDescriptor = (WGPUSamplerDescriptor){
       .compare = WGPUCompareFunction_Undefined,
-      .mipmapFilter = WGPUMipmapFilterMode_Nearest,
-      .minFilter = WGPUFilterMode_Nearest,
+      .mipmapFilter = WGPUMipmapFilterMode_Linear,
+      .minFilter = WGPUFilterMode_Linear,
       .magFilter = WGPUFilterMode_Nearest,
       .addressModeU = WGPUAddressMode_ClampToEdge,
       .addressModeV = WGPUAddressMode_ClampToEdge,
       .addressModeW = WGPUAddressMode_ClampToEdge,
       .maxAnisotropy = 1,
       .lodMinClamp = 0.0f,
-      .lodMaxClamp = 1.0f
+      // Loaded textures carry full mip chains.
+      .lodMaxClamp = 32.0f
     };
 
-    demo.sampler = wgpuDeviceCreateSampler(demo.device, &samplerDescriptor);
+    demo.sampler =
+        frmwrk_object_cache_sampler(demo.objectCache, &samplerDescriptor);
     ASSERT_CHECK(demo.sampler);
   }
 #pragma endregion
 
 #pragma region create uniform buffer
-  // {
-  //   uint32_t uniformData = 0;
-  //   WGPUBufferDescriptor bufferDescriptor = (WGPUBufferDescriptor){
-  //     .size = sizeof(uint32_t),
-  //     .mappedAtCreation = true,
-  //     .usage = WGPUBufferUsage_CopyDst, WGPUBufferUsage_Uniform
-  //   };
-  //   demo.uniformBuffer = wgpuDeviceCreateBuffer(demo.device, &bufferDescriptor);
-  //   ASSERT_CHECK(demo.uniformBuffer);
-  //   void* mapping = wgpuBufferGetMappedRange(demo.uniformBuffer, 0, sizeof(uint32_t));
-  //   memcpy(mapping, &uniformData, sizeof(uint32_t));
-  //   wgpuBufferUnmap(demo.uniformBuffer);
-  // }
+  demo.uniformRing = frmwrk_create_uniform_ring(
+      demo.device, UNIFORM_RING_SEGMENT_SIZE, sizeof(DrawParams));
+  ASSERT_CHECK(demo.uniformRing);
 #pragma endregion
 
-#pragma region bindgroup
-  const int bindingsCount = 2;
-
-  WGPUBindGroupLayoutEntry bindGroupLayoutEntries[] = {
-    (WGPUBindGroupLayoutEntry) {
-      .binding = 0,
-      .texture = (WGPUTextureBindingLayout) {
-        .multisampled = false,
-        .sampleType = WGPUTextureSampleType_Float,
-        .viewDimension = WGPUTextureViewDimension_2D
-      },
-      .visibility = WGPUShaderStage_Fragment,
-      .count = 2
-      //.count = 1
-    },
-    (WGPUBindGroupLayoutEntry) {
-      .binding = 1,
-      .sampler = (WGPUSamplerBindingLayout) {
-        .type = WGPUSamplerBindingType_Filtering
-      },
-      .visibility = WGPUShaderStage_Fragment
-    }/*,
-    (WGPUBindGroupLayoutEntry) {
-      .binding = 2,
-      .buffer = (WGPUBufferBindingLayout) {
-        .minBindingSize = sizeof(uint32_t),
-        .type = WGPUBufferBindingType_Uniform,
-        .hasDynamicOffset = false
-      },
-      .visibility = WGPUShaderStage_Fragment
-    }*/
-  };
+#pragma region texture table
+  demo.textureTable = frmwrk_create_texture_table(
+      demo.device, demo.sampler, demo.textureLoader->placeholder.view);
+  ASSERT_CHECK(demo.textureTable);
 
-  WGPUBindGroupLayoutDescriptor bindGroupLayoutDescriptor = (WGPUBindGroupLayoutDescriptor){
-    .entries = bindGroupLayoutEntries,
-    .entryCount = bindingsCount
-  };
+  // Both slots start on the placeholder and follow the loader from there.
+  demo.tbhSlot = frmwrk_texture_table_add(demo.textureTable, NULL);
+  demo.tbhSlimeSlot = frmwrk_texture_table_add(demo.textureTable, NULL);
+  ASSERT_CHECK(demo.tbhSlot != TEXTURE_TABLE_INVALID_SLOT);
+  ASSERT_CHECK(demo.tbhSlimeSlot != TEXTURE_TABLE_INVALID_SLOT);
+  update_texture_slots(&demo);
+  #pragma endregion
 
-  demo.bindGroupLayout = wgpuDeviceCreateBindGroupLayout(demo.device, &bindGroupLayoutDescriptor);
-  ASSERT_CHECK(demo.bindGroupLayout);
+  #pragma region pipeline
+  ASSERT_CHECK(create_pipeline(&demo, &pipeline_layout, &render_pipeline));
+  pipeline_generation = demo.textureTable->generation;
+  for (uint32_t i = 0; !demo.noBundles && i < UNIFORM_RING_FRAMES; i++) {
+    demo.spriteBundles[i] = frmwrk_create_static_bundle(
+        demo.device, surface_preferred_format, 1, "sprite_bundle");
+    ASSERT_CHECK(demo.spriteBundles[i]);
+  }
+  #pragma endregion
 
-  demo.textureViews = malloc(sizeof(WGPUTextureView) * 2);
-  demo.textureViews[0] = demo.tbh.view;
-  demo.textureViews[1] = demo.tbhSlime.view;
+  demo.profiler = frmwrk_create_frame_profiler();
+  ASSERT_CHECK(demo.profiler);
+  demo.gpuProfiler = frmwrk_create_gpu_profiler(demo.device);
+  ASSERT_CHECK(demo.gpuProfiler);
 
-  WGPUBindGroupEntry bindGroupEntries[] = {
-    (WGPUBindGroupEntry) {
-      .binding = 0,
-      .textureViewArray = demo.textureViews,
-      .textureViewArrayLength = 2
-    },
-    (WGPUBindGroupEntry) {
-      .binding = 1,
-      .sampler = demo.sampler
-    }
-  };
+  uint64_t loop_start = frmwrk_time_ns();
+  uint64_t loop_cpu_time = 0;
 
-  WGPUBindGroupDescriptor bindGroupDescriptor = (WGPUBindGroupDescriptor){
-    .entries = bindGroupEntries,
-    .entryCount = bindingsCount,
-    .layout = demo.bindGroupLayout
-  };
-  demo.bindGroup = wgpuDeviceCreateBindGroup(demo.device, &bindGroupDescriptor);
-  ASSERT_CHECK(demo.bindGroup);
+  while (demo.headless ? frame < demo.headlessFrames
+                       : !glfwWindowShouldClose(window)) {
+    uint64_t frame_start = frmwrk_time_ns();
+    frmwrk_frame_profiler_begin(demo.profiler);
+    frmwrk_gpu_profiler_begin_frame(demo.gpuProfiler);
 
-  #pragma endregion
+    if (!demo.headless)
+      glfwPollEvents();
 
-  #pragma region pipeline
-  {
-    WGPUBlendState blendState = (WGPUBlendState){
-      .color = (WGPUBlendComponent){
-        .srcFactor = WGPUBlendFactor_SrcAlpha,
-        .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
-        .operation = WGPUBlendOperation_Add
-      },
-      .alpha = (WGPUBlendComponent){
-        .srcFactor = WGPUBlendFactor_SrcAlpha,
-        .dstFactor = WGPUBlendFactor_OneMinusSrcAlpha,
-        .operation = WGPUBlendOperation_Add
+    if (frmwrk_texture_loader_update(demo.textureLoader,
+                                     TEXTURE_UPLOAD_BUDGET_BYTES) > 0)
+      update_texture_slots(&demo);
+    // Only what the sprites sample this frame counts as in use; the other
+    // image can be evicted and comes back when W switches to it.
+    frmwrk_texture_loader_touch(demo.textureLoader,
+                                demo.currentTexture == 0 ? demo.tbh
+                                                         : demo.tbhSlime);
+    frmwrk_texture_loader_touch(demo.textureLoader, demo.tbhSlime);
+    // The pipeline is only ever replaced here, between frames: when a grown
+    // texture table brings a new layout, or a reloaded shader is ready.
+    bool layout_changed = demo.textureTable->generation != pipeline_generation;
+    bool shader_changed =
+        frmwrk_shader_reloader_update(demo.shaderReloader) > 0;
+    if (layout_changed) {
+      frmwrk_object_cache_release(demo.objectCache, render_pipeline);
+      render_pipeline = NULL;
+      frmwrk_object_cache_release(demo.objectCache, pipeline_layout);
+      pipeline_layout = NULL;
+      // Both are keyed on the table's old layout, which is gone.
+      frmwrk_object_cache_trim(demo.objectCache);
+      pipeline_generation = demo.textureTable->generation;
+    }
+    if (layout_changed || shader_changed) {
+      WGPUPipelineLayout new_layout = NULL;
+      WGPURenderPipeline new_pipeline = NULL;
+      bool built = create_pipeline(&demo, &new_layout, &new_pipeline);
+      if (built || !render_pipeline) {
+        ASSERT_CHECK(built);
+        frmwrk_object_cache_release(demo.objectCache, render_pipeline);
+        frmwrk_object_cache_release(demo.objectCache, pipeline_layout);
+        render_pipeline = new_pipeline;
+        pipeline_layout = new_layout;
+        frmwrk_object_cache_trim(demo.objectCache);
+      } else {
+        printf(LOG_PREFIX " pipeline rebuild failed, keeping the old one\n");
+        frmwrk_object_cache_release(demo.objectCache, new_layout);
       }
-    };
+      // The bundles reference the pipeline they were recorded with.
+      for (uint32_t i = 0; i < UNIFORM_RING_FRAMES; i++) {
+        if (demo.spriteBundles[i])
+          frmwrk_static_bundle_invalidate(demo.spriteBundles[i]);
+      }
+    }
+    frmwrk_frame_profiler_mark(demo.profiler, FrameStage_PollEvents);
 
-    pipeline_layout = wgpuDeviceCreatePipelineLayout(
-      demo.device, &(const WGPUPipelineLayoutDescriptor){
-                       .label = "pipeline_layout",
-                       .bindGroupLayoutCount = 1,
-                       .bindGroupLayouts = &demo.bindGroupLayout
-                   });
-    ASSERT_CHECK(pipeline_layout);
-
-  render_pipeline = wgpuDeviceCreateRenderPipeline(
-      demo.device, &(const WGPURenderPipelineDescriptor){
-                       .label = "render_pipeline",
-                       .layout = pipeline_layout,
-                       .vertex =
-                           (const WGPUVertexState){
-                               .module = shader_module,
-                               .entryPoint = "vs_main",
-                           },
-                       .fragment =
-                           &(const WGPUFragmentState){
-                               .module = shader_module,
-                               .entryPoint = "fs_main",
-                               .targetCount = 1,
-                               .targets =
-                                   (const WGPUColorTargetState[]){
-                                       (const WGPUColorTargetState){
-                                           .format = surface_preferred_format,
-                                           .blend = &blendState,
-                                           .writeMask = WGPUColorWriteMask_All,
-                                       },
-                                   },
-                           },
-                       .primitive =
-                           (const WGPUPrimitiveState){
-                               .topology = WGPUPrimitiveTopology_TriangleList,
-                           },
-                       .multisample =
-                           (const WGPUMultisampleState){
-                               .count = 1,
-                               .mask = 0xFFFFFFFF,
-                           },
-                   });
-    ASSERT_CHECK(render_pipeline);
-  }
-  #pragma endregion
+    if (demo.headless)
+      next_texture = frmwrk_headless_target_view(&demo.offscreen);
+    else
+      next_texture = wgpuSwapChainGetCurrentTextureView(demo.swapchain);
+    ASSERT_CHECK(next_texture);
+    frmwrk_frame_profiler_mark(demo.profiler, FrameStage_AcquireTexture);
 
-  #pragma region index buffer
-  {    
-    uint16_t indices[] = {
-      0, 1, 2, 3, 0, 2
-    };
-    WGPUBufferDescriptor bufferDescriptor = (WGPUBufferDescriptor){
-      .size = sizeof(uint16_t) * 6,
-      .mappedAtCreation = true,
-      .usage = WGPUBufferUsage_Index | WGPUBufferUsage_CopyDst,
+    // The sprites are filled in chunks across the job system, then staged,
+    // then the copy and pass command buffers are recorded side by side.
+    frame_jobs.demo = &demo;
+    frame_jobs.frame = frame;
+    frame_jobs.pipeline = render_pipeline;
+    frame_jobs.target = next_texture;
+    frame_jobs.staged = false;
+    if (demo.defragRequested) {
+      demo.defragRequested = false;
+      uint32_t moved = frmwrk_buffer_arena_defragment(demo.bufferArena,
+                                                      BUFFER_ARENA_BLOCK_SIZE);
+      printf(LOG_PREFIX " defragmented the buffer arena, %u moves\n", moved);
+      frmwrk_buffer_arena_print(demo.bufferArena);
+    }
+    frmwrk_uniform_ring_begin_frame(demo.uniformRing);
+    DrawParams *draw_params = frmwrk_uniform_ring_alloc(
+        demo.uniformRing, sizeof(DrawParams), &frame_jobs.drawOffset);
+    ASSERT_CHECK(draw_params);
+    float fade = frame < FADE_IN_FRAMES ? (float)(frame + 1) / FADE_IN_FRAMES
+                                        : 1.0f;
+    *draw_params = (DrawParams){{1.0f, 1.0f, 1.0f, fade}};
+    frame_jobs.firstSprite = begin_sprites(&demo);
+    ASSERT_CHECK(frame_jobs.firstSprite != UINT32_MAX);
+    for (uint32_t i = 0; i < demo.spriteFillJobCount; i++)
+      frmwrk_job_system_run(demo.jobs,
+                            &(const JobDecl){fill_sprites_job,
+                                             &demo.spriteFillJobs[i]},
+                            1, &frame_jobs.filledCounter);
+    frmwrk_job_system_run_after(
+        demo.jobs, &(const JobDecl){stage_sprites_job, &frame_jobs}, 1,
+        &frame_jobs.filledCounter, &frame_jobs.stagedCounter);
+    const JobDecl record_jobs[FRAME_COMMAND_BUFFERS] = {
+      {record_copies_job, &frame_jobs},
+      {record_main_pass_job, &frame_jobs}
     };
-    demo.indexBuffer = wgpuDeviceCreateBuffer(demo.device, &bufferDescriptor);
-    ASSERT_CHECK(demo.indexBuffer);
-    void* mapping = wgpuBufferGetMappedRange(demo.indexBuffer, 0, sizeof(uint16_t) * 6);
-    memcpy(mapping, indices, sizeof(uint16_t) * 6);
-    wgpuBufferUnmap(demo.indexBuffer);
-  }
-  #pragma endregion
+    frmwrk_job_system_run_after(demo.jobs, record_jobs, FRAME_COMMAND_BUFFERS,
+                                &frame_jobs.stagedCounter,
+                                &frame_jobs.recordedCounter);
+    frmwrk_job_system_wait(demo.jobs, &frame_jobs.stagedCounter);
+    frmwrk_frame_profiler_mark(demo.profiler, FrameStage_BuildBatch);
+    // Every job is done before anything below can bail out.
+    frmwrk_job_system_wait(demo.jobs, &frame_jobs.recordedCounter);
+    frmwrk_frame_profiler_mark(demo.profiler, FrameStage_RecordPass);
 
-  while (!glfwWindowShouldClose(window)) {
-    glfwPollEvents();
+    wgpuTextureViewDrop(next_texture);
+    next_texture = NULL;
+    ASSERT_CHECK(frame_jobs.staged);
+    for (uint32_t i = 0; i < FRAME_COMMAND_BUFFERS; i++)
+      ASSERT_CHECK(frame_jobs.commandBuffers[i]);
 
-    next_texture = wgpuSwapChainGetCurrentTextureView(demo.swapchain);
-    ASSERT_CHECK(next_texture);
+    frmwrk_uniform_ring_flush(demo.uniformRing);
+    wgpuQueueSubmit(queue, FRAME_COMMAND_BUFFERS, frame_jobs.commandBuffers);
+    // wgpuQueueSubmit() drops the command buffers
+    for (uint32_t i = 0; i < FRAME_COMMAND_BUFFERS; i++)
+      frame_jobs.commandBuffers[i] = NULL;
+    frmwrk_uniform_ring_submitted(demo.uniformRing);
+    frmwrk_upload_ring_submitted(demo.uploadRing);
+    frmwrk_buffer_arena_frame_submitted(demo.bufferArena);
+    frmwrk_resources_frame_submitted(demo.resources);
+    frmwrk_gpu_profiler_end_frame(demo.gpuProfiler);
+    frmwrk_frame_profiler_mark(demo.profiler, FrameStage_Submit);
 
-    command_encoder = wgpuDeviceCreateCommandEncoder(
-        demo.device, &(const WGPUCommandEncoderDescriptor){
-                         .label = "command_encoder",
-                     });
-    ASSERT_CHECK(command_encoder);
-
-    render_pass_encoder = wgpuCommandEncoderBeginRenderPass(
-        command_encoder, &(const WGPURenderPassDescriptor){
-                             .label = "render_pass_encoder",
-                             .colorAttachmentCount = 1,
-                             .colorAttachments =
-                                 (const WGPURenderPassColorAttachment[]){
-                                     (const WGPURenderPassColorAttachment){
-                                         .view = next_texture,
-                                         .loadOp = WGPULoadOp_Clear,
-                                         .storeOp = WGPUStoreOp_Store,
-                                         .clearValue =
-                                             (const WGPUColor){
-                                                 .r = 0.0,
-                                                 .g = 0.0,
-                                                 .b = 0.0,
-                                                 .a = 1.0,
-                                             },
-                                     },
-                                 },
-                         });
-    ASSERT_CHECK(render_pass_encoder);
-
-    wgpuRenderPassEncoderSetPipeline(render_pass_encoder, render_pipeline);
-    wgpuRenderPassEncoderSetIndexBuffer(render_pass_encoder, demo.indexBuffer, WGPUIndexFormat_Uint16, 0, sizeof(uint16_t) * 6);
-    wgpuRenderPassEncoderSetBindGroup(render_pass_encoder, 0, demo.bindGroup, 0, NULL);
-    wgpuRenderPassEncoderDrawIndexed(render_pass_encoder, 6, 2, 0, 0, 0);
-    wgpuRenderPassEncoderEnd(render_pass_encoder);
-    // wgpuRenderPassEncoderEnd() drops render_pass_encoder
-    render_pass_encoder = NULL;
+    if (demo.headless) {
+      // Nothing throttles an offscreen loop, so reclaim finished submissions
+      // here instead of letting them queue up behind the GPU.
+      wgpuDevicePoll(demo.device, false, NULL);
+    } else {
+      wgpuSwapChainPresent(demo.swapchain);
+    }
+    frmwrk_frame_profiler_mark(demo.profiler, FrameStage_Present);
+    frmwrk_frame_profiler_end(demo.profiler);
+    frmwrk_resource_telemetry_update(demo.telemetry, frame);
+    frmwrk_capture_frame(demo.capture);
 
-    wgpuTextureViewDrop(next_texture);
-    next_texture = NULL;
+    frame++;
+    loop_cpu_time += frmwrk_time_ns() - frame_start;
+  }
 
-    command_buffer = wgpuCommandEncoderFinish(
-        command_encoder, &(const WGPUCommandBufferDescriptor){
-                             .label = "command_buffer",
-                         });
-    ASSERT_CHECK(command_buffer);
-    // wgpuCommandEncoderFinish() drops command_encoder
-    command_encoder = NULL;
+  if (demo.headless) {
+    unsigned char *pixels =
+        malloc((size_t)demo.config.width * demo.config.height * 4);
+    ASSERT_CHECK(pixels);
+    // The readback waits for the GPU, so the wall time below covers all frames.
+    bool read_back = frmwrk_headless_target_read_back(demo.device, queue,
+                                                      &demo.offscreen, pixels);
+    double wall_seconds = (frmwrk_time_ns() - loop_start) / 1e9;
 
-    wgpuQueueSubmit(queue, 1, (const WGPUCommandBuffer[]){command_buffer});
-    // wgpuQueueSubmit() drops command_buffer
-    command_buffer = NULL;
+    printf(LOG_PREFIX " headless %ux%u: %u frames in %.3fs, %.1f fps, "
+                      "%.3f ms cpu/frame\n",
+           demo.config.width, demo.config.height, frame, wall_seconds,
+           frame / wall_seconds,
+           frame ? loop_cpu_time / 1e6 / frame : 0.0);
 
-    wgpuSwapChainPresent(demo.swapchain);
-    
+    // CI runs compare the output, so a missing one fails the run.
+    if (!read_back ||
+        (demo.headlessOutput &&
+         !frmwrk_write_ppm(demo.headlessOutput, pixels, demo.config.width,
+                           demo.config.height)))
+      ret = EXIT_FAILURE;
+    free(pixels);
   }
 
 cleanup_and_exit:
-  if (command_buffer)
-    wgpuCommandBufferDrop(command_buffer);
-  if (render_pass_encoder)
-    wgpuRenderPassEncoderDrop(render_pass_encoder);
-  if (command_encoder)
-    wgpuCommandEncoderDrop(command_encoder);
+  if (demo.capture) {
+    frmwrk_capture_print(demo.capture);
+    frmwrk_drop_capture(demo.capture);
+  }
+  if (demo.telemetry) {
+    frmwrk_resource_telemetry_sample(demo.telemetry, frame);
+    frmwrk_resource_telemetry_print(demo.telemetry);
+    if (demo.telemetryOutput)
+      frmwrk_resource_telemetry_dump(demo.telemetry, demo.telemetryOutput);
+    frmwrk_drop_resource_telemetry(demo.telemetry);
+  }
+  if (demo.profiler) {
+    frmwrk_frame_profiler_print_summary(demo.profiler);
+    if (demo.profileOutput)
+      frmwrk_frame_profiler_dump(demo.profiler, demo.profileOutput);
+    frmwrk_drop_frame_profiler(demo.profiler);
+  }
+  if (demo.gpuProfiler) {
+    frmwrk_gpu_profiler_print(demo.gpuProfiler);
+    frmwrk_drop_gpu_profiler(demo.gpuProfiler);
+  }
+  for (uint32_t i = 0; i < FRAME_COMMAND_BUFFERS; i++) {
+    if (frame_jobs.commandBuffers[i])
+      wgpuCommandBufferDrop(frame_jobs.commandBuffers[i]);
+  }
+  if (demo.jobs) {
+    frmwrk_job_system_print(demo.jobs);
+    frmwrk_drop_job_system(demo.jobs);
+  }
+  free(demo.spriteFillJobs);
   if (next_texture)
     wgpuTextureViewDrop(next_texture);
-  if (render_pipeline)
-    wgpuRenderPipelineDrop(render_pipeline);
-  if (pipeline_layout)
-    wgpuPipelineLayoutDrop(pipeline_layout);
-  if (demo.uniformBuffer)
-    wgpuBufferDrop(demo.uniformBuffer);
-  if (demo.indexBuffer)
-    wgpuBufferDrop(demo.indexBuffer);
-  if (demo.sampler)
-    wgpuSamplerDrop(demo.sampler);
-  if (demo.textureViews)
-    free(demo.textureViews);
-  if (demo.tbh.data)
-  {
-    wgpuTextureDrop(demo.tbh.texture);
-    wgpuTextureViewDrop(demo.tbh.view);
-    free(demo.tbh.data);
+  if (demo.objectCache) {
+    frmwrk_object_cache_release(demo.objectCache, render_pipeline);
+    frmwrk_object_cache_release(demo.objectCache, pipeline_layout);
+    frmwrk_object_cache_release(demo.objectCache, demo.sampler);
   }
-  if (demo.tbhSlime.data)
-  {
-    wgpuTextureDrop(demo.tbhSlime.texture);
-    wgpuTextureViewDrop(demo.tbhSlime.view);
-    free(demo.tbhSlime.data);
+  for (uint32_t i = 0; i < UNIFORM_RING_FRAMES; i++) {
+    if (demo.spriteBundles[i]) {
+      frmwrk_static_bundle_print(demo.spriteBundles[i]);
+      frmwrk_drop_static_bundle(demo.spriteBundles[i]);
+    }
+  }
+  if (demo.uniformRing) {
+    frmwrk_uniform_ring_print(demo.uniformRing);
+    frmwrk_drop_uniform_ring(demo.uniformRing);
+  }
+  if (demo.spriteBatch)
+    frmwrk_drop_sprite_batch(demo.spriteBatch);
+  if (demo.bufferArena) {
+    frmwrk_buffer_arena_print(demo.bufferArena);
+    frmwrk_drop_buffer_arena(demo.bufferArena);
+  }
+  if (demo.textureTable)
+    frmwrk_drop_texture_table(demo.textureTable);
+  if (demo.objectCache) {
+    frmwrk_object_cache_print(demo.objectCache);
+    frmwrk_drop_object_cache(demo.objectCache);
+  }
+  if (demo.textureLoader) {
+    frmwrk_texture_loader_print(demo.textureLoader);
+    frmwrk_drop_texture_loader(demo.textureLoader);
+  }
+  if (demo.atlas) {
+    frmwrk_atlas_print(demo.atlas);
+    frmwrk_drop_atlas(demo.atlas);
+  }
+  if (demo.mipmapGenerator)
+    frmwrk_drop_mipmap_generator(demo.mipmapGenerator);
+  if (demo.resources) {
+    frmwrk_resources_print(demo.resources);
+    frmwrk_drop_resource_registry(demo.resources);
+  }
+  if (demo.uploadRing)
+    frmwrk_drop_upload_ring(demo.uploadRing);
+  if (demo.shaderReloader) {
+    frmwrk_shader_reloader_print(demo.shaderReloader);
+    frmwrk_drop_shader_reloader(demo.shaderReloader);
   }
-  if (shader_module)
-    wgpuShaderModuleDrop(shader_module);
   if (demo.swapchain)
     wgpuSwapChainDrop(demo.swapchain);
+  if (demo.offscreen.texture)
+    frmwrk_drop_headless_target(&demo.offscreen);
   if (queue)
     wgpuQueueDrop(queue);
   if (demo.device)
@@ -597,7 +1356,14 @@ cleanup_and_exit:
     glfwDestroyWindow(window);
   if (demo.instance)
     wgpuInstanceDrop(demo.instance);
+  if (demo.logger) {
+    // Back to the synchronous callback before the logger goes away.
+    frmwrk_setup_logging(demo.logLevel);
+    frmwrk_async_logger_flush(demo.logger);
+    frmwrk_async_logger_print(demo.logger);
+    frmwrk_drop_async_logger(demo.logger);
+  }
 
   glfwTerminate();
-  return 0;
+  return ret;
 }
\ No newline at end of file
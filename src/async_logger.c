@@ -0,0 +1,274 @@
+#include "async_logger.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool rate_limited(AsyncLogger *logger, uint64_t now) {
+  if (logger->rateLimit == 0)
+    return false;
+  // Whoever sees the second change first resets the count. Racing writers
+  // can let a few extra messages through at the boundary, which is fine.
+  uint_fast64_t second = now / 1000000000ull;
+  uint_fast64_t window = atomic_load_explicit(&logger->rateWindow,
+                                              memory_order_relaxed);
+  if (window != second &&
+      atomic_compare_exchange_strong(&logger->rateWindow, &window, second))
+    atomic_store_explicit(&logger->rateCount, 0, memory_order_relaxed);
+  return atomic_fetch_add_explicit(&logger->rateCount, 1,
+                                   memory_order_relaxed) >= logger->rateLimit;
+}
+
+bool frmwrk_async_logger_write(AsyncLogger *logger, uint32_t level,
+                               const char *tag, const char *message) {
+  uint64_t now = frmwrk_time_ns();
+  if (rate_limited(logger, now)) {
+    atomic_fetch_add_explicit(&logger->rateLimited, 1, memory_order_relaxed);
+    return false;
+  }
+
+  AsyncLogSlot *slot;
+  size_t position =
+      atomic_load_explicit(&logger->enqueuePosition, memory_order_relaxed);
+  for (;;) {
+    slot = &logger->slots[position & (ASYNC_LOGGER_CAPACITY - 1)];
+    size_t sequence =
+        atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+    if (difference == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &logger->enqueuePosition, &position, position + 1,
+              memory_order_relaxed, memory_order_relaxed))
+        break;
+    } else if (difference < 0) {
+      // The flush thread has not freed this slot yet: the ring is full.
+      atomic_fetch_add_explicit(&logger->dropped, 1, memory_order_relaxed);
+      return false;
+    } else {
+      position =
+          atomic_load_explicit(&logger->enqueuePosition, memory_order_relaxed);
+    }
+  }
+
+  size_t length = strlen(message);
+  if (length >= ASYNC_LOGGER_MESSAGE_SIZE) {
+    length = ASYNC_LOGGER_MESSAGE_SIZE - 1;
+    atomic_fetch_add_explicit(&logger->truncated, 1, memory_order_relaxed);
+  }
+  memcpy(slot->message, message, length);
+  slot->message[length] = '\0';
+  slot->length = (uint32_t)length;
+  slot->timeNs = now - logger->startNs;
+  slot->threadId = frmwrk_thread_id();
+  slot->tag = tag;
+  slot->level = level;
+  atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+  return true;
+}
+
+static void write_binary(AsyncLogger *logger, const AsyncLogRecord *record,
+                         const char *message, const char *tag) {
+  fwrite(record, sizeof(*record), 1, logger->binary);
+  fwrite(message, 1, record->length, logger->binary);
+  fwrite(tag, 1, record->tagLength, logger->binary);
+}
+
+static void write_repeats(AsyncLogger *logger) {
+  if (logger->repeatCount == 0)
+    return;
+  if (logger->text)
+    fprintf(logger->text, "[%s] [%s] +%.6fs last message repeated %u times\n",
+            logger->previousTag,
+            frmwrk_log_level_name((WGPULogLevel)logger->previousLevel),
+            logger->repeatLastNs / 1e9, logger->repeatCount);
+  if (logger->binary) {
+    AsyncLogRecord record = (AsyncLogRecord){
+      .timeNs = logger->repeatLastNs,
+      .level = logger->previousLevel,
+      .repeatCount = logger->repeatCount
+    };
+    write_binary(logger, &record, "", "");
+  }
+  logger->repeatCount = 0;
+}
+
+static void write_slot(AsyncLogger *logger, const AsyncLogSlot *slot) {
+  const char *tag = slot->tag ? slot->tag : "log";
+  uint64_t hash = frmwrk_hash_bytes(slot->message, slot->length,
+                                    FRMWRK_HASH_SEED);
+  if (hash == logger->previousHash && slot->level == logger->previousLevel &&
+      tag == logger->previousTag) {
+    if (logger->repeatCount == 0)
+      logger->repeatSinceNs = frmwrk_time_ns();
+    logger->repeatCount++;
+    logger->repeatLastNs = slot->timeNs;
+    atomic_fetch_add_explicit(&logger->deduplicated, 1, memory_order_relaxed);
+    return;
+  }
+  write_repeats(logger);
+  logger->previousHash = hash;
+  logger->previousLevel = slot->level;
+  logger->previousTag = tag;
+
+  if (logger->text)
+    fprintf(logger->text, "[%s] [%s] +%.6fs tid=%llu %s\n", tag,
+            frmwrk_log_level_name((WGPULogLevel)slot->level),
+            slot->timeNs / 1e9, (unsigned long long)slot->threadId,
+            slot->message);
+  if (logger->binary) {
+    size_t tag_length = strlen(tag);
+    AsyncLogRecord record = (AsyncLogRecord){
+      .timeNs = slot->timeNs,
+      .threadId = slot->threadId,
+      .level = slot->level,
+      .length = (uint16_t)slot->length,
+      .tagLength = (uint16_t)(tag_length < UINT16_MAX ? tag_length : UINT16_MAX)
+    };
+    write_binary(logger, &record, slot->message, tag);
+  }
+  atomic_fetch_add_explicit(&logger->written, 1, memory_order_relaxed);
+}
+
+// Writes every message queued so far. Only called by the flush thread, or by
+// drop once it has stopped.
+static void drain(AsyncLogger *logger) {
+  size_t position =
+      atomic_load_explicit(&logger->dequeuePosition, memory_order_relaxed);
+  bool wrote = false;
+  for (;;) {
+    AsyncLogSlot *slot = &logger->slots[position & (ASYNC_LOGGER_CAPACITY - 1)];
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) !=
+        position + 1)
+      break;
+    write_slot(logger, slot);
+    atomic_store_explicit(&slot->sequence, position + ASYNC_LOGGER_CAPACITY,
+                          memory_order_release);
+    position++;
+    atomic_store_explicit(&logger->dequeuePosition, position,
+                          memory_order_release);
+    wrote = true;
+  }
+  if (logger->repeatCount > 0 &&
+      frmwrk_time_ns() - logger->repeatSinceNs >= ASYNC_LOGGER_REPEAT_REPORT_NS) {
+    write_repeats(logger);
+    wrote = true;
+  }
+  if (wrote) {
+    if (logger->text)
+      fflush(logger->text);
+    if (logger->binary)
+      fflush(logger->binary);
+  }
+}
+
+static void flush_thread(void *userdata) {
+  AsyncLogger *logger = userdata;
+  while (!atomic_load(&logger->stopping)) {
+    drain(logger);
+    frmwrk_thread_sleep_ms(ASYNC_LOGGER_FLUSH_INTERVAL_MS);
+  }
+}
+
+AsyncLogger *frmwrk_create_async_logger(FILE *text, const char *binaryPath,
+                                        uint32_t rateLimit) {
+  AsyncLogger *logger = calloc(1, sizeof(AsyncLogger));
+  if (!logger)
+    return NULL;
+  logger->slots = malloc(sizeof(AsyncLogSlot) * ASYNC_LOGGER_CAPACITY);
+  if (!logger->slots) {
+    free(logger);
+    return NULL;
+  }
+  for (size_t i = 0; i < ASYNC_LOGGER_CAPACITY; i++)
+    atomic_init(&logger->slots[i].sequence, i);
+  atomic_init(&logger->enqueuePosition, 0);
+  atomic_init(&logger->dequeuePosition, 0);
+  atomic_init(&logger->rateWindow, 0);
+  atomic_init(&logger->rateCount, 0);
+  atomic_init(&logger->stopping, false);
+  atomic_init(&logger->dropped, 0);
+  atomic_init(&logger->rateLimited, 0);
+  atomic_init(&logger->truncated, 0);
+  atomic_init(&logger->written, 0);
+  atomic_init(&logger->deduplicated, 0);
+  logger->startNs = frmwrk_time_ns();
+  logger->rateLimit = rateLimit;
+  logger->text = text;
+
+  if (binaryPath) {
+    logger->binary = fopen(binaryPath, "wb");
+    if (!logger->binary) {
+      perror("fopen");
+      frmwrk_drop_async_logger(logger);
+      return NULL;
+    }
+    const uint32_t header[2] = {ASYNC_LOGGER_BINARY_MAGIC,
+                                ASYNC_LOGGER_BINARY_VERSION};
+    fwrite(header, sizeof(header), 1, logger->binary);
+  }
+
+  logger->threadStarted =
+      frmwrk_thread_create(&logger->thread, flush_thread, logger);
+  if (!logger->threadStarted) {
+    printf("[async_logger] could not start the flush thread\n");
+    frmwrk_drop_async_logger(logger);
+    return NULL;
+  }
+  return logger;
+}
+
+void frmwrk_drop_async_logger(AsyncLogger *logger) {
+  if (!logger)
+    return;
+  if (logger->threadStarted) {
+    atomic_store(&logger->stopping, true);
+    frmwrk_thread_join(logger->thread);
+  }
+  // Whatever was queued after the thread's last pass.
+  drain(logger);
+  write_repeats(logger);
+  if (logger->text)
+    fflush(logger->text);
+  if (logger->binary)
+    fclose(logger->binary);
+  free(logger->slots);
+  free(logger);
+}
+
+void frmwrk_async_logger_flush(AsyncLogger *logger) {
+  size_t target =
+      atomic_load_explicit(&logger->enqueuePosition, memory_order_acquire);
+  while (atomic_load_explicit(&logger->dequeuePosition,
+                              memory_order_acquire) < target)
+    frmwrk_thread_sleep_ms(1);
+}
+
+static void wgpu_log_callback(WGPULogLevel level, char const *message,
+                              void *userdata) {
+  frmwrk_async_logger_write(userdata, level, "wgpu", message);
+}
+
+void frmwrk_async_logger_attach_wgpu(AsyncLogger *logger, WGPULogLevel level) {
+  wgpuSetLogCallback(wgpu_log_callback, logger);
+  wgpuSetLogLevel(level);
+}
+
+AsyncLoggerStats frmwrk_async_logger_stats(const AsyncLogger *logger) {
+  return (AsyncLoggerStats){
+    .written = atomic_load(&logger->written),
+    .dropped = atomic_load(&logger->dropped),
+    .rateLimited = atomic_load(&logger->rateLimited),
+    .deduplicated = atomic_load(&logger->deduplicated),
+    .truncated = atomic_load(&logger->truncated)
+  };
+}
+
+void frmwrk_async_logger_print(const AsyncLogger *logger) {
+  AsyncLoggerStats stats = frmwrk_async_logger_stats(logger);
+  printf("[async_logger] written=%llu deduplicated=%llu dropped=%llu "
+         "rate_limited=%llu truncated=%llu\n",
+         (unsigned long long)stats.written,
+         (unsigned long long)stats.deduplicated,
+         (unsigned long long)stats.dropped,
+         (unsigned long long)stats.rateLimited,
+         (unsigned long long)stats.truncated);
+}
@@ -0,0 +1,120 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include "framework.h"
+#include "threading.h"
+
+// Slots in the ring, a power of two. Writers drop messages when it is full
+// rather than wait for the flush thread.
+#define ASYNC_LOGGER_CAPACITY 4096
+// Longer messages are truncated.
+#define ASYNC_LOGGER_MESSAGE_SIZE 480
+#define ASYNC_LOGGER_FLUSH_INTERVAL_MS 10
+// How long a run of identical messages is held back before its repeat count
+// is written anyway.
+#define ASYNC_LOGGER_REPEAT_REPORT_NS 1000000000ull
+
+// "FLOG" read as a little-endian uint32_t.
+#define ASYNC_LOGGER_BINARY_MAGIC 0x474f4c46u
+#define ASYNC_LOGGER_BINARY_VERSION 1
+
+// Binary log files start with the magic and version as two uint32_t, followed
+// by records: this header, then `length` bytes of message and `tagLength`
+// bytes of tag, neither NUL-terminated. A record with `length` 0 and a nonzero
+// `repeatCount` means the previous message was repeated that many more times.
+typedef struct AsyncLogRecord {
+  // Since the logger was created.
+  uint64_t timeNs;
+  uint64_t threadId;
+  uint32_t level;
+  uint32_t repeatCount;
+  uint16_t length;
+  uint16_t tagLength;
+  uint32_t reserved;
+} AsyncLogRecord;
+
+typedef struct AsyncLogSlot {
+  // Vyukov ring sequence: the slot is free for the writer at position `p`
+  // when this is `p` and holds its message when it is `p + 1`.
+  atomic_size_t sequence;
+  uint64_t timeNs;
+  uint64_t threadId;
+  // A string that outlives the logger, such as a literal.
+  const char *tag;
+  uint32_t level;
+  uint32_t length;
+  char message[ASYNC_LOGGER_MESSAGE_SIZE];
+} AsyncLogSlot;
+
+typedef struct AsyncLoggerStats {
+  uint64_t written;
+  // Ring full.
+  uint64_t dropped;
+  uint64_t rateLimited;
+  uint64_t deduplicated;
+  uint64_t truncated;
+} AsyncLoggerStats;
+
+// Multi-producer ring of fixed-size messages drained by a flush thread, so
+// writers only pay for a timestamp, a copy and an atomic increment. The flush
+// thread formats and writes them, collapsing runs of identical messages into
+// a repeat count.
+typedef struct AsyncLogger {
+  AsyncLogSlot *slots;
+  atomic_size_t enqueuePosition;
+  // Only advanced by the flush thread; read by frmwrk_async_logger_flush.
+  atomic_size_t dequeuePosition;
+  uint64_t startNs;
+
+  // Messages per second across all writers, 0 for no limit.
+  uint32_t rateLimit;
+  atomic_uint_fast64_t rateWindow;
+  atomic_uint rateCount;
+
+  FILE *text;
+  FILE *binary;
+  FrmwrkThread thread;
+  bool threadStarted;
+  atomic_bool stopping;
+
+  // The flush thread's view of the last message, for deduplication.
+  uint64_t previousHash;
+  uint32_t previousLevel;
+  const char *previousTag;
+  uint32_t repeatCount;
+  // When the run started, and the last repeat's timeNs for its report.
+  uint64_t repeatSinceNs;
+  uint64_t repeatLastNs;
+
+  atomic_uint_fast64_t dropped;
+  atomic_uint_fast64_t rateLimited;
+  atomic_uint_fast64_t truncated;
+  // Written by the flush thread.
+  atomic_uint_fast64_t written;
+  atomic_uint_fast64_t deduplicated;
+} AsyncLogger;
+
+// Writes formatted lines to `text` and records to a new file at
+// `binaryPath`; either may be NULL. Neither stream is closed by the logger
+// apart from the binary file it opened.
+AsyncLogger *frmwrk_create_async_logger(FILE *text, const char *binaryPath,
+                                        uint32_t rateLimit);
+// Writes out everything queued, then stops the flush thread.
+void frmwrk_drop_async_logger(AsyncLogger *logger);
+
+// Queues a message without blocking. Returns false when it was dropped.
+bool frmwrk_async_logger_write(AsyncLogger *logger, uint32_t level,
+                               const char *tag, const char *message);
+// Blocks until everything queued so far has been written.
+void frmwrk_async_logger_flush(AsyncLogger *logger);
+
+// Routes wgpu's log callback into `logger` at `level`. Call
+// frmwrk_setup_logging before dropping the logger to switch back.
+void frmwrk_async_logger_attach_wgpu(AsyncLogger *logger, WGPULogLevel level);
+
+AsyncLoggerStats frmwrk_async_logger_stats(const AsyncLogger *logger);
+void frmwrk_async_logger_print(const AsyncLogger *logger);
+
+#endif // ASYNC_LOGGER_H
@@ -0,0 +1,438 @@
+#include "atlas.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pixel_convert.h"
+#include "stb_image.h"
+#include "upload_ring.h"
+
+static WGPUTexture create_array_texture(WGPUDevice device, uint32_t pageSize,
+                                        uint32_t layers) {
+  WGPUTextureFormat format = WGPUTextureFormat_RGBA8Unorm;
+  return wgpuDeviceCreateTexture(
+      device, &(const WGPUTextureDescriptor){
+                  .label = "atlas",
+                  .dimension = WGPUTextureDimension_2D,
+                  .format = format,
+                  .size = (WGPUExtent3D){
+                    .width = pageSize,
+                    .height = pageSize,
+                    .depthOrArrayLayers = layers
+                  },
+                  // CopySrc lets a full array be carried over when it grows.
+                  .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_CopySrc |
+                           WGPUTextureUsage_TextureBinding,
+                  .mipLevelCount = 1,
+                  .sampleCount = 1,
+                  .viewFormats = &format,
+                  .viewFormatCount = 1
+              });
+}
+
+static WGPUTextureView create_array_view(WGPUTexture texture,
+                                         uint32_t layers) {
+  return wgpuTextureCreateView(
+      texture, &(const WGPUTextureViewDescriptor){
+                   .label = "atlas_view",
+                   .format = WGPUTextureFormat_RGBA8Unorm,
+                   .dimension = WGPUTextureViewDimension_2DArray,
+                   .aspect = WGPUTextureAspect_All,
+                   .baseMipLevel = 0,
+                   .mipLevelCount = 1,
+                   .baseArrayLayer = 0,
+                   .arrayLayerCount = layers
+               });
+}
+
+static void create_layer_views(Atlas *atlas) {
+  for (uint32_t i = 0; i < atlas->layerCapacity; i++) {
+    atlas->layerViews[i] = wgpuTextureCreateView(
+        atlas->texture, &(const WGPUTextureViewDescriptor){
+                            .label = "atlas_layer_view",
+                            .format = WGPUTextureFormat_RGBA8Unorm,
+                            .dimension = WGPUTextureViewDimension_2D,
+                            .aspect = WGPUTextureAspect_All,
+                            .baseMipLevel = 0,
+                            .mipLevelCount = 1,
+                            .baseArrayLayer = i,
+                            .arrayLayerCount = 1
+                        });
+  }
+}
+
+static void drop_layer_views(Atlas *atlas) {
+  for (uint32_t i = 0; i < atlas->layerCapacity; i++) {
+    if (atlas->layerViews[i])
+      wgpuTextureViewDrop(atlas->layerViews[i]);
+    atlas->layerViews[i] = NULL;
+  }
+}
+
+static bool layer_init(AtlasLayer *layer, uint32_t pageSize) {
+  layer->nodes = malloc(sizeof(SkylineNode) * 16);
+  if (!layer->nodes)
+    return false;
+  layer->nodes[0] = (SkylineNode){.x = 0, .y = 0, .width = pageSize};
+  layer->nodeCount = 1;
+  layer->nodeCapacity = 16;
+  layer->usedArea = 0;
+  return true;
+}
+
+Atlas *frmwrk_create_atlas(WGPUDevice device, UploadRing *uploadRing,
+                           uint32_t pageSize, uint32_t gutter,
+                           uint32_t initialLayers) {
+  if (initialLayers == 0)
+    initialLayers = 1;
+  if (initialLayers > ATLAS_MAX_LAYERS)
+    initialLayers = ATLAS_MAX_LAYERS;
+
+  Atlas *atlas = calloc(1, sizeof(Atlas));
+  if (!atlas)
+    return NULL;
+  atlas->device = device;
+  atlas->queue = wgpuDeviceGetQueue(device);
+  atlas->uploadRing = uploadRing;
+  atlas->pageSize = pageSize;
+  atlas->gutter = gutter;
+
+  atlas->texture = create_array_texture(device, pageSize, initialLayers);
+  if (!atlas->texture) {
+    frmwrk_drop_atlas(atlas);
+    return NULL;
+  }
+  atlas->view = create_array_view(atlas->texture, initialLayers);
+  atlas->layerCapacity = initialLayers;
+  create_layer_views(atlas);
+  return atlas;
+}
+
+void frmwrk_drop_atlas(Atlas *atlas) {
+  if (!atlas)
+    return;
+  for (uint32_t i = 0; i < atlas->layerCount; i++)
+    free(atlas->layers[i].nodes);
+  free(atlas->regions);
+  drop_layer_views(atlas);
+  if (atlas->view)
+    wgpuTextureViewDrop(atlas->view);
+  if (atlas->texture)
+    wgpuTextureDrop(atlas->texture);
+  if (atlas->queue)
+    wgpuQueueDrop(atlas->queue);
+  free(atlas);
+}
+
+// Finds the lowest y at which a `w` x `h` rectangle can sit with its left edge
+// on node `index`, or false if it would leave the page.
+static bool skyline_fit(const AtlasLayer *layer, uint32_t index, uint32_t w,
+                        uint32_t h, uint32_t pageSize, uint32_t *y) {
+  uint32_t x = layer->nodes[index].x;
+  if (x + w > pageSize)
+    return false;
+
+  uint32_t top = 0;
+  uint32_t remaining = w;
+  // The nodes span the whole page width, so this cannot run off the end.
+  for (uint32_t i = index; remaining > 0; i++) {
+    const SkylineNode *node = &layer->nodes[i];
+    if (node->y > top)
+      top = node->y;
+    if (top + h > pageSize)
+      return false;
+    remaining -= remaining < node->width ? remaining : node->width;
+  }
+  *y = top;
+  return true;
+}
+
+static bool skyline_insert(AtlasLayer *layer, uint32_t index, uint32_t x,
+                           uint32_t y, uint32_t w, uint32_t h) {
+  if (layer->nodeCount == layer->nodeCapacity) {
+    uint32_t capacity = layer->nodeCapacity * 2;
+    SkylineNode *nodes = realloc(layer->nodes, sizeof(SkylineNode) * capacity);
+    if (!nodes)
+      return false;
+    layer->nodes = nodes;
+    layer->nodeCapacity = capacity;
+  }
+
+  memmove(&layer->nodes[index + 1], &layer->nodes[index],
+          sizeof(SkylineNode) * (layer->nodeCount - index));
+  layer->nodes[index] = (SkylineNode){.x = x, .y = y + h, .width = w};
+  layer->nodeCount++;
+
+  // Trim or remove the nodes now covered by the new one.
+  for (uint32_t i = index + 1; i < layer->nodeCount;) {
+    SkylineNode *prev = &layer->nodes[i - 1];
+    SkylineNode *node = &layer->nodes[i];
+    uint32_t prev_end = prev->x + prev->width;
+    if (node->x >= prev_end)
+      break;
+    uint32_t shrink = prev_end - node->x;
+    if (node->width > shrink) {
+      node->x += shrink;
+      node->width -= shrink;
+      break;
+    }
+    memmove(node, node + 1, sizeof(SkylineNode) * (layer->nodeCount - i - 1));
+    layer->nodeCount--;
+  }
+
+  // Merge neighbours left at the same height.
+  for (uint32_t i = 0; i + 1 < layer->nodeCount;) {
+    if (layer->nodes[i].y == layer->nodes[i + 1].y) {
+      layer->nodes[i].width += layer->nodes[i + 1].width;
+      memmove(&layer->nodes[i + 1], &layer->nodes[i + 2],
+              sizeof(SkylineNode) * (layer->nodeCount - i - 2));
+      layer->nodeCount--;
+    } else {
+      i++;
+    }
+  }
+
+  layer->usedArea += (uint64_t)w * h;
+  return true;
+}
+
+// Bottom-left heuristic: lowest resulting top edge, then the narrowest node.
+static bool skyline_pack(AtlasLayer *layer, uint32_t w, uint32_t h,
+                         uint32_t pageSize, uint32_t *x, uint32_t *y) {
+  uint32_t best_index = UINT32_MAX;
+  uint32_t best_top = UINT32_MAX;
+  uint32_t best_width = UINT32_MAX;
+  uint32_t best_y = 0;
+
+  for (uint32_t i = 0; i < layer->nodeCount; i++) {
+    uint32_t fit_y;
+    if (!skyline_fit(layer, i, w, h, pageSize, &fit_y))
+      continue;
+    uint32_t top = fit_y + h;
+    if (top < best_top ||
+        (top == best_top && layer->nodes[i].width < best_width)) {
+      best_index = i;
+      best_top = top;
+      best_width = layer->nodes[i].width;
+      best_y = fit_y;
+    }
+  }
+  if (best_index == UINT32_MAX)
+    return false;
+
+  *x = layer->nodes[best_index].x;
+  *y = best_y;
+  return skyline_insert(layer, best_index, *x, best_y, w, h);
+}
+
+// Replaces the array texture with one of `layers` layers, carrying over every
+// layer already in use.
+static bool grow(Atlas *atlas, uint32_t layers) {
+  WGPUTexture texture = create_array_texture(atlas->device, atlas->pageSize,
+                                             layers);
+  if (!texture)
+    return false;
+
+  // Staged writes to the old texture have to land before it is copied.
+  if (atlas->uploadRing)
+    frmwrk_upload_ring_flush(atlas->uploadRing);
+
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
+      atlas->device, &(const WGPUCommandEncoderDescriptor){
+                         .label = "atlas_grow_encoder",
+                     });
+  wgpuCommandEncoderCopyTextureToTexture(
+      encoder,
+      &(const WGPUImageCopyTexture){
+          .texture = atlas->texture,
+          .aspect = WGPUTextureAspect_All,
+          .mipLevel = 0,
+          .origin = (WGPUOrigin3D){0, 0, 0}
+      },
+      &(const WGPUImageCopyTexture){
+          .texture = texture,
+          .aspect = WGPUTextureAspect_All,
+          .mipLevel = 0,
+          .origin = (WGPUOrigin3D){0, 0, 0}
+      },
+      &(const WGPUExtent3D){atlas->pageSize, atlas->pageSize,
+                            atlas->layerCount});
+  WGPUCommandBuffer command_buffer = wgpuCommandEncoderFinish(
+      encoder, &(const WGPUCommandBufferDescriptor){
+                   .label = "atlas_grow_command_buffer",
+               });
+  wgpuQueueSubmit(atlas->queue, 1, &command_buffer);
+
+  drop_layer_views(atlas);
+  wgpuTextureViewDrop(atlas->view);
+  wgpuTextureDrop(atlas->texture);
+  atlas->texture = texture;
+  atlas->view = create_array_view(texture, layers);
+  atlas->layerCapacity = layers;
+  create_layer_views(atlas);
+  atlas->generation++;
+  return true;
+}
+
+static bool add_layer(Atlas *atlas) {
+  if (atlas->layerCount == ATLAS_MAX_LAYERS)
+    return false;
+  if (atlas->layerCount == atlas->layerCapacity) {
+    uint32_t layers = atlas->layerCapacity * 2;
+    if (layers > ATLAS_MAX_LAYERS)
+      layers = ATLAS_MAX_LAYERS;
+    if (!grow(atlas, layers))
+      return false;
+  }
+  if (!layer_init(&atlas->layers[atlas->layerCount], atlas->pageSize))
+    return false;
+  atlas->layerCount++;
+  return true;
+}
+
+// Writes `pixels` into `dst` surrounded by `gutter` texels repeated from the
+// image's edges.
+static void write_padded(unsigned char *dst, uint32_t dstBytesPerRow,
+                         const unsigned char *pixels, uint32_t w, uint32_t h,
+                         uint32_t gutter) {
+  for (uint32_t py = 0; py < h + gutter * 2; py++) {
+    uint32_t sy = py < gutter ? 0 : py - gutter;
+    if (sy >= h)
+      sy = h - 1;
+    const unsigned char *src = pixels + (size_t)sy * w * 4;
+    unsigned char *row = dst + (size_t)py * dstBytesPerRow;
+
+    for (uint32_t i = 0; i < gutter; i++)
+      memcpy(row + i * 4, src, 4);
+    memcpy(row + gutter * 4, src, (size_t)w * 4);
+    for (uint32_t i = 0; i < gutter; i++)
+      memcpy(row + (gutter + w + i) * 4, src + (w - 1) * 4, 4);
+  }
+}
+
+static void upload_padded(Atlas *atlas, const unsigned char *pixels,
+                          uint32_t w, uint32_t h, uint32_t x, uint32_t y,
+                          uint32_t layer) {
+  uint32_t pw = w + atlas->gutter * 2;
+  uint32_t ph = h + atlas->gutter * 2;
+  WGPUOrigin3D origin = (WGPUOrigin3D){x, y, layer};
+
+  if (atlas->uploadRing) {
+    uint32_t bytesPerRow;
+    unsigned char *staging = frmwrk_upload_ring_alloc_texture(
+        atlas->uploadRing, atlas->texture, 0, origin, pw, ph, 4, &bytesPerRow);
+    if (staging) {
+      write_padded(staging, bytesPerRow, pixels, w, h, atlas->gutter);
+      return;
+    }
+  }
+
+  unsigned char *padded = malloc((size_t)pw * ph * 4);
+  if (!padded)
+    return;
+  write_padded(padded, pw * 4, pixels, w, h, atlas->gutter);
+  wgpuQueueWriteTexture(
+      atlas->queue,
+      &(const WGPUImageCopyTexture){
+          .texture = atlas->texture,
+          .aspect = WGPUTextureAspect_All,
+          .mipLevel = 0,
+          .origin = origin
+      },
+      padded, (size_t)pw * ph * 4,
+      &(const WGPUTextureDataLayout){
+          .bytesPerRow = pw * 4,
+          .rowsPerImage = ph
+      },
+      &(const WGPUExtent3D){pw, ph, 1});
+  free(padded);
+}
+
+AtlasHandle frmwrk_atlas_insert(Atlas *atlas, const unsigned char *pixels,
+                                uint32_t w, uint32_t h) {
+  uint32_t pw = w + atlas->gutter * 2;
+  uint32_t ph = h + atlas->gutter * 2;
+  if (w == 0 || h == 0 || pw > atlas->pageSize || ph > atlas->pageSize)
+    return 0;
+
+  if (atlas->regionCount == atlas->regionCapacity) {
+    uint32_t capacity = atlas->regionCapacity ? atlas->regionCapacity * 2 : 64;
+    AtlasRegion *regions =
+        realloc(atlas->regions, sizeof(AtlasRegion) * capacity);
+    if (!regions)
+      return 0;
+    atlas->regions = regions;
+    atlas->regionCapacity = capacity;
+  }
+
+  // Earlier layers first, so they fill up before a new one is opened.
+  uint32_t layer = 0;
+  uint32_t x, y;
+  for (;; layer++) {
+    if (layer == atlas->layerCount && !add_layer(atlas)) {
+      printf("[atlas] no room for a %ux%u image\n", w, h);
+      return 0;
+    }
+    if (skyline_pack(&atlas->layers[layer], pw, ph, atlas->pageSize, &x, &y))
+      break;
+  }
+
+  upload_padded(atlas, pixels, w, h, x, y, layer);
+
+  float scale = 1.0f / (float)atlas->pageSize;
+  uint32_t ix = x + atlas->gutter;
+  uint32_t iy = y + atlas->gutter;
+  atlas->regions[atlas->regionCount++] = (AtlasRegion){
+    .layer = layer,
+    .x = ix,
+    .y = iy,
+    .w = w,
+    .h = h,
+    .u0 = ix * scale,
+    .v0 = iy * scale,
+    .u1 = (ix + w) * scale,
+    .v1 = (iy + h) * scale
+  };
+  return atlas->regionCount;
+}
+
+AtlasHandle frmwrk_atlas_insert_file(Atlas *atlas, const char *path) {
+  int w, h, channels;
+  unsigned char *decoded = stbi_load(path, &w, &h, &channels, 0);
+  if (!decoded) {
+    printf("[atlas] failed to load %s: %s\n", path, stbi_failure_reason());
+    return 0;
+  }
+
+  AtlasHandle handle = 0;
+  unsigned char *pixels = malloc((size_t)w * h * 4);
+  if (pixels) {
+    frmwrk_convert_image_to_rgba(pixels, w * 4, decoded, w, h, channels,
+                                 PixelConvert_None);
+    handle = frmwrk_atlas_insert(atlas, pixels, w, h);
+    free(pixels);
+  }
+  stbi_image_free(decoded);
+  return handle;
+}
+
+const AtlasRegion *frmwrk_atlas_region(const Atlas *atlas,
+                                       AtlasHandle handle) {
+  if (handle == 0 || handle > atlas->regionCount)
+    return NULL;
+  return &atlas->regions[handle - 1];
+}
+
+WGPUTextureView frmwrk_atlas_layer_view(const Atlas *atlas, uint32_t layer) {
+  return layer < atlas->layerCapacity ? atlas->layerViews[layer] : NULL;
+}
+
+void frmwrk_atlas_print(const Atlas *atlas) {
+  uint64_t page_area = (uint64_t)atlas->pageSize * atlas->pageSize;
+  printf("[atlas] %u images in %u/%u layers of %ux%u (gutter %u)\n",
+         atlas->regionCount, atlas->layerCount, atlas->layerCapacity,
+         atlas->pageSize, atlas->pageSize, atlas->gutter);
+  for (uint32_t i = 0; i < atlas->layerCount; i++)
+    printf("[atlas]   layer %u: %.1f%% used, %u skyline nodes\n", i,
+           100.0 * (double)atlas->layers[i].usedArea / (double)page_area,
+           atlas->layers[i].nodeCount);
+}
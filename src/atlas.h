@@ -0,0 +1,88 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "framework.h"
+
+#define ATLAS_MAX_LAYERS 64
+
+// Handle to an image packed into an Atlas. 0 is never a valid handle.
+typedef uint32_t AtlasHandle;
+
+typedef struct AtlasRegion {
+  uint32_t layer;
+  // Texel rectangle of the image itself, excluding the gutter.
+  uint32_t x;
+  uint32_t y;
+  uint32_t w;
+  uint32_t h;
+  // Normalized coordinates of the same rectangle within its layer.
+  float u0;
+  float v0;
+  float u1;
+  float v1;
+} AtlasRegion;
+
+// One horizontal segment of a layer's skyline: everything below `y` across
+// [x, x + width) is taken.
+typedef struct SkylineNode {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+} SkylineNode;
+
+typedef struct AtlasLayer {
+  SkylineNode *nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  uint64_t usedArea;
+} AtlasLayer;
+
+// Packs RGBA8 images into the layers of one 2D array texture with a skyline
+// bottom-left packer. Each image is surrounded by `gutter` texels copied from
+// its edges so filtering never reads a neighbour.
+typedef struct Atlas {
+  WGPUDevice device;
+  WGPUQueue queue;
+  UploadRing *uploadRing;
+  uint32_t pageSize;
+  uint32_t gutter;
+
+  WGPUTexture texture;
+  WGPUTextureView view;
+  // A 2D view of each of the `layerCapacity` layers, for binding arrays of
+  // plain 2D textures. Replaced along with `view`.
+  WGPUTextureView layerViews[ATLAS_MAX_LAYERS];
+  // Layers allocated in `texture`; `layerCount` of them hold images.
+  uint32_t layerCapacity;
+  uint32_t layerCount;
+  AtlasLayer layers[ATLAS_MAX_LAYERS];
+
+  AtlasRegion *regions;
+  uint32_t regionCount;
+  uint32_t regionCapacity;
+
+  // Bumped whenever `texture` and `view` are replaced by a larger array, so
+  // callers know to rebuild bind groups.
+  uint32_t generation;
+} Atlas;
+
+// `pageSize` is the width and height of every layer. Uploads are staged
+// through `uploadRing` when it is not NULL.
+Atlas *frmwrk_create_atlas(WGPUDevice device, UploadRing *uploadRing,
+                           uint32_t pageSize, uint32_t gutter,
+                           uint32_t initialLayers);
+void frmwrk_drop_atlas(Atlas *atlas);
+
+// Packs tightly packed RGBA8 `pixels` and uploads them. Returns 0 when the
+// image is larger than a page or every layer is full.
+AtlasHandle frmwrk_atlas_insert(Atlas *atlas, const unsigned char *pixels,
+                                uint32_t w, uint32_t h);
+AtlasHandle frmwrk_atlas_insert_file(Atlas *atlas, const char *path);
+
+// NULL for invalid handles.
+const AtlasRegion *frmwrk_atlas_region(const Atlas *atlas, AtlasHandle handle);
+// The 2D view of `layer`, or NULL past `layerCapacity`.
+WGPUTextureView frmwrk_atlas_layer_view(const Atlas *atlas, uint32_t layer);
+void frmwrk_atlas_print(const Atlas *atlas);
+
+#endif // ATLAS_H
@@ -0,0 +1,657 @@
+// Microbenchmarks of the framework's hot paths: image decode, pixel
+// conversion, texture and shader module loading, and the demo's headless
+// frame loop.
+//
+// Every benchmark runs a fixed number of iterations per repetition, after a
+// few warm-up repetitions that are not counted, and each repetition gives one
+// sample of the time per iteration. Inputs are fixed (the conversion sources
+// come from a seeded generator), so runs on the same machine can be compared
+// across commits: --json writes the samples and their summary, and
+// --baseline prints each median against one written earlier.
+//
+// The frame loop is measured by launching the demo itself with --headless
+// and reading the summary it prints, so it covers the real frame rather than
+// a copy of it.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "framework.h"
+#include "pixel_convert.h"
+#include "threading.h"
+#include "upload_ring.h"
+#include "stb_image.h"
+
+#if defined(_WIN32)
+#define popen _popen
+#define pclose _pclose
+#endif
+
+#define LOG_PREFIX "[bench]"
+#define BENCH_JSON_VERSION 1
+#define BENCH_MAX_REPETITIONS 1000
+#define BENCH_CONVERT_WIDTH 1024
+#define BENCH_CONVERT_HEIGHT 1024
+#define BENCH_CONVERT_SEED 0x9e3779b97f4a7c15ull
+#define BENCH_UPLOAD_RING_PAGE_SIZE (8u << 20)
+#define BENCH_MAX_ERRORS_PRINTED 8
+
+typedef struct BenchOptions {
+  uint32_t warmup;
+  uint32_t repetitions;
+  // Only benchmarks whose name contains this run.
+  const char *filter;
+  const char *jsonPath;
+  const char *baselinePath;
+  // Free-form, stored in the JSON; a commit hash for instance.
+  const char *label;
+  const char *image;
+  const char *shader;
+  // The demo executable, for the frame loop benchmark.
+  const char *app;
+  uint32_t frames;
+  uint32_t width;
+  uint32_t height;
+} BenchOptions;
+
+typedef struct BenchContext {
+  const BenchOptions *options;
+
+  WGPUInstance instance;
+  WGPUAdapter adapter;
+  WGPUDevice device;
+  WGPUQueue queue;
+  UploadRing *uploadRing;
+  uint64_t errors;
+
+  // Synthetic conversion sources, one per channel count, and their target.
+  uint8_t *sources[4];
+  uint8_t *converted;
+  uint32_t convertedPitch;
+} BenchContext;
+
+typedef enum BenchNeeds {
+  BenchNeeds_None = 0,
+  BenchNeeds_Image = 1 << 0,
+  BenchNeeds_Device = 1 << 1,
+  BenchNeeds_Shader = 1 << 2,
+  BenchNeeds_App = 1 << 3,
+} BenchNeeds;
+
+typedef struct Benchmark Benchmark;
+
+// Runs the benchmark's iterations and stores the time per iteration in `ms`.
+// Benchmarks timing themselves from the outside, like the frame loop, report
+// their own measure instead.
+typedef bool (*BenchRun)(BenchContext *context, const Benchmark *benchmark,
+                         double *ms);
+
+struct Benchmark {
+  const char *name;
+  BenchRun run;
+  uint32_t iterations;
+  uint32_t needs;
+  // Conversions: source channel count and PixelConvertFlags.
+  uint32_t channels;
+  uint32_t convertFlags;
+};
+
+typedef struct BenchSummary {
+  double meanMs;
+  double stddevMs;
+  double minMs;
+  double medianMs;
+  double p95Ms;
+  double maxMs;
+} BenchSummary;
+
+typedef struct BenchResult {
+  const Benchmark *benchmark;
+  double samples[BENCH_MAX_REPETITIONS];
+  uint32_t sampleCount;
+  // Bytes processed per iteration, 0 where throughput means nothing.
+  uint64_t bytes;
+  BenchSummary summary;
+  bool hasBaseline;
+  double baselineMedianMs;
+} BenchResult;
+
+static void handle_request_adapter(WGPURequestAdapterStatus status,
+                                   WGPUAdapter adapter, char const *message,
+                                   void *userdata) {
+  if (status == WGPURequestAdapterStatus_Success) {
+    BenchContext *context = userdata;
+    context->adapter = adapter;
+  } else {
+    printf(LOG_PREFIX " request_adapter status=%#.8x message=%s\n", status,
+           message);
+  }
+}
+
+static void handle_request_device(WGPURequestDeviceStatus status,
+                                  WGPUDevice device, char const *message,
+                                  void *userdata) {
+  if (status == WGPURequestDeviceStatus_Success) {
+    BenchContext *context = userdata;
+    context->device = device;
+  } else {
+    printf(LOG_PREFIX " request_device status=%#.8x message=%s\n", status,
+           message);
+  }
+}
+
+static void handle_uncaptured_error(WGPUErrorType type, char const *message,
+                                    void *userdata) {
+  BenchContext *context = userdata;
+  if (context->errors++ < BENCH_MAX_ERRORS_PRINTED)
+    printf(LOG_PREFIX " uncaptured_error type=%#.8x message=%s\n", type,
+           message);
+}
+
+#pragma region benchmarks
+// Same image bytes every run: a fixed xorshift sequence.
+static void fill_random(uint8_t *data, size_t size, uint64_t seed) {
+  uint64_t x = seed;
+  for (size_t i = 0; i < size; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    data[i] = (uint8_t)(x >> 24);
+  }
+}
+
+static bool run_decode(BenchContext *context, const Benchmark *benchmark,
+                       double *ms) {
+  uint64_t start = frmwrk_time_ns();
+  for (uint32_t i = 0; i < benchmark->iterations; i++) {
+    int w;
+    int h;
+    int channels;
+    unsigned char *data =
+        stbi_load(context->options->image, &w, &h, &channels, 0);
+    if (!data)
+      return false;
+    stbi_image_free(data);
+  }
+  *ms = (frmwrk_time_ns() - start) / 1e6 / benchmark->iterations;
+  return true;
+}
+
+static bool run_convert(BenchContext *context, const Benchmark *benchmark,
+                        double *ms) {
+  uint64_t start = frmwrk_time_ns();
+  for (uint32_t i = 0; i < benchmark->iterations; i++) {
+    if (!frmwrk_convert_image_to_rgba(
+            context->converted, context->convertedPitch,
+            context->sources[benchmark->channels - 1], BENCH_CONVERT_WIDTH,
+            BENCH_CONVERT_HEIGHT, benchmark->channels,
+            benchmark->convertFlags))
+      return false;
+  }
+  *ms = (frmwrk_time_ns() - start) / 1e6 / benchmark->iterations;
+  return true;
+}
+
+// Decode, conversion into the upload ring and the copy, waiting for the GPU
+// at the end so the copies are counted too.
+static bool run_load_texture(BenchContext *context,
+                             const Benchmark *benchmark, double *ms) {
+  uint64_t start = frmwrk_time_ns();
+  for (uint32_t i = 0; i < benchmark->iterations; i++) {
+    Texture2D texture = frmwrk_load_texture2D(
+        context->device, context->uploadRing, context->options->image);
+    if (!texture.texture)
+      return false;
+    frmwrk_upload_ring_flush(context->uploadRing);
+    stbi_image_free(texture.data);
+    wgpuTextureViewDrop(texture.view);
+    wgpuTextureDrop(texture.texture);
+  }
+  wgpuDevicePoll(context->device, true, NULL);
+  *ms = (frmwrk_time_ns() - start) / 1e6 / benchmark->iterations;
+  return true;
+}
+
+static bool run_load_shader(BenchContext *context,
+                            const Benchmark *benchmark, double *ms) {
+  uint64_t start = frmwrk_time_ns();
+  for (uint32_t i = 0; i < benchmark->iterations; i++) {
+    WGPUShaderModule module =
+        frmwrk_load_shader_module(context->device, context->options->shader);
+    if (!module)
+      return false;
+    wgpuShaderModuleDrop(module);
+  }
+  *ms = (frmwrk_time_ns() - start) / 1e6 / benchmark->iterations;
+  return true;
+}
+
+// Wall time per frame as reported by the demo, which waits for the GPU before
+// taking it. Start-up and teardown are not included.
+static bool run_headless_frames(BenchContext *context,
+                                const Benchmark *benchmark, double *ms) {
+  const BenchOptions *options = context->options;
+  char command[1024];
+  snprintf(command, sizeof(command),
+           "\"%s\" --headless --frames %u --size %ux%u --log-level error",
+           options->app, options->frames, options->width, options->height);
+
+  double total_ms = 0.0;
+  for (uint32_t i = 0; i < benchmark->iterations; i++) {
+    FILE *output = popen(command, "r");
+    if (!output) {
+      perror("popen");
+      return false;
+    }
+    char line[512];
+    bool found = false;
+    uint32_t frames = 0;
+    double seconds = 0.0;
+    while (fgets(line, sizeof(line), output)) {
+      const char *summary = strstr(line, "] headless ");
+      uint32_t width;
+      uint32_t height;
+      if (summary &&
+          sscanf(summary, "] headless %ux%u: %u frames in %lfs", &width,
+                 &height, &frames, &seconds) == 4)
+        found = true;
+    }
+    int status = pclose(output);
+    if (!found || status != 0 || frames == 0) {
+      printf(LOG_PREFIX " %s did not finish its headless run (status %d)\n",
+             options->app, status);
+      return false;
+    }
+    total_ms += seconds * 1e3 / frames;
+  }
+  *ms = total_ms / benchmark->iterations;
+  return true;
+}
+
+static const Benchmark benchmarks[] = {
+  {"stbi_load", run_decode, 4, BenchNeeds_Image},
+  {"convert_grey_to_rgba", run_convert, 16, BenchNeeds_None, 1,
+   PixelConvert_None},
+  {"convert_rgb_to_rgba", run_convert, 16, BenchNeeds_None, 3,
+   PixelConvert_None},
+  {"convert_swizzle_bgra", run_convert, 16, BenchNeeds_None, 4,
+   PixelConvert_SwizzleBGRA},
+  {"convert_premultiply_srgb", run_convert, 8, BenchNeeds_None, 4,
+   PixelConvert_SrgbToLinear | PixelConvert_PremultiplyAlpha |
+       PixelConvert_LinearToSrgb},
+  {"load_texture2D", run_load_texture, 4,
+   BenchNeeds_Image | BenchNeeds_Device},
+  {"load_shader_module", run_load_shader, 16,
+   BenchNeeds_Shader | BenchNeeds_Device},
+  {"headless_frame", run_headless_frames, 1, BenchNeeds_App},
+};
+#define BENCHMARK_COUNT (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+// Bytes each iteration reads, for throughput. Images count their decoded
+// size.
+static uint64_t bench_bytes(const Benchmark *benchmark,
+                            const BenchContext *context) {
+  if (benchmark->channels)
+    return (uint64_t)BENCH_CONVERT_WIDTH * BENCH_CONVERT_HEIGHT *
+           benchmark->channels;
+  int w;
+  int h;
+  int channels;
+  if ((benchmark->needs & BenchNeeds_Image) &&
+      stbi_info(context->options->image, &w, &h, &channels))
+    return (uint64_t)w * h * channels;
+  return 0;
+}
+#pragma endregion
+
+#pragma region statistics
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static BenchSummary summarize(const double *samples, uint32_t count) {
+  if (count == 0)
+    return (BenchSummary){0};
+  double sorted[BENCH_MAX_REPETITIONS];
+  memcpy(sorted, samples, sizeof(double) * count);
+  qsort(sorted, count, sizeof(double), compare_double);
+
+  double sum = 0.0;
+  for (uint32_t i = 0; i < count; i++)
+    sum += sorted[i];
+  double mean = sum / count;
+  double squares = 0.0;
+  for (uint32_t i = 0; i < count; i++)
+    squares += (sorted[i] - mean) * (sorted[i] - mean);
+
+  return (BenchSummary){
+    .meanMs = mean,
+    .stddevMs = count > 1 ? sqrt(squares / (count - 1)) : 0.0,
+    .minMs = sorted[0],
+    .medianMs = count % 2 ? sorted[count / 2]
+                          : (sorted[count / 2 - 1] + sorted[count / 2]) / 2,
+    // Nearest-rank, as in the frame profiler.
+    .p95Ms = sorted[((count - 1) * 95 + 50) / 100],
+    .maxMs = sorted[count - 1],
+  };
+}
+#pragma endregion
+
+#pragma region output
+static void write_json_string(FILE *file, const char *string) {
+  fputc('"', file);
+  for (const char *c = string ? string : ""; *c; c++) {
+    if (*c == '"' || *c == '\\')
+      fprintf(file, "\\%c", *c);
+    else if ((unsigned char)*c < 0x20)
+      fprintf(file, "\\u%04x", *c);
+    else
+      fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+static bool write_json(const char *path, const BenchOptions *options,
+                       const BenchResult *results, uint32_t resultCount) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+
+  fprintf(file, "{\n  \"version\": %d,\n  \"label\": ", BENCH_JSON_VERSION);
+  write_json_string(file, options->label);
+  fprintf(file, ",\n  \"isa\": \"%s\",\n  \"cpus\": %u,\n",
+          frmwrk_convert_isa(), frmwrk_cpu_count());
+  fprintf(file, "  \"warmup\": %u,\n  \"repetitions\": %u,\n",
+          options->warmup, options->repetitions);
+  fprintf(file, "  \"unit\": \"ms\",\n  \"results\": [\n");
+  for (uint32_t i = 0; i < resultCount; i++) {
+    const BenchResult *result = &results[i];
+    BenchSummary s = result->summary;
+    fprintf(file, "    {\"name\": \"%s\", \"iterations\": %u, "
+                  "\"bytes\": %llu,\n",
+            result->benchmark->name, result->benchmark->iterations,
+            (unsigned long long)result->bytes);
+    fprintf(file,
+            "     \"mean\": %.6f, \"stddev\": %.6f, \"min\": %.6f, "
+            "\"median\": %.6f, \"p95\": %.6f, \"max\": %.6f,\n",
+            s.meanMs, s.stddevMs, s.minMs, s.medianMs, s.p95Ms, s.maxMs);
+    fprintf(file, "     \"samples\": [");
+    for (uint32_t j = 0; j < result->sampleCount; j++)
+      fprintf(file, "%s%.6f", j ? ", " : "", result->samples[j]);
+    fprintf(file, "]}%s\n", i + 1 < resultCount ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+// Finds the median of `name` in a file written by write_json. Only that
+// layout is understood: each result's name comes before its median.
+static bool find_baseline_median(const char *json, const char *name,
+                                 double *median) {
+  char key[128];
+  snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+  const char *result = strstr(json, key);
+  if (!result)
+    return false;
+  const char *next = strstr(result + strlen(key), "\"name\": ");
+  const char *value = strstr(result, "\"median\": ");
+  if (!value || (next && value > next))
+    return false;
+  return sscanf(value, "\"median\": %lf", median) == 1;
+}
+
+static void print_results(const BenchResult *results, uint32_t resultCount) {
+  printf(LOG_PREFIX " %-26s %10s %10s %10s %10s %7s %10s %9s\n", "benchmark",
+         "median ms", "mean ms", "min ms", "p95 ms", "cv", "MB/s",
+         "baseline");
+  for (uint32_t i = 0; i < resultCount; i++) {
+    const BenchResult *result = &results[i];
+    BenchSummary s = result->summary;
+    char throughput[32] = "-";
+    if (result->bytes && s.medianMs > 0.0)
+      snprintf(throughput, sizeof(throughput), "%.1f",
+               result->bytes / (s.medianMs * 1e3));
+    char baseline[32] = "-";
+    if (result->hasBaseline && result->baselineMedianMs > 0.0)
+      snprintf(baseline, sizeof(baseline), "%+.1f%%",
+               100.0 * (s.medianMs / result->baselineMedianMs - 1.0));
+    printf(LOG_PREFIX " %-26s %10.4f %10.4f %10.4f %10.4f %6.1f%% %10s %9s\n",
+           result->benchmark->name, s.medianMs, s.meanMs, s.minMs, s.p95Ms,
+           s.meanMs > 0.0 ? 100.0 * s.stddevMs / s.meanMs : 0.0, throughput,
+           baseline);
+  }
+}
+#pragma endregion
+
+static bool create_device(BenchContext *context) {
+  context->instance = wgpuCreateInstance(&(const WGPUInstanceDescriptor){0});
+  if (!context->instance)
+    return false;
+  wgpuInstanceRequestAdapter(context->instance,
+                             &(const WGPURequestAdapterOptions){0},
+                             handle_request_adapter, context);
+  if (!context->adapter)
+    return false;
+  wgpuAdapterRequestDevice(context->adapter,
+                           &(const WGPUDeviceDescriptor){0},
+                           handle_request_device, context);
+  if (!context->device)
+    return false;
+  context->queue = wgpuDeviceGetQueue(context->device);
+  wgpuDeviceSetUncapturedErrorCallback(context->device,
+                                       handle_uncaptured_error, context);
+  context->uploadRing = frmwrk_create_upload_ring(context->device,
+                                                  BENCH_UPLOAD_RING_PAGE_SIZE);
+  return context->queue && context->uploadRing;
+}
+
+static bool create_sources(BenchContext *context) {
+  size_t pixels = (size_t)BENCH_CONVERT_WIDTH * BENCH_CONVERT_HEIGHT;
+  for (uint32_t channels = 1; channels <= 4; channels++) {
+    context->sources[channels - 1] = malloc(pixels * channels);
+    if (!context->sources[channels - 1])
+      return false;
+    fill_random(context->sources[channels - 1], pixels * channels,
+                BENCH_CONVERT_SEED + channels);
+  }
+  context->convertedPitch =
+      frmwrk_convert_aligned_row_pitch(BENCH_CONVERT_WIDTH);
+  context->converted =
+      malloc((size_t)context->convertedPitch * BENCH_CONVERT_HEIGHT);
+  return context->converted != NULL;
+}
+
+static void drop_context(BenchContext *context) {
+  if (context->uploadRing)
+    frmwrk_drop_upload_ring(context->uploadRing);
+  if (context->queue)
+    wgpuQueueDrop(context->queue);
+  if (context->device)
+    wgpuDeviceDrop(context->device);
+  if (context->adapter)
+    wgpuAdapterDrop(context->adapter);
+  if (context->instance)
+    wgpuInstanceDrop(context->instance);
+  for (uint32_t i = 0; i < 4; i++)
+    free(context->sources[i]);
+  free(context->converted);
+}
+
+static bool file_exists(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+  fclose(file);
+  return true;
+}
+
+// Why a benchmark cannot run here, or NULL.
+static const char *missing_need(const Benchmark *benchmark,
+                                const BenchContext *context) {
+  const BenchOptions *options = context->options;
+  if ((benchmark->needs & BenchNeeds_Device) && !context->device)
+    return "no device";
+  if ((benchmark->needs & BenchNeeds_App) && !options->app)
+    return "no --app";
+  if ((benchmark->needs & BenchNeeds_Image) && !file_exists(options->image))
+    return "image not found";
+  if ((benchmark->needs & BenchNeeds_Shader) && !file_exists(options->shader))
+    return "shader not found";
+  return NULL;
+}
+
+static void print_usage(const char *program) {
+  printf("usage: %s [--warmup N] [--repetitions N] [--filter NAME] "
+         "[--json FILE.json] [--baseline FILE.json] [--label TEXT] "
+         "[--image FILE] [--shader FILE.wgsl] [--app PATH] [--frames N] "
+         "[--size WIDTHxHEIGHT] [--list]\n",
+         program);
+}
+
+static bool parse_args(BenchOptions *options, int argc, char *argv[],
+                       bool *list) {
+  options->warmup = 2;
+  options->repetitions = 10;
+  options->image = "tbh.png";
+  // The demo's shader.wgsl needs the preprocessor; this one is plain WGSL.
+  options->shader = "mipmap.wgsl";
+  options->frames = 300;
+  options->width = 640;
+  options->height = 480;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (strcmp(arg, "--list") == 0) {
+      *list = true;
+      continue;
+    }
+    if (!value) {
+      printf(LOG_PREFIX " unknown option '%s'\n", arg);
+      return false;
+    }
+    if (strcmp(arg, "--warmup") == 0) {
+      options->warmup = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--repetitions") == 0) {
+      options->repetitions = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--filter") == 0) {
+      options->filter = value;
+    } else if (strcmp(arg, "--json") == 0) {
+      options->jsonPath = value;
+    } else if (strcmp(arg, "--baseline") == 0) {
+      options->baselinePath = value;
+    } else if (strcmp(arg, "--label") == 0) {
+      options->label = value;
+    } else if (strcmp(arg, "--image") == 0) {
+      options->image = value;
+    } else if (strcmp(arg, "--shader") == 0) {
+      options->shader = value;
+    } else if (strcmp(arg, "--app") == 0) {
+      options->app = value;
+    } else if (strcmp(arg, "--frames") == 0) {
+      options->frames = (uint32_t)strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--size") == 0) {
+      if (sscanf(value, "%ux%u", &options->width, &options->height) != 2)
+        return false;
+    } else {
+      printf(LOG_PREFIX " unknown option '%s'\n", arg);
+      return false;
+    }
+    i++;
+  }
+  return options->repetitions > 0 &&
+         options->repetitions <= BENCH_MAX_REPETITIONS &&
+         options->frames > 0 && options->width > 0 && options->height > 0;
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions options = {0};
+  bool list = false;
+  if (!parse_args(&options, argc, argv, &list)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+  if (list) {
+    for (uint32_t i = 0; i < BENCHMARK_COUNT; i++)
+      printf("%s\n", benchmarks[i].name);
+    return 0;
+  }
+
+  frmwrk_setup_logging(WGPULogLevel_Warn);
+  BenchContext context = {.options = &options};
+  BenchResult *results = calloc(BENCHMARK_COUNT, sizeof(BenchResult));
+  FrmwrkMappedFile baseline = {0};
+  bool has_baseline = false;
+  uint32_t result_count = 0;
+  int ret = 1;
+  if (!results || !create_sources(&context)) {
+    printf(LOG_PREFIX " out of memory\n");
+    goto cleanup_and_exit;
+  }
+  if (!create_device(&context))
+    printf(LOG_PREFIX " could not create a device, skipping GPU benchmarks\n");
+  if (options.baselinePath) {
+    has_baseline = frmwrk_map_file(options.baselinePath, &baseline);
+    if (!has_baseline)
+      printf(LOG_PREFIX " could not read %s\n", options.baselinePath);
+  }
+
+  printf(LOG_PREFIX " %u warm-up and %u timed repetitions, %s kernels, "
+                    "%u cpus\n",
+         options.warmup, options.repetitions, frmwrk_convert_isa(),
+         frmwrk_cpu_count());
+  ret = 0;
+  for (uint32_t i = 0; i < BENCHMARK_COUNT; i++) {
+    const Benchmark *benchmark = &benchmarks[i];
+    if (options.filter && !strstr(benchmark->name, options.filter))
+      continue;
+    const char *missing = missing_need(benchmark, &context);
+    if (missing) {
+      printf(LOG_PREFIX " skipping %s: %s\n", benchmark->name, missing);
+      continue;
+    }
+
+    // A failed benchmark leaves its samples in the slot the next one reuses.
+    BenchResult *result = &results[result_count];
+    *result = (BenchResult){.benchmark = benchmark};
+    result->bytes = bench_bytes(benchmark, &context);
+    uint64_t errors = context.errors;
+    bool ok = true;
+    for (uint32_t rep = 0; rep < options.warmup + options.repetitions && ok;
+         rep++) {
+      double ms = 0.0;
+      ok = benchmark->run(&context, benchmark, &ms);
+      if (ok && rep >= options.warmup)
+        result->samples[result->sampleCount++] = ms;
+    }
+    if (!ok || context.errors != errors) {
+      printf(LOG_PREFIX " %s failed\n", benchmark->name);
+      ret = 1;
+      continue;
+    }
+    result->summary = summarize(result->samples, result->sampleCount);
+    if (has_baseline)
+      result->hasBaseline = find_baseline_median(
+          baseline.data, benchmark->name, &result->baselineMedianMs);
+    result_count++;
+  }
+
+  print_results(results, result_count);
+  if (options.jsonPath && !write_json(options.jsonPath, &options, results,
+                                      result_count))
+    ret = 1;
+
+cleanup_and_exit:
+  if (has_baseline)
+    frmwrk_unmap_file(&baseline);
+  drop_context(&context);
+  free(results);
+  return ret;
+}
@@ -0,0 +1,212 @@
+// Job system scaling benchmark: runs the same rounds of jobs on 1 to N
+// threads and reports throughput and speedup over a single thread.
+//
+// Each round fans out from a few spawner jobs that queue the leaf jobs on
+// their own deques, so the other threads only get work by stealing, then
+// reduces the leaves' results in jobs that wait on the leaves' counter.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "framework.h"
+#include "job_system.h"
+
+#define LOG_PREFIX "[bench-jobs]"
+#define BENCH_SPAWNERS 64
+#define BENCH_REDUCERS 64
+
+typedef struct BenchOptions {
+  uint32_t maxThreads;
+  uint32_t jobCount;
+  // Iterations of the leaf jobs' arithmetic loop, roughly nanoseconds.
+  uint32_t work;
+  uint32_t rounds;
+} BenchOptions;
+
+typedef struct BenchRound BenchRound;
+
+typedef struct BenchSlice {
+  BenchRound *round;
+  uint32_t first;
+  uint32_t count;
+  uint64_t sum;
+} BenchSlice;
+
+struct BenchRound {
+  JobSystem *system;
+  uint32_t work;
+  uint64_t *results;
+  BenchSlice *leaves;
+  uint32_t leafCount;
+  BenchSlice spawners[BENCH_SPAWNERS];
+  BenchSlice reducers[BENCH_REDUCERS];
+  // Counts the spawners and every leaf they queue, so it only reaches zero
+  // once all of them are done.
+  JobCounter leafCounter;
+  JobCounter reduceCounter;
+};
+
+static void leaf_job(void *userdata) {
+  BenchSlice *leaf = userdata;
+  uint64_t x = leaf->first + 1;
+  for (uint32_t i = 0; i < leaf->round->work; i++) {
+    x = x * 6364136223846793005ull + 1442695040888963407ull;
+    x ^= x >> 33;
+  }
+  leaf->round->results[leaf->first] = x;
+}
+
+static void spawn_job(void *userdata) {
+  BenchSlice *spawner = userdata;
+  BenchRound *round = spawner->round;
+  JobDecl jobs[256];
+  for (uint32_t i = 0; i < spawner->count; i += 256) {
+    uint32_t batch = spawner->count - i < 256 ? spawner->count - i : 256;
+    for (uint32_t j = 0; j < batch; j++)
+      jobs[j] = (JobDecl){leaf_job, &round->leaves[spawner->first + i + j]};
+    frmwrk_job_system_run(round->system, jobs, batch, &round->leafCounter);
+  }
+}
+
+static void reduce_job(void *userdata) {
+  BenchSlice *reducer = userdata;
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < reducer->count; i++)
+    sum += reducer->round->results[reducer->first + i];
+  reducer->sum = sum;
+}
+
+static void split(BenchRound *round, BenchSlice *slices, uint32_t sliceCount) {
+  uint32_t per_slice = (round->leafCount + sliceCount - 1) / sliceCount;
+  for (uint32_t i = 0; i < sliceCount; i++) {
+    uint32_t first = i * per_slice < round->leafCount ? i * per_slice
+                                                      : round->leafCount;
+    uint32_t last = first + per_slice < round->leafCount ? first + per_slice
+                                                         : round->leafCount;
+    slices[i] = (BenchSlice){round, first, last - first, 0};
+  }
+}
+
+// Returns the sum of every leaf's result, which must not depend on the
+// thread count.
+static uint64_t run_round(BenchRound *round) {
+  JobDecl spawn[BENCH_SPAWNERS];
+  JobDecl reduce[BENCH_REDUCERS];
+  for (uint32_t i = 0; i < BENCH_SPAWNERS; i++)
+    spawn[i] = (JobDecl){spawn_job, &round->spawners[i]};
+  for (uint32_t i = 0; i < BENCH_REDUCERS; i++)
+    reduce[i] = (JobDecl){reduce_job, &round->reducers[i]};
+
+  frmwrk_job_system_run(round->system, spawn, BENCH_SPAWNERS,
+                        &round->leafCounter);
+  frmwrk_job_system_run_after(round->system, reduce, BENCH_REDUCERS,
+                              &round->leafCounter, &round->reduceCounter);
+  frmwrk_job_system_wait(round->system, &round->reduceCounter);
+
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < BENCH_REDUCERS; i++)
+    sum += round->reducers[i].sum;
+  return sum;
+}
+
+static void print_usage(const char *program) {
+  printf("usage: %s [--threads N] [--jobs N] [--work N] [--rounds N]\n",
+         program);
+}
+
+static bool parse_args(BenchOptions *options, int argc, char *argv[]) {
+  options->maxThreads = frmwrk_cpu_count();
+  options->jobCount = 65536;
+  options->work = 1000;
+  options->rounds = 10;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    uint32_t *target = NULL;
+    if (strcmp(arg, "--threads") == 0)
+      target = &options->maxThreads;
+    else if (strcmp(arg, "--jobs") == 0)
+      target = &options->jobCount;
+    else if (strcmp(arg, "--work") == 0)
+      target = &options->work;
+    else if (strcmp(arg, "--rounds") == 0)
+      target = &options->rounds;
+    if (!target || !value) {
+      printf(LOG_PREFIX " unknown option '%s'\n", arg);
+      return false;
+    }
+    *target = (uint32_t)strtoul(value, NULL, 10);
+    i++;
+  }
+  if (options->maxThreads > JOB_SYSTEM_MAX_THREADS)
+    options->maxThreads = JOB_SYSTEM_MAX_THREADS;
+  return options->maxThreads > 0 && options->jobCount > 0 &&
+         options->rounds > 0;
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions options = {0};
+  if (!parse_args(&options, argc, argv)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  BenchRound round = {0};
+  round.work = options.work;
+  round.leafCount = options.jobCount;
+  round.results = calloc(options.jobCount, sizeof(uint64_t));
+  round.leaves = calloc(options.jobCount, sizeof(BenchSlice));
+  if (!round.results || !round.leaves) {
+    printf(LOG_PREFIX " out of memory\n");
+    return 1;
+  }
+  for (uint32_t i = 0; i < options.jobCount; i++)
+    round.leaves[i] = (BenchSlice){&round, i, 1, 0};
+  split(&round, round.spawners, BENCH_SPAWNERS);
+  split(&round, round.reducers, BENCH_REDUCERS);
+
+  printf(LOG_PREFIX " %u jobs x %u iterations, %u rounds\n", options.jobCount,
+         options.work, options.rounds);
+  printf("%7s %12s %14s %8s %10s %8s\n", "threads", "ms/round", "jobs/s",
+         "speedup", "efficiency", "stolen");
+
+  int ret = 0;
+  uint64_t expected = 0;
+  double single_ms = 0.0;
+  for (uint32_t threads = 1; threads <= options.maxThreads; threads++) {
+    round.system = frmwrk_create_job_system(threads);
+    if (!round.system) {
+      printf(LOG_PREFIX " could not create a job system\n");
+      ret = 1;
+      break;
+    }
+    // Warms up the threads and the pools before timing.
+    uint64_t sum = run_round(&round);
+    JobWorkerStats before = frmwrk_job_system_stats(round.system);
+
+    uint64_t start = frmwrk_time_ns();
+    for (uint32_t i = 0; i < options.rounds; i++)
+      sum = run_round(&round);
+    double ms = (frmwrk_time_ns() - start) / 1e6 / options.rounds;
+    JobWorkerStats after = frmwrk_job_system_stats(round.system);
+    frmwrk_drop_job_system(round.system);
+
+    if (threads == 1) {
+      expected = sum;
+      single_ms = ms;
+    } else if (sum != expected) {
+      printf(LOG_PREFIX " %u threads produced a different result\n", threads);
+      ret = 1;
+    }
+    uint64_t executed = after.executed - before.executed;
+    double speedup = single_ms / ms;
+    printf("%7u %12.3f %14.0f %7.2fx %9.1f%% %7.1f%%\n", threads, ms,
+           options.jobCount / (ms / 1e3), speedup, 100.0 * speedup / threads,
+           executed ? 100.0 * (after.stolen - before.stolen) / executed
+                    : 0.0);
+  }
+
+  free(round.leaves);
+  free(round.results);
+  return ret;
+}
@@ -0,0 +1,787 @@
+#include "block_compress.h"
+#include <limits.h>
+#include <string.h>
+#include "threading.h"
+
+// Every format here comes down to the same inner loop: choose the nearest of
+// a few interpolated colors for each of 16 pixels. That search runs four
+// pixels at a time with SSE2 (the x86-64 baseline); endpoint fitting is
+// scalar float math on one block at a time.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define BLOCK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+const char *frmwrk_block_compress_isa(void) {
+#if defined(BLOCK_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+WGPUTextureFormat frmwrk_block_texture_format(BlockFormat format, bool srgb) {
+  switch (format) {
+  case BlockFormat_BC1:
+    return srgb ? WGPUTextureFormat_BC1RGBAUnormSrgb
+                : WGPUTextureFormat_BC1RGBAUnorm;
+  case BlockFormat_BC3:
+    return srgb ? WGPUTextureFormat_BC3RGBAUnormSrgb
+                : WGPUTextureFormat_BC3RGBAUnorm;
+  case BlockFormat_BC7:
+    return srgb ? WGPUTextureFormat_BC7RGBAUnormSrgb
+                : WGPUTextureFormat_BC7RGBAUnorm;
+  }
+  return WGPUTextureFormat_Undefined;
+}
+
+bool frmwrk_texture_format_block_info(WGPUTextureFormat format,
+                                      uint32_t *blockSize,
+                                      uint32_t *blockBytes) {
+  switch (format) {
+  case WGPUTextureFormat_RGBA8Unorm:
+  case WGPUTextureFormat_RGBA8UnormSrgb:
+  case WGPUTextureFormat_BGRA8Unorm:
+  case WGPUTextureFormat_BGRA8UnormSrgb:
+    *blockSize = 1;
+    *blockBytes = 4;
+    return true;
+  case WGPUTextureFormat_BC1RGBAUnorm:
+  case WGPUTextureFormat_BC1RGBAUnormSrgb:
+    *blockSize = 4;
+    *blockBytes = 8;
+    return true;
+  case WGPUTextureFormat_BC3RGBAUnorm:
+  case WGPUTextureFormat_BC3RGBAUnormSrgb:
+  case WGPUTextureFormat_BC7RGBAUnorm:
+  case WGPUTextureFormat_BC7RGBAUnormSrgb:
+    *blockSize = 4;
+    *blockBytes = 16;
+    return true;
+  default:
+    return false;
+  }
+}
+
+size_t frmwrk_texture_chain_size(WGPUTextureFormat format, uint32_t width,
+                                 uint32_t height, uint32_t levelCount) {
+  uint32_t block_size, block_bytes;
+  if (!frmwrk_texture_format_block_info(format, &block_size, &block_bytes))
+    return 0;
+  size_t size = 0;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint32_t w = width >> level ? width >> level : 1;
+    uint32_t h = height >> level ? height >> level : 1;
+    size += (size_t)((w + block_size - 1) / block_size) *
+            ((h + block_size - 1) / block_size) * block_bytes;
+  }
+  return size;
+}
+
+static float clamp_channel(float value) {
+  return value < 0.0f ? 0.0f : value > 255.0f ? 255.0f : value;
+}
+
+static uint32_t squared_distance(const uint8_t *a, const uint8_t *b,
+                                 uint32_t channels) {
+  uint32_t sum = 0;
+  for (uint32_t c = 0; c < channels; c++) {
+    int32_t d = (int32_t)a[c] - (int32_t)b[c];
+    sum += (uint32_t)(d * d);
+  }
+  return sum;
+}
+
+// Picks the nearest palette entry for each of the 16 pixels and returns the
+// summed squared error. Alpha only counts when `alpha` is set.
+static uint32_t select_indices(const uint8_t pixels[64],
+                               const uint8_t palette[][4],
+                               uint32_t paletteCount, bool alpha,
+                               uint8_t indices[16]) {
+#if defined(BLOCK_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = alpha ? _mm_set1_epi16(-1)
+                             : _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+  uint32_t total = 0;
+  for (uint32_t group = 0; group < 4; group++) {
+    __m128i px = _mm_loadu_si128((const __m128i *)(pixels + group * 16));
+    __m128i lo = _mm_unpacklo_epi8(px, zero);
+    __m128i hi = _mm_unpackhi_epi8(px, zero);
+    __m128i best = _mm_set1_epi32(INT_MAX);
+    __m128i best_index = zero;
+    for (uint32_t i = 0; i < paletteCount; i++) {
+      int32_t color;
+      memcpy(&color, palette[i], 4);
+      __m128i entry = _mm_unpacklo_epi8(_mm_set1_epi32(color), zero);
+      __m128i d_lo = _mm_sub_epi16(lo, entry);
+      __m128i d_hi = _mm_sub_epi16(hi, entry);
+      // Per pixel: [r*r + g*g, b*b + a*a], then the two halves summed.
+      __m128i s_lo = _mm_madd_epi16(d_lo, _mm_and_si128(d_lo, mask));
+      __m128i s_hi = _mm_madd_epi16(d_hi, _mm_and_si128(d_hi, mask));
+      s_lo = _mm_add_epi32(s_lo, _mm_shuffle_epi32(s_lo, _MM_SHUFFLE(2, 3, 0, 1)));
+      s_hi = _mm_add_epi32(s_hi, _mm_shuffle_epi32(s_hi, _MM_SHUFFLE(2, 3, 0, 1)));
+      __m128i distance =
+          _mm_unpacklo_epi64(_mm_shuffle_epi32(s_lo, _MM_SHUFFLE(3, 1, 2, 0)),
+                             _mm_shuffle_epi32(s_hi, _MM_SHUFFLE(3, 1, 2, 0)));
+      __m128i closer = _mm_cmplt_epi32(distance, best);
+      best = _mm_or_si128(_mm_and_si128(closer, distance),
+                          _mm_andnot_si128(closer, best));
+      best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int)i)),
+                                _mm_andnot_si128(closer, best_index));
+    }
+    int32_t errors[4];
+    int32_t selected[4];
+    _mm_storeu_si128((__m128i *)errors, best);
+    _mm_storeu_si128((__m128i *)selected, best_index);
+    for (uint32_t k = 0; k < 4; k++) {
+      indices[group * 4 + k] = (uint8_t)selected[k];
+      total += (uint32_t)errors[k];
+    }
+  }
+  return total;
+#else
+  uint32_t channels = alpha ? 4 : 3;
+  uint32_t total = 0;
+  for (uint32_t p = 0; p < 16; p++) {
+    uint32_t best = UINT32_MAX;
+    for (uint32_t i = 0; i < paletteCount; i++) {
+      uint32_t distance = squared_distance(pixels + p * 4, palette[i], channels);
+      if (distance < best) {
+        best = distance;
+        indices[p] = (uint8_t)i;
+      }
+    }
+    total += best;
+  }
+  return total;
+#endif
+}
+
+// Endpoints spanning the per-channel bounds of the pixels in `mask`, inset by
+// a sixteenth of the range. Channels that fall while the widest one rises are
+// flipped, which keeps the diagonal right for the common two-color blocks.
+static void fit_bounds(const uint8_t pixels[64], uint32_t mask,
+                       uint32_t channels, float e0[4], float e1[4]) {
+  float low[4] = {255.0f, 255.0f, 255.0f, 255.0f};
+  float high[4] = {0};
+  float mean[4] = {0};
+  uint32_t count = 0;
+  for (uint32_t p = 0; p < 16; p++) {
+    if (!(mask & (1u << p)))
+      continue;
+    for (uint32_t c = 0; c < channels; c++) {
+      float v = pixels[p * 4 + c];
+      low[c] = v < low[c] ? v : low[c];
+      high[c] = v > high[c] ? v : high[c];
+      mean[c] += v;
+    }
+    count++;
+  }
+  uint32_t widest = 0;
+  for (uint32_t c = 0; c < channels; c++) {
+    mean[c] /= (float)count;
+    if (high[c] - low[c] > high[widest] - low[widest])
+      widest = c;
+  }
+  for (uint32_t c = 0; c < channels; c++) {
+    float covariance = 0.0f;
+    for (uint32_t p = 0; p < 16; p++) {
+      if (mask & (1u << p))
+        covariance += (pixels[p * 4 + c] - mean[c]) *
+                      (pixels[p * 4 + widest] - mean[widest]);
+    }
+    float inset = (high[c] - low[c]) / 16.0f;
+    float from = low[c] + inset;
+    float to = high[c] - inset;
+    e0[c] = covariance < 0.0f ? to : from;
+    e1[c] = covariance < 0.0f ? from : to;
+  }
+  for (uint32_t c = channels; c < 4; c++)
+    e0[c] = e1[c] = 255.0f;
+}
+
+// Endpoints at the extremes of the pixels' projection onto their principal
+// axis, found by power iteration on the covariance matrix.
+static void fit_principal_axis(const uint8_t pixels[64], uint32_t mask,
+                               uint32_t channels, float e0[4], float e1[4]) {
+  float mean[4] = {0};
+  uint32_t count = 0;
+  for (uint32_t p = 0; p < 16; p++) {
+    if (!(mask & (1u << p)))
+      continue;
+    for (uint32_t c = 0; c < channels; c++)
+      mean[c] += pixels[p * 4 + c];
+    count++;
+  }
+  for (uint32_t c = 0; c < channels; c++)
+    mean[c] /= (float)count;
+
+  float covariance[4][4] = {{0}};
+  for (uint32_t p = 0; p < 16; p++) {
+    if (!(mask & (1u << p)))
+      continue;
+    float d[4];
+    for (uint32_t c = 0; c < channels; c++)
+      d[c] = pixels[p * 4 + c] - mean[c];
+    for (uint32_t i = 0; i < channels; i++) {
+      for (uint32_t j = 0; j < channels; j++)
+        covariance[i][j] += d[i] * d[j];
+    }
+  }
+
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (uint32_t iteration = 0; iteration < 8; iteration++) {
+    float next[4] = {0};
+    float largest = 0.0f;
+    for (uint32_t i = 0; i < channels; i++) {
+      for (uint32_t j = 0; j < channels; j++)
+        next[i] += covariance[i][j] * axis[j];
+      float magnitude = next[i] < 0.0f ? -next[i] : next[i];
+      largest = magnitude > largest ? magnitude : largest;
+    }
+    // A flat block has no axis; both endpoints collapse onto the mean.
+    if (largest == 0.0f)
+      break;
+    for (uint32_t i = 0; i < channels; i++)
+      axis[i] = next[i] / largest;
+  }
+
+  float length = 0.0f;
+  for (uint32_t c = 0; c < channels; c++)
+    length += axis[c] * axis[c];
+  float low = 0.0f, high = 0.0f;
+  if (length > 0.0f) {
+    low = 1e30f;
+    high = -1e30f;
+    for (uint32_t p = 0; p < 16; p++) {
+      if (!(mask & (1u << p)))
+        continue;
+      float t = 0.0f;
+      for (uint32_t c = 0; c < channels; c++)
+        t += (pixels[p * 4 + c] - mean[c]) * axis[c];
+      t /= length;
+      low = t < low ? t : low;
+      high = t > high ? t : high;
+    }
+  }
+  for (uint32_t c = 0; c < channels; c++) {
+    e0[c] = clamp_channel(mean[c] + axis[c] * low);
+    e1[c] = clamp_channel(mean[c] + axis[c] * high);
+  }
+  for (uint32_t c = channels; c < 4; c++)
+    e0[c] = e1[c] = 255.0f;
+}
+
+// Least-squares endpoints for fixed indices, where index i blends the
+// endpoints by weights[i]. Returns false when the system is singular (every
+// pixel on one weight) and leaves the endpoints alone.
+static bool refine_endpoints(const uint8_t pixels[64], uint32_t mask,
+                             uint32_t channels, const uint8_t indices[16],
+                             const float *weights, float e0[4], float e1[4]) {
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[4] = {0}, bx[4] = {0};
+  for (uint32_t p = 0; p < 16; p++) {
+    if (!(mask & (1u << p)))
+      continue;
+    float b = weights[indices[p]];
+    float a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (uint32_t c = 0; c < channels; c++) {
+      ax[c] += a * pixels[p * 4 + c];
+      bx[c] += b * pixels[p * 4 + c];
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (determinant < 1e-6f && determinant > -1e-6f)
+    return false;
+  for (uint32_t c = 0; c < channels; c++) {
+    e0[c] = clamp_channel((bb * ax[c] - ab * bx[c]) / determinant);
+    e1[c] = clamp_channel((aa * bx[c] - ab * ax[c]) / determinant);
+  }
+  return true;
+}
+
+static uint32_t refinement_passes(BlockQuality quality) {
+  return quality == BlockQuality_High ? 2 : quality == BlockQuality_Normal;
+}
+
+// Starting endpoints each block is encoded from. Fast takes the bounding box
+// alone; the others also try the principal axis and keep whichever block ends
+// up closer, so they never do worse than Fast.
+static uint32_t fit_count(BlockQuality quality) {
+  return quality == BlockQuality_Fast ? 1 : 2;
+}
+
+static void fit_endpoints(const uint8_t pixels[64], uint32_t mask,
+                          uint32_t channels, uint32_t fit, float e0[4],
+                          float e1[4]) {
+  if (fit == 0)
+    fit_bounds(pixels, mask, channels, e0, e1);
+  else
+    fit_principal_axis(pixels, mask, channels, e0, e1);
+}
+
+static void swap_endpoints(float e0[4], float e1[4]) {
+  for (uint32_t c = 0; c < 4; c++) {
+    float t = e0[c];
+    e0[c] = e1[c];
+    e1[c] = t;
+  }
+}
+
+#pragma region BC1
+typedef struct ColorBlock {
+  uint16_t c0;
+  uint16_t c1;
+  uint8_t indices[16];
+  uint32_t error;
+} ColorBlock;
+
+// Weights of each index towards the second endpoint.
+static const float bc1_weights4[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+static const float bc1_weights3[4] = {0.0f, 1.0f, 0.5f, 0.0f};
+
+static uint16_t pack_565(const float color[4]) {
+  uint32_t r = (uint32_t)(clamp_channel(color[0]) * 31.0f / 255.0f + 0.5f);
+  uint32_t g = (uint32_t)(clamp_channel(color[1]) * 63.0f / 255.0f + 0.5f);
+  uint32_t b = (uint32_t)(clamp_channel(color[2]) * 31.0f / 255.0f + 0.5f);
+  return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void unpack_565(uint16_t color, uint8_t out[4]) {
+  uint32_t r = color >> 11;
+  uint32_t g = (color >> 5) & 63;
+  uint32_t b = color & 31;
+  out[0] = (uint8_t)(r << 3 | r >> 2);
+  out[1] = (uint8_t)(g << 2 | g >> 4);
+  out[2] = (uint8_t)(b << 3 | b >> 2);
+  out[3] = 255;
+}
+
+// Quantizes the endpoints and picks indices. Four-color blocks need c0 > c1
+// and three-color ones (punch-through alpha) c0 <= c1, so the endpoints are
+// swapped in place to match the order written.
+static void bc1_evaluate(const uint8_t pixels[64], uint32_t transparent,
+                         bool three_color, float e0[4], float e1[4],
+                         ColorBlock *block) {
+  uint16_t c0 = pack_565(e0);
+  uint16_t c1 = pack_565(e1);
+  if (three_color ? c0 > c1 : c0 < c1) {
+    uint16_t t = c0;
+    c0 = c1;
+    c1 = t;
+    swap_endpoints(e0, e1);
+  }
+
+  uint8_t palette[4][4];
+  unpack_565(c0, palette[0]);
+  unpack_565(c1, palette[1]);
+  uint32_t count = 4;
+  if (three_color) {
+    for (uint32_t c = 0; c < 3; c++)
+      palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+    count = 3;
+  } else if (c0 == c1) {
+    // Equal endpoints decode as a three-color block; index 0 is still exact.
+    count = 1;
+  } else {
+    for (uint32_t c = 0; c < 3; c++) {
+      palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+      palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+    }
+  }
+
+  block->c0 = c0;
+  block->c1 = c1;
+  block->error = select_indices(pixels, palette, count, false, block->indices);
+  for (uint32_t p = 0; p < 16; p++) {
+    if (!(transparent & (1u << p)))
+      continue;
+    block->error -= squared_distance(pixels + p * 4,
+                                     palette[block->indices[p]], 3);
+    block->indices[p] = 3;
+  }
+}
+
+// `punchThrough` lets pixels with alpha below 128 use BC1's transparent
+// index; BC3 color blocks are always opaque four-color blocks.
+static void encode_bc1_color(const uint8_t pixels[64], BlockQuality quality,
+                             bool punchThrough, uint8_t out[8]) {
+  uint32_t transparent = 0;
+  if (punchThrough) {
+    for (uint32_t p = 0; p < 16; p++) {
+      if (pixels[p * 4 + 3] < 128)
+        transparent |= 1u << p;
+    }
+  }
+  uint32_t opaque = ~transparent & 0xFFFF;
+
+  ColorBlock best;
+  if (opaque == 0) {
+    best = (ColorBlock){0};
+    memset(best.indices, 3, sizeof(best.indices));
+  } else {
+    bool three_color = transparent != 0;
+    const float *weights = three_color ? bc1_weights3 : bc1_weights4;
+    for (uint32_t fit = 0; fit < fit_count(quality); fit++) {
+      float e0[4], e1[4];
+      ColorBlock block;
+      fit_endpoints(pixels, opaque, 3, fit, e0, e1);
+      bc1_evaluate(pixels, transparent, three_color, e0, e1, &block);
+      for (uint32_t pass = 0; pass < refinement_passes(quality); pass++) {
+        if (!refine_endpoints(pixels, opaque, 3, block.indices, weights, e0,
+                              e1))
+          break;
+        ColorBlock candidate;
+        bc1_evaluate(pixels, transparent, three_color, e0, e1, &candidate);
+        if (candidate.error >= block.error)
+          break;
+        block = candidate;
+      }
+      if (fit == 0 || block.error < best.error)
+        best = block;
+    }
+  }
+
+  uint32_t bits = 0;
+  for (uint32_t p = 0; p < 16; p++)
+    bits |= (uint32_t)best.indices[p] << (p * 2);
+  out[0] = (uint8_t)best.c0;
+  out[1] = (uint8_t)(best.c0 >> 8);
+  out[2] = (uint8_t)best.c1;
+  out[3] = (uint8_t)(best.c1 >> 8);
+  for (uint32_t i = 0; i < 4; i++)
+    out[4 + i] = (uint8_t)(bits >> (i * 8));
+}
+#pragma endregion
+
+#pragma region BC3 alpha
+// Builds the palette of an alpha block: eight interpolated values when
+// a0 > a1, otherwise six plus exact 0 and 255.
+static void alpha_palette(uint8_t a0, uint8_t a1, uint8_t palette[8]) {
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (uint32_t i = 2; i < 8; i++)
+      palette[i] = (uint8_t)(((8 - i) * a0 + (i - 1) * a1 + 3) / 7);
+  } else {
+    for (uint32_t i = 2; i < 6; i++)
+      palette[i] = (uint8_t)(((6 - i) * a0 + (i - 1) * a1 + 2) / 5);
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+static uint32_t alpha_indices(const uint8_t pixels[64], const uint8_t palette[8],
+                              uint8_t indices[16]) {
+  uint32_t total = 0;
+  for (uint32_t p = 0; p < 16; p++) {
+    uint32_t best = UINT32_MAX;
+    for (uint32_t i = 0; i < 8; i++) {
+      int32_t d = (int32_t)pixels[p * 4 + 3] - (int32_t)palette[i];
+      if ((uint32_t)(d * d) < best) {
+        best = (uint32_t)(d * d);
+        indices[p] = (uint8_t)i;
+      }
+    }
+    total += best;
+  }
+  return total;
+}
+
+static void encode_alpha(const uint8_t pixels[64], BlockQuality quality,
+                         uint8_t out[8]) {
+  uint8_t low = 255, high = 0;
+  // Range of the values other than 0 and 255, which the six-value mode has
+  // exact entries for.
+  uint8_t inner_low = 255, inner_high = 0;
+  for (uint32_t p = 0; p < 16; p++) {
+    uint8_t a = pixels[p * 4 + 3];
+    low = a < low ? a : low;
+    high = a > high ? a : high;
+    if (a != 0 && a != 255) {
+      inner_low = a < inner_low ? a : inner_low;
+      inner_high = a > inner_high ? a : inner_high;
+    }
+  }
+
+  uint8_t a0 = high, a1 = low;
+  uint8_t palette[8];
+  uint8_t indices[16];
+  alpha_palette(a0, a1, palette);
+  uint32_t error = alpha_indices(pixels, palette, indices);
+  if (quality == BlockQuality_High && error > 0 && inner_low <= inner_high) {
+    uint8_t six_indices[16];
+    alpha_palette(inner_low, inner_high, palette);
+    if (alpha_indices(pixels, palette, six_indices) < error) {
+      a0 = inner_low;
+      a1 = inner_high;
+      memcpy(indices, six_indices, sizeof(indices));
+    }
+  }
+
+  uint64_t bits = 0;
+  for (uint32_t p = 0; p < 16; p++)
+    bits |= (uint64_t)indices[p] << (p * 3);
+  out[0] = a0;
+  out[1] = a1;
+  for (uint32_t i = 0; i < 6; i++)
+    out[2 + i] = (uint8_t)(bits >> (i * 8));
+}
+#pragma endregion
+
+#pragma region BC7
+typedef struct Bc7Block {
+  uint8_t q0[4];
+  uint8_t q1[4];
+  uint32_t p0;
+  uint32_t p1;
+  uint8_t indices[16];
+  uint32_t error;
+} Bc7Block;
+
+static const uint8_t bc7_weights4[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                         34, 38, 43, 47, 51, 55, 60, 64};
+static const float bc7_weight_table[16] = {
+  0.0f / 64,  4.0f / 64,  9.0f / 64,  13.0f / 64, 17.0f / 64, 21.0f / 64,
+  26.0f / 64, 30.0f / 64, 34.0f / 64, 38.0f / 64, 43.0f / 64, 47.0f / 64,
+  51.0f / 64, 55.0f / 64, 60.0f / 64, 64.0f / 64};
+
+// Endpoints are 7 bits per channel plus a shared low bit per endpoint.
+static void bc7_quantize(const float e[4], uint32_t pbit, uint8_t q[4]) {
+  for (uint32_t c = 0; c < 4; c++) {
+    float v = (clamp_channel(e[c]) - (float)pbit) / 2.0f + 0.5f;
+    int32_t quantized = (int32_t)v;
+    q[c] = (uint8_t)(quantized < 0 ? 0 : quantized > 127 ? 127 : quantized);
+  }
+}
+
+static uint32_t bc7_quantization_error(const float e[4], uint32_t pbit) {
+  uint8_t q[4];
+  bc7_quantize(e, pbit, q);
+  float error = 0.0f;
+  for (uint32_t c = 0; c < 4; c++) {
+    float d = (float)(q[c] << 1 | pbit) - e[c];
+    error += d * d;
+  }
+  return (uint32_t)error;
+}
+
+static void bc7_evaluate(const uint8_t pixels[64], const float e0[4],
+                         const float e1[4], uint32_t p0, uint32_t p1,
+                         Bc7Block *block) {
+  bc7_quantize(e0, p0, block->q0);
+  bc7_quantize(e1, p1, block->q1);
+  block->p0 = p0;
+  block->p1 = p1;
+  uint8_t palette[16][4];
+  for (uint32_t i = 0; i < 16; i++) {
+    uint32_t w = bc7_weights4[i];
+    for (uint32_t c = 0; c < 4; c++) {
+      uint32_t a = (uint32_t)(block->q0[c] << 1 | p0);
+      uint32_t b = (uint32_t)(block->q1[c] << 1 | p1);
+      palette[i][c] = (uint8_t)(((64 - w) * a + w * b + 32) >> 6);
+    }
+  }
+  block->error = select_indices(pixels, palette, 16, true, block->indices);
+}
+
+// Picks shared bits: by endpoint rounding error, or with `search` by trying
+// all four pairs against the pixels.
+static void bc7_encode_endpoints(const uint8_t pixels[64], const float e0[4],
+                                 const float e1[4], bool search,
+                                 Bc7Block *block) {
+  if (!search) {
+    uint32_t p0 = bc7_quantization_error(e0, 1) < bc7_quantization_error(e0, 0);
+    uint32_t p1 = bc7_quantization_error(e1, 1) < bc7_quantization_error(e1, 0);
+    bc7_evaluate(pixels, e0, e1, p0, p1, block);
+    return;
+  }
+  bc7_evaluate(pixels, e0, e1, 0, 0, block);
+  for (uint32_t bits = 1; bits < 4; bits++) {
+    Bc7Block candidate;
+    bc7_evaluate(pixels, e0, e1, bits & 1, bits >> 1, &candidate);
+    if (candidate.error < block->error)
+      *block = candidate;
+  }
+}
+
+typedef struct BitWriter {
+  uint8_t *out;
+  uint32_t bit;
+} BitWriter;
+
+static void write_bits(BitWriter *writer, uint32_t value, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, writer->bit++) {
+    if (value & (1u << i))
+      writer->out[writer->bit >> 3] |= (uint8_t)(1u << (writer->bit & 7));
+  }
+}
+
+static void encode_bc7(const uint8_t pixels[64], BlockQuality quality,
+                       uint8_t out[16]) {
+  bool search = quality == BlockQuality_High;
+  Bc7Block best;
+  for (uint32_t fit = 0; fit < fit_count(quality); fit++) {
+    float e0[4], e1[4];
+    Bc7Block block;
+    fit_endpoints(pixels, 0xFFFF, 4, fit, e0, e1);
+    bc7_encode_endpoints(pixels, e0, e1, search, &block);
+    for (uint32_t pass = 0; pass < refinement_passes(quality); pass++) {
+      if (!refine_endpoints(pixels, 0xFFFF, 4, block.indices,
+                            bc7_weight_table, e0, e1))
+        break;
+      Bc7Block candidate;
+      bc7_encode_endpoints(pixels, e0, e1, search, &candidate);
+      if (candidate.error >= block.error)
+        break;
+      block = candidate;
+    }
+    if (fit == 0 || block.error < best.error)
+      best = block;
+  }
+
+  // The first index is stored without its top bit, which must be clear;
+  // swapping the endpoints mirrors every index.
+  if (best.indices[0] & 8) {
+    uint8_t q[4];
+    memcpy(q, best.q0, 4);
+    memcpy(best.q0, best.q1, 4);
+    memcpy(best.q1, q, 4);
+    uint32_t p = best.p0;
+    best.p0 = best.p1;
+    best.p1 = p;
+    for (uint32_t i = 0; i < 16; i++)
+      best.indices[i] = (uint8_t)(15 - best.indices[i]);
+  }
+
+  memset(out, 0, 16);
+  BitWriter writer = {.out = out};
+  write_bits(&writer, 1u << 6, 7);
+  for (uint32_t c = 0; c < 4; c++) {
+    write_bits(&writer, best.q0[c], 7);
+    write_bits(&writer, best.q1[c], 7);
+  }
+  write_bits(&writer, best.p0, 1);
+  write_bits(&writer, best.p1, 1);
+  write_bits(&writer, best.indices[0], 3);
+  for (uint32_t i = 1; i < 16; i++)
+    write_bits(&writer, best.indices[i], 4);
+}
+#pragma endregion
+
+static void load_block(uint8_t block[64], const uint8_t *src,
+                       uint32_t srcBytesPerRow, uint32_t width, uint32_t height,
+                       uint32_t bx, uint32_t by) {
+  for (uint32_t y = 0; y < 4; y++) {
+    uint32_t sy = by * 4 + y < height ? by * 4 + y : height - 1;
+    const uint8_t *row = src + (size_t)sy * srcBytesPerRow;
+    for (uint32_t x = 0; x < 4; x++) {
+      uint32_t sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+      memcpy(block + (y * 4 + x) * 4, row + (size_t)sx * 4, 4);
+    }
+  }
+}
+
+typedef struct CompressJob {
+  uint8_t *dst;
+  uint32_t dstBytesPerRow;
+  const uint8_t *src;
+  uint32_t srcBytesPerRow;
+  uint32_t width;
+  uint32_t height;
+  BlockFormat format;
+  BlockQuality quality;
+  uint32_t firstRow;
+  uint32_t rowCount;
+} CompressJob;
+
+static void compress_rows(void *userdata) {
+  const CompressJob *job = userdata;
+  uint32_t block_bytes = job->format == BlockFormat_BC1 ? 8 : 16;
+  uint32_t columns = (job->width + 3) / 4;
+  for (uint32_t by = job->firstRow; by < job->firstRow + job->rowCount; by++) {
+    uint8_t *out = job->dst + (size_t)by * job->dstBytesPerRow;
+    for (uint32_t bx = 0; bx < columns; bx++, out += block_bytes) {
+      uint8_t pixels[64];
+      load_block(pixels, job->src, job->srcBytesPerRow, job->width,
+                 job->height, bx, by);
+      switch (job->format) {
+      case BlockFormat_BC1:
+        encode_bc1_color(pixels, job->quality, true, out);
+        break;
+      case BlockFormat_BC3:
+        encode_alpha(pixels, job->quality, out);
+        encode_bc1_color(pixels, job->quality, false, out + 8);
+        break;
+      case BlockFormat_BC7:
+        encode_bc7(pixels, job->quality, out);
+        break;
+      }
+    }
+  }
+}
+
+void frmwrk_compress_blocks(uint8_t *dst, uint32_t dstBytesPerRow,
+                            const uint8_t *src, uint32_t srcBytesPerRow,
+                            uint32_t width, uint32_t height,
+                            BlockFormat format, BlockQuality quality,
+                            uint32_t threadCount) {
+  uint32_t rows = (height + 3) / 4;
+  uint32_t threads = threadCount ? threadCount : frmwrk_cpu_count();
+  uint32_t max_threads = rows / BLOCK_COMPRESS_MIN_ROWS_PER_THREAD;
+  if (threads > max_threads)
+    threads = max_threads ? max_threads : 1;
+  if (threads > BLOCK_COMPRESS_MAX_THREADS)
+    threads = BLOCK_COMPRESS_MAX_THREADS;
+
+  CompressJob jobs[BLOCK_COMPRESS_MAX_THREADS];
+  FrmwrkThread workers[BLOCK_COMPRESS_MAX_THREADS];
+  bool started[BLOCK_COMPRESS_MAX_THREADS] = {false};
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < threads; i++) {
+    uint32_t count = rows / threads + (i < rows % threads);
+    jobs[i] = (CompressJob){
+      .dst = dst,
+      .dstBytesPerRow = dstBytesPerRow,
+      .src = src,
+      .srcBytesPerRow = srcBytesPerRow,
+      .width = width,
+      .height = height,
+      .format = format,
+      .quality = quality,
+      .firstRow = first,
+      .rowCount = count
+    };
+    first += count;
+  }
+  for (uint32_t i = 1; i < threads; i++)
+    started[i] = frmwrk_thread_create(&workers[i], compress_rows, &jobs[i]);
+  compress_rows(&jobs[0]);
+  for (uint32_t i = 1; i < threads; i++) {
+    // A worker that failed to start leaves its rows to this thread.
+    if (started[i])
+      frmwrk_thread_join(workers[i]);
+    else
+      compress_rows(&jobs[i]);
+  }
+}
+
+void frmwrk_compress_mip_chain(uint8_t *dst, const uint8_t *chain,
+                               uint32_t width, uint32_t height,
+                               uint32_t levelCount, BlockFormat format,
+                               BlockQuality quality, uint32_t threadCount) {
+  uint32_t block_bytes = format == BlockFormat_BC1 ? 8 : 16;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint32_t w = width >> level ? width >> level : 1;
+    uint32_t h = height >> level ? height >> level : 1;
+    uint32_t pitch = (w + 3) / 4 * block_bytes;
+    frmwrk_compress_blocks(dst, pitch, chain, w * 4, w, h, format, quality,
+                           threadCount);
+    dst += (size_t)pitch * ((h + 3) / 4);
+    chain += (size_t)w * h * 4;
+  }
+}
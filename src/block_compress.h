@@ -0,0 +1,62 @@
+#ifndef BLOCK_COMPRESS_H
+#define BLOCK_COMPRESS_H
+
+#include "framework.h"
+
+// Below this many block rows per thread an image is not worth splitting.
+#define BLOCK_COMPRESS_MIN_ROWS_PER_THREAD 4
+#define BLOCK_COMPRESS_MAX_THREADS 64
+
+typedef enum BlockFormat {
+  // 8 bytes per 4x4 block: RGB with 1-bit punch-through alpha.
+  BlockFormat_BC1,
+  // 16 bytes: BC1 color plus a separately interpolated alpha block.
+  BlockFormat_BC3,
+  // 16 bytes: high quality RGBA. Only mode 6 (one subset, 4-bit indices,
+  // shared-bit 7777 endpoints) is encoded.
+  BlockFormat_BC7,
+} BlockFormat;
+
+typedef enum BlockQuality {
+  // Bounding-box endpoints, no refinement.
+  BlockQuality_Fast,
+  // Bounding-box and principal-axis endpoints, each refined once by least
+  // squares; the closer block is kept.
+  BlockQuality_Normal,
+  // Two refinement passes and an exhaustive search of the cheap choices
+  // (BC7 shared bits, BC3 alpha modes).
+  BlockQuality_High,
+} BlockQuality;
+
+WGPUTextureFormat frmwrk_block_texture_format(BlockFormat format, bool srgb);
+// Footprint of formats the framework uploads: 1x1 texels of 4 bytes for the
+// 8-bit RGBA formats, 4x4 blocks of 8 or 16 bytes for BC1/BC3/BC7. Returns
+// false for anything else.
+bool frmwrk_texture_format_block_info(WGPUTextureFormat format,
+                                      uint32_t *blockSize,
+                                      uint32_t *blockBytes);
+// Bytes of `levelCount` levels of `format`, each tightly packed in whole
+// blocks, level 0 first.
+size_t frmwrk_texture_chain_size(WGPUTextureFormat format, uint32_t width,
+                                 uint32_t height, uint32_t levelCount);
+
+// Encodes RGBA8 rows `srcBytesPerRow` apart into blocks, rows of blocks
+// `dstBytesPerRow` apart. Edge blocks repeat the last row and column. Block
+// rows are split across `threadCount` threads (0 = one per logical
+// processor), with the caller taking the first share.
+void frmwrk_compress_blocks(uint8_t *dst, uint32_t dstBytesPerRow,
+                            const uint8_t *src, uint32_t srcBytesPerRow,
+                            uint32_t width, uint32_t height,
+                            BlockFormat format, BlockQuality quality,
+                            uint32_t threadCount);
+// Encodes a chain laid out as by frmwrk_mip_chain_size into `dst`, laid out
+// as by frmwrk_texture_chain_size.
+void frmwrk_compress_mip_chain(uint8_t *dst, const uint8_t *chain,
+                               uint32_t width, uint32_t height,
+                               uint32_t levelCount, BlockFormat format,
+                               BlockQuality quality, uint32_t threadCount);
+
+// Instruction set the index search runs on: "sse2" or "scalar".
+const char *frmwrk_block_compress_isa(void);
+
+#endif // BLOCK_COMPRESS_H
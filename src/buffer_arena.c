@@ -0,0 +1,678 @@
+#include "buffer_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static uint32_t highest_bit(uint64_t value) {
+  uint32_t bit = 0;
+  while (value >>= 1)
+    bit++;
+  return bit;
+}
+
+static uint32_t lowest_bit(uint64_t value) {
+  uint32_t bit = 0;
+  while (!(value & 1)) {
+    value >>= 1;
+    bit++;
+  }
+  return bit;
+}
+
+// Size class of a free range of `size` bytes. Sizes below SL_COUNT granules
+// get a class each; above that each power of two is split SL_COUNT ways.
+static void mapping(uint64_t size, uint32_t *fl, uint32_t *sl) {
+  uint64_t units = size / BUFFER_ARENA_GRANULARITY;
+  if (units < BUFFER_ARENA_SL_COUNT) {
+    *fl = 0;
+    *sl = (uint32_t)units;
+    return;
+  }
+  uint32_t msb = highest_bit(units);
+  *fl = msb - BUFFER_ARENA_SL_BITS + 1;
+  *sl = (uint32_t)(units >> (msb - BUFFER_ARENA_SL_BITS)) -
+        BUFFER_ARENA_SL_COUNT;
+}
+
+// The first class whose every range is at least `size`, so the head of any
+// non-empty list at or above it fits without walking the list.
+static void mapping_search(uint64_t size, uint32_t *fl, uint32_t *sl) {
+  uint64_t units = size / BUFFER_ARENA_GRANULARITY;
+  if (units >= BUFFER_ARENA_SL_COUNT) {
+    uint32_t msb = highest_bit(units);
+    uint64_t class_size = (uint64_t)BUFFER_ARENA_GRANULARITY
+                          << (msb - BUFFER_ARENA_SL_BITS);
+    size += class_size - 1;
+  }
+  mapping(size, fl, sl);
+}
+
+static uint32_t node_new(BufferArena *arena) {
+  if (arena->unusedNodes != BUFFER_ARENA_NONE) {
+    uint32_t index = arena->unusedNodes;
+    arena->unusedNodes = arena->nodes[index].nextFree;
+    return index;
+  }
+  if (arena->nodeCount == arena->nodeCapacity) {
+    uint32_t capacity = arena->nodeCapacity ? arena->nodeCapacity * 2 : 64;
+    BufferArenaNode *nodes =
+        realloc(arena->nodes, sizeof(BufferArenaNode) * capacity);
+    if (!nodes)
+      return BUFFER_ARENA_NONE;
+    arena->nodes = nodes;
+    arena->nodeCapacity = capacity;
+  }
+  return arena->nodeCount++;
+}
+
+static void node_recycle(BufferArena *arena, uint32_t index) {
+  arena->nodes[index] = (BufferArenaNode){
+    .state = BufferArenaNodeState_Unused,
+    .nextFree = arena->unusedNodes
+  };
+  arena->unusedNodes = index;
+}
+
+static void free_insert(BufferArena *arena, uint32_t index) {
+  BufferArenaNode *node = &arena->nodes[index];
+  uint32_t fl, sl;
+  mapping(node->size, &fl, &sl);
+  node->state = BufferArenaNodeState_Free;
+  node->allocation = BUFFER_ARENA_NONE;
+  node->prevFree = BUFFER_ARENA_NONE;
+  node->nextFree = arena->freeHeads[fl][sl];
+  if (node->nextFree != BUFFER_ARENA_NONE)
+    arena->nodes[node->nextFree].prevFree = index;
+  arena->freeHeads[fl][sl] = index;
+  arena->flBitmap |= 1ull << fl;
+  arena->slBitmaps[fl] |= 1u << sl;
+}
+
+static void free_remove(BufferArena *arena, uint32_t index) {
+  BufferArenaNode *node = &arena->nodes[index];
+  uint32_t fl, sl;
+  mapping(node->size, &fl, &sl);
+  if (node->prevFree != BUFFER_ARENA_NONE)
+    arena->nodes[node->prevFree].nextFree = node->nextFree;
+  else
+    arena->freeHeads[fl][sl] = node->nextFree;
+  if (node->nextFree != BUFFER_ARENA_NONE)
+    arena->nodes[node->nextFree].prevFree = node->prevFree;
+  if (arena->freeHeads[fl][sl] == BUFFER_ARENA_NONE) {
+    arena->slBitmaps[fl] &= ~(1u << sl);
+    if (arena->slBitmaps[fl] == 0)
+      arena->flBitmap &= ~(1ull << fl);
+  }
+  node->prevFree = BUFFER_ARENA_NONE;
+  node->nextFree = BUFFER_ARENA_NONE;
+}
+
+static uint32_t find_free(const BufferArena *arena, uint64_t size) {
+  uint32_t fl, sl;
+  mapping_search(size, &fl, &sl);
+  if (fl >= BUFFER_ARENA_FL_COUNT)
+    return BUFFER_ARENA_NONE;
+  uint32_t sl_map = arena->slBitmaps[fl] & (~0u << sl);
+  if (sl_map == 0) {
+    uint64_t fl_map =
+        fl + 1 < 64 ? arena->flBitmap & (~0ull << (fl + 1)) : 0;
+    if (fl_map == 0)
+      return BUFFER_ARENA_NONE;
+    fl = lowest_bit(fl_map);
+    sl_map = arena->slBitmaps[fl];
+  }
+  return arena->freeHeads[fl][lowest_bit(sl_map)];
+}
+
+// Splits `size` bytes off the front of node `index` into a new node, which
+// takes over the front; `index` keeps the rest. Returns the new node.
+static uint32_t split_front(BufferArena *arena, uint32_t index, uint64_t size) {
+  uint32_t front = node_new(arena);
+  if (front == BUFFER_ARENA_NONE)
+    return BUFFER_ARENA_NONE;
+  BufferArenaNode *node = &arena->nodes[index];
+  arena->nodes[front] = (BufferArenaNode){
+    .offset = node->offset,
+    .size = size,
+    .block = node->block,
+    .prevPhysical = node->prevPhysical,
+    .nextPhysical = index,
+    .prevFree = BUFFER_ARENA_NONE,
+    .nextFree = BUFFER_ARENA_NONE,
+    .allocation = BUFFER_ARENA_NONE
+  };
+  if (node->prevPhysical != BUFFER_ARENA_NONE)
+    arena->nodes[node->prevPhysical].nextPhysical = front;
+  else
+    arena->blocks[node->block].firstNode = front;
+  node->prevPhysical = front;
+  node->offset += size;
+  node->size -= size;
+  return front;
+}
+
+static uint32_t add_block(BufferArena *arena, uint64_t size, bool dedicated) {
+  uint32_t block = BUFFER_ARENA_NONE;
+  for (uint32_t i = 0; i < arena->blockCount; i++) {
+    if (!arena->blocks[i].live) {
+      block = i;
+      break;
+    }
+  }
+  if (block == BUFFER_ARENA_NONE) {
+    if (arena->blockCount == arena->blockCapacity) {
+      uint32_t capacity = arena->blockCapacity ? arena->blockCapacity * 2 : 8;
+      BufferArenaBlock *blocks =
+          realloc(arena->blocks, sizeof(BufferArenaBlock) * capacity);
+      if (!blocks)
+        return BUFFER_ARENA_NONE;
+      arena->blocks = blocks;
+      arena->blockCapacity = capacity;
+    }
+    block = arena->blockCount++;
+    arena->blocks[block] = (BufferArenaBlock){0};
+  }
+
+  uint32_t node = node_new(arena);
+  if (node == BUFFER_ARENA_NONE)
+    return BUFFER_ARENA_NONE;
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(
+      arena->device, &(const WGPUBufferDescriptor){
+                         .label = dedicated ? "buffer_arena_dedicated"
+                                            : "buffer_arena_block",
+                         .size = size,
+                         .usage = arena->usage
+                     });
+  if (!buffer) {
+    node_recycle(arena, node);
+    return BUFFER_ARENA_NONE;
+  }
+  arena->blocks[block] = (BufferArenaBlock){
+    .buffer = buffer,
+    .size = size,
+    .firstNode = node,
+    .dedicated = dedicated,
+    .live = true
+  };
+  arena->nodes[node] = (BufferArenaNode){
+    .size = size,
+    .block = block,
+    .prevPhysical = BUFFER_ARENA_NONE,
+    .nextPhysical = BUFFER_ARENA_NONE
+  };
+  free_insert(arena, node);
+  arena->stats.blocksCreated++;
+  return block;
+}
+
+static void release_block(BufferArena *arena, uint32_t block) {
+  BufferArenaBlock *entry = &arena->blocks[block];
+  // Only called once the block is one free range, which nothing references.
+  uint32_t node = entry->firstNode;
+  free_remove(arena, node);
+  node_recycle(arena, node);
+  wgpuBufferDestroy(entry->buffer);
+  wgpuBufferDrop(entry->buffer);
+  *entry = (BufferArenaBlock){0};
+  arena->stats.blocksReleased++;
+}
+
+static bool block_empty(const BufferArena *arena, uint32_t block) {
+  const BufferArenaNode *node = &arena->nodes[arena->blocks[block].firstNode];
+  return node->state == BufferArenaNodeState_Free &&
+         node->nextPhysical == BUFFER_ARENA_NONE;
+}
+
+// Takes `size` bytes at `alignment` from a free range, creating a block when
+// `grow` allows it and nothing fits. Large allocations always get a dedicated
+// block when `grow` is set. Returns the used node.
+static uint32_t alloc_node(BufferArena *arena, uint64_t size,
+                           uint32_t alignment, bool grow) {
+  bool dedicated = size > arena->blockSize / BUFFER_ARENA_DEDICATED_FRACTION;
+  uint64_t search = size + (alignment > BUFFER_ARENA_GRANULARITY
+                                ? alignment - BUFFER_ARENA_GRANULARITY
+                                : 0);
+  uint32_t index =
+      grow && dedicated ? BUFFER_ARENA_NONE : find_free(arena, search);
+  if (index == BUFFER_ARENA_NONE) {
+    if (!grow)
+      return BUFFER_ARENA_NONE;
+    uint32_t block = add_block(
+        arena, dedicated ? align_up(size, BUFFER_ARENA_GRANULARITY)
+                         : arena->blockSize,
+        dedicated);
+    if (block == BUFFER_ARENA_NONE)
+      return BUFFER_ARENA_NONE;
+    // Block offsets start at 0, which satisfies any alignment.
+    index = arena->blocks[block].firstNode;
+  }
+  free_remove(arena, index);
+
+  uint64_t padding =
+      align_up(arena->nodes[index].offset, alignment) - arena->nodes[index].offset;
+  if (padding > 0) {
+    uint32_t front = split_front(arena, index, padding);
+    if (front == BUFFER_ARENA_NONE) {
+      free_insert(arena, index);
+      return BUFFER_ARENA_NONE;
+    }
+    free_insert(arena, front);
+  }
+  if (arena->nodes[index].size > size) {
+    uint32_t used = split_front(arena, index, size);
+    if (used == BUFFER_ARENA_NONE) {
+      free_insert(arena, index);
+      return BUFFER_ARENA_NONE;
+    }
+    free_insert(arena, index);
+    index = used;
+  }
+  BufferArenaNode *node = &arena->nodes[index];
+  node->state = BufferArenaNodeState_Used;
+  arena->blocks[node->block].used += node->size;
+  return index;
+}
+
+// Returns a retired range to the free lists, merged with free neighbours.
+static void free_node(BufferArena *arena, uint32_t index) {
+  BufferArenaNode *node = &arena->nodes[index];
+  uint32_t block = node->block;
+  uint32_t prev = node->prevPhysical;
+  if (prev != BUFFER_ARENA_NONE &&
+      arena->nodes[prev].state == BufferArenaNodeState_Free) {
+    free_remove(arena, prev);
+    BufferArenaNode *previous = &arena->nodes[prev];
+    node->offset = previous->offset;
+    node->size += previous->size;
+    node->prevPhysical = previous->prevPhysical;
+    if (node->prevPhysical != BUFFER_ARENA_NONE)
+      arena->nodes[node->prevPhysical].nextPhysical = index;
+    else
+      arena->blocks[block].firstNode = index;
+    node_recycle(arena, prev);
+  }
+  uint32_t next = node->nextPhysical;
+  if (next != BUFFER_ARENA_NONE &&
+      arena->nodes[next].state == BufferArenaNodeState_Free) {
+    free_remove(arena, next);
+    BufferArenaNode *following = &arena->nodes[next];
+    node->size += following->size;
+    node->nextPhysical = following->nextPhysical;
+    if (node->nextPhysical != BUFFER_ARENA_NONE)
+      arena->nodes[node->nextPhysical].prevPhysical = index;
+    node_recycle(arena, next);
+  }
+  free_insert(arena, index);
+  if (arena->blocks[block].dedicated && block_empty(arena, block))
+    release_block(arena, block);
+}
+
+static bool reserve_retiring(BufferArena *arena) {
+  if (arena->retiringCount == arena->retiringCapacity) {
+    uint32_t capacity =
+        arena->retiringCapacity ? arena->retiringCapacity * 2 : 32;
+    BufferArenaRetire *retiring =
+        realloc(arena->retiring, sizeof(BufferArenaRetire) * capacity);
+    if (!retiring)
+      return false;
+    arena->retiring = retiring;
+    arena->retiringCapacity = capacity;
+  }
+  return true;
+}
+
+// Call with room reserved.
+static void retire_later(BufferArena *arena, uint32_t index) {
+  BufferArenaNode *node = &arena->nodes[index];
+  node->state = BufferArenaNodeState_Retiring;
+  node->allocation = BUFFER_ARENA_NONE;
+  arena->blocks[node->block].used -= node->size;
+  arena->retiring[arena->retiringCount++] =
+      (BufferArenaRetire){.node = index, .frame = arena->frame};
+}
+
+BufferArena *frmwrk_create_buffer_arena(WGPUDevice device, uint64_t blockSize,
+                                        WGPUBufferUsageFlags usage) {
+  BufferArena *arena = calloc(1, sizeof(BufferArena));
+  if (!arena)
+    return NULL;
+  arena->device = device;
+  arena->queue = wgpuDeviceGetQueue(device);
+  arena->blockSize = align_up(blockSize, BUFFER_ARENA_GRANULARITY);
+  arena->usage = usage | WGPUBufferUsage_CopySrc | WGPUBufferUsage_CopyDst;
+  arena->unusedNodes = BUFFER_ARENA_NONE;
+  memset(arena->freeHeads, 0xff, sizeof(arena->freeHeads));
+  return arena;
+}
+
+static void retire(BufferArena *arena) {
+  // Retirements are appended in frame order, so finished ones form a prefix.
+  uint32_t retired = 0;
+  while (retired < arena->retiringCount &&
+         arena->retiring[retired].frame < arena->retiredFrame) {
+    free_node(arena, arena->retiring[retired].node);
+    retired++;
+  }
+  if (retired > 0) {
+    memmove(arena->retiring, arena->retiring + retired,
+            sizeof(BufferArenaRetire) * (arena->retiringCount - retired));
+    arena->retiringCount -= retired;
+  }
+}
+
+void frmwrk_drop_buffer_arena(BufferArena *arena) {
+  if (!arena)
+    return;
+  // The work-done callbacks point into the arena.
+  for (uint32_t i = 0; i < BUFFER_ARENA_MAX_FENCES; i++) {
+    while (arena->fences[i].pending)
+      wgpuDevicePoll(arena->device, true, NULL);
+  }
+  for (uint32_t i = 0; i < arena->blockCount; i++) {
+    if (arena->blocks[i].live)
+      wgpuBufferDrop(arena->blocks[i].buffer);
+  }
+  if (arena->queue)
+    wgpuQueueDrop(arena->queue);
+  free(arena->blocks);
+  free(arena->nodes);
+  free(arena->allocations);
+  free(arena->freeAllocations);
+  free(arena->retiring);
+  free(arena->moves);
+  free(arena);
+}
+
+static BufferArenaAllocation *resolve(const BufferArena *arena,
+                                      BufferArenaId id) {
+  uint32_t index = (id & (BUFFER_ARENA_MAX_ALLOCATIONS - 1)) - 1;
+  uint32_t generation = id >> BUFFER_ARENA_INDEX_BITS;
+  if (id == 0 || index >= arena->allocationCount)
+    return NULL;
+  BufferArenaAllocation *allocation = &arena->allocations[index];
+  if (!allocation->live || allocation->generation != generation)
+    return NULL;
+  return allocation;
+}
+
+static uint32_t new_allocation(BufferArena *arena) {
+  if (arena->freeAllocationCount > 0)
+    return arena->freeAllocations[--arena->freeAllocationCount];
+  if (arena->allocationCount + 1 >= BUFFER_ARENA_MAX_ALLOCATIONS)
+    return BUFFER_ARENA_NONE;
+  if (arena->allocationCount == arena->allocationCapacity) {
+    uint32_t capacity =
+        arena->allocationCapacity ? arena->allocationCapacity * 2 : 64;
+    BufferArenaAllocation *allocations =
+        realloc(arena->allocations, sizeof(BufferArenaAllocation) * capacity);
+    if (!allocations)
+      return BUFFER_ARENA_NONE;
+    arena->allocations = allocations;
+    uint32_t *free_allocations =
+        realloc(arena->freeAllocations, sizeof(uint32_t) * capacity);
+    if (!free_allocations)
+      return BUFFER_ARENA_NONE;
+    arena->freeAllocations = free_allocations;
+    arena->allocationCapacity = capacity;
+  }
+  arena->allocations[arena->allocationCount] = (BufferArenaAllocation){0};
+  return arena->allocationCount++;
+}
+
+BufferArenaId frmwrk_buffer_arena_alloc(BufferArena *arena, uint64_t size,
+                                        uint32_t alignment) {
+  if (alignment < BUFFER_ARENA_GRANULARITY)
+    alignment = BUFFER_ARENA_GRANULARITY;
+  size = align_up(size ? size : 1, BUFFER_ARENA_GRANULARITY);
+  uint32_t index = new_allocation(arena);
+  uint32_t node = index != BUFFER_ARENA_NONE
+                      ? alloc_node(arena, size, alignment, true)
+                      : BUFFER_ARENA_NONE;
+  if (node == BUFFER_ARENA_NONE) {
+    if (index != BUFFER_ARENA_NONE)
+      arena->freeAllocations[arena->freeAllocationCount++] = index;
+    arena->stats.failures++;
+    return 0;
+  }
+  BufferArenaAllocation *allocation = &arena->allocations[index];
+  allocation->node = node;
+  allocation->alignment = alignment;
+  allocation->live = true;
+  arena->nodes[node].allocation = index;
+  arena->stats.allocationCount++;
+  return (allocation->generation << BUFFER_ARENA_INDEX_BITS) | (index + 1);
+}
+
+void frmwrk_buffer_arena_free(BufferArena *arena, BufferArenaId id) {
+  BufferArenaAllocation *allocation = resolve(arena, id);
+  if (!allocation)
+    return;
+  uint32_t index = (uint32_t)(allocation - arena->allocations);
+  // Without room to defer it the range is leaked rather than reused early.
+  if (reserve_retiring(arena))
+    retire_later(arena, allocation->node);
+  else
+    arena->nodes[allocation->node].allocation = BUFFER_ARENA_NONE;
+  allocation->live = false;
+  allocation->generation =
+      (allocation->generation + 1) & BUFFER_ARENA_GENERATION_MASK;
+  arena->freeAllocations[arena->freeAllocationCount++] = index;
+}
+
+bool frmwrk_buffer_arena_resolve(const BufferArena *arena, BufferArenaId id,
+                                 BufferArenaRange *range) {
+  const BufferArenaAllocation *allocation = resolve(arena, id);
+  if (!allocation)
+    return false;
+  const BufferArenaNode *node = &arena->nodes[allocation->node];
+  *range = (BufferArenaRange){
+    .buffer = arena->blocks[node->block].buffer,
+    .offset = node->offset,
+    .size = node->size
+  };
+  return true;
+}
+
+static bool reserve_move(BufferArena *arena) {
+  if (arena->moveCount == arena->moveCapacity) {
+    uint32_t capacity = arena->moveCapacity ? arena->moveCapacity * 2 : 16;
+    BufferArenaMove *moves =
+        realloc(arena->moves, sizeof(BufferArenaMove) * capacity);
+    if (!moves)
+      return false;
+    arena->moves = moves;
+    arena->moveCapacity = capacity;
+  }
+  return true;
+}
+
+// Free ranges of `block` come off the lists so nothing is allocated into the
+// block being emptied, and go back on afterwards.
+static void set_evacuating(BufferArena *arena, uint32_t block, bool on) {
+  for (uint32_t index = arena->blocks[block].firstNode;
+       index != BUFFER_ARENA_NONE; index = arena->nodes[index].nextPhysical) {
+    if (arena->nodes[index].state != BufferArenaNodeState_Free)
+      continue;
+    if (on)
+      free_remove(arena, index);
+    else
+      free_insert(arena, index);
+  }
+}
+
+static uint32_t emptiest_block(const BufferArena *arena) {
+  uint32_t best = BUFFER_ARENA_NONE;
+  uint32_t shared = 0;
+  for (uint32_t i = 0; i < arena->blockCount; i++) {
+    const BufferArenaBlock *block = &arena->blocks[i];
+    if (!block->live || block->dedicated)
+      continue;
+    shared++;
+    if (block->used == 0 ||
+        block->used >= block->size * BUFFER_ARENA_DEFRAG_OCCUPANCY)
+      continue;
+    if (best == BUFFER_ARENA_NONE || block->used < arena->blocks[best].used)
+      best = i;
+  }
+  // With a single shared block there is nowhere to move to.
+  return shared > 1 ? best : BUFFER_ARENA_NONE;
+}
+
+uint32_t frmwrk_buffer_arena_defragment(BufferArena *arena, uint64_t maxBytes) {
+  arena->stats.defragPasses++;
+  uint32_t moved = 0;
+  uint32_t block = emptiest_block(arena);
+  if (block != BUFFER_ARENA_NONE) {
+    set_evacuating(arena, block, true);
+    uint64_t moved_bytes = 0;
+    uint32_t index = arena->blocks[block].firstNode;
+    while (index != BUFFER_ARENA_NONE && moved_bytes < maxBytes) {
+      // Retiring a node never merges it, so `next` stays valid.
+      uint32_t next = arena->nodes[index].nextPhysical;
+      uint32_t allocation = arena->nodes[index].allocation;
+      if (arena->nodes[index].state != BufferArenaNodeState_Used ||
+          allocation == BUFFER_ARENA_NONE) {
+        index = next;
+        continue;
+      }
+      if (!reserve_move(arena) || !reserve_retiring(arena))
+        break;
+      uint64_t size = arena->nodes[index].size;
+      uint32_t target = alloc_node(
+          arena, size, arena->allocations[allocation].alignment, false);
+      if (target == BUFFER_ARENA_NONE) {
+        // A smaller one further on may still fit somewhere.
+        index = next;
+        continue;
+      }
+      arena->moves[arena->moveCount++] = (BufferArenaMove){
+        .source = arena->blocks[block].buffer,
+        .sourceOffset = arena->nodes[index].offset,
+        .destination = arena->blocks[arena->nodes[target].block].buffer,
+        .destinationOffset = arena->nodes[target].offset,
+        .size = size
+      };
+      retire_later(arena, index);
+      arena->nodes[target].allocation = allocation;
+      arena->allocations[allocation].node = target;
+      moved_bytes += size;
+      moved++;
+      index = next;
+    }
+    set_evacuating(arena, block, false);
+    arena->stats.moves += moved;
+    arena->stats.movedBytes += moved_bytes;
+    if (moved > 0)
+      arena->generation++;
+  }
+
+  // Keep one empty shared block around so a steady alloc/free pattern does
+  // not create and release one every frame.
+  bool kept = false;
+  for (uint32_t i = 0; i < arena->blockCount; i++) {
+    if (!arena->blocks[i].live || !block_empty(arena, i))
+      continue;
+    if (!kept) {
+      kept = true;
+      continue;
+    }
+    release_block(arena, i);
+  }
+  return moved;
+}
+
+void frmwrk_buffer_arena_record(BufferArena *arena,
+                                WGPUCommandEncoder encoder) {
+  for (uint32_t i = 0; i < arena->moveCount; i++) {
+    const BufferArenaMove *move = &arena->moves[i];
+    wgpuCommandEncoderCopyBufferToBuffer(encoder, move->source,
+                                         move->sourceOffset, move->destination,
+                                         move->destinationOffset, move->size);
+  }
+  arena->moveCount = 0;
+}
+
+static void handle_work_done(WGPUQueueWorkDoneStatus status, void *userdata) {
+  UNUSED(status)
+  BufferArenaFence *fence = userdata;
+  if (fence->frame + 1 > fence->arena->retiredFrame)
+    fence->arena->retiredFrame = fence->frame + 1;
+  fence->pending = false;
+}
+
+void frmwrk_buffer_arena_frame_submitted(BufferArena *arena) {
+  // As in the resource registry: fence whatever no callback covers yet,
+  // including retirements from frames that found every fence busy.
+  bool needs_fence = arena->retiringCount > 0 &&
+                     arena->retiring[arena->retiringCount - 1].frame >=
+                         arena->fencedFrame;
+  for (uint32_t i = 0; needs_fence && i < BUFFER_ARENA_MAX_FENCES; i++) {
+    BufferArenaFence *fence = &arena->fences[i];
+    if (fence->pending)
+      continue;
+    *fence = (BufferArenaFence){
+      .arena = arena,
+      .frame = arena->frame,
+      .pending = true
+    };
+    wgpuQueueOnSubmittedWorkDone(arena->queue, handle_work_done, fence);
+    arena->fencedFrame = arena->frame + 1;
+    break;
+  }
+  arena->frame++;
+  retire(arena);
+}
+
+BufferArenaStats frmwrk_buffer_arena_stats(const BufferArena *arena) {
+  BufferArenaStats stats = arena->stats;
+  for (uint32_t i = 0; i < arena->blockCount; i++) {
+    const BufferArenaBlock *block = &arena->blocks[i];
+    if (!block->live)
+      continue;
+    stats.blocks++;
+    stats.reservedBytes += block->size;
+    stats.usedBytes += block->used;
+    for (uint32_t index = block->firstNode; index != BUFFER_ARENA_NONE;
+         index = arena->nodes[index].nextPhysical) {
+      const BufferArenaNode *node = &arena->nodes[index];
+      if (node->state == BufferArenaNodeState_Used) {
+        stats.allocations++;
+      } else if (node->state == BufferArenaNodeState_Retiring) {
+        stats.retiringBytes += node->size;
+      } else if (node->state == BufferArenaNodeState_Free) {
+        stats.freeRanges++;
+        stats.freeBytes += node->size;
+        if (node->size > stats.largestFreeRange)
+          stats.largestFreeRange = node->size;
+      }
+    }
+  }
+  stats.fragmentation =
+      stats.freeBytes
+          ? 1.0 - (double)stats.largestFreeRange / (double)stats.freeBytes
+          : 0.0;
+  return stats;
+}
+
+void frmwrk_buffer_arena_print(const BufferArena *arena) {
+  BufferArenaStats stats = frmwrk_buffer_arena_stats(arena);
+  printf("[buffer_arena] %u allocations in %u blocks: %.1f/%.1f KiB used "
+         "(%.1f%%), %.1f KiB retiring\n",
+         stats.allocations, stats.blocks, stats.usedBytes / 1024.0,
+         stats.reservedBytes / 1024.0,
+         stats.reservedBytes ? 100.0 * stats.usedBytes / stats.reservedBytes
+                             : 0.0,
+         stats.retiringBytes / 1024.0);
+  printf("[buffer_arena] %u free ranges, largest %.1f KiB, fragmentation "
+         "%.1f%%; %llu moves (%.1f KiB) in %llu defrag passes, %llu blocks "
+         "released, %llu failures\n",
+         stats.freeRanges, stats.largestFreeRange / 1024.0,
+         100.0 * stats.fragmentation, (unsigned long long)stats.moves,
+         stats.movedBytes / 1024.0, (unsigned long long)stats.defragPasses,
+         (unsigned long long)stats.blocksReleased,
+         (unsigned long long)stats.failures);
+}
@@ -0,0 +1,202 @@
+#ifndef BUFFER_ARENA_H
+#define BUFFER_ARENA_H
+
+#include "framework.h"
+
+// Offsets and sizes are multiples of this, which covers the 4-byte alignment
+// of vertex, index and copy offsets. Storage bindings ask for 256.
+#define BUFFER_ARENA_GRANULARITY 16
+// TLSF second-level subdivisions per power of two, as a shift.
+#define BUFFER_ARENA_SL_BITS 4
+#define BUFFER_ARENA_SL_COUNT (1u << BUFFER_ARENA_SL_BITS)
+#define BUFFER_ARENA_FL_COUNT 40
+// Allocations bigger than half a block get a block of their own.
+#define BUFFER_ARENA_DEDICATED_FRACTION 2
+// Blocks less full than this are evacuated by frmwrk_buffer_arena_defragment.
+#define BUFFER_ARENA_DEFRAG_OCCUPANCY 0.5
+#define BUFFER_ARENA_MAX_FENCES 8
+#define BUFFER_ARENA_NONE UINT32_MAX
+
+// Handles pack an allocation index with its generation like resource handles,
+// and keep resolving while defragmentation moves the allocation. 0 is never
+// a valid handle.
+#define BUFFER_ARENA_INDEX_BITS 20
+#define BUFFER_ARENA_MAX_ALLOCATIONS (1u << BUFFER_ARENA_INDEX_BITS)
+#define BUFFER_ARENA_GENERATION_MASK ((1u << (32 - BUFFER_ARENA_INDEX_BITS)) - 1)
+
+typedef uint32_t BufferArenaId;
+typedef struct BufferArena BufferArena;
+
+typedef enum BufferArenaNodeState {
+  // In the node pool, not describing any range.
+  BufferArenaNodeState_Unused,
+  BufferArenaNodeState_Free,
+  BufferArenaNodeState_Used,
+  // Freed or moved away from, waiting for the GPU to finish with it.
+  BufferArenaNodeState_Retiring,
+} BufferArenaNodeState;
+
+// A range of a block. Nodes are linked to their physical neighbours in the
+// block, and free ones also into the free list of their TLSF size class.
+typedef struct BufferArenaNode {
+  uint64_t offset;
+  uint64_t size;
+  uint32_t block;
+  uint32_t prevPhysical;
+  uint32_t nextPhysical;
+  // Free list links, or the next unused node in the pool.
+  uint32_t prevFree;
+  uint32_t nextFree;
+  uint32_t allocation;
+  BufferArenaNodeState state;
+} BufferArenaNode;
+
+typedef struct BufferArenaBlock {
+  WGPUBuffer buffer;
+  uint64_t size;
+  uint64_t used;
+  uint32_t firstNode;
+  // Holds one allocation too large to share and goes once it is freed.
+  bool dedicated;
+  bool live;
+} BufferArenaBlock;
+
+typedef struct BufferArenaAllocation {
+  uint32_t node;
+  uint32_t alignment;
+  uint32_t generation;
+  bool live;
+} BufferArenaAllocation;
+
+// Where an allocation currently lives; bind or draw with these.
+typedef struct BufferArenaRange {
+  WGPUBuffer buffer;
+  uint64_t offset;
+  uint64_t size;
+} BufferArenaRange;
+
+typedef struct BufferArenaMove {
+  WGPUBuffer source;
+  uint64_t sourceOffset;
+  WGPUBuffer destination;
+  uint64_t destinationOffset;
+  uint64_t size;
+} BufferArenaMove;
+
+typedef struct BufferArenaRetire {
+  uint32_t node;
+  uint64_t frame;
+} BufferArenaRetire;
+
+typedef struct BufferArenaFence {
+  BufferArena *arena;
+  uint64_t frame;
+  bool pending;
+} BufferArenaFence;
+
+typedef struct BufferArenaStats {
+  // Occupancy, filled in by frmwrk_buffer_arena_stats.
+  uint32_t blocks;
+  uint32_t allocations;
+  uint64_t reservedBytes;
+  uint64_t usedBytes;
+  uint64_t retiringBytes;
+  uint32_t freeRanges;
+  uint64_t freeBytes;
+  uint64_t largestFreeRange;
+  // 1 - largest free range / free bytes: 0 when all free space is one range.
+  double fragmentation;
+
+  // Running totals.
+  uint64_t allocationCount;
+  uint64_t failures;
+  uint64_t blocksCreated;
+  uint64_t blocksReleased;
+  uint64_t defragPasses;
+  uint64_t moves;
+  uint64_t movedBytes;
+} BufferArenaStats;
+
+// Carves vertex, index and storage ranges out of a few large buffers with a
+// two-level segregated fit (TLSF) allocator: free ranges are binned by size
+// class, found through two bitmaps in constant time and merged with their
+// neighbours when freed. Like the resource registry, freed ranges are only
+// reused once the frames that may still read them have retired.
+struct BufferArena {
+  WGPUDevice device;
+  WGPUQueue queue;
+  uint64_t blockSize;
+  WGPUBufferUsageFlags usage;
+
+  BufferArenaBlock *blocks;
+  uint32_t blockCount;
+  uint32_t blockCapacity;
+
+  BufferArenaNode *nodes;
+  uint32_t nodeCount;
+  uint32_t nodeCapacity;
+  uint32_t unusedNodes;
+
+  uint64_t flBitmap;
+  uint32_t slBitmaps[BUFFER_ARENA_FL_COUNT];
+  uint32_t freeHeads[BUFFER_ARENA_FL_COUNT][BUFFER_ARENA_SL_COUNT];
+
+  BufferArenaAllocation *allocations;
+  uint32_t allocationCount;
+  uint32_t allocationCapacity;
+  uint32_t *freeAllocations;
+  uint32_t freeAllocationCount;
+
+  BufferArenaRetire *retiring;
+  uint32_t retiringCount;
+  uint32_t retiringCapacity;
+  BufferArenaFence fences[BUFFER_ARENA_MAX_FENCES];
+  uint64_t frame;
+  uint64_t retiredFrame;
+  // Ranges retired before this frame are covered by a registered callback.
+  uint64_t fencedFrame;
+
+  BufferArenaMove *moves;
+  uint32_t moveCount;
+  uint32_t moveCapacity;
+  // Bumped whenever defragmentation moves anything, so holders of resolved
+  // ranges know to resolve them again.
+  uint32_t generation;
+
+  BufferArenaStats stats;
+};
+
+// Blocks are `blockSize` bytes (rounded up to the granularity) with `usage`
+// plus CopySrc and CopyDst for defragmentation.
+BufferArena *frmwrk_create_buffer_arena(WGPUDevice device, uint64_t blockSize,
+                                        WGPUBufferUsageFlags usage);
+// Waits for the GPU, then drops every block.
+void frmwrk_drop_buffer_arena(BufferArena *arena);
+
+// `alignment` is a power of two; 0 uses the granularity. Returns 0 on failure.
+BufferArenaId frmwrk_buffer_arena_alloc(BufferArena *arena, uint64_t size,
+                                        uint32_t alignment);
+// The range stays readable by frames already submitted. Stale handles are
+// ignored.
+void frmwrk_buffer_arena_free(BufferArena *arena, BufferArenaId id);
+// False for stale or invalid handles.
+bool frmwrk_buffer_arena_resolve(const BufferArena *arena, BufferArenaId id,
+                                 BufferArenaRange *range);
+
+// Moves allocations out of the emptiest block into the others, up to
+// `maxBytes`, and releases blocks left empty. Returns how many allocations
+// moved. The copies are recorded by the next frmwrk_buffer_arena_record, which
+// must be submitted ahead of anything using the new ranges in this frame, so
+// call it between frames, before new data is staged into the arena.
+uint32_t frmwrk_buffer_arena_defragment(BufferArena *arena, uint64_t maxBytes);
+// Records the copies of pending moves.
+void frmwrk_buffer_arena_record(BufferArena *arena,
+                                WGPUCommandEncoder encoder);
+// Call after each frame's wgpuQueueSubmit, like
+// frmwrk_resources_frame_submitted. Never blocks.
+void frmwrk_buffer_arena_frame_submitted(BufferArena *arena);
+
+BufferArenaStats frmwrk_buffer_arena_stats(const BufferArena *arena);
+void frmwrk_buffer_arena_print(const BufferArena *arena);
+
+#endif // BUFFER_ARENA_H
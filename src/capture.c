@@ -0,0 +1,1396 @@
+// The wrappers below call the real wgpu functions, so the redirecting macros
+// must stay out of this file.
+#define CAPTURE_IMPLEMENTATION
+#include "capture.h"
+#include "framework.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(FRMWRK_CAPTURE)
+#include <stdatomic.h>
+#include "threading.h"
+
+#define CAPTURE_INITIAL_OBJECTS 1024
+#define CAPTURE_TOMBSTONE ((const void *)(uintptr_t)1)
+
+// Checked before taking the lock so calls stay cheap while nothing records.
+static _Atomic(Capture *) active_capture;
+// Outlives any one capture so a wrapper that saw the old pointer can still
+// lock safely after frmwrk_drop_capture.
+static FrmwrkMutex capture_mutex;
+static bool capture_mutex_initialized;
+
+// The swapchain is usually configured before a capture starts, and again on
+// every resize, so this is tracked regardless.
+static uint32_t target_width;
+static uint32_t target_height;
+static WGPUTextureFormat target_format;
+
+static Capture *capture_lock(void) {
+  if (!atomic_load_explicit(&active_capture, memory_order_acquire))
+    return NULL;
+  frmwrk_mutex_lock(&capture_mutex);
+  Capture *capture = atomic_load_explicit(&active_capture, memory_order_relaxed);
+  if (!capture)
+    frmwrk_mutex_unlock(&capture_mutex);
+  return capture;
+}
+
+static void capture_unlock(Capture *capture) {
+  UNUSED(capture)
+  frmwrk_mutex_unlock(&capture_mutex);
+}
+
+#pragma region objects
+static uint32_t hash_handle(const void *handle, uint32_t capacity) {
+  uint64_t x = (uint64_t)(uintptr_t)handle;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  return (uint32_t)x & (capacity - 1);
+}
+
+static CaptureObject *find_object(Capture *capture, const void *handle) {
+  if (!handle)
+    return NULL;
+  uint32_t mask = capture->objectCapacity - 1;
+  uint32_t i = hash_handle(handle, capture->objectCapacity);
+  for (uint32_t probes = 0; probes < capture->objectCapacity; probes++) {
+    CaptureObject *object = &capture->objects[i];
+    if (object->handle == handle)
+      return object;
+    if (!object->handle)
+      return NULL;
+    i = (i + 1) & mask;
+  }
+  return NULL;
+}
+
+static CaptureObject *insert_slot(CaptureObject *objects, uint32_t capacity,
+                                  const void *handle) {
+  uint32_t i = hash_handle(handle, capacity);
+  while (objects[i].handle && objects[i].handle != CAPTURE_TOMBSTONE)
+    i = (i + 1) & (capacity - 1);
+  return &objects[i];
+}
+
+static bool rehash(Capture *capture, uint32_t capacity) {
+  CaptureObject *objects = calloc(capacity, sizeof(CaptureObject));
+  if (!objects)
+    return false;
+  for (uint32_t i = 0; i < capture->objectCapacity; i++) {
+    const CaptureObject *object = &capture->objects[i];
+    if (object->handle && object->handle != CAPTURE_TOMBSTONE)
+      *insert_slot(objects, capacity, object->handle) = *object;
+  }
+  free(capture->objects);
+  capture->objects = objects;
+  capture->objectCapacity = capacity;
+  capture->tombstoneCount = 0;
+  return true;
+}
+
+// Names `handle` with a new id. A handle that is already known was released
+// without passing through a wrapper and is named afresh.
+static CaptureObject *add_object(Capture *capture, const void *handle,
+                                 CaptureObjectType type) {
+  CaptureObject *object = find_object(capture, handle);
+  if (!object) {
+    uint32_t used = capture->objectCount + capture->tombstoneCount + 1;
+    if (used * 4 > capture->objectCapacity * 3) {
+      // Mostly tombstones: clearing them out is enough.
+      uint32_t capacity = capture->objectCapacity;
+      if ((capture->objectCount + 1) * 2 > capacity)
+        capacity *= 2;
+      if (!rehash(capture, capacity)) {
+        capture->failed = true;
+        return NULL;
+      }
+    }
+    object = insert_slot(capture->objects, capture->objectCapacity, handle);
+    if (object->handle == CAPTURE_TOMBSTONE)
+      capture->tombstoneCount--;
+    capture->objectCount++;
+  }
+  *object = (CaptureObject){
+    .handle = handle,
+    .id = capture->nextId++,
+    .type = type,
+  };
+  capture->stats.objects++;
+  return object;
+}
+
+static void remove_object(Capture *capture, CaptureObject *object) {
+  *object = (CaptureObject){.handle = CAPTURE_TOMBSTONE};
+  capture->objectCount--;
+  capture->tombstoneCount++;
+}
+
+static uint32_t object_id(Capture *capture, const void *handle) {
+  const CaptureObject *object = find_object(capture, handle);
+  if (object)
+    return object->id;
+  if (handle)
+    capture->stats.unknownObjects++;
+  return 0;
+}
+
+// Forgets a handle the call about to be made releases, returning its id.
+static uint32_t take_object(const void *handle) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return 0;
+  uint32_t id = 0;
+  CaptureObject *object = find_object(capture, handle);
+  if (object) {
+    id = object->id;
+    remove_object(capture, object);
+  } else if (handle) {
+    capture->stats.unknownObjects++;
+  }
+  capture_unlock(capture);
+  return id;
+}
+#pragma endregion
+
+#pragma region records
+static void put(Capture *capture, const void *data, size_t size) {
+  if (capture->failed || size == 0)
+    return;
+  if (capture->scratchSize + size > capture->scratchCapacity) {
+    size_t capacity = capture->scratchCapacity ? capture->scratchCapacity : 4096;
+    while (capture->scratchSize + size > capacity)
+      capacity *= 2;
+    unsigned char *scratch = realloc(capture->scratch, capacity);
+    if (!scratch) {
+      capture->failed = true;
+      return;
+    }
+    capture->scratch = scratch;
+    capture->scratchCapacity = capacity;
+  }
+  memcpy(capture->scratch + capture->scratchSize, data, size);
+  capture->scratchSize += size;
+}
+
+static void put_u32(Capture *capture, uint32_t value) {
+  put(capture, &value, sizeof(value));
+}
+
+static void put_i32(Capture *capture, int32_t value) {
+  put(capture, &value, sizeof(value));
+}
+
+static void put_u64(Capture *capture, uint64_t value) {
+  put(capture, &value, sizeof(value));
+}
+
+static void put_f32(Capture *capture, float value) {
+  put(capture, &value, sizeof(value));
+}
+
+static void put_f64(Capture *capture, double value) {
+  put(capture, &value, sizeof(value));
+}
+
+static void put_bytes(Capture *capture, const void *data, size_t size) {
+  put_u32(capture, (uint32_t)size);
+  put(capture, data, size);
+}
+
+// The terminator is kept so the replay can use strings in place.
+static void put_string(Capture *capture, const char *string) {
+  put_bytes(capture, string, string ? strlen(string) + 1 : 0);
+}
+
+static void put_object(Capture *capture, const void *handle) {
+  put_u32(capture, object_id(capture, handle));
+}
+
+static void begin_record(Capture *capture, CaptureOp op) {
+  capture->scratchSize = 0;
+  put(capture, &(CaptureRecordHeader){.op = op}, sizeof(CaptureRecordHeader));
+}
+
+// Commands on encoders created before the capture started are left out.
+static bool begin_encoder_record(Capture *capture, CaptureOp op,
+                                 const void *encoder) {
+  uint32_t id = object_id(capture, encoder);
+  if (!id)
+    return false;
+  begin_record(capture, op);
+  put_u32(capture, id);
+  return true;
+}
+
+static void end_record(Capture *capture) {
+  if (capture->failed)
+    return;
+  CaptureRecordHeader header = {
+    .op = ((CaptureRecordHeader *)capture->scratch)->op,
+    .size = (uint32_t)(capture->scratchSize - sizeof(CaptureRecordHeader)),
+  };
+  memcpy(capture->scratch, &header, sizeof(header));
+  if (fwrite(capture->scratch, 1, capture->scratchSize, capture->file) !=
+      capture->scratchSize) {
+    printf("[capture] failed to write the trace, recording stopped\n");
+    capture->failed = true;
+    return;
+  }
+  capture->stats.records++;
+  capture->stats.bytes += capture->scratchSize;
+}
+
+// Adds `handle` and starts its creation record.
+static bool begin_create_record(Capture *capture, const void *handle,
+                                CaptureObjectType type, CaptureOp op) {
+  if (!handle)
+    return false;
+  CaptureObject *object = add_object(capture, handle, type);
+  if (!object)
+    return false;
+  begin_record(capture, op);
+  put_u32(capture, object->id);
+  return true;
+}
+
+static void put_copy_buffer(Capture *capture, const WGPUImageCopyBuffer *copy) {
+  put_object(capture, copy->buffer);
+  put_u64(capture, copy->layout.offset);
+  put_u32(capture, copy->layout.bytesPerRow);
+  put_u32(capture, copy->layout.rowsPerImage);
+}
+
+static void put_copy_texture(Capture *capture,
+                             const WGPUImageCopyTexture *copy) {
+  put_object(capture, copy->texture);
+  put_u32(capture, copy->mipLevel);
+  put_u32(capture, copy->origin.x);
+  put_u32(capture, copy->origin.y);
+  put_u32(capture, copy->origin.z);
+  put_u32(capture, copy->aspect);
+}
+
+static void put_extent(Capture *capture, const WGPUExtent3D *extent) {
+  put_u32(capture, extent->width);
+  put_u32(capture, extent->height);
+  put_u32(capture, extent->depthOrArrayLayers);
+}
+
+static void put_stage(Capture *capture, WGPUShaderModule module,
+                      const char *entryPoint, uint32_t constantCount,
+                      const WGPUConstantEntry *constants) {
+  put_object(capture, module);
+  put_string(capture, entryPoint);
+  put_u32(capture, constantCount);
+  for (uint32_t i = 0; i < constantCount; i++) {
+    put_string(capture, constants[i].key);
+    put_f64(capture, constants[i].value);
+  }
+}
+
+static void put_blend_component(Capture *capture,
+                                const WGPUBlendComponent *component) {
+  put_u32(capture, component->operation);
+  put_u32(capture, component->srcFactor);
+  put_u32(capture, component->dstFactor);
+}
+
+static void put_stencil_face(Capture *capture,
+                             const WGPUStencilFaceState *face) {
+  put_u32(capture, face->compare);
+  put_u32(capture, face->failOp);
+  put_u32(capture, face->depthFailOp);
+  put_u32(capture, face->passOp);
+}
+
+// The bytes a copy out of a staging buffer reads, while its mapping is still
+// live. `size` is clamped to the mapping when `clamp` is set.
+static const unsigned char *staging_range(Capture *capture,
+                                          const CaptureObject *staging,
+                                          uint64_t offset, uint64_t *size,
+                                          bool clamp) {
+  uint64_t end = staging->mappingOffset + staging->mappingSize;
+  if (!staging->mapping || offset < staging->mappingOffset || offset > end ||
+      (!clamp && *size > end - offset)) {
+    capture->stats.skipped++;
+    return NULL;
+  }
+  if (*size > end - offset)
+    *size = end - offset;
+  return staging->mapping + (offset - staging->mappingOffset);
+}
+#pragma endregion
+
+#pragma region device
+WGPUBuffer frmwrk_capture_wgpuDeviceCreateBuffer(
+    WGPUDevice device, WGPUBufferDescriptor const *descriptor) {
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return buffer;
+  if (buffer && (descriptor->usage & WGPUBufferUsage_MapWrite)) {
+    CaptureObject *object =
+        add_object(capture, buffer, CaptureObjectType_StagingBuffer);
+    if (object)
+      object->size = descriptor->size;
+  } else if (begin_create_record(capture, buffer, CaptureObjectType_Buffer,
+                                 CaptureOp_CreateBuffer)) {
+    CaptureObject *object = find_object(capture, buffer);
+    object->size = descriptor->size;
+    object->mappedAtCreation = descriptor->mappedAtCreation;
+    put_u32(capture, descriptor->usage);
+    put_u64(capture, descriptor->size);
+    put_u32(capture, descriptor->mappedAtCreation);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return buffer;
+}
+
+WGPUTexture frmwrk_capture_wgpuDeviceCreateTexture(
+    WGPUDevice device, WGPUTextureDescriptor const *descriptor) {
+  WGPUTexture texture = wgpuDeviceCreateTexture(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return texture;
+  if (begin_create_record(capture, texture, CaptureObjectType_Texture,
+                          CaptureOp_CreateTexture)) {
+    put_u32(capture, descriptor->usage);
+    put_u32(capture, descriptor->dimension);
+    put_extent(capture, &descriptor->size);
+    put_u32(capture, descriptor->format);
+    put_u32(capture, descriptor->mipLevelCount);
+    put_u32(capture, descriptor->sampleCount);
+    put_u32(capture, (uint32_t)descriptor->viewFormatCount);
+    for (size_t i = 0; i < descriptor->viewFormatCount; i++)
+      put_u32(capture, descriptor->viewFormats[i]);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return texture;
+}
+
+WGPUTextureView frmwrk_capture_wgpuTextureCreateView(
+    WGPUTexture texture, WGPUTextureViewDescriptor const *descriptor) {
+  WGPUTextureView view = wgpuTextureCreateView(texture, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return view;
+  uint32_t texture_id = object_id(capture, texture);
+  if (texture_id && begin_create_record(capture, view,
+                                        CaptureObjectType_TextureView,
+                                        CaptureOp_CreateTextureView)) {
+    put_u32(capture, texture_id);
+    put_u32(capture, descriptor != NULL);
+    if (descriptor) {
+      put_u32(capture, descriptor->format);
+      put_u32(capture, descriptor->dimension);
+      put_u32(capture, descriptor->baseMipLevel);
+      put_u32(capture, descriptor->mipLevelCount);
+      put_u32(capture, descriptor->baseArrayLayer);
+      put_u32(capture, descriptor->arrayLayerCount);
+      put_u32(capture, descriptor->aspect);
+    }
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return view;
+}
+
+WGPUSampler frmwrk_capture_wgpuDeviceCreateSampler(
+    WGPUDevice device, WGPUSamplerDescriptor const *descriptor) {
+  WGPUSampler sampler = wgpuDeviceCreateSampler(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return sampler;
+  if (begin_create_record(capture, sampler, CaptureObjectType_Sampler,
+                          CaptureOp_CreateSampler)) {
+    put_u32(capture, descriptor != NULL);
+    if (descriptor) {
+      put_u32(capture, descriptor->addressModeU);
+      put_u32(capture, descriptor->addressModeV);
+      put_u32(capture, descriptor->addressModeW);
+      put_u32(capture, descriptor->magFilter);
+      put_u32(capture, descriptor->minFilter);
+      put_u32(capture, descriptor->mipmapFilter);
+      put_f32(capture, descriptor->lodMinClamp);
+      put_f32(capture, descriptor->lodMaxClamp);
+      put_u32(capture, descriptor->compare);
+      put_u32(capture, descriptor->maxAnisotropy);
+    }
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return sampler;
+}
+
+WGPUShaderModule frmwrk_capture_wgpuDeviceCreateShaderModule(
+    WGPUDevice device, WGPUShaderModuleDescriptor const *descriptor) {
+  WGPUShaderModule module = wgpuDeviceCreateShaderModule(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return module;
+  const WGPUChainedStruct *chain = descriptor->nextInChain;
+  if (!chain || chain->sType != WGPUSType_ShaderModuleWGSLDescriptor) {
+    // Only WGSL source is recorded; pipelines using the module are replayed
+    // without it and fail there.
+    capture->stats.skipped++;
+  } else if (begin_create_record(capture, module,
+                                 CaptureObjectType_ShaderModule,
+                                 CaptureOp_CreateShaderModule)) {
+    put_string(capture, ((const WGPUShaderModuleWGSLDescriptor *)chain)->code);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return module;
+}
+
+WGPUBindGroupLayout frmwrk_capture_wgpuDeviceCreateBindGroupLayout(
+    WGPUDevice device, WGPUBindGroupLayoutDescriptor const *descriptor) {
+  WGPUBindGroupLayout layout =
+      wgpuDeviceCreateBindGroupLayout(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return layout;
+  if (begin_create_record(capture, layout, CaptureObjectType_BindGroupLayout,
+                          CaptureOp_CreateBindGroupLayout)) {
+    put_u32(capture, descriptor->entryCount);
+    for (uint32_t i = 0; i < descriptor->entryCount; i++) {
+      const WGPUBindGroupLayoutEntry *entry = &descriptor->entries[i];
+      put_u32(capture, entry->binding);
+      put_u32(capture, entry->visibility);
+      put_u32(capture, entry->buffer.type);
+      put_u32(capture, entry->buffer.hasDynamicOffset);
+      put_u64(capture, entry->buffer.minBindingSize);
+      put_u32(capture, entry->sampler.type);
+      put_u32(capture, entry->texture.sampleType);
+      put_u32(capture, entry->texture.viewDimension);
+      put_u32(capture, entry->texture.multisampled);
+      put_u32(capture, entry->storageTexture.access);
+      put_u32(capture, entry->storageTexture.format);
+      put_u32(capture, entry->storageTexture.viewDimension);
+      put_u32(capture, entry->count);
+    }
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return layout;
+}
+
+WGPUPipelineLayout frmwrk_capture_wgpuDeviceCreatePipelineLayout(
+    WGPUDevice device, WGPUPipelineLayoutDescriptor const *descriptor) {
+  WGPUPipelineLayout layout = wgpuDeviceCreatePipelineLayout(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return layout;
+  if (begin_create_record(capture, layout, CaptureObjectType_PipelineLayout,
+                          CaptureOp_CreatePipelineLayout)) {
+    put_u32(capture, descriptor->bindGroupLayoutCount);
+    for (uint32_t i = 0; i < descriptor->bindGroupLayoutCount; i++)
+      put_object(capture, descriptor->bindGroupLayouts[i]);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return layout;
+}
+
+WGPURenderPipeline frmwrk_capture_wgpuDeviceCreateRenderPipeline(
+    WGPUDevice device, WGPURenderPipelineDescriptor const *descriptor) {
+  WGPURenderPipeline pipeline =
+      wgpuDeviceCreateRenderPipeline(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return pipeline;
+  if (begin_create_record(capture, pipeline, CaptureObjectType_RenderPipeline,
+                          CaptureOp_CreateRenderPipeline)) {
+    const WGPUVertexState *vertex = &descriptor->vertex;
+    put_object(capture, descriptor->layout);
+    put_stage(capture, vertex->module, vertex->entryPoint,
+              vertex->constantCount, vertex->constants);
+    put_u32(capture, vertex->bufferCount);
+    for (uint32_t i = 0; i < vertex->bufferCount; i++) {
+      const WGPUVertexBufferLayout *buffer = &vertex->buffers[i];
+      put_u64(capture, buffer->arrayStride);
+      put_u32(capture, buffer->stepMode);
+      put_u32(capture, buffer->attributeCount);
+      for (uint32_t j = 0; j < buffer->attributeCount; j++) {
+        put_u32(capture, buffer->attributes[j].format);
+        put_u64(capture, buffer->attributes[j].offset);
+        put_u32(capture, buffer->attributes[j].shaderLocation);
+      }
+    }
+    put_u32(capture, descriptor->primitive.topology);
+    put_u32(capture, descriptor->primitive.stripIndexFormat);
+    put_u32(capture, descriptor->primitive.frontFace);
+    put_u32(capture, descriptor->primitive.cullMode);
+    put_u32(capture, descriptor->multisample.count);
+    put_u32(capture, descriptor->multisample.mask);
+    put_u32(capture, descriptor->multisample.alphaToCoverageEnabled);
+
+    const WGPUDepthStencilState *depth_stencil = descriptor->depthStencil;
+    put_u32(capture, depth_stencil != NULL);
+    if (depth_stencil) {
+      put_u32(capture, depth_stencil->format);
+      put_u32(capture, depth_stencil->depthWriteEnabled);
+      put_u32(capture, depth_stencil->depthCompare);
+      put_stencil_face(capture, &depth_stencil->stencilFront);
+      put_stencil_face(capture, &depth_stencil->stencilBack);
+      put_u32(capture, depth_stencil->stencilReadMask);
+      put_u32(capture, depth_stencil->stencilWriteMask);
+      put_i32(capture, depth_stencil->depthBias);
+      put_f32(capture, depth_stencil->depthBiasSlopeScale);
+      put_f32(capture, depth_stencil->depthBiasClamp);
+    }
+
+    const WGPUFragmentState *fragment = descriptor->fragment;
+    put_u32(capture, fragment != NULL);
+    if (fragment) {
+      put_stage(capture, fragment->module, fragment->entryPoint,
+                fragment->constantCount, fragment->constants);
+      put_u32(capture, fragment->targetCount);
+      for (uint32_t i = 0; i < fragment->targetCount; i++) {
+        const WGPUColorTargetState *target = &fragment->targets[i];
+        put_u32(capture, target->format);
+        put_u32(capture, target->blend != NULL);
+        if (target->blend) {
+          put_blend_component(capture, &target->blend->color);
+          put_blend_component(capture, &target->blend->alpha);
+        }
+        put_u32(capture, target->writeMask);
+      }
+    }
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return pipeline;
+}
+
+WGPUComputePipeline frmwrk_capture_wgpuDeviceCreateComputePipeline(
+    WGPUDevice device, WGPUComputePipelineDescriptor const *descriptor) {
+  WGPUComputePipeline pipeline =
+      wgpuDeviceCreateComputePipeline(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return pipeline;
+  if (begin_create_record(capture, pipeline, CaptureObjectType_ComputePipeline,
+                          CaptureOp_CreateComputePipeline)) {
+    const WGPUProgrammableStageDescriptor *stage = &descriptor->compute;
+    put_object(capture, descriptor->layout);
+    put_stage(capture, stage->module, stage->entryPoint, stage->constantCount,
+              stage->constants);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return pipeline;
+}
+
+WGPUBindGroup frmwrk_capture_wgpuDeviceCreateBindGroup(
+    WGPUDevice device, WGPUBindGroupDescriptor const *descriptor) {
+  WGPUBindGroup group = wgpuDeviceCreateBindGroup(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return group;
+  if (begin_create_record(capture, group, CaptureObjectType_BindGroup,
+                          CaptureOp_CreateBindGroup)) {
+    put_object(capture, descriptor->layout);
+    put_u32(capture, descriptor->entryCount);
+    for (uint32_t i = 0; i < descriptor->entryCount; i++) {
+      const WGPUBindGroupEntry *entry = &descriptor->entries[i];
+      put_u32(capture, entry->binding);
+      if (entry->buffer) {
+        put_u32(capture, CaptureBinding_Buffer);
+        put_object(capture, entry->buffer);
+        put_u64(capture, entry->offset);
+        put_u64(capture, entry->size);
+      } else if (entry->sampler) {
+        put_u32(capture, CaptureBinding_Sampler);
+        put_object(capture, entry->sampler);
+      } else if (entry->textureViewArrayLength) {
+        put_u32(capture, CaptureBinding_TextureViewArray);
+        put_u32(capture, entry->textureViewArrayLength);
+        for (uint32_t j = 0; j < entry->textureViewArrayLength; j++)
+          put_object(capture, entry->textureViewArray[j]);
+      } else {
+        put_u32(capture, CaptureBinding_TextureView);
+        put_object(capture, entry->textureView);
+      }
+    }
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return group;
+}
+
+WGPUCommandEncoder frmwrk_capture_wgpuDeviceCreateCommandEncoder(
+    WGPUDevice device, WGPUCommandEncoderDescriptor const *descriptor) {
+  WGPUCommandEncoder encoder =
+      wgpuDeviceCreateCommandEncoder(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return encoder;
+  if (begin_create_record(capture, encoder, CaptureObjectType_CommandEncoder,
+                          CaptureOp_CreateCommandEncoder))
+    end_record(capture);
+  capture_unlock(capture);
+  return encoder;
+}
+
+WGPURenderBundleEncoder frmwrk_capture_wgpuDeviceCreateRenderBundleEncoder(
+    WGPUDevice device, WGPURenderBundleEncoderDescriptor const *descriptor) {
+  WGPURenderBundleEncoder encoder =
+      wgpuDeviceCreateRenderBundleEncoder(device, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return encoder;
+  if (begin_create_record(capture, encoder,
+                          CaptureObjectType_RenderBundleEncoder,
+                          CaptureOp_CreateRenderBundleEncoder)) {
+    put_u32(capture, descriptor->colorFormatsCount);
+    for (uint32_t i = 0; i < descriptor->colorFormatsCount; i++)
+      put_u32(capture, descriptor->colorFormats[i]);
+    put_u32(capture, descriptor->depthStencilFormat);
+    put_u32(capture, descriptor->sampleCount);
+    put_u32(capture, descriptor->depthReadOnly);
+    put_u32(capture, descriptor->stencilReadOnly);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return encoder;
+}
+
+WGPUSwapChain frmwrk_capture_wgpuDeviceCreateSwapChain(
+    WGPUDevice device, WGPUSurface surface,
+    WGPUSwapChainDescriptor const *descriptor) {
+  target_width = descriptor->width;
+  target_height = descriptor->height;
+  target_format = descriptor->format;
+  return wgpuDeviceCreateSwapChain(device, surface, descriptor);
+}
+
+WGPUTextureView frmwrk_capture_wgpuSwapChainGetCurrentTextureView(
+    WGPUSwapChain swapChain) {
+  WGPUTextureView view = wgpuSwapChainGetCurrentTextureView(swapChain);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return view;
+  if (begin_create_record(capture, view, CaptureObjectType_TextureView,
+                          CaptureOp_AcquireTarget)) {
+    put_u32(capture, target_width);
+    put_u32(capture, target_height);
+    put_u32(capture, target_format);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return view;
+}
+#pragma endregion
+
+#pragma region buffers
+void *frmwrk_capture_wgpuBufferGetMappedRange(WGPUBuffer buffer, size_t offset,
+                                              size_t size) {
+  void *mapping = wgpuBufferGetMappedRange(buffer, offset, size);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return mapping;
+  CaptureObject *object = find_object(capture, buffer);
+  if (mapping && object &&
+      (object->type == CaptureObjectType_StagingBuffer ||
+       object->mappedAtCreation)) {
+    object->mapping = mapping;
+    object->mappingOffset = offset;
+    object->mappingSize =
+        size == WGPU_WHOLE_MAP_SIZE ? object->size - offset : size;
+  }
+  capture_unlock(capture);
+  return mapping;
+}
+
+void frmwrk_capture_wgpuBufferUnmap(WGPUBuffer buffer) {
+  Capture *capture = capture_lock();
+  if (capture) {
+    CaptureObject *object = find_object(capture, buffer);
+    if (object && object->mappedAtCreation) {
+      if (object->mapping) {
+        begin_record(capture, CaptureOp_UnmapBuffer);
+        put_u32(capture, object->id);
+        put_u64(capture, object->mappingOffset);
+        put_bytes(capture, object->mapping, object->mappingSize);
+        end_record(capture);
+      }
+      object->mappedAtCreation = false;
+    }
+    if (object)
+      object->mapping = NULL;
+    capture_unlock(capture);
+  }
+  wgpuBufferUnmap(buffer);
+}
+#pragma endregion
+
+#pragma region drops
+static void capture_drop(const void *handle) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  CaptureObject *object = find_object(capture, handle);
+  if (object) {
+    if (object->type != CaptureObjectType_StagingBuffer) {
+      begin_record(capture, CaptureOp_Drop);
+      put_u32(capture, object->id);
+      end_record(capture);
+    }
+    remove_object(capture, object);
+  }
+  capture_unlock(capture);
+}
+
+#define CAPTURE_DROP(Type)                                                     \
+  void frmwrk_capture_wgpu##Type##Drop(WGPU##Type object) {                    \
+    capture_drop(object);                                                      \
+    wgpu##Type##Drop(object);                                                  \
+  }
+
+CAPTURE_DROP(Buffer)
+CAPTURE_DROP(Texture)
+CAPTURE_DROP(TextureView)
+CAPTURE_DROP(Sampler)
+CAPTURE_DROP(ShaderModule)
+CAPTURE_DROP(BindGroupLayout)
+CAPTURE_DROP(PipelineLayout)
+CAPTURE_DROP(RenderPipeline)
+CAPTURE_DROP(ComputePipeline)
+CAPTURE_DROP(BindGroup)
+CAPTURE_DROP(CommandEncoder)
+CAPTURE_DROP(CommandBuffer)
+CAPTURE_DROP(RenderBundle)
+#pragma endregion
+
+#pragma region command encoder
+WGPURenderPassEncoder frmwrk_capture_wgpuCommandEncoderBeginRenderPass(
+    WGPUCommandEncoder encoder, WGPURenderPassDescriptor const *descriptor) {
+  WGPURenderPassEncoder pass =
+      wgpuCommandEncoderBeginRenderPass(encoder, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return pass;
+  uint32_t encoder_id = object_id(capture, encoder);
+  if (encoder_id && begin_create_record(capture, pass,
+                                        CaptureObjectType_RenderPassEncoder,
+                                        CaptureOp_BeginRenderPass)) {
+    put_u32(capture, encoder_id);
+    put_u32(capture, descriptor->colorAttachmentCount);
+    for (uint32_t i = 0; i < descriptor->colorAttachmentCount; i++) {
+      const WGPURenderPassColorAttachment *attachment =
+          &descriptor->colorAttachments[i];
+      put_object(capture, attachment->view);
+      put_object(capture, attachment->resolveTarget);
+      put_u32(capture, attachment->loadOp);
+      put_u32(capture, attachment->storeOp);
+      put_f64(capture, attachment->clearValue.r);
+      put_f64(capture, attachment->clearValue.g);
+      put_f64(capture, attachment->clearValue.b);
+      put_f64(capture, attachment->clearValue.a);
+    }
+    const WGPURenderPassDepthStencilAttachment *depth_stencil =
+        descriptor->depthStencilAttachment;
+    put_u32(capture, depth_stencil != NULL);
+    if (depth_stencil) {
+      put_object(capture, depth_stencil->view);
+      put_u32(capture, depth_stencil->depthLoadOp);
+      put_u32(capture, depth_stencil->depthStoreOp);
+      put_f32(capture, depth_stencil->depthClearValue);
+      put_u32(capture, depth_stencil->depthReadOnly);
+      put_u32(capture, depth_stencil->stencilLoadOp);
+      put_u32(capture, depth_stencil->stencilStoreOp);
+      put_u32(capture, depth_stencil->stencilClearValue);
+      put_u32(capture, depth_stencil->stencilReadOnly);
+    }
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return pass;
+}
+
+WGPUComputePassEncoder frmwrk_capture_wgpuCommandEncoderBeginComputePass(
+    WGPUCommandEncoder encoder, WGPUComputePassDescriptor const *descriptor) {
+  WGPUComputePassEncoder pass =
+      wgpuCommandEncoderBeginComputePass(encoder, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return pass;
+  uint32_t encoder_id = object_id(capture, encoder);
+  if (encoder_id && begin_create_record(capture, pass,
+                                        CaptureObjectType_ComputePassEncoder,
+                                        CaptureOp_BeginComputePass)) {
+    put_u32(capture, encoder_id);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return pass;
+}
+
+void frmwrk_capture_wgpuCommandEncoderCopyBufferToBuffer(
+    WGPUCommandEncoder encoder, WGPUBuffer source, uint64_t sourceOffset,
+    WGPUBuffer destination, uint64_t destinationOffset, uint64_t size) {
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, source, sourceOffset,
+                                       destination, destinationOffset, size);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  const CaptureObject *staging = find_object(capture, source);
+  if (staging && staging->type == CaptureObjectType_StagingBuffer) {
+    const unsigned char *data =
+        staging_range(capture, staging, sourceOffset, &size, false);
+    if (data && begin_encoder_record(capture, CaptureOp_CopyDataToBuffer,
+                                     encoder)) {
+      put_object(capture, destination);
+      put_u64(capture, destinationOffset);
+      put_bytes(capture, data, size);
+      end_record(capture);
+    }
+  } else if (begin_encoder_record(capture, CaptureOp_CopyBufferToBuffer,
+                                  encoder)) {
+    put_object(capture, source);
+    put_u64(capture, sourceOffset);
+    put_object(capture, destination);
+    put_u64(capture, destinationOffset);
+    put_u64(capture, size);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuCommandEncoderCopyBufferToTexture(
+    WGPUCommandEncoder encoder, WGPUImageCopyBuffer const *source,
+    WGPUImageCopyTexture const *destination, WGPUExtent3D const *copySize) {
+  wgpuCommandEncoderCopyBufferToTexture(encoder, source, destination,
+                                        copySize);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  const CaptureObject *staging = find_object(capture, source->buffer);
+  if (staging && staging->type == CaptureObjectType_StagingBuffer) {
+    // Rows are counted in texels rather than blocks for compressed formats,
+    // so this can overshoot; the clamp to the mapping keeps it in bounds.
+    const WGPUTextureDataLayout *layout = &source->layout;
+    uint64_t rows =
+        layout->rowsPerImage ? layout->rowsPerImage : copySize->height;
+    uint64_t size = layout->bytesPerRow
+                        ? layout->bytesPerRow * rows *
+                              copySize->depthOrArrayLayers
+                        : UINT64_MAX;
+    const unsigned char *data =
+        staging_range(capture, staging, layout->offset, &size, true);
+    if (data && begin_encoder_record(capture, CaptureOp_CopyDataToTexture,
+                                     encoder)) {
+      put_u32(capture, layout->bytesPerRow);
+      put_u32(capture, layout->rowsPerImage);
+      put_copy_texture(capture, destination);
+      put_extent(capture, copySize);
+      put_bytes(capture, data, size);
+      end_record(capture);
+    }
+  } else if (begin_encoder_record(capture, CaptureOp_CopyBufferToTexture,
+                                  encoder)) {
+    put_copy_buffer(capture, source);
+    put_copy_texture(capture, destination);
+    put_extent(capture, copySize);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuCommandEncoderCopyTextureToBuffer(
+    WGPUCommandEncoder encoder, WGPUImageCopyTexture const *source,
+    WGPUImageCopyBuffer const *destination, WGPUExtent3D const *copySize) {
+  wgpuCommandEncoderCopyTextureToBuffer(encoder, source, destination,
+                                        copySize);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_CopyTextureToBuffer, encoder)) {
+    put_copy_texture(capture, source);
+    put_copy_buffer(capture, destination);
+    put_extent(capture, copySize);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuCommandEncoderCopyTextureToTexture(
+    WGPUCommandEncoder encoder, WGPUImageCopyTexture const *source,
+    WGPUImageCopyTexture const *destination, WGPUExtent3D const *copySize) {
+  wgpuCommandEncoderCopyTextureToTexture(encoder, source, destination,
+                                         copySize);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_CopyTextureToTexture, encoder)) {
+    put_copy_texture(capture, source);
+    put_copy_texture(capture, destination);
+    put_extent(capture, copySize);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+WGPUCommandBuffer frmwrk_capture_wgpuCommandEncoderFinish(
+    WGPUCommandEncoder encoder, WGPUCommandBufferDescriptor const *descriptor) {
+  // Finishing drops the encoder.
+  uint32_t encoder_id = take_object(encoder);
+  WGPUCommandBuffer commands = wgpuCommandEncoderFinish(encoder, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return commands;
+  if (encoder_id) {
+    CaptureObject *object =
+        commands ? add_object(capture, commands, CaptureObjectType_CommandBuffer)
+                 : NULL;
+    begin_record(capture, CaptureOp_FinishCommandEncoder);
+    put_u32(capture, encoder_id);
+    put_u32(capture, object ? object->id : 0);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return commands;
+}
+#pragma endregion
+
+#pragma region passes
+static void record_set_pipeline(const void *encoder, const void *pipeline) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_SetPipeline, encoder)) {
+    put_object(capture, pipeline);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+static void record_set_bind_group(const void *encoder, uint32_t groupIndex,
+                                  WGPUBindGroup group,
+                                  uint32_t dynamicOffsetCount,
+                                  uint32_t const *dynamicOffsets) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_SetBindGroup, encoder)) {
+    put_u32(capture, groupIndex);
+    put_object(capture, group);
+    put_u32(capture, dynamicOffsetCount);
+    put(capture, dynamicOffsets, dynamicOffsetCount * sizeof(uint32_t));
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+static void record_set_vertex_buffer(const void *encoder, uint32_t slot,
+                                     WGPUBuffer buffer, uint64_t offset,
+                                     uint64_t size) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_SetVertexBuffer, encoder)) {
+    put_u32(capture, slot);
+    put_object(capture, buffer);
+    put_u64(capture, offset);
+    put_u64(capture, size);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+static void record_set_index_buffer(const void *encoder, WGPUBuffer buffer,
+                                    WGPUIndexFormat format, uint64_t offset,
+                                    uint64_t size) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_SetIndexBuffer, encoder)) {
+    put_object(capture, buffer);
+    put_u32(capture, format);
+    put_u64(capture, offset);
+    put_u64(capture, size);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+static void record_draw(const void *encoder, uint32_t vertexCount,
+                        uint32_t instanceCount, uint32_t firstVertex,
+                        uint32_t firstInstance) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_Draw, encoder)) {
+    put_u32(capture, vertexCount);
+    put_u32(capture, instanceCount);
+    put_u32(capture, firstVertex);
+    put_u32(capture, firstInstance);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+static void record_draw_indexed(const void *encoder, uint32_t indexCount,
+                                uint32_t instanceCount, uint32_t firstIndex,
+                                int32_t baseVertex, uint32_t firstInstance) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_DrawIndexed, encoder)) {
+    put_u32(capture, indexCount);
+    put_u32(capture, instanceCount);
+    put_u32(capture, firstIndex);
+    put_i32(capture, baseVertex);
+    put_u32(capture, firstInstance);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+// Ending a pass drops it.
+static void record_end_pass(const void *pass) {
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_EndPass, pass)) {
+    end_record(capture);
+    remove_object(capture, find_object(capture, pass));
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderSetPipeline(
+    WGPURenderPassEncoder pass, WGPURenderPipeline pipeline) {
+  wgpuRenderPassEncoderSetPipeline(pass, pipeline);
+  record_set_pipeline(pass, pipeline);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderSetBindGroup(
+    WGPURenderPassEncoder pass, uint32_t groupIndex, WGPUBindGroup group,
+    uint32_t dynamicOffsetCount, uint32_t const *dynamicOffsets) {
+  wgpuRenderPassEncoderSetBindGroup(pass, groupIndex, group,
+                                    dynamicOffsetCount, dynamicOffsets);
+  record_set_bind_group(pass, groupIndex, group, dynamicOffsetCount,
+                        dynamicOffsets);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderSetVertexBuffer(
+    WGPURenderPassEncoder pass, uint32_t slot, WGPUBuffer buffer,
+    uint64_t offset, uint64_t size) {
+  wgpuRenderPassEncoderSetVertexBuffer(pass, slot, buffer, offset, size);
+  record_set_vertex_buffer(pass, slot, buffer, offset, size);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderSetIndexBuffer(
+    WGPURenderPassEncoder pass, WGPUBuffer buffer, WGPUIndexFormat format,
+    uint64_t offset, uint64_t size) {
+  wgpuRenderPassEncoderSetIndexBuffer(pass, buffer, format, offset, size);
+  record_set_index_buffer(pass, buffer, format, offset, size);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderDraw(WGPURenderPassEncoder pass,
+                                              uint32_t vertexCount,
+                                              uint32_t instanceCount,
+                                              uint32_t firstVertex,
+                                              uint32_t firstInstance) {
+  wgpuRenderPassEncoderDraw(pass, vertexCount, instanceCount, firstVertex,
+                            firstInstance);
+  record_draw(pass, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderDrawIndexed(
+    WGPURenderPassEncoder pass, uint32_t indexCount, uint32_t instanceCount,
+    uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) {
+  wgpuRenderPassEncoderDrawIndexed(pass, indexCount, instanceCount, firstIndex,
+                                   baseVertex, firstInstance);
+  record_draw_indexed(pass, indexCount, instanceCount, firstIndex, baseVertex,
+                      firstInstance);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderExecuteBundles(
+    WGPURenderPassEncoder pass, uint32_t bundleCount,
+    WGPURenderBundle const *bundles) {
+  wgpuRenderPassEncoderExecuteBundles(pass, bundleCount, bundles);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_ExecuteBundles, pass)) {
+    put_u32(capture, bundleCount);
+    for (uint32_t i = 0; i < bundleCount; i++)
+      put_object(capture, bundles[i]);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuRenderPassEncoderEnd(WGPURenderPassEncoder pass) {
+  record_end_pass(pass);
+  wgpuRenderPassEncoderEnd(pass);
+}
+
+void frmwrk_capture_wgpuRenderBundleEncoderSetPipeline(
+    WGPURenderBundleEncoder encoder, WGPURenderPipeline pipeline) {
+  wgpuRenderBundleEncoderSetPipeline(encoder, pipeline);
+  record_set_pipeline(encoder, pipeline);
+}
+
+void frmwrk_capture_wgpuRenderBundleEncoderSetBindGroup(
+    WGPURenderBundleEncoder encoder, uint32_t groupIndex, WGPUBindGroup group,
+    uint32_t dynamicOffsetCount, uint32_t const *dynamicOffsets) {
+  wgpuRenderBundleEncoderSetBindGroup(encoder, groupIndex, group,
+                                      dynamicOffsetCount, dynamicOffsets);
+  record_set_bind_group(encoder, groupIndex, group, dynamicOffsetCount,
+                        dynamicOffsets);
+}
+
+void frmwrk_capture_wgpuRenderBundleEncoderSetVertexBuffer(
+    WGPURenderBundleEncoder encoder, uint32_t slot, WGPUBuffer buffer,
+    uint64_t offset, uint64_t size) {
+  wgpuRenderBundleEncoderSetVertexBuffer(encoder, slot, buffer, offset, size);
+  record_set_vertex_buffer(encoder, slot, buffer, offset, size);
+}
+
+void frmwrk_capture_wgpuRenderBundleEncoderSetIndexBuffer(
+    WGPURenderBundleEncoder encoder, WGPUBuffer buffer, WGPUIndexFormat format,
+    uint64_t offset, uint64_t size) {
+  wgpuRenderBundleEncoderSetIndexBuffer(encoder, buffer, format, offset, size);
+  record_set_index_buffer(encoder, buffer, format, offset, size);
+}
+
+void frmwrk_capture_wgpuRenderBundleEncoderDraw(WGPURenderBundleEncoder encoder,
+                                                uint32_t vertexCount,
+                                                uint32_t instanceCount,
+                                                uint32_t firstVertex,
+                                                uint32_t firstInstance) {
+  wgpuRenderBundleEncoderDraw(encoder, vertexCount, instanceCount, firstVertex,
+                              firstInstance);
+  record_draw(encoder, vertexCount, instanceCount, firstVertex, firstInstance);
+}
+
+void frmwrk_capture_wgpuRenderBundleEncoderDrawIndexed(
+    WGPURenderBundleEncoder encoder, uint32_t indexCount,
+    uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+    uint32_t firstInstance) {
+  wgpuRenderBundleEncoderDrawIndexed(encoder, indexCount, instanceCount,
+                                     firstIndex, baseVertex, firstInstance);
+  record_draw_indexed(encoder, indexCount, instanceCount, firstIndex,
+                      baseVertex, firstInstance);
+}
+
+WGPURenderBundle frmwrk_capture_wgpuRenderBundleEncoderFinish(
+    WGPURenderBundleEncoder encoder,
+    WGPURenderBundleDescriptor const *descriptor) {
+  // Finishing drops the encoder.
+  uint32_t encoder_id = take_object(encoder);
+  WGPURenderBundle bundle = wgpuRenderBundleEncoderFinish(encoder, descriptor);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return bundle;
+  if (encoder_id) {
+    CaptureObject *object =
+        bundle ? add_object(capture, bundle, CaptureObjectType_RenderBundle)
+               : NULL;
+    begin_record(capture, CaptureOp_FinishRenderBundleEncoder);
+    put_u32(capture, encoder_id);
+    put_u32(capture, object ? object->id : 0);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+  return bundle;
+}
+
+void frmwrk_capture_wgpuComputePassEncoderSetPipeline(
+    WGPUComputePassEncoder pass, WGPUComputePipeline pipeline) {
+  wgpuComputePassEncoderSetPipeline(pass, pipeline);
+  record_set_pipeline(pass, pipeline);
+}
+
+void frmwrk_capture_wgpuComputePassEncoderSetBindGroup(
+    WGPUComputePassEncoder pass, uint32_t groupIndex, WGPUBindGroup group,
+    uint32_t dynamicOffsetCount, uint32_t const *dynamicOffsets) {
+  wgpuComputePassEncoderSetBindGroup(pass, groupIndex, group,
+                                     dynamicOffsetCount, dynamicOffsets);
+  record_set_bind_group(pass, groupIndex, group, dynamicOffsetCount,
+                        dynamicOffsets);
+}
+
+void frmwrk_capture_wgpuComputePassEncoderDispatchWorkgroups(
+    WGPUComputePassEncoder pass, uint32_t workgroupCountX,
+    uint32_t workgroupCountY, uint32_t workgroupCountZ) {
+  wgpuComputePassEncoderDispatchWorkgroups(pass, workgroupCountX,
+                                           workgroupCountY, workgroupCountZ);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  if (begin_encoder_record(capture, CaptureOp_Dispatch, pass)) {
+    put_u32(capture, workgroupCountX);
+    put_u32(capture, workgroupCountY);
+    put_u32(capture, workgroupCountZ);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuComputePassEncoderEnd(WGPUComputePassEncoder pass) {
+  record_end_pass(pass);
+  wgpuComputePassEncoderEnd(pass);
+}
+#pragma endregion
+
+#pragma region queue
+void frmwrk_capture_wgpuQueueWriteBuffer(WGPUQueue queue, WGPUBuffer buffer,
+                                         uint64_t bufferOffset,
+                                         void const *data, size_t size) {
+  wgpuQueueWriteBuffer(queue, buffer, bufferOffset, data, size);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  uint32_t buffer_id = object_id(capture, buffer);
+  if (buffer_id) {
+    begin_record(capture, CaptureOp_WriteBuffer);
+    put_u32(capture, buffer_id);
+    put_u64(capture, bufferOffset);
+    put_bytes(capture, data, size);
+    end_record(capture);
+  }
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuQueueWriteTexture(
+    WGPUQueue queue, WGPUImageCopyTexture const *destination, void const *data,
+    size_t dataSize, WGPUTextureDataLayout const *dataLayout,
+    WGPUExtent3D const *writeSize) {
+  wgpuQueueWriteTexture(queue, destination, data, dataSize, dataLayout,
+                        writeSize);
+  Capture *capture = capture_lock();
+  if (!capture)
+    return;
+  begin_record(capture, CaptureOp_WriteTexture);
+  put_copy_texture(capture, destination);
+  put_u64(capture, dataLayout->offset);
+  put_u32(capture, dataLayout->bytesPerRow);
+  put_u32(capture, dataLayout->rowsPerImage);
+  put_extent(capture, writeSize);
+  put_bytes(capture, data, dataSize);
+  end_record(capture);
+  capture_unlock(capture);
+}
+
+void frmwrk_capture_wgpuQueueSubmit(WGPUQueue queue, uint32_t commandCount,
+                                    WGPUCommandBuffer const *commands) {
+  // Submitting drops the command buffers.
+  Capture *capture = capture_lock();
+  if (capture) {
+    begin_record(capture, CaptureOp_Submit);
+    put_u32(capture, commandCount);
+    for (uint32_t i = 0; i < commandCount; i++) {
+      CaptureObject *object = find_object(capture, commands[i]);
+      put_u32(capture, object ? object->id : 0);
+      if (object)
+        remove_object(capture, object);
+    }
+    end_record(capture);
+    capture_unlock(capture);
+  }
+  wgpuQueueSubmit(queue, commandCount, commands);
+}
+#pragma endregion
+#endif // FRMWRK_CAPTURE
+
+Capture *frmwrk_create_capture(WGPUDevice device, const char *path) {
+#if !defined(FRMWRK_CAPTURE)
+  UNUSED(device)
+  printf("[capture] cannot record %s: built without -Dcapture=true\n", path);
+  return NULL;
+#else
+  if (atomic_load(&active_capture)) {
+    printf("[capture] a capture is already running\n");
+    return NULL;
+  }
+  Capture *capture = calloc(1, sizeof(Capture));
+  if (!capture)
+    return NULL;
+  capture->device = device;
+  capture->nextId = 1;
+  capture->objectCapacity = CAPTURE_INITIAL_OBJECTS;
+  capture->objects = calloc(capture->objectCapacity, sizeof(CaptureObject));
+  capture->file = fopen(path, "wb");
+  if (!capture->objects || !capture->file) {
+    printf("[capture] could not open %s\n", path);
+    frmwrk_drop_capture(capture);
+    return NULL;
+  }
+
+  const uint32_t file_header[2] = {CAPTURE_MAGIC, CAPTURE_VERSION};
+  fwrite(file_header, sizeof(file_header), 1, capture->file);
+
+  WGPUFeatureName features[CAPTURE_MAX_FEATURES];
+  size_t feature_count = wgpuDeviceEnumerateFeatures(device, NULL);
+  if (feature_count > CAPTURE_MAX_FEATURES)
+    feature_count = 0;
+  wgpuDeviceEnumerateFeatures(device, feature_count ? features : NULL);
+  begin_record(capture, CaptureOp_Device);
+  put_u32(capture, (uint32_t)feature_count);
+  for (size_t i = 0; i < feature_count; i++)
+    put_u32(capture, features[i]);
+  end_record(capture);
+
+  if (!capture_mutex_initialized) {
+    frmwrk_mutex_init(&capture_mutex);
+    capture_mutex_initialized = true;
+  }
+  atomic_store_explicit(&active_capture, capture, memory_order_release);
+  printf("[capture] recording to %s\n", path);
+  return capture;
+#endif
+}
+
+void frmwrk_drop_capture(Capture *capture) {
+  if (!capture)
+    return;
+#if defined(FRMWRK_CAPTURE)
+  if (capture_mutex_initialized) {
+    // Waits out any call still recording.
+    frmwrk_mutex_lock(&capture_mutex);
+    if (atomic_load_explicit(&active_capture, memory_order_relaxed) == capture)
+      atomic_store_explicit(&active_capture, NULL, memory_order_relaxed);
+    frmwrk_mutex_unlock(&capture_mutex);
+  }
+#endif
+  if (capture->file)
+    fclose(capture->file);
+  free(capture->objects);
+  free(capture->scratch);
+  free(capture);
+}
+
+void frmwrk_capture_frame(Capture *capture) {
+  if (!capture)
+    return;
+#if defined(FRMWRK_CAPTURE)
+  frmwrk_mutex_lock(&capture_mutex);
+  begin_record(capture, CaptureOp_FrameEnd);
+  put_u64(capture, capture->stats.frames++);
+  end_record(capture);
+  frmwrk_mutex_unlock(&capture_mutex);
+#endif
+}
+
+void frmwrk_capture_print(const Capture *capture) {
+  if (!capture)
+    return;
+  printf("[capture] %llu records (%.1f MiB) over %llu frames, %llu objects, "
+         "%llu calls skipped, %llu on unknown objects%s\n",
+         (unsigned long long)capture->stats.records,
+         capture->stats.bytes / (1024.0 * 1024.0),
+         (unsigned long long)capture->stats.frames,
+         (unsigned long long)capture->stats.objects,
+         (unsigned long long)capture->stats.skipped,
+         (unsigned long long)capture->stats.unknownObjects,
+         capture->failed ? ", write failed" : "");
+}
@@ -0,0 +1,460 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include "webgpu-headers/webgpu.h"
+#include "wgpu.h"
+
+// "FCAP" read as a little-endian uint32_t.
+#define CAPTURE_MAGIC 0x50414346u
+#define CAPTURE_VERSION 1
+#define CAPTURE_MAX_FEATURES 64
+
+// A trace starts with the magic and version as two uint32_t, followed by
+// records: a CaptureRecordHeader, then `size` bytes of payload. Payloads are
+// the fields listed below, little-endian and unpadded. Objects are named by
+// ids counting up from 1; 0 stands for NULL or an object the trace does not
+// know, such as a query set. Byte arrays are a uint32_t length followed by the
+// bytes; strings are stored the same way with their NUL, and NULL as length 0.
+typedef enum CaptureOp {
+  // featureCount, features[]: what the device was created with.
+  CaptureOp_Device = 1,
+  // id, usage, size(u64), mappedAtCreation
+  CaptureOp_CreateBuffer,
+  // id, usage, dimension, width, height, depthOrArrayLayers, format,
+  // mipLevelCount, sampleCount, viewFormatCount, viewFormats[]
+  CaptureOp_CreateTexture,
+  // id, texture, hasDescriptor, then format, dimension, baseMipLevel,
+  // mipLevelCount, baseArrayLayer, arrayLayerCount, aspect
+  CaptureOp_CreateTextureView,
+  // id, hasDescriptor, then addressModeU/V/W, magFilter, minFilter,
+  // mipmapFilter, lodMinClamp(f32), lodMaxClamp(f32), compare, maxAnisotropy
+  CaptureOp_CreateSampler,
+  // id, code(string): WGSL only.
+  CaptureOp_CreateShaderModule,
+  // id, entryCount, then per entry binding, visibility, buffer type,
+  // hasDynamicOffset, minBindingSize(u64), sampler type, texture sampleType,
+  // viewDimension, multisampled, storageTexture access, format,
+  // viewDimension, count
+  CaptureOp_CreateBindGroupLayout,
+  // id, layoutCount, layouts[]
+  CaptureOp_CreatePipelineLayout,
+  // id, layout, vertex stage, bufferCount, then per buffer arrayStride(u64),
+  // stepMode, attributeCount, then per attribute format, offset(u64),
+  // shaderLocation; topology, stripIndexFormat, frontFace, cullMode,
+  // sampleCount, sampleMask, alphaToCoverage, hasDepthStencil, then format,
+  // depthWriteEnabled, depthCompare, stencilFront and stencilBack as compare,
+  // failOp, depthFailOp, passOp, stencilReadMask, stencilWriteMask,
+  // depthBias(i32), depthBiasSlopeScale(f32), depthBiasClamp(f32);
+  // hasFragment, then fragment stage,
+  // targetCount, then per target format, hasBlend, color and alpha
+  // operation/srcFactor/dstFactor, writeMask. A stage is module,
+  // entryPoint(string), constantCount, then per constant key(string),
+  // value(f64).
+  CaptureOp_CreateRenderPipeline,
+  // id, layout, stage
+  CaptureOp_CreateComputePipeline,
+  // id, layout, entryCount, then per entry binding, kind (a CaptureBinding),
+  // then buffer, offset(u64), size(u64) | sampler | view | count, views[]
+  CaptureOp_CreateBindGroup,
+  // id
+  CaptureOp_CreateCommandEncoder,
+  // encoder, commandBuffer
+  CaptureOp_FinishCommandEncoder,
+  // id, colorFormatCount, colorFormats[], depthStencilFormat, sampleCount,
+  // depthReadOnly, stencilReadOnly
+  CaptureOp_CreateRenderBundleEncoder,
+  // encoder, bundle
+  CaptureOp_FinishRenderBundleEncoder,
+  // encoder, source, sourceOffset(u64), destination, destinationOffset(u64),
+  // size(u64)
+  CaptureOp_CopyBufferToBuffer,
+  // encoder, then CopyBuffer, CopyTexture and extent as for the call
+  CaptureOp_CopyBufferToTexture,
+  CaptureOp_CopyTextureToBuffer,
+  CaptureOp_CopyTextureToTexture,
+  // encoder, destination, destinationOffset(u64), data(bytes): a copy out of
+  // a mapped staging buffer, with the bytes it read.
+  CaptureOp_CopyDataToBuffer,
+  // encoder, bytesPerRow, rowsPerImage, CopyTexture, extent, data(bytes)
+  CaptureOp_CopyDataToTexture,
+  // encoder, pass, colorAttachmentCount, then per attachment view,
+  // resolveTarget, loadOp, storeOp, clearValue(4 x f64); hasDepthStencil,
+  // then view, depthLoadOp, depthStoreOp, depthClearValue(f32),
+  // depthReadOnly, stencilLoadOp, stencilStoreOp, stencilClearValue,
+  // stencilReadOnly
+  CaptureOp_BeginRenderPass,
+  // encoder, pass
+  CaptureOp_BeginComputePass,
+  // The commands below name a render pass, render bundle encoder or compute
+  // pass as `encoder`.
+  // encoder, pipeline
+  CaptureOp_SetPipeline,
+  // encoder, groupIndex, group, dynamicOffsetCount, dynamicOffsets[]
+  CaptureOp_SetBindGroup,
+  // encoder, slot, buffer, offset(u64), size(u64)
+  CaptureOp_SetVertexBuffer,
+  // encoder, buffer, format, offset(u64), size(u64)
+  CaptureOp_SetIndexBuffer,
+  // encoder, vertexCount, instanceCount, firstVertex, firstInstance
+  CaptureOp_Draw,
+  // encoder, indexCount, instanceCount, firstIndex, baseVertex(i32),
+  // firstInstance
+  CaptureOp_DrawIndexed,
+  // encoder, x, y, z
+  CaptureOp_Dispatch,
+  // encoder, bundleCount, bundles[]
+  CaptureOp_ExecuteBundles,
+  // encoder: ends and drops a render or compute pass.
+  CaptureOp_EndPass,
+  // buffer, offset(u64), data(bytes)
+  CaptureOp_WriteBuffer,
+  // CopyTexture, offset(u64), bytesPerRow, rowsPerImage, extent, data(bytes)
+  CaptureOp_WriteTexture,
+  // buffer, offset(u64), data(bytes): what was written through the mapping
+  // of a buffer created mappedAtCreation, then unmapped.
+  CaptureOp_UnmapBuffer,
+  // commandBufferCount, commandBuffers[]: submits and drops them.
+  CaptureOp_Submit,
+  // view, width, height, format: the swapchain's view for this frame, which
+  // the replay renders into an offscreen texture instead.
+  CaptureOp_AcquireTarget,
+  // frame(u64): everything since the previous marker made up one frame.
+  CaptureOp_FrameEnd,
+  // id
+  CaptureOp_Drop,
+  CaptureOp_Count
+} CaptureOp;
+
+// A CopyBuffer is buffer, offset(u64), bytesPerRow, rowsPerImage; a
+// CopyTexture is texture, mipLevel, origin x, y, z, aspect; an extent is
+// width, height, depthOrArrayLayers.
+
+typedef enum CaptureBinding {
+  CaptureBinding_Buffer,
+  CaptureBinding_Sampler,
+  CaptureBinding_TextureView,
+  CaptureBinding_TextureViewArray,
+} CaptureBinding;
+
+typedef struct CaptureRecordHeader {
+  uint32_t op;
+  uint32_t size;
+} CaptureRecordHeader;
+
+typedef enum CaptureObjectType {
+  CaptureObjectType_None,
+  CaptureObjectType_Buffer,
+  CaptureObjectType_Texture,
+  CaptureObjectType_TextureView,
+  CaptureObjectType_Sampler,
+  CaptureObjectType_ShaderModule,
+  CaptureObjectType_BindGroupLayout,
+  CaptureObjectType_PipelineLayout,
+  CaptureObjectType_RenderPipeline,
+  CaptureObjectType_ComputePipeline,
+  CaptureObjectType_BindGroup,
+  CaptureObjectType_CommandEncoder,
+  CaptureObjectType_CommandBuffer,
+  CaptureObjectType_RenderPassEncoder,
+  CaptureObjectType_ComputePassEncoder,
+  CaptureObjectType_RenderBundleEncoder,
+  CaptureObjectType_RenderBundle,
+  // MapWrite staging buffers, which are not recorded: copies out of them are
+  // recorded with the bytes they read instead.
+  CaptureObjectType_StagingBuffer,
+} CaptureObjectType;
+
+// A live object the trace has named, found by its handle.
+typedef struct CaptureObject {
+  const void *handle;
+  uint32_t id;
+  CaptureObjectType type;
+  // Buffers only.
+  uint64_t size;
+  // Still mapped from creation; unmapping records what was written.
+  bool mappedAtCreation;
+  // The range handed out by wgpuBufferGetMappedRange while mapped for
+  // writing.
+  unsigned char *mapping;
+  uint64_t mappingOffset;
+  uint64_t mappingSize;
+} CaptureObject;
+
+typedef struct CaptureStats {
+  uint64_t records;
+  uint64_t bytes;
+  uint64_t frames;
+  uint64_t objects;
+  // Copies out of staging memory that was no longer mapped, and calls naming
+  // objects created before the capture started.
+  uint64_t skipped;
+  uint64_t unknownObjects;
+} CaptureStats;
+
+// Records the wgpu calls the app makes into a trace the replay tool re-issues
+// against a headless device. Calls are routed here by the macros at the end
+// of this header in builds with FRMWRK_CAPTURE (zig build -Dcapture=true);
+// other builds call wgpu directly and cannot capture. While no capture is
+// running the wrappers only forward the call.
+//
+// Calls may come from any thread; records are serialised under one lock, so
+// each object's creation lands ahead of its uses. Calls that consume a handle
+// (drops, finishing an encoder, ending a pass, submitting) are recorded before
+// the handle is released, so a reused handle never aliases an older id.
+typedef struct Capture {
+  FILE *file;
+  WGPUDevice device;
+  uint32_t nextId;
+
+  // Open-addressed by handle.
+  CaptureObject *objects;
+  uint32_t objectCapacity;
+  uint32_t objectCount;
+  uint32_t tombstoneCount;
+
+  // The record being built.
+  unsigned char *scratch;
+  size_t scratchSize;
+  size_t scratchCapacity;
+  bool failed;
+
+  CaptureStats stats;
+} Capture;
+
+// Starts recording calls made on `device` into a new file at `path`. Only one
+// capture runs at a time. Returns NULL in builds without FRMWRK_CAPTURE.
+Capture *frmwrk_create_capture(WGPUDevice device, const char *path);
+// Stops recording and closes the trace.
+void frmwrk_drop_capture(Capture *capture);
+// Marks the end of a frame, after its submit.
+void frmwrk_capture_frame(Capture *capture);
+void frmwrk_capture_print(const Capture *capture);
+
+#if defined(FRMWRK_CAPTURE)
+WGPUBuffer frmwrk_capture_wgpuDeviceCreateBuffer(
+    WGPUDevice device, WGPUBufferDescriptor const *descriptor);
+WGPUTexture frmwrk_capture_wgpuDeviceCreateTexture(
+    WGPUDevice device, WGPUTextureDescriptor const *descriptor);
+WGPUTextureView frmwrk_capture_wgpuTextureCreateView(
+    WGPUTexture texture, WGPUTextureViewDescriptor const *descriptor);
+WGPUSampler frmwrk_capture_wgpuDeviceCreateSampler(
+    WGPUDevice device, WGPUSamplerDescriptor const *descriptor);
+WGPUShaderModule frmwrk_capture_wgpuDeviceCreateShaderModule(
+    WGPUDevice device, WGPUShaderModuleDescriptor const *descriptor);
+WGPUBindGroupLayout frmwrk_capture_wgpuDeviceCreateBindGroupLayout(
+    WGPUDevice device, WGPUBindGroupLayoutDescriptor const *descriptor);
+WGPUPipelineLayout frmwrk_capture_wgpuDeviceCreatePipelineLayout(
+    WGPUDevice device, WGPUPipelineLayoutDescriptor const *descriptor);
+WGPURenderPipeline frmwrk_capture_wgpuDeviceCreateRenderPipeline(
+    WGPUDevice device, WGPURenderPipelineDescriptor const *descriptor);
+WGPUComputePipeline frmwrk_capture_wgpuDeviceCreateComputePipeline(
+    WGPUDevice device, WGPUComputePipelineDescriptor const *descriptor);
+WGPUBindGroup frmwrk_capture_wgpuDeviceCreateBindGroup(
+    WGPUDevice device, WGPUBindGroupDescriptor const *descriptor);
+WGPUCommandEncoder frmwrk_capture_wgpuDeviceCreateCommandEncoder(
+    WGPUDevice device, WGPUCommandEncoderDescriptor const *descriptor);
+WGPURenderBundleEncoder frmwrk_capture_wgpuDeviceCreateRenderBundleEncoder(
+    WGPUDevice device, WGPURenderBundleEncoderDescriptor const *descriptor);
+WGPUSwapChain frmwrk_capture_wgpuDeviceCreateSwapChain(
+    WGPUDevice device, WGPUSurface surface,
+    WGPUSwapChainDescriptor const *descriptor);
+WGPUTextureView frmwrk_capture_wgpuSwapChainGetCurrentTextureView(
+    WGPUSwapChain swapChain);
+
+void *frmwrk_capture_wgpuBufferGetMappedRange(WGPUBuffer buffer, size_t offset,
+                                              size_t size);
+void frmwrk_capture_wgpuBufferUnmap(WGPUBuffer buffer);
+
+void frmwrk_capture_wgpuBufferDrop(WGPUBuffer buffer);
+void frmwrk_capture_wgpuTextureDrop(WGPUTexture texture);
+void frmwrk_capture_wgpuTextureViewDrop(WGPUTextureView textureView);
+void frmwrk_capture_wgpuSamplerDrop(WGPUSampler sampler);
+void frmwrk_capture_wgpuShaderModuleDrop(WGPUShaderModule shaderModule);
+void frmwrk_capture_wgpuBindGroupLayoutDrop(WGPUBindGroupLayout layout);
+void frmwrk_capture_wgpuPipelineLayoutDrop(WGPUPipelineLayout layout);
+void frmwrk_capture_wgpuRenderPipelineDrop(WGPURenderPipeline pipeline);
+void frmwrk_capture_wgpuComputePipelineDrop(WGPUComputePipeline pipeline);
+void frmwrk_capture_wgpuBindGroupDrop(WGPUBindGroup bindGroup);
+void frmwrk_capture_wgpuCommandEncoderDrop(WGPUCommandEncoder encoder);
+void frmwrk_capture_wgpuCommandBufferDrop(WGPUCommandBuffer commandBuffer);
+void frmwrk_capture_wgpuRenderBundleDrop(WGPURenderBundle bundle);
+
+WGPURenderPassEncoder frmwrk_capture_wgpuCommandEncoderBeginRenderPass(
+    WGPUCommandEncoder encoder, WGPURenderPassDescriptor const *descriptor);
+WGPUComputePassEncoder frmwrk_capture_wgpuCommandEncoderBeginComputePass(
+    WGPUCommandEncoder encoder, WGPUComputePassDescriptor const *descriptor);
+void frmwrk_capture_wgpuCommandEncoderCopyBufferToBuffer(
+    WGPUCommandEncoder encoder, WGPUBuffer source, uint64_t sourceOffset,
+    WGPUBuffer destination, uint64_t destinationOffset, uint64_t size);
+void frmwrk_capture_wgpuCommandEncoderCopyBufferToTexture(
+    WGPUCommandEncoder encoder, WGPUImageCopyBuffer const *source,
+    WGPUImageCopyTexture const *destination, WGPUExtent3D const *copySize);
+void frmwrk_capture_wgpuCommandEncoderCopyTextureToBuffer(
+    WGPUCommandEncoder encoder, WGPUImageCopyTexture const *source,
+    WGPUImageCopyBuffer const *destination, WGPUExtent3D const *copySize);
+void frmwrk_capture_wgpuCommandEncoderCopyTextureToTexture(
+    WGPUCommandEncoder encoder, WGPUImageCopyTexture const *source,
+    WGPUImageCopyTexture const *destination, WGPUExtent3D const *copySize);
+WGPUCommandBuffer frmwrk_capture_wgpuCommandEncoderFinish(
+    WGPUCommandEncoder encoder, WGPUCommandBufferDescriptor const *descriptor);
+
+void frmwrk_capture_wgpuRenderPassEncoderSetPipeline(
+    WGPURenderPassEncoder pass, WGPURenderPipeline pipeline);
+void frmwrk_capture_wgpuRenderPassEncoderSetBindGroup(
+    WGPURenderPassEncoder pass, uint32_t groupIndex, WGPUBindGroup group,
+    uint32_t dynamicOffsetCount, uint32_t const *dynamicOffsets);
+void frmwrk_capture_wgpuRenderPassEncoderSetVertexBuffer(
+    WGPURenderPassEncoder pass, uint32_t slot, WGPUBuffer buffer,
+    uint64_t offset, uint64_t size);
+void frmwrk_capture_wgpuRenderPassEncoderSetIndexBuffer(
+    WGPURenderPassEncoder pass, WGPUBuffer buffer, WGPUIndexFormat format,
+    uint64_t offset, uint64_t size);
+void frmwrk_capture_wgpuRenderPassEncoderDraw(WGPURenderPassEncoder pass,
+                                              uint32_t vertexCount,
+                                              uint32_t instanceCount,
+                                              uint32_t firstVertex,
+                                              uint32_t firstInstance);
+void frmwrk_capture_wgpuRenderPassEncoderDrawIndexed(
+    WGPURenderPassEncoder pass, uint32_t indexCount, uint32_t instanceCount,
+    uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance);
+void frmwrk_capture_wgpuRenderPassEncoderExecuteBundles(
+    WGPURenderPassEncoder pass, uint32_t bundleCount,
+    WGPURenderBundle const *bundles);
+void frmwrk_capture_wgpuRenderPassEncoderEnd(WGPURenderPassEncoder pass);
+
+void frmwrk_capture_wgpuRenderBundleEncoderSetPipeline(
+    WGPURenderBundleEncoder encoder, WGPURenderPipeline pipeline);
+void frmwrk_capture_wgpuRenderBundleEncoderSetBindGroup(
+    WGPURenderBundleEncoder encoder, uint32_t groupIndex, WGPUBindGroup group,
+    uint32_t dynamicOffsetCount, uint32_t const *dynamicOffsets);
+void frmwrk_capture_wgpuRenderBundleEncoderSetVertexBuffer(
+    WGPURenderBundleEncoder encoder, uint32_t slot, WGPUBuffer buffer,
+    uint64_t offset, uint64_t size);
+void frmwrk_capture_wgpuRenderBundleEncoderSetIndexBuffer(
+    WGPURenderBundleEncoder encoder, WGPUBuffer buffer, WGPUIndexFormat format,
+    uint64_t offset, uint64_t size);
+void frmwrk_capture_wgpuRenderBundleEncoderDraw(WGPURenderBundleEncoder encoder,
+                                                uint32_t vertexCount,
+                                                uint32_t instanceCount,
+                                                uint32_t firstVertex,
+                                                uint32_t firstInstance);
+void frmwrk_capture_wgpuRenderBundleEncoderDrawIndexed(
+    WGPURenderBundleEncoder encoder, uint32_t indexCount,
+    uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex,
+    uint32_t firstInstance);
+WGPURenderBundle frmwrk_capture_wgpuRenderBundleEncoderFinish(
+    WGPURenderBundleEncoder encoder, WGPURenderBundleDescriptor const *descriptor);
+
+void frmwrk_capture_wgpuComputePassEncoderSetPipeline(
+    WGPUComputePassEncoder pass, WGPUComputePipeline pipeline);
+void frmwrk_capture_wgpuComputePassEncoderSetBindGroup(
+    WGPUComputePassEncoder pass, uint32_t groupIndex, WGPUBindGroup group,
+    uint32_t dynamicOffsetCount, uint32_t const *dynamicOffsets);
+void frmwrk_capture_wgpuComputePassEncoderDispatchWorkgroups(
+    WGPUComputePassEncoder pass, uint32_t workgroupCountX,
+    uint32_t workgroupCountY, uint32_t workgroupCountZ);
+void frmwrk_capture_wgpuComputePassEncoderEnd(WGPUComputePassEncoder pass);
+
+void frmwrk_capture_wgpuQueueWriteBuffer(WGPUQueue queue, WGPUBuffer buffer,
+                                         uint64_t bufferOffset,
+                                         void const *data, size_t size);
+void frmwrk_capture_wgpuQueueWriteTexture(
+    WGPUQueue queue, WGPUImageCopyTexture const *destination, void const *data,
+    size_t dataSize, WGPUTextureDataLayout const *dataLayout,
+    WGPUExtent3D const *writeSize);
+void frmwrk_capture_wgpuQueueSubmit(WGPUQueue queue, uint32_t commandCount,
+                                    WGPUCommandBuffer const *commands);
+
+// capture.c defines CAPTURE_IMPLEMENTATION to call the real functions.
+#if !defined(CAPTURE_IMPLEMENTATION)
+#define wgpuDeviceCreateBuffer frmwrk_capture_wgpuDeviceCreateBuffer
+#define wgpuDeviceCreateTexture frmwrk_capture_wgpuDeviceCreateTexture
+#define wgpuTextureCreateView frmwrk_capture_wgpuTextureCreateView
+#define wgpuDeviceCreateSampler frmwrk_capture_wgpuDeviceCreateSampler
+#define wgpuDeviceCreateShaderModule frmwrk_capture_wgpuDeviceCreateShaderModule
+#define wgpuDeviceCreateBindGroupLayout                                        \
+  frmwrk_capture_wgpuDeviceCreateBindGroupLayout
+#define wgpuDeviceCreatePipelineLayout                                         \
+  frmwrk_capture_wgpuDeviceCreatePipelineLayout
+#define wgpuDeviceCreateRenderPipeline                                         \
+  frmwrk_capture_wgpuDeviceCreateRenderPipeline
+#define wgpuDeviceCreateComputePipeline                                        \
+  frmwrk_capture_wgpuDeviceCreateComputePipeline
+#define wgpuDeviceCreateBindGroup frmwrk_capture_wgpuDeviceCreateBindGroup
+#define wgpuDeviceCreateCommandEncoder                                         \
+  frmwrk_capture_wgpuDeviceCreateCommandEncoder
+#define wgpuDeviceCreateRenderBundleEncoder                                    \
+  frmwrk_capture_wgpuDeviceCreateRenderBundleEncoder
+#define wgpuDeviceCreateSwapChain frmwrk_capture_wgpuDeviceCreateSwapChain
+#define wgpuSwapChainGetCurrentTextureView                                     \
+  frmwrk_capture_wgpuSwapChainGetCurrentTextureView
+#define wgpuBufferGetMappedRange frmwrk_capture_wgpuBufferGetMappedRange
+#define wgpuBufferUnmap frmwrk_capture_wgpuBufferUnmap
+#define wgpuBufferDrop frmwrk_capture_wgpuBufferDrop
+#define wgpuTextureDrop frmwrk_capture_wgpuTextureDrop
+#define wgpuTextureViewDrop frmwrk_capture_wgpuTextureViewDrop
+#define wgpuSamplerDrop frmwrk_capture_wgpuSamplerDrop
+#define wgpuShaderModuleDrop frmwrk_capture_wgpuShaderModuleDrop
+#define wgpuBindGroupLayoutDrop frmwrk_capture_wgpuBindGroupLayoutDrop
+#define wgpuPipelineLayoutDrop frmwrk_capture_wgpuPipelineLayoutDrop
+#define wgpuRenderPipelineDrop frmwrk_capture_wgpuRenderPipelineDrop
+#define wgpuComputePipelineDrop frmwrk_capture_wgpuComputePipelineDrop
+#define wgpuBindGroupDrop frmwrk_capture_wgpuBindGroupDrop
+#define wgpuCommandEncoderDrop frmwrk_capture_wgpuCommandEncoderDrop
+#define wgpuCommandBufferDrop frmwrk_capture_wgpuCommandBufferDrop
+#define wgpuRenderBundleDrop frmwrk_capture_wgpuRenderBundleDrop
+#define wgpuCommandEncoderBeginRenderPass                                      \
+  frmwrk_capture_wgpuCommandEncoderBeginRenderPass
+#define wgpuCommandEncoderBeginComputePass                                     \
+  frmwrk_capture_wgpuCommandEncoderBeginComputePass
+#define wgpuCommandEncoderCopyBufferToBuffer                                   \
+  frmwrk_capture_wgpuCommandEncoderCopyBufferToBuffer
+#define wgpuCommandEncoderCopyBufferToTexture                                  \
+  frmwrk_capture_wgpuCommandEncoderCopyBufferToTexture
+#define wgpuCommandEncoderCopyTextureToBuffer                                  \
+  frmwrk_capture_wgpuCommandEncoderCopyTextureToBuffer
+#define wgpuCommandEncoderCopyTextureToTexture                                 \
+  frmwrk_capture_wgpuCommandEncoderCopyTextureToTexture
+#define wgpuCommandEncoderFinish frmwrk_capture_wgpuCommandEncoderFinish
+#define wgpuRenderPassEncoderSetPipeline                                       \
+  frmwrk_capture_wgpuRenderPassEncoderSetPipeline
+#define wgpuRenderPassEncoderSetBindGroup                                      \
+  frmwrk_capture_wgpuRenderPassEncoderSetBindGroup
+#define wgpuRenderPassEncoderSetVertexBuffer                                   \
+  frmwrk_capture_wgpuRenderPassEncoderSetVertexBuffer
+#define wgpuRenderPassEncoderSetIndexBuffer                                    \
+  frmwrk_capture_wgpuRenderPassEncoderSetIndexBuffer
+#define wgpuRenderPassEncoderDraw frmwrk_capture_wgpuRenderPassEncoderDraw
+#define wgpuRenderPassEncoderDrawIndexed                                       \
+  frmwrk_capture_wgpuRenderPassEncoderDrawIndexed
+#define wgpuRenderPassEncoderExecuteBundles                                    \
+  frmwrk_capture_wgpuRenderPassEncoderExecuteBundles
+#define wgpuRenderPassEncoderEnd frmwrk_capture_wgpuRenderPassEncoderEnd
+#define wgpuRenderBundleEncoderSetPipeline                                     \
+  frmwrk_capture_wgpuRenderBundleEncoderSetPipeline
+#define wgpuRenderBundleEncoderSetBindGroup                                    \
+  frmwrk_capture_wgpuRenderBundleEncoderSetBindGroup
+#define wgpuRenderBundleEncoderSetVertexBuffer                                 \
+  frmwrk_capture_wgpuRenderBundleEncoderSetVertexBuffer
+#define wgpuRenderBundleEncoderSetIndexBuffer                                  \
+  frmwrk_capture_wgpuRenderBundleEncoderSetIndexBuffer
+#define wgpuRenderBundleEncoderDraw frmwrk_capture_wgpuRenderBundleEncoderDraw
+#define wgpuRenderBundleEncoderDrawIndexed                                     \
+  frmwrk_capture_wgpuRenderBundleEncoderDrawIndexed
+#define wgpuRenderBundleEncoderFinish                                          \
+  frmwrk_capture_wgpuRenderBundleEncoderFinish
+#define wgpuComputePassEncoderSetPipeline                                      \
+  frmwrk_capture_wgpuComputePassEncoderSetPipeline
+#define wgpuComputePassEncoderSetBindGroup                                     \
+  frmwrk_capture_wgpuComputePassEncoderSetBindGroup
+#define wgpuComputePassEncoderDispatchWorkgroups                               \
+  frmwrk_capture_wgpuComputePassEncoderDispatchWorkgroups
+#define wgpuComputePassEncoderEnd frmwrk_capture_wgpuComputePassEncoderEnd
+#define wgpuQueueWriteBuffer frmwrk_capture_wgpuQueueWriteBuffer
+#define wgpuQueueWriteTexture frmwrk_capture_wgpuQueueWriteTexture
+#define wgpuQueueSubmit frmwrk_capture_wgpuQueueSubmit
+#endif // !CAPTURE_IMPLEMENTATION
+#endif // FRMWRK_CAPTURE
+
+#endif // CAPTURE_H
@@ -0,0 +1,194 @@
+// Offline texture cooker: decodes a source image once and writes it as a
+// texture container with its mip chain already in the GPU's layout, so the
+// demo maps it at startup instead of decoding.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "block_compress.h"
+#include "framework.h"
+#include "mipmap.h"
+#include "pixel_convert.h"
+#include "texture_container.h"
+#include "stb_image.h"
+
+#define LOG_PREFIX "[cook]"
+
+typedef struct CookOptions {
+  WGPUTextureFormat format;
+  // Set for the BC formats, which are encoded from the RGBA8 chain.
+  bool compress;
+  BlockFormat blockFormat;
+  BlockQuality quality;
+  uint32_t convertFlags;
+  bool mips;
+  MipFilter filter;
+  uint32_t containerFlags;
+  const char *input;
+  const char *output;
+} CookOptions;
+
+static void print_usage(const char *program) {
+  printf("usage: %s [--format rgba8|bgra8|bc1|bc3|bc7[-srgb]] "
+         "[--quality fast|normal|high] [--premultiply] [--no-mips] "
+         "[--filter box|kaiser] [--checksum] INPUT OUTPUT.ftex\n",
+         program);
+}
+
+static bool parse_format(const char *name, CookOptions *options) {
+  static const struct {
+    const char *name;
+    WGPUTextureFormat format;
+    bool compress;
+    BlockFormat blockFormat;
+  } formats[] = {
+    {"rgba8", WGPUTextureFormat_RGBA8Unorm},
+    {"rgba8-srgb", WGPUTextureFormat_RGBA8UnormSrgb},
+    {"bgra8", WGPUTextureFormat_BGRA8Unorm},
+    {"bgra8-srgb", WGPUTextureFormat_BGRA8UnormSrgb},
+    {"bc1", WGPUTextureFormat_BC1RGBAUnorm, true, BlockFormat_BC1},
+    {"bc1-srgb", WGPUTextureFormat_BC1RGBAUnormSrgb, true, BlockFormat_BC1},
+    {"bc3", WGPUTextureFormat_BC3RGBAUnorm, true, BlockFormat_BC3},
+    {"bc3-srgb", WGPUTextureFormat_BC3RGBAUnormSrgb, true, BlockFormat_BC3},
+    {"bc7", WGPUTextureFormat_BC7RGBAUnorm, true, BlockFormat_BC7},
+    {"bc7-srgb", WGPUTextureFormat_BC7RGBAUnormSrgb, true, BlockFormat_BC7},
+  };
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+    if (strcmp(name, formats[i].name) == 0) {
+      options->format = formats[i].format;
+      options->compress = formats[i].compress;
+      options->blockFormat = formats[i].blockFormat;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parse_args(CookOptions *options, int argc, char *argv[]) {
+  options->format = WGPUTextureFormat_RGBA8Unorm;
+  options->mips = true;
+  options->filter = MipFilter_Box;
+  options->quality = BlockQuality_High;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+    if (strcmp(arg, "--format") == 0 && value) {
+      if (!parse_format(value, options)) {
+        printf(LOG_PREFIX " unknown format '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--quality") == 0 && value) {
+      if (strcmp(value, "fast") == 0) {
+        options->quality = BlockQuality_Fast;
+      } else if (strcmp(value, "normal") == 0) {
+        options->quality = BlockQuality_Normal;
+      } else if (strcmp(value, "high") == 0) {
+        options->quality = BlockQuality_High;
+      } else {
+        printf(LOG_PREFIX " unknown quality '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--premultiply") == 0) {
+      options->convertFlags |= PixelConvert_PremultiplyAlpha;
+    } else if (strcmp(arg, "--no-mips") == 0) {
+      options->mips = false;
+    } else if (strcmp(arg, "--filter") == 0 && value) {
+      if (strcmp(value, "box") == 0) {
+        options->filter = MipFilter_Box;
+      } else if (strcmp(value, "kaiser") == 0) {
+        options->filter = MipFilter_Kaiser;
+      } else {
+        printf(LOG_PREFIX " unknown filter '%s'\n", value);
+        return false;
+      }
+      i++;
+    } else if (strcmp(arg, "--checksum") == 0) {
+      options->containerFlags |= TextureContainer_Checksum;
+    } else if (strncmp(arg, "--", 2) == 0) {
+      printf(LOG_PREFIX " unknown option '%s'\n", arg);
+      return false;
+    } else if (!options->input) {
+      options->input = arg;
+    } else if (!options->output) {
+      options->output = arg;
+    } else {
+      printf(LOG_PREFIX " unexpected argument '%s'\n", arg);
+      return false;
+    }
+  }
+  return options->input && options->output;
+}
+
+int main(int argc, char *argv[]) {
+  CookOptions options = {0};
+  if (!parse_args(&options, argc, argv)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  uint64_t start = frmwrk_time_ns();
+  int w, h, channels;
+  unsigned char *decoded = stbi_load(options.input, &w, &h, &channels, 0);
+  if (!decoded) {
+    printf(LOG_PREFIX " failed to load %s: %s\n", options.input,
+           stbi_failure_reason());
+    return 1;
+  }
+
+  uint32_t flags = options.convertFlags;
+  if (options.format == WGPUTextureFormat_BGRA8Unorm ||
+      options.format == WGPUTextureFormat_BGRA8UnormSrgb)
+    flags |= PixelConvert_SwizzleBGRA;
+  bool srgb = options.format == WGPUTextureFormat_RGBA8UnormSrgb ||
+              options.format == WGPUTextureFormat_BGRA8UnormSrgb ||
+              options.format == WGPUTextureFormat_BC1RGBAUnormSrgb ||
+              options.format == WGPUTextureFormat_BC3RGBAUnormSrgb ||
+              options.format == WGPUTextureFormat_BC7RGBAUnormSrgb;
+  // WebGPU only creates block-compressed textures of whole blocks.
+  if (options.compress && (w % 4 != 0 || h % 4 != 0)) {
+    printf(LOG_PREFIX " %s is %dx%d; compressed formats need multiples of 4\n",
+           options.input, w, h);
+    stbi_image_free(decoded);
+    return 1;
+  }
+  uint32_t levels = options.mips ? frmwrk_mip_level_count(w, h) : 1;
+  if (levels > TEXTURE_CONTAINER_MAX_LEVELS)
+    levels = TEXTURE_CONTAINER_MAX_LEVELS;
+
+  bool cooked = false;
+  unsigned char *chain = malloc(frmwrk_mip_chain_size(w, h, levels));
+  if (chain) {
+    frmwrk_convert_image_to_rgba(chain, w * 4, decoded, w, h, channels, flags);
+    frmwrk_generate_mip_chain(chain, w, h, levels, options.filter, srgb);
+    unsigned char *data = chain;
+    if (options.compress) {
+      data = malloc(frmwrk_texture_chain_size(options.format, w, h, levels));
+      if (data)
+        frmwrk_compress_mip_chain(data, chain, w, h, levels,
+                                  options.blockFormat, options.quality, 0);
+    }
+    if (data)
+      cooked = frmwrk_write_texture_container(options.output, options.format,
+                                              w, h, levels, data,
+                                              options.containerFlags);
+    else
+      printf(LOG_PREFIX " out of memory\n");
+    if (data != chain)
+      free(data);
+    free(chain);
+  } else {
+    printf(LOG_PREFIX " out of memory\n");
+  }
+  stbi_image_free(decoded);
+  if (!cooked)
+    return 1;
+
+  printf(LOG_PREFIX " %s -> %s (%dx%d, %u levels, %zu bytes) in %.1f ms\n",
+         options.input, options.output, w, h, levels,
+         frmwrk_texture_chain_size(options.format, w, h, levels),
+         (double)(frmwrk_time_ns() - start) / 1e6);
+  return 0;
+}
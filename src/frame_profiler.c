@@ -0,0 +1,172 @@
+#include "frame_profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *stage_names[FrameStage_Count] = {
+  "poll_events",
+  "acquire_texture",
+  "build_batch",
+  "record_pass",
+  "submit",
+  "present",
+};
+
+const char *frmwrk_frame_stage_name(FrameStage stage) {
+  return stage < FrameStage_Count ? stage_names[stage] : "unknown_stage";
+}
+
+FrameProfiler *frmwrk_create_frame_profiler(void) {
+  return calloc(1, sizeof(FrameProfiler));
+}
+
+void frmwrk_drop_frame_profiler(FrameProfiler *profiler) {
+  free(profiler);
+}
+
+void frmwrk_frame_profiler_begin(FrameProfiler *profiler) {
+  memset(&profiler->current, 0, sizeof(profiler->current));
+  profiler->current.frameIndex = profiler->frameCount;
+  profiler->frameStart = frmwrk_time_ns();
+  profiler->lastMark = profiler->frameStart;
+}
+
+void frmwrk_frame_profiler_mark(FrameProfiler *profiler, FrameStage stage) {
+  uint64_t now = frmwrk_time_ns();
+  profiler->current.stageNs[stage] += now - profiler->lastMark;
+  profiler->lastMark = now;
+}
+
+void frmwrk_frame_profiler_end(FrameProfiler *profiler) {
+  profiler->current.totalNs = frmwrk_time_ns() - profiler->frameStart;
+  profiler->records[profiler->frameCount % FRAME_PROFILER_CAPACITY] =
+      profiler->current;
+  profiler->frameCount++;
+}
+
+static uint32_t record_count(const FrameProfiler *profiler) {
+  return profiler->frameCount < FRAME_PROFILER_CAPACITY
+             ? (uint32_t)profiler->frameCount
+             : FRAME_PROFILER_CAPACITY;
+}
+
+// Oldest frame first.
+static const FrameRecord *record_at(const FrameProfiler *profiler,
+                                    uint32_t i) {
+  uint64_t first = profiler->frameCount - record_count(profiler);
+  return &profiler->records[(first + i) % FRAME_PROFILER_CAPACITY];
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static FrameStageSummary summarize_samples(uint64_t *samples, uint32_t count) {
+  if (count == 0)
+    return (FrameStageSummary){0};
+  qsort(samples, count, sizeof(uint64_t), compare_u64);
+  // Nearest-rank percentiles.
+#define PERCENTILE_MS(p) (samples[((count - 1) * (p) + 50) / 100] / 1e6)
+  return (FrameStageSummary){
+    .p50Ms = PERCENTILE_MS(50),
+    .p95Ms = PERCENTILE_MS(95),
+    .p99Ms = PERCENTILE_MS(99),
+    .maxMs = samples[count - 1] / 1e6
+  };
+#undef PERCENTILE_MS
+}
+
+FrameProfilerSummary frmwrk_frame_profiler_summarize(const FrameProfiler *profiler) {
+  uint64_t samples[FRAME_PROFILER_CAPACITY];
+  uint32_t count = record_count(profiler);
+  FrameProfilerSummary summary = (FrameProfilerSummary){.sampleCount = count};
+
+  for (int stage = 0; stage < FrameStage_Count; stage++) {
+    for (uint32_t i = 0; i < count; i++)
+      samples[i] = record_at(profiler, i)->stageNs[stage];
+    summary.stages[stage] = summarize_samples(samples, count);
+  }
+  for (uint32_t i = 0; i < count; i++)
+    samples[i] = record_at(profiler, i)->totalNs;
+  summary.total = summarize_samples(samples, count);
+  return summary;
+}
+
+void frmwrk_frame_profiler_print_summary(const FrameProfiler *profiler) {
+  FrameProfilerSummary summary = frmwrk_frame_profiler_summarize(profiler);
+  printf("[frame_profiler] last %u frames (ms)      p50      p95      p99      max\n",
+         summary.sampleCount);
+  for (int stage = 0; stage < FrameStage_Count; stage++) {
+    FrameStageSummary s = summary.stages[stage];
+    printf("[frame_profiler] %-24s %8.3f %8.3f %8.3f %8.3f\n",
+           stage_names[stage], s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs);
+  }
+  printf("[frame_profiler] %-24s %8.3f %8.3f %8.3f %8.3f\n", "total",
+         summary.total.p50Ms, summary.total.p95Ms, summary.total.p99Ms,
+         summary.total.maxMs);
+}
+
+static void write_csv(const FrameProfiler *profiler, FILE *file) {
+  fprintf(file, "frame");
+  for (int stage = 0; stage < FrameStage_Count; stage++)
+    fprintf(file, ",%s_ms", stage_names[stage]);
+  fprintf(file, ",total_ms\n");
+
+  for (uint32_t i = 0; i < record_count(profiler); i++) {
+    const FrameRecord *record = record_at(profiler, i);
+    fprintf(file, "%llu", (unsigned long long)record->frameIndex);
+    for (int stage = 0; stage < FrameStage_Count; stage++)
+      fprintf(file, ",%.6f", record->stageNs[stage] / 1e6);
+    fprintf(file, ",%.6f\n", record->totalNs / 1e6);
+  }
+}
+
+static void write_json_summary(FILE *file, const char *name,
+                               FrameStageSummary s, bool last) {
+  fprintf(file,
+          "    \"%s\": {\"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f, "
+          "\"max\": %.6f}%s\n",
+          name, s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs, last ? "" : ",");
+}
+
+static void write_json(const FrameProfiler *profiler, FILE *file) {
+  FrameProfilerSummary summary = frmwrk_frame_profiler_summarize(profiler);
+
+  fprintf(file, "{\n  \"unit\": \"ms\",\n  \"summary\": {\n");
+  for (int stage = 0; stage < FrameStage_Count; stage++)
+    write_json_summary(file, stage_names[stage], summary.stages[stage], false);
+  write_json_summary(file, "total", summary.total, true);
+  fprintf(file, "  },\n  \"frames\": [\n");
+
+  uint32_t count = record_count(profiler);
+  for (uint32_t i = 0; i < count; i++) {
+    const FrameRecord *record = record_at(profiler, i);
+    fprintf(file, "    {\"frame\": %llu",
+            (unsigned long long)record->frameIndex);
+    for (int stage = 0; stage < FrameStage_Count; stage++)
+      fprintf(file, ", \"%s\": %.6f", stage_names[stage],
+              record->stageNs[stage] / 1e6);
+    fprintf(file, ", \"total\": %.6f}%s\n", record->totalNs / 1e6,
+            i + 1 < count ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+}
+
+bool frmwrk_frame_profiler_dump(const FrameProfiler *profiler, const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+
+  size_t length = strlen(path);
+  if (length >= 5 && strcmp(path + length - 5, ".json") == 0)
+    write_json(profiler, file);
+  else
+    write_csv(profiler, file);
+
+  fclose(file);
+  return true;
+}
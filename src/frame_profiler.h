@@ -0,0 +1,65 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include "framework.h"
+
+// Stages of a frame in the order the render loop goes through them. Each mark
+// attributes the time since the previous mark (or the frame start) to a stage.
+typedef enum FrameStage {
+  FrameStage_PollEvents,
+  FrameStage_AcquireTexture,
+  FrameStage_BuildBatch,
+  // Includes creating and finishing the encoders, which the recording jobs
+  // do themselves.
+  FrameStage_RecordPass,
+  FrameStage_Submit,
+  FrameStage_Present,
+  FrameStage_Count
+} FrameStage;
+
+#define FRAME_PROFILER_CAPACITY 1024
+
+typedef struct FrameRecord {
+  uint64_t frameIndex;
+  uint64_t stageNs[FrameStage_Count];
+  uint64_t totalNs;
+} FrameRecord;
+
+// Fixed-size ring of the most recent FRAME_PROFILER_CAPACITY frames.
+typedef struct FrameProfiler {
+  FrameRecord records[FRAME_PROFILER_CAPACITY];
+  uint64_t frameCount;
+  FrameRecord current;
+  uint64_t frameStart;
+  uint64_t lastMark;
+} FrameProfiler;
+
+typedef struct FrameStageSummary {
+  double p50Ms;
+  double p95Ms;
+  double p99Ms;
+  double maxMs;
+} FrameStageSummary;
+
+typedef struct FrameProfilerSummary {
+  uint32_t sampleCount;
+  FrameStageSummary stages[FrameStage_Count];
+  FrameStageSummary total;
+} FrameProfilerSummary;
+
+FrameProfiler *frmwrk_create_frame_profiler(void);
+void frmwrk_drop_frame_profiler(FrameProfiler *profiler);
+
+void frmwrk_frame_profiler_begin(FrameProfiler *profiler);
+void frmwrk_frame_profiler_mark(FrameProfiler *profiler, FrameStage stage);
+void frmwrk_frame_profiler_end(FrameProfiler *profiler);
+
+const char *frmwrk_frame_stage_name(FrameStage stage);
+// Percentiles over the frames currently held in the ring.
+FrameProfilerSummary frmwrk_frame_profiler_summarize(const FrameProfiler *profiler);
+void frmwrk_frame_profiler_print_summary(const FrameProfiler *profiler);
+// Writes every frame in the ring plus the summary. Paths ending in ".json" are
+// written as JSON, anything else as CSV.
+bool frmwrk_frame_profiler_dump(const FrameProfiler *profiler, const char *path);
+
+#endif // FRAME_PROFILER_H
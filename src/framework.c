@@ -1,34 +1,44 @@
 #include "framework.h"
+#include "block_compress.h"
+#include "mipmap.h"
+#include "pixel_convert.h"
+#include "upload_ring.h"
 #include "wgpu.h"
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include "stb_image.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
 
-static void log_callback(WGPULogLevel level, char const *message,
-                         void *userdata) {
-  UNUSED(userdata)
-  char *level_str;
+const char *frmwrk_log_level_name(WGPULogLevel level) {
   switch (level) {
   case WGPULogLevel_Error:
-    level_str = "error";
-    break;
+    return "error";
   case WGPULogLevel_Warn:
-    level_str = "warn";
-    break;
+    return "warn";
   case WGPULogLevel_Info:
-    level_str = "info";
-    break;
+    return "info";
   case WGPULogLevel_Debug:
-    level_str = "debug";
-    break;
+    return "debug";
   case WGPULogLevel_Trace:
-    level_str = "trace";
-    break;
+    return "trace";
   default:
-    level_str = "unknown_level";
+    return "unknown_level";
   }
-  fprintf(stderr, "[wgpu] [%s] %s\n", level_str, message);
+}
+
+static void log_callback(WGPULogLevel level, char const *message,
+                         void *userdata) {
+  UNUSED(userdata)
+  fprintf(stderr, "[wgpu] [%s] %s\n", frmwrk_log_level_name(level), message);
 }
 
 void frmwrk_setup_logging(WGPULogLevel level) {
@@ -36,15 +46,42 @@ void frmwrk_setup_logging(WGPULogLevel level) {
   wgpuSetLogLevel(level);
 }
 
-Texture2D frmwrk_load_texture2D(WGPUDevice device, const char *name)
+uint64_t frmwrk_time_ns(void) {
+#if defined(_WIN32)
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+         (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull /
+             frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+uint64_t frmwrk_hash_bytes(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *bytes = data;
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+Texture2D frmwrk_create_texture2D(WGPUDevice device, int32_t w, int32_t h,
+                                  WGPUTextureFormat format,
+                                  uint32_t mipLevelCount, const char *label)
 {
-  unsigned char *data;
-  int w;
-  int h;
-  int channels;
-  data = stbi_load(name, &w, &h, &channels, 0);
-  
-  WGPUTextureFormat textureFormat = WGPUTextureFormat_RGBA8Unorm;
+  WGPUTextureFormat textureFormat = format;
+  WGPUTextureUsageFlags usage =
+      WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding;
+  if (mipLevelCount > 1 && frmwrk_mipmap_generator_supports(format))
+    usage |= WGPUTextureUsage_StorageBinding;
 
   WGPUTextureDescriptor textureDescriptor = (WGPUTextureDescriptor){
     .dimension = WGPUTextureDimension_2D,
@@ -54,12 +91,12 @@ Texture2D frmwrk_load_texture2D(WGPUDevice device, const char *name)
       .height = h,
       .depthOrArrayLayers = 1
     },
-    .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
-    .mipLevelCount = 1,
+    .usage = usage,
+    .mipLevelCount = mipLevelCount,
     .sampleCount = 1,
     .viewFormats = &textureFormat,
     .viewFormatCount = 1,
-    .label = name
+    .label = label
   };
   WGPUTexture texture = wgpuDeviceCreateTexture(device, &textureDescriptor);
 
@@ -67,96 +104,277 @@ Texture2D frmwrk_load_texture2D(WGPUDevice device, const char *name)
     .format = textureFormat,
     .dimension = WGPUTextureViewDimension_2D,
     .aspect = WGPUTextureAspect_All,
-    .mipLevelCount = 1,
+    .mipLevelCount = mipLevelCount,
     .baseMipLevel = 0,
     .arrayLayerCount = 1,
     .baseArrayLayer = 0,
-    .label = name
+    .label = label
   };
 
   WGPUTextureView textureView = wgpuTextureCreateView(texture, &textureViewDescriptor);
 
-  //fill up texture
-  {
-    WGPUImageCopyTexture copyTexture = (WGPUImageCopyTexture){
-      .texture = texture,
-      .aspect = WGPUTextureAspect_All,
-      .mipLevel = 0,
-      .origin = (WGPUOrigin3D) {
-        .x = 0,
-        .y = 0,
-        .z = 0
-      }
-    };
-
-    WGPUTextureDataLayout dataLayout = (WGPUTextureDataLayout){
-        .bytesPerRow = w * channels,
-        .rowsPerImage = h
-    };
-    WGPUExtent3D dataExtents = (WGPUExtent3D){
-      .width = w,
-      .height = h,
-      .depthOrArrayLayers = 1
-    };
+  return (Texture2D){
+    .w = w,
+    .h = h,
+    .n = 4,
+    .format = textureFormat,
+    .mipLevelCount = mipLevelCount,
+    .texture = texture,
+    .view = textureView
+  };
+}
 
-    WGPUQueue queue = wgpuDeviceGetQueue(device);
-    WGPUCommandEncoder cmdEncoder = wgpuDeviceCreateCommandEncoder(device, &(const WGPUCommandEncoderDescriptor){
-                         .label = "command_encoder",
-                     });
-    wgpuQueueWriteTexture(queue, &copyTexture, data, w * h * channels, &dataLayout, &dataExtents);
+// `w` and `h` are in texels; rows hold whole `blockSize` blocks of
+// `blockBytes` each (1 and 4 for the RGBA8 formats).
+static void write_texture_level(WGPUQueue queue, UploadRing *uploadRing,
+                                WGPUTexture texture, uint32_t level,
+                                uint32_t w, uint32_t h, uint32_t blockSize,
+                                uint32_t blockBytes,
+                                const unsigned char *pixels,
+                                uint32_t bytesPerRow)
+{
+  if (uploadRing) {
+    frmwrk_upload_ring_write_texture_blocks(uploadRing, texture, level,
+                                            (WGPUOrigin3D){0, 0, 0}, w, h,
+                                            blockSize, blockBytes, pixels,
+                                            bytesPerRow);
+    return;
+  }
+
+  uint32_t rows = (h + blockSize - 1) / blockSize;
+  WGPUImageCopyTexture copyTexture = (WGPUImageCopyTexture){
+    .texture = texture,
+    .aspect = WGPUTextureAspect_All,
+    .mipLevel = level,
+    .origin = (WGPUOrigin3D){0, 0, 0}
+  };
+  WGPUTextureDataLayout dataLayout = (WGPUTextureDataLayout){
+    .bytesPerRow = bytesPerRow,
+    .rowsPerImage = rows
+  };
+  WGPUExtent3D dataExtents = (WGPUExtent3D){
+    .width = (w + blockSize - 1) / blockSize * blockSize,
+    .height = rows * blockSize,
+    .depthOrArrayLayers = 1
+  };
+  wgpuQueueWriteTexture(queue, &copyTexture, pixels, (size_t)bytesPerRow * rows,
+                        &dataLayout, &dataExtents);
+}
 
-    WGPUCommandBuffer cmdBuffer = wgpuCommandEncoderFinish(cmdEncoder, &(const WGPUCommandBufferDescriptor){
-                             .label = "command_buffer",
-                         });
+void frmwrk_write_texture2D(WGPUQueue queue, UploadRing *uploadRing,
+                            const Texture2D *texture,
+                            const unsigned char *pixels)
+{
+  write_texture_level(queue, uploadRing, texture->texture, 0, texture->w,
+                      texture->h, 1, 4, pixels, texture->w * 4);
+}
 
-    wgpuQueueSubmit(queue, 1, &cmdBuffer);
+void frmwrk_write_texture2D_levels(WGPUQueue queue, UploadRing *uploadRing,
+                                   const Texture2D *texture,
+                                   const unsigned char *chain,
+                                   uint32_t levelCount)
+{
+  uint32_t block_size, block_bytes;
+  if (!frmwrk_texture_format_block_info(texture->format, &block_size,
+                                        &block_bytes))
+    return;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint32_t w = texture->w >> level ? texture->w >> level : 1;
+    uint32_t h = texture->h >> level ? texture->h >> level : 1;
+    uint32_t pitch = (w + block_size - 1) / block_size * block_bytes;
+    uint32_t rows = (h + block_size - 1) / block_size;
+    write_texture_level(queue, uploadRing, texture->texture, level, w, h,
+                        block_size, block_bytes, chain, pitch);
+    chain += (size_t)pitch * rows;
   }
+}
 
-  Texture2D result = (Texture2D){
-    .data = data,
-    .w = w,
-    .h = h,
-    .n = channels,
-    .texture = texture,
-    .view = textureView
+Texture2D frmwrk_load_texture2D(WGPUDevice device, UploadRing *uploadRing,
+                                const char *name)
+{
+  TextureLoadOptions options = (TextureLoadOptions){
+    .format = WGPUTextureFormat_RGBA8Unorm,
+    .convertFlags = PixelConvert_None
   };
-  return result;
+  return frmwrk_load_texture2D_ex(device, uploadRing, name, &options);
 }
 
-WGPUShaderModule frmwrk_load_shader_module(WGPUDevice device,
-                                           const char *name) {
-  FILE *file = NULL;
-  char *buf = NULL;
-  WGPUShaderModule shader_module = NULL;
+Texture2D frmwrk_load_texture2D_ex(WGPUDevice device, UploadRing *uploadRing,
+                                   const char *name,
+                                   const TextureLoadOptions *options)
+{
+  int w;
+  int h;
+  int channels;
+  // Decode in the file's own layout; the conversion below expands to four
+  // channels, so stb_image never makes a second RGBA copy.
+  unsigned char *data = stbi_load(name, &w, &h, &channels, 0);
+  if (!data) {
+    printf("[framework] failed to load %s: %s\n", name, stbi_failure_reason());
+    return (Texture2D){0};
+  }
+
+  uint32_t flags = options->convertFlags;
+  if (options->format == WGPUTextureFormat_BGRA8Unorm ||
+      options->format == WGPUTextureFormat_BGRA8UnormSrgb)
+    flags |= PixelConvert_SwizzleBGRA;
+  bool srgb = options->format == WGPUTextureFormat_RGBA8UnormSrgb ||
+              options->format == WGPUTextureFormat_BGRA8UnormSrgb;
+
+  uint32_t levels = options->generateMips ? frmwrk_mip_level_count(w, h) : 1;
+  bool gpuMips = levels > 1 && options->mipmapGenerator &&
+                 frmwrk_mipmap_generator_supports(options->format);
+
+  Texture2D result =
+      frmwrk_create_texture2D(device, w, h, options->format, levels, name);
+  result.data = data;
+  result.n = channels;
+
+  WGPUQueue queue = wgpuDeviceGetQueue(device);
+  if (levels > 1 && !gpuMips) {
+    // The CPU filters need every level tightly packed in one chain.
+    uint8_t *chain = malloc(frmwrk_mip_chain_size(w, h, levels));
+    assert(chain);
+    frmwrk_convert_image_to_rgba(chain, w * 4, data, w, h, channels, flags);
+    frmwrk_generate_mip_chain(chain, w, h, levels,
+                              (MipFilter)options->mipFilter, srgb);
+    frmwrk_write_texture2D_levels(queue, uploadRing, &result, chain, levels);
+    free(chain);
+    wgpuQueueDrop(queue);
+    return result;
+  }
 
-  file = fopen(name, "rb");
-  if (!file) {
+  // Convert straight into staging memory when the ring has room, so the
+  // converted image is written exactly once.
+  uint8_t *staging = NULL;
+  if (uploadRing) {
+    uint32_t bytesPerRow = 0;
+    staging = frmwrk_upload_ring_alloc_texture(
+        uploadRing, result.texture, 0, (WGPUOrigin3D){0, 0, 0}, w, h, 4,
+        &bytesPerRow);
+    if (staging)
+      frmwrk_convert_image_to_rgba(staging, bytesPerRow, data, w, h, channels,
+                                   flags);
+  }
+  if (!staging) {
+    uint32_t pitch = frmwrk_convert_aligned_row_pitch(w);
+    uint8_t *converted = malloc((size_t)pitch * h);
+    assert(converted);
+    frmwrk_convert_image_to_rgba(converted, pitch, data, w, h, channels, flags);
+    write_texture_level(queue, NULL, result.texture, 0, w, h, 1, 4, converted,
+                        pitch);
+    free(converted);
+  }
+  wgpuQueueDrop(queue);
+
+  // Level 0 is copied before the generator's passes: ring copies are recorded
+  // first and queue writes land ahead of the next submission.
+  if (gpuMips)
+    frmwrk_mipmap_generator_queue(options->mipmapGenerator, &result);
+
+  return result;
+}
+
+// Fallback for files whose size leaves no zeroed tail in the last page.
+static bool read_file_copy(const char *path, FrmwrkMappedFile *file) {
+  FILE *stream = fopen(path, "rb");
+  if (!stream) {
     perror("fopen");
-    goto cleanup;
+    return false;
   }
+  char *buf = malloc(file->size + 1);
+  size_t read = buf ? fread(buf, 1, file->size, stream) : 0;
+  fclose(stream);
+  if (!buf || read != file->size) {
+    printf("[framework] short read of %s (%zu of %zu bytes)\n", path, read,
+           file->size);
+    free(buf);
+    return false;
+  }
+  buf[file->size] = 0;
+  file->data = buf;
+  file->copied = true;
+  return true;
+}
 
-  if (fseek(file, 0, SEEK_END) != 0) {
-    perror("fseek");
-    goto cleanup;
+bool frmwrk_map_file(const char *path, FrmwrkMappedFile *file) {
+  *file = (FrmwrkMappedFile){0};
+#if defined(_WIN32)
+  HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    printf("[framework] could not open %s\n", path);
+    return false;
   }
-  long length = ftell(file);
-  if (length == -1) {
-    perror("ftell");
-    goto cleanup;
+  LARGE_INTEGER size;
+  bool sized = GetFileSizeEx(handle, &size);
+  file->size = sized ? (size_t)size.QuadPart : 0;
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  if (!sized || file->size == 0 || file->size % info.dwPageSize == 0) {
+    CloseHandle(handle);
+    return sized && read_file_copy(path, file);
   }
-  if (fseek(file, 0, SEEK_SET) != 0) {
-    perror("fseek");
-    goto cleanup;
+  HANDLE mapping =
+      CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(handle);
+  if (!mapping)
+    return read_file_copy(path, file);
+  file->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (!file->data) {
+    CloseHandle(mapping);
+    return read_file_copy(path, file);
   }
+  file->mapping = mapping;
+#else
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    perror("open");
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    perror("fstat");
+    close(fd);
+    return false;
+  }
+  file->size = (size_t)info.st_size;
+  long page_size = sysconf(_SC_PAGESIZE);
+  if (file->size == 0 || page_size <= 0 || file->size % page_size == 0) {
+    close(fd);
+    return read_file_copy(path, file);
+  }
+  void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return read_file_copy(path, file);
+  file->data = data;
+#endif
+  return true;
+}
 
-  buf = malloc(length + 1);
-  assert(buf);
-  fread(buf, 1, length, file);
-  buf[length] = 0;
+void frmwrk_unmap_file(FrmwrkMappedFile *file) {
+  if (!file->data)
+    return;
+  if (file->copied) {
+    free((void *)file->data);
+  } else {
+#if defined(_WIN32)
+    UnmapViewOfFile(file->data);
+    CloseHandle(file->mapping);
+#else
+    munmap((void *)file->data, file->size);
+#endif
+  }
+  *file = (FrmwrkMappedFile){0};
+}
 
-  shader_module = wgpuDeviceCreateShaderModule(
+WGPUShaderModule frmwrk_create_shader_module(WGPUDevice device,
+                                             const char *label,
+                                             const char *code) {
+  return wgpuDeviceCreateShaderModule(
       device, &(const WGPUShaderModuleDescriptor){
-                  .label = name,
+                  .label = label,
                   .nextInChain =
                       (const WGPUChainedStruct *)&(
                           const WGPUShaderModuleWGSLDescriptor){
@@ -164,15 +382,19 @@ WGPUShaderModule frmwrk_load_shader_module(WGPUDevice device,
                               (const WGPUChainedStruct){
                                   .sType = WGPUSType_ShaderModuleWGSLDescriptor,
                               },
-                          .code = buf,
+                          .code = code,
                       },
               });
+}
 
-cleanup:
-  if (file)
-    fclose(file);
-  if (buf)
-    free(buf);
+WGPUShaderModule frmwrk_load_shader_module(WGPUDevice device,
+                                           const char *name) {
+  FrmwrkMappedFile file;
+  if (!frmwrk_map_file(name, &file))
+    return NULL;
+  WGPUShaderModule shader_module =
+      frmwrk_create_shader_module(device, name, file.data);
+  frmwrk_unmap_file(&file);
   return shader_module;
 }
 
@@ -6,9 +6,38 @@
 
 #define UNUSED(x) (void)x;
 
+// Logs synchronously to stderr. See async_logger.h to keep I/O off the calling
+// thread.
 void frmwrk_setup_logging(WGPULogLevel level);
+const char *frmwrk_log_level_name(WGPULogLevel level);
+
+// A read-only view of a whole file, mapped rather than copied. `data` is always
+// NUL-terminated: mappings rely on the zeroed tail of the last page, and files
+// that end exactly on a page boundary are read into a buffer instead.
+typedef struct FrmwrkMappedFile {
+  const char *data;
+  size_t size;
+  bool copied;
+#if defined(_WIN32)
+  void *mapping;
+#endif
+} FrmwrkMappedFile;
+
+bool frmwrk_map_file(const char *path, FrmwrkMappedFile *file);
+void frmwrk_unmap_file(FrmwrkMappedFile *file);
+
+WGPUShaderModule frmwrk_create_shader_module(WGPUDevice device,
+                                             const char *label,
+                                             const char *code);
+// Maps `name` and compiles it as WGSL. Returns NULL if the file cannot be read.
 WGPUShaderModule frmwrk_load_shader_module(WGPUDevice device, const char *name);
 void frmwrk_print_global_report(WGPUGlobalReport report);
+// Monotonic clock in nanoseconds, usable without a window or GLFW.
+uint64_t frmwrk_time_ns(void);
+// 64-bit FNV-1a. Pass the previous result as `seed` to hash in pieces, or
+// FRMWRK_HASH_SEED to start.
+#define FRMWRK_HASH_SEED 0xcbf29ce484222325ull
+uint64_t frmwrk_hash_bytes(const void *data, size_t size, uint64_t seed);
 
 typedef struct Texture2D {
   unsigned char *data;
@@ -16,11 +45,56 @@ typedef struct Texture2D {
   int32_t h;
   int32_t n;
 
+  WGPUTextureFormat format;
+  uint32_t mipLevelCount;
   WGPUTexture texture;
   WGPUTextureView view;
 } Texture2D;
 
-Texture2D frmwrk_load_texture2D(WGPUDevice device, const char *name);
+typedef struct UploadRing UploadRing;
+typedef struct MipmapGenerator MipmapGenerator;
+
+typedef struct TextureLoadOptions {
+  // One of the 8-bit RGBA/BGRA formats (sRGB variants included).
+  WGPUTextureFormat format;
+  // PixelConvertFlags applied while expanding to four channels; BGRA formats
+  // imply PixelConvert_SwizzleBGRA.
+  uint32_t convertFlags;
+  // Allocates and fills the full mip chain. Levels are built by
+  // `mipmapGenerator` on the GPU when it supports the format, otherwise on the
+  // CPU with `mipFilter` (a MipFilter).
+  bool generateMips;
+  uint32_t mipFilter;
+  MipmapGenerator *mipmapGenerator;
+} TextureLoadOptions;
+
+// Uploads go through `uploadRing` when one is given and are then only visible
+// to the GPU once the ring is recorded; with NULL they go straight to the queue.
+Texture2D frmwrk_load_texture2D(WGPUDevice device, UploadRing *uploadRing,
+                                const char *name);
+// Like frmwrk_load_texture2D but converts into `options->format`. Pixels are
+// converted straight into staging memory, so `data` keeps the file's own
+// channel layout (`n` channels). Returns a zeroed Texture2D on failure.
+Texture2D frmwrk_load_texture2D_ex(WGPUDevice device, UploadRing *uploadRing,
+                                   const char *name,
+                                   const TextureLoadOptions *options);
+// Creates an empty 8-bit four channel or block-compressed texture and a view
+// over all `mipLevelCount` levels, ready to receive uploads. Multi-level
+// RGBA8Unorm textures can also be written by the GPU mipmap generator.
+Texture2D frmwrk_create_texture2D(WGPUDevice device, int32_t w, int32_t h,
+                                  WGPUTextureFormat format,
+                                  uint32_t mipLevelCount, const char *label);
+// Writes tightly packed four channel pixels into mip 0 of `texture`.
+void frmwrk_write_texture2D(WGPUQueue queue, UploadRing *uploadRing,
+                            const Texture2D *texture,
+                            const unsigned char *pixels);
+// Writes a tightly packed chain laid out as by frmwrk_texture_chain_size for
+// the texture's format (frmwrk_mip_chain_size for RGBA8) into the first
+// `levelCount` levels of `texture`.
+void frmwrk_write_texture2D_levels(WGPUQueue queue, UploadRing *uploadRing,
+                                   const Texture2D *texture,
+                                   const unsigned char *chain,
+                                   uint32_t levelCount);
 
 typedef struct vec4 {
   float index;
@@ -29,4 +103,8 @@ typedef struct vec4 {
   float unused3;
 } vec4;
 
+// Last, so that builds with FRMWRK_CAPTURE route the wgpu calls of every file
+// including this header through the capture layer.
+#include "capture.h"
+
 #endif // FRAMEWORK_H
\ No newline at end of file
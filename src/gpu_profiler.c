@@ -0,0 +1,232 @@
+#include "gpu_profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUERIES_PER_FRAME (GPU_PROFILER_MAX_PASSES * 2)
+#define RESULTS_SIZE (QUERIES_PER_FRAME * sizeof(uint64_t))
+#define NO_PASS UINT32_MAX
+// Weight of the newest sample in the running averages.
+#define AVERAGE_WEIGHT 0.1
+
+GpuProfiler *frmwrk_create_gpu_profiler(WGPUDevice device) {
+  GpuProfiler *profiler = calloc(1, sizeof(GpuProfiler));
+  if (!profiler)
+    return NULL;
+
+  profiler->device = device;
+  profiler->timestampPeriod = 1.0f;
+  profiler->timestampsSupported =
+      wgpuDeviceHasFeature(device, WGPUFeatureName_TimestampQuery);
+
+  if (profiler->timestampsSupported) {
+    profiler->querySet = wgpuDeviceCreateQuerySet(
+        device, &(const WGPUQuerySetDescriptor){
+                    .label = "gpu_profiler_queries",
+                    .type = WGPUQueryType_Timestamp,
+                    .count = QUERIES_PER_FRAME * GPU_PROFILER_FRAMES_IN_FLIGHT
+                });
+    profiler->timestampsSupported = profiler->querySet != NULL;
+  }
+
+  for (int i = 0; i < GPU_PROFILER_FRAMES_IN_FLIGHT; i++) {
+    GpuProfilerFrame *frame = &profiler->frames[i];
+    frame->profiler = profiler;
+    if (!profiler->timestampsSupported)
+      continue;
+
+    frame->resolveBuffer = wgpuDeviceCreateBuffer(
+        device, &(const WGPUBufferDescriptor){
+                    .label = "gpu_profiler_resolve",
+                    .size = RESULTS_SIZE,
+                    .usage = WGPUBufferUsage_QueryResolve |
+                             WGPUBufferUsage_CopySrc
+                });
+    frame->readbackBuffer = wgpuDeviceCreateBuffer(
+        device, &(const WGPUBufferDescriptor){
+                    .label = "gpu_profiler_readback",
+                    .size = RESULTS_SIZE,
+                    .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead
+                });
+  }
+
+  if (!profiler->timestampsSupported)
+    printf("[gpu_profiler] timestamp queries unavailable, reporting CPU "
+           "recording time only\n");
+  return profiler;
+}
+
+void frmwrk_drop_gpu_profiler(GpuProfiler *profiler) {
+  if (!profiler)
+    return;
+  for (int i = 0; i < GPU_PROFILER_FRAMES_IN_FLIGHT; i++) {
+    if (profiler->frames[i].resolveBuffer)
+      wgpuBufferDrop(profiler->frames[i].resolveBuffer);
+    if (profiler->frames[i].readbackBuffer)
+      wgpuBufferDrop(profiler->frames[i].readbackBuffer);
+  }
+  if (profiler->querySet)
+    wgpuQuerySetDrop(profiler->querySet);
+  free(profiler);
+}
+
+static uint32_t first_query(const GpuProfiler *profiler,
+                            const GpuProfilerFrame *frame) {
+  return (uint32_t)(frame - profiler->frames) * QUERIES_PER_FRAME;
+}
+
+static void publish(GpuProfiler *profiler, const GpuProfilerFrame *frame,
+                    const uint64_t *ticks) {
+  for (uint32_t i = 0; i < frame->passCount; i++) {
+    GpuPassTiming *result = &profiler->results[i];
+    double gpu_ms = -1.0;
+    if (ticks && ticks[i * 2 + 1] >= ticks[i * 2])
+      gpu_ms = (ticks[i * 2 + 1] - ticks[i * 2]) * profiler->timestampPeriod / 1e6;
+    double cpu_ms = frame->passCpuNs[i] / 1e6;
+
+    // Restart the averages when a different pass shows up in this position.
+    bool same_pass = i < profiler->resultCount && result->name &&
+                     strcmp(result->name, frame->passNames[i]) == 0;
+    result->name = frame->passNames[i];
+    result->gpuMs = gpu_ms;
+    result->cpuMs = cpu_ms;
+    result->averageGpuMs =
+        same_pass && gpu_ms >= 0.0
+            ? result->averageGpuMs + (gpu_ms - result->averageGpuMs) * AVERAGE_WEIGHT
+            : gpu_ms;
+    result->averageCpuMs =
+        same_pass
+            ? result->averageCpuMs + (cpu_ms - result->averageCpuMs) * AVERAGE_WEIGHT
+            : cpu_ms;
+  }
+  profiler->resultCount = frame->passCount;
+  profiler->resultFrameNumber = frame->frameNumber;
+}
+
+static void handle_readback_map(WGPUBufferMapAsyncStatus status,
+                                void *userdata) {
+  GpuProfilerFrame *frame = userdata;
+  frame->mapFailed = status != WGPUBufferMapAsyncStatus_Success;
+  frame->state = GpuProfilerFrameState_Mapped;
+}
+
+static void collect(GpuProfiler *profiler) {
+  // Frames are published oldest first so the newest results win.
+  for (uint64_t n = 0; n < GPU_PROFILER_FRAMES_IN_FLIGHT; n++) {
+    GpuProfilerFrame *frame =
+        &profiler->frames[(profiler->frameNumber + n) % GPU_PROFILER_FRAMES_IN_FLIGHT];
+    if (frame->state != GpuProfilerFrameState_Mapped)
+      continue;
+
+    if (!frame->mapFailed) {
+      size_t size = frame->passCount * 2 * sizeof(uint64_t);
+      const uint64_t *ticks =
+          wgpuBufferGetConstMappedRange(frame->readbackBuffer, 0, size);
+      publish(profiler, frame, ticks);
+      wgpuBufferUnmap(frame->readbackBuffer);
+    }
+    frame->state = GpuProfilerFrameState_Free;
+  }
+}
+
+void frmwrk_gpu_profiler_begin_frame(GpuProfiler *profiler) {
+  if (profiler->timestampsSupported) {
+    // Lets pending map callbacks fire without blocking.
+    wgpuDevicePoll(profiler->device, false, NULL);
+    collect(profiler);
+  }
+
+  GpuProfilerFrame *frame =
+      &profiler->frames[profiler->frameNumber % GPU_PROFILER_FRAMES_IN_FLIGHT];
+  if (frame->state == GpuProfilerFrameState_Free) {
+    frame->state = GpuProfilerFrameState_Recording;
+    frame->passCount = 0;
+    frame->frameNumber = profiler->frameNumber;
+    profiler->current = frame;
+  } else {
+    // The GPU is more than GPU_PROFILER_FRAMES_IN_FLIGHT frames behind; skip
+    // this frame rather than stall on the readback.
+    profiler->current = NULL;
+    profiler->skippedFrames++;
+  }
+  profiler->frameNumber++;
+}
+
+uint32_t frmwrk_gpu_profiler_begin_pass(GpuProfiler *profiler,
+                                        WGPUCommandEncoder encoder,
+                                        const char *name) {
+  GpuProfilerFrame *frame = profiler->current;
+  if (!frame || frame->passCount == GPU_PROFILER_MAX_PASSES)
+    return NO_PASS;
+
+  uint32_t pass = frame->passCount++;
+  frame->passNames[pass] = name;
+  if (profiler->timestampsSupported)
+    wgpuCommandEncoderWriteTimestamp(encoder, profiler->querySet,
+                                     first_query(profiler, frame) + pass * 2);
+  frame->passCpuNs[pass] = frmwrk_time_ns();
+  return pass;
+}
+
+void frmwrk_gpu_profiler_end_pass(GpuProfiler *profiler,
+                                  WGPUCommandEncoder encoder, uint32_t pass) {
+  GpuProfilerFrame *frame = profiler->current;
+  if (!frame || pass == NO_PASS)
+    return;
+
+  frame->passCpuNs[pass] = frmwrk_time_ns() - frame->passCpuNs[pass];
+  if (profiler->timestampsSupported)
+    wgpuCommandEncoderWriteTimestamp(encoder, profiler->querySet,
+                                     first_query(profiler, frame) + pass * 2 + 1);
+}
+
+void frmwrk_gpu_profiler_resolve(GpuProfiler *profiler,
+                                 WGPUCommandEncoder encoder) {
+  GpuProfilerFrame *frame = profiler->current;
+  if (!frame || !profiler->timestampsSupported || frame->passCount == 0)
+    return;
+
+  wgpuCommandEncoderResolveQuerySet(encoder, profiler->querySet,
+                                    first_query(profiler, frame),
+                                    frame->passCount * 2, frame->resolveBuffer,
+                                    0);
+  wgpuCommandEncoderCopyBufferToBuffer(encoder, frame->resolveBuffer, 0,
+                                       frame->readbackBuffer, 0,
+                                       frame->passCount * 2 * sizeof(uint64_t));
+}
+
+void frmwrk_gpu_profiler_end_frame(GpuProfiler *profiler) {
+  GpuProfilerFrame *frame = profiler->current;
+  if (!frame)
+    return;
+  profiler->current = NULL;
+
+  if (profiler->timestampsSupported && frame->passCount > 0) {
+    frame->state = GpuProfilerFrameState_Mapping;
+    wgpuBufferMapAsync(frame->readbackBuffer, WGPUMapMode_Read, 0,
+                       frame->passCount * 2 * sizeof(uint64_t),
+                       handle_readback_map, frame);
+  } else {
+    publish(profiler, frame, NULL);
+    frame->state = GpuProfilerFrameState_Free;
+  }
+}
+
+void frmwrk_gpu_profiler_print(const GpuProfiler *profiler) {
+  printf("[gpu_profiler] frame %llu (%llu skipped)%s\n",
+         (unsigned long long)profiler->resultFrameNumber,
+         (unsigned long long)profiler->skippedFrames,
+         profiler->timestampsSupported ? "" : ", cpu only");
+  for (uint32_t i = 0; i < profiler->resultCount; i++) {
+    const GpuPassTiming *result = &profiler->results[i];
+    if (result->gpuMs >= 0.0)
+      printf("[gpu_profiler] %-24s gpu %8.3f ms (avg %8.3f)  cpu %8.3f ms "
+             "(avg %8.3f)\n",
+             result->name, result->gpuMs, result->averageGpuMs, result->cpuMs,
+             result->averageCpuMs);
+    else
+      printf("[gpu_profiler] %-24s gpu      n/a               cpu %8.3f ms "
+             "(avg %8.3f)\n",
+             result->name, result->cpuMs, result->averageCpuMs);
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "framework.h"
+
+#define GPU_PROFILER_MAX_PASSES 16
+// Readbacks are consumed this many frames after submission at the earliest, so
+// the CPU never waits on a map.
+#define GPU_PROFILER_FRAMES_IN_FLIGHT 4
+
+typedef enum GpuProfilerFrameState {
+  GpuProfilerFrameState_Free,
+  GpuProfilerFrameState_Recording,
+  GpuProfilerFrameState_Mapping,
+  GpuProfilerFrameState_Mapped,
+} GpuProfilerFrameState;
+
+typedef struct GpuProfiler GpuProfiler;
+
+typedef struct GpuProfilerFrame {
+  GpuProfiler *profiler;
+  // Query results land in resolveBuffer and are copied to readbackBuffer,
+  // since a QueryResolve buffer cannot also be mapped.
+  WGPUBuffer resolveBuffer;
+  WGPUBuffer readbackBuffer;
+  const char *passNames[GPU_PROFILER_MAX_PASSES];
+  uint64_t passCpuNs[GPU_PROFILER_MAX_PASSES];
+  uint32_t passCount;
+  uint64_t frameNumber;
+  GpuProfilerFrameState state;
+  bool mapFailed;
+} GpuProfilerFrame;
+
+typedef struct GpuPassTiming {
+  const char *name;
+  // -1 when the device has no timestamp support.
+  double gpuMs;
+  double cpuMs;
+  double averageGpuMs;
+  double averageCpuMs;
+} GpuPassTiming;
+
+struct GpuProfiler {
+  WGPUDevice device;
+  bool timestampsSupported;
+  // Nanoseconds per timestamp tick. wgpu-native does not expose the queue's
+  // timestamp period, so this defaults to 1 and can be overridden per backend.
+  float timestampPeriod;
+  WGPUQuerySet querySet;
+  GpuProfilerFrame frames[GPU_PROFILER_FRAMES_IN_FLIGHT];
+  // NULL while the current frame is not being profiled because its slot is
+  // still waiting on a readback.
+  GpuProfilerFrame *current;
+  uint64_t frameNumber;
+
+  GpuPassTiming results[GPU_PROFILER_MAX_PASSES];
+  uint32_t resultCount;
+  uint64_t resultFrameNumber;
+  uint64_t skippedFrames;
+};
+
+// Timestamps are used when the device was created with
+// WGPUFeatureName_TimestampQuery, otherwise only CPU recording time is reported.
+GpuProfiler *frmwrk_create_gpu_profiler(WGPUDevice device);
+void frmwrk_drop_gpu_profiler(GpuProfiler *profiler);
+
+// Call once per frame before recording. Also consumes any readbacks that have
+// completed since the last call.
+void frmwrk_gpu_profiler_begin_frame(GpuProfiler *profiler);
+// Brackets a render or compute pass recorded on `encoder`. Returns the pass
+// index to hand to frmwrk_gpu_profiler_end_pass.
+uint32_t frmwrk_gpu_profiler_begin_pass(GpuProfiler *profiler,
+                                        WGPUCommandEncoder encoder,
+                                        const char *name);
+void frmwrk_gpu_profiler_end_pass(GpuProfiler *profiler,
+                                  WGPUCommandEncoder encoder,
+                                  uint32_t pass);
+// Records the query resolve and readback copy; call before finishing the encoder.
+void frmwrk_gpu_profiler_resolve(GpuProfiler *profiler,
+                                 WGPUCommandEncoder encoder);
+// Call after the frame's command buffers have been submitted.
+void frmwrk_gpu_profiler_end_frame(GpuProfiler *profiler);
+
+void frmwrk_gpu_profiler_print(const GpuProfiler *profiler);
+
+#endif // GPU_PROFILER_H
@@ -0,0 +1,144 @@
+#include "headless.h"
+#include <stdio.h>
+#include <string.h>
+
+#define COPY_BYTES_PER_ROW_ALIGNMENT 256
+
+HeadlessTarget frmwrk_create_headless_target(WGPUDevice device, uint32_t width,
+                                             uint32_t height,
+                                             WGPUTextureFormat format) {
+  HeadlessTarget target = (HeadlessTarget){
+    .format = format,
+    .width = width,
+    .height = height,
+    .bytesPerRow = (width * 4 + COPY_BYTES_PER_ROW_ALIGNMENT - 1) &
+                   ~(uint32_t)(COPY_BYTES_PER_ROW_ALIGNMENT - 1)
+  };
+
+  target.texture = wgpuDeviceCreateTexture(
+      device, &(const WGPUTextureDescriptor){
+                  .label = "headless_target",
+                  .dimension = WGPUTextureDimension_2D,
+                  .format = format,
+                  .size = (WGPUExtent3D){
+                    .width = width,
+                    .height = height,
+                    .depthOrArrayLayers = 1
+                  },
+                  .usage = WGPUTextureUsage_RenderAttachment |
+                           WGPUTextureUsage_CopySrc,
+                  .mipLevelCount = 1,
+                  .sampleCount = 1,
+                  .viewFormats = &format,
+                  .viewFormatCount = 1
+              });
+
+  target.readbackBuffer = wgpuDeviceCreateBuffer(
+      device, &(const WGPUBufferDescriptor){
+                  .label = "headless_readback",
+                  .size = (uint64_t)target.bytesPerRow * height,
+                  .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead,
+                  .mappedAtCreation = false
+              });
+  return target;
+}
+
+WGPUTextureView frmwrk_headless_target_view(HeadlessTarget *target) {
+  return wgpuTextureCreateView(target->texture,
+                               &(const WGPUTextureViewDescriptor){
+                                   .label = "headless_target_view",
+                                   .format = target->format,
+                                   .dimension = WGPUTextureViewDimension_2D,
+                                   .aspect = WGPUTextureAspect_All,
+                                   .baseMipLevel = 0,
+                                   .mipLevelCount = 1,
+                                   .baseArrayLayer = 0,
+                                   .arrayLayerCount = 1
+                               });
+}
+
+static void handle_readback_map(WGPUBufferMapAsyncStatus status,
+                                void *userdata) {
+  *(WGPUBufferMapAsyncStatus *)userdata = status;
+}
+
+bool frmwrk_headless_target_read_back(WGPUDevice device, WGPUQueue queue,
+                                      HeadlessTarget *target,
+                                      unsigned char *pixels) {
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
+      device, &(const WGPUCommandEncoderDescriptor){
+                  .label = "headless_readback_encoder",
+              });
+  wgpuCommandEncoderCopyTextureToBuffer(
+      encoder,
+      &(const WGPUImageCopyTexture){
+          .texture = target->texture,
+          .aspect = WGPUTextureAspect_All,
+          .mipLevel = 0,
+          .origin = (WGPUOrigin3D){0, 0, 0}
+      },
+      &(const WGPUImageCopyBuffer){
+          .buffer = target->readbackBuffer,
+          .layout = (WGPUTextureDataLayout){
+            .offset = 0,
+            .bytesPerRow = target->bytesPerRow,
+            .rowsPerImage = target->height
+          }
+      },
+      &(const WGPUExtent3D){
+          .width = target->width,
+          .height = target->height,
+          .depthOrArrayLayers = 1
+      });
+  WGPUCommandBuffer command_buffer = wgpuCommandEncoderFinish(
+      encoder, &(const WGPUCommandBufferDescriptor){
+                   .label = "headless_readback_command_buffer",
+               });
+  wgpuQueueSubmit(queue, 1, &command_buffer);
+
+  size_t size = (size_t)target->bytesPerRow * target->height;
+  // Anything other than Success/Error means the callback has not run yet.
+  WGPUBufferMapAsyncStatus status = (WGPUBufferMapAsyncStatus)-1;
+  wgpuBufferMapAsync(target->readbackBuffer, WGPUMapMode_Read, 0, size,
+                     handle_readback_map, &status);
+  while (status == (WGPUBufferMapAsyncStatus)-1)
+    wgpuDevicePoll(device, true, NULL);
+
+  if (status != WGPUBufferMapAsyncStatus_Success) {
+    printf("[framework] frmwrk_headless_target_read_back: map failed: %#.8x\n",
+           status);
+    return false;
+  }
+
+  const unsigned char *mapping =
+      wgpuBufferGetConstMappedRange(target->readbackBuffer, 0, size);
+  for (uint32_t y = 0; y < target->height; y++) {
+    memcpy(pixels + (size_t)y * target->width * 4,
+           mapping + (size_t)y * target->bytesPerRow, target->width * 4);
+  }
+  wgpuBufferUnmap(target->readbackBuffer);
+  return true;
+}
+
+bool frmwrk_write_ppm(const char *path, const unsigned char *pixels,
+                      uint32_t width, uint32_t height) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+  fprintf(file, "P6\n%u %u\n255\n", width, height);
+  for (size_t i = 0; i < (size_t)width * height; i++) {
+    fwrite(pixels + i * 4, 1, 3, file);
+  }
+  fclose(file);
+  return true;
+}
+
+void frmwrk_drop_headless_target(HeadlessTarget *target) {
+  if (target->readbackBuffer)
+    wgpuBufferDrop(target->readbackBuffer);
+  if (target->texture)
+    wgpuTextureDrop(target->texture);
+  *target = (HeadlessTarget){0};
+}
@@ -0,0 +1,35 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "framework.h"
+
+// An offscreen render target used in place of a swapchain when there is no
+// window to present to. Frames are rendered into `texture` and can be copied
+// back to the CPU through `readbackBuffer`.
+typedef struct HeadlessTarget {
+  WGPUTexture texture;
+  WGPUBuffer readbackBuffer;
+  WGPUTextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  // Row pitch of the readback buffer, padded to the 256-byte copy alignment.
+  uint32_t bytesPerRow;
+} HeadlessTarget;
+
+HeadlessTarget frmwrk_create_headless_target(WGPUDevice device, uint32_t width,
+                                             uint32_t height,
+                                             WGPUTextureFormat format);
+// Creates a view of the target for this frame. Like the view returned by
+// wgpuSwapChainGetCurrentTextureView it must be dropped once the pass is recorded.
+WGPUTextureView frmwrk_headless_target_view(HeadlessTarget *target);
+// Copies the target into `pixels` (width * height * 4 bytes, tightly packed),
+// blocking until the GPU has finished all submitted work.
+bool frmwrk_headless_target_read_back(WGPUDevice device, WGPUQueue queue,
+                                      HeadlessTarget *target,
+                                      unsigned char *pixels);
+// Writes tightly packed 4-channel pixels as a binary PPM, dropping alpha.
+bool frmwrk_write_ppm(const char *path, const unsigned char *pixels,
+                      uint32_t width, uint32_t height);
+void frmwrk_drop_headless_target(HeadlessTarget *target);
+
+#endif // HEADLESS_H
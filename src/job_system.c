@@ -0,0 +1,367 @@
+#include "job_system.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Empty polls a worker makes, yielding between them, before it sleeps.
+#define JOB_SYSTEM_SPIN_COUNT 64
+
+// The worker the calling thread runs as, when it is one of a system's own
+// threads. Every other thread submits as worker 0.
+static _Thread_local JobWorker *current_worker;
+
+static JobWorker *current(JobSystem *system) {
+  if (current_worker && current_worker->system == system)
+    return current_worker;
+  return &system->workers[0];
+}
+
+#pragma region deque
+static bool deque_push(JobDeque *deque, Job *job) {
+  int_fast64_t bottom =
+      atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+  int_fast64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  if (bottom - top >= JOB_DEQUE_CAPACITY)
+    return false;
+  atomic_store_explicit(&deque->items[bottom & (JOB_DEQUE_CAPACITY - 1)], job,
+                        memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  return true;
+}
+
+static Job *deque_pop(JobDeque *deque) {
+  int_fast64_t bottom =
+      atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  int_fast64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+  if (top > bottom) {
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    return NULL;
+  }
+  Job *job = atomic_load_explicit(
+      &deque->items[bottom & (JOB_DEQUE_CAPACITY - 1)], memory_order_relaxed);
+  if (top == bottom) {
+    // Last job: race the thieves for it.
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed))
+      job = NULL;
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+  }
+  return job;
+}
+
+static Job *deque_steal(JobDeque *deque) {
+  int_fast64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  int_fast64_t bottom =
+      atomic_load_explicit(&deque->bottom, memory_order_acquire);
+  if (top >= bottom)
+    return NULL;
+  Job *job = atomic_load_explicit(&deque->items[top & (JOB_DEQUE_CAPACITY - 1)],
+                                  memory_order_relaxed);
+  // Losing the race means someone else took it; the caller looks elsewhere.
+  if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                               memory_order_seq_cst,
+                                               memory_order_relaxed))
+    return NULL;
+  return job;
+}
+#pragma endregion
+
+static Job *alloc_job(JobWorker *worker) {
+  Job *job = &worker->pool[worker->poolNext % JOB_POOL_CAPACITY];
+  if (atomic_load_explicit(&job->finished, memory_order_acquire)) {
+    worker->poolNext++;
+    atomic_store_explicit(&job->finished, false, memory_order_relaxed);
+    job->heap = false;
+    return job;
+  }
+  // The next slot is still in flight, so the pool is full.
+  job = malloc(sizeof(Job));
+  if (job) {
+    atomic_init(&job->finished, false);
+    job->heap = true;
+  }
+  return job;
+}
+
+static void push_job(JobWorker *worker, Job *job);
+
+// Queues every waiting job whose counter has reached zero on `worker`.
+static void release_waiting(JobWorker *worker) {
+  JobSystem *system = worker->system;
+  Job *ready = NULL;
+  frmwrk_mutex_lock(&system->waitingMutex);
+  Job **link = &system->waiting;
+  while (*link) {
+    Job *job = *link;
+    if (atomic_load(&job->waitFor->value) == 0) {
+      *link = job->nextWaiting;
+      job->nextWaiting = ready;
+      ready = job;
+    } else {
+      link = &job->nextWaiting;
+    }
+  }
+  frmwrk_mutex_unlock(&system->waitingMutex);
+
+  while (ready) {
+    Job *next = ready->nextWaiting;
+    push_job(worker, ready);
+    ready = next;
+  }
+}
+
+static void finish_counter(JobWorker *worker, JobCounter *counter) {
+  if (counter && atomic_fetch_sub(&counter->value, 1) == 1)
+    release_waiting(worker);
+}
+
+static void execute_job(JobWorker *worker, Job *job) {
+  job->decl.function(job->decl.userdata);
+  JobCounter *counter = job->counter;
+  if (job->heap)
+    free(job);
+  else
+    atomic_store_explicit(&job->finished, true, memory_order_release);
+  worker->stats.executed++;
+  finish_counter(worker, counter);
+}
+
+static void notify(JobSystem *system) {
+  if (atomic_load(&system->sleeping) == 0)
+    return;
+  // Taking the lock orders this after a sleeper's check of `queued`.
+  frmwrk_mutex_lock(&system->sleepMutex);
+  frmwrk_condition_signal(&system->wake);
+  frmwrk_mutex_unlock(&system->sleepMutex);
+}
+
+static void push_job(JobWorker *worker, Job *job) {
+  JobSystem *system = worker->system;
+  // Counted before it is visible so a thief never takes it uncounted.
+  atomic_fetch_add(&system->queued, 1);
+  if (!deque_push(&worker->deque, job)) {
+    atomic_fetch_sub(&system->queued, 1);
+    worker->stats.inlined++;
+    execute_job(worker, job);
+    return;
+  }
+  notify(system);
+}
+
+static uint32_t next_random(JobWorker *worker) {
+  uint32_t x = worker->random;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  worker->random = x;
+  return x;
+}
+
+static Job *take_job(JobWorker *worker) {
+  JobSystem *system = worker->system;
+  Job *job = deque_pop(&worker->deque);
+  if (!job && atomic_load(&system->queued) != 0) {
+    uint32_t start = next_random(worker) % system->threadCount;
+    for (uint32_t i = 0; i < system->threadCount && !job; i++) {
+      JobWorker *victim = &system->workers[(start + i) % system->threadCount];
+      if (victim != worker)
+        job = deque_steal(&victim->deque);
+    }
+    if (job)
+      worker->stats.stolen++;
+  }
+  if (job)
+    atomic_fetch_sub(&system->queued, 1);
+  return job;
+}
+
+static void worker_main(void *userdata) {
+  JobWorker *worker = userdata;
+  JobSystem *system = worker->system;
+  current_worker = worker;
+
+  uint32_t idle = 0;
+  while (!atomic_load(&system->stopping)) {
+    Job *job = take_job(worker);
+    if (job) {
+      execute_job(worker, job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < JOB_SYSTEM_SPIN_COUNT) {
+      frmwrk_thread_yield();
+      continue;
+    }
+    idle = 0;
+    frmwrk_mutex_lock(&system->sleepMutex);
+    atomic_fetch_add(&system->sleeping, 1);
+    while (atomic_load(&system->queued) == 0 &&
+           !atomic_load(&system->stopping))
+      frmwrk_condition_wait(&system->wake, &system->sleepMutex);
+    atomic_fetch_sub(&system->sleeping, 1);
+    frmwrk_mutex_unlock(&system->sleepMutex);
+    worker->stats.sleeps++;
+  }
+  current_worker = NULL;
+}
+
+JobSystem *frmwrk_create_job_system(uint32_t threadCount) {
+  if (threadCount == 0)
+    threadCount = frmwrk_cpu_count();
+  if (threadCount > JOB_SYSTEM_MAX_THREADS)
+    threadCount = JOB_SYSTEM_MAX_THREADS;
+
+  JobSystem *system = calloc(1, sizeof(JobSystem));
+  if (!system)
+    return NULL;
+  system->workers = calloc(threadCount, sizeof(JobWorker));
+  if (!system->workers) {
+    free(system);
+    return NULL;
+  }
+  system->threadCount = threadCount;
+  atomic_init(&system->queued, 0);
+  atomic_init(&system->sleeping, 0);
+  atomic_init(&system->stopping, false);
+  frmwrk_mutex_init(&system->sleepMutex);
+  frmwrk_condition_init(&system->wake);
+  frmwrk_mutex_init(&system->waitingMutex);
+
+  for (uint32_t i = 0; i < threadCount; i++) {
+    JobWorker *worker = &system->workers[i];
+    worker->system = system;
+    worker->index = i;
+    worker->random = 2654435761u * (i + 1);
+    atomic_init(&worker->deque.top, 0);
+    atomic_init(&worker->deque.bottom, 0);
+    for (uint32_t slot = 0; slot < JOB_POOL_CAPACITY; slot++)
+      atomic_init(&worker->pool[slot].finished, true);
+  }
+  // A worker that fails to start just leaves its deque empty; the others
+  // carry on without it.
+  for (uint32_t i = 1; i < threadCount; i++) {
+    JobWorker *worker = &system->workers[i];
+    worker->started = frmwrk_thread_create(&worker->thread, worker_main, worker);
+    if (!worker->started)
+      printf("[job_system] could not start worker %u\n", i);
+  }
+  return system;
+}
+
+void frmwrk_drop_job_system(JobSystem *system) {
+  if (!system)
+    return;
+
+  frmwrk_mutex_lock(&system->sleepMutex);
+  atomic_store(&system->stopping, true);
+  frmwrk_condition_broadcast(&system->wake);
+  frmwrk_mutex_unlock(&system->sleepMutex);
+  for (uint32_t i = 1; i < system->threadCount; i++) {
+    if (system->workers[i].started)
+      frmwrk_thread_join(system->workers[i].thread);
+  }
+
+  while (system->waiting) {
+    Job *next = system->waiting->nextWaiting;
+    if (system->waiting->heap)
+      free(system->waiting);
+    system->waiting = next;
+  }
+  frmwrk_mutex_destroy(&system->waitingMutex);
+  frmwrk_condition_destroy(&system->wake);
+  frmwrk_mutex_destroy(&system->sleepMutex);
+  free(system->workers);
+  free(system);
+}
+
+void frmwrk_job_system_run(JobSystem *system, const JobDecl *jobs,
+                           uint32_t count, JobCounter *counter) {
+  frmwrk_job_system_run_after(system, jobs, count, NULL, counter);
+}
+
+void frmwrk_job_system_run_after(JobSystem *system, const JobDecl *jobs,
+                                 uint32_t count, JobCounter *waitFor,
+                                 JobCounter *counter) {
+  if (count == 0)
+    return;
+  JobWorker *worker = current(system);
+  // Added up front so the counter cannot reach zero while these are queued.
+  if (counter)
+    atomic_fetch_add(&counter->value, count);
+
+  Job *held = NULL;
+  for (uint32_t i = 0; i < count; i++) {
+    Job *job = alloc_job(worker);
+    if (!job) {
+      // Out of memory: run it here once it is allowed to start.
+      if (waitFor)
+        frmwrk_job_system_wait(system, waitFor);
+      jobs[i].function(jobs[i].userdata);
+      worker->stats.inlined++;
+      finish_counter(worker, counter);
+      continue;
+    }
+    job->decl = jobs[i];
+    job->counter = counter;
+    job->waitFor = waitFor;
+    job->nextWaiting = NULL;
+    if (waitFor) {
+      job->nextWaiting = held;
+      held = job;
+    } else {
+      push_job(worker, job);
+    }
+  }
+
+  if (held) {
+    frmwrk_mutex_lock(&system->waitingMutex);
+    Job *tail = held;
+    while (tail->nextWaiting)
+      tail = tail->nextWaiting;
+    tail->nextWaiting = system->waiting;
+    system->waiting = held;
+    // The counter may have reached zero before the jobs were linked, in which
+    // case nobody else will release them.
+    bool ready = atomic_load(&waitFor->value) == 0;
+    frmwrk_mutex_unlock(&system->waitingMutex);
+    if (ready)
+      release_waiting(worker);
+  }
+}
+
+void frmwrk_job_system_wait(JobSystem *system, JobCounter *counter) {
+  JobWorker *worker = current(system);
+  while (atomic_load(&counter->value) != 0) {
+    Job *job = take_job(worker);
+    if (job)
+      execute_job(worker, job);
+    else
+      frmwrk_thread_yield();
+  }
+}
+
+JobWorkerStats frmwrk_job_system_stats(const JobSystem *system) {
+  JobWorkerStats total = {0};
+  for (uint32_t i = 0; i < system->threadCount; i++) {
+    const JobWorkerStats *stats = &system->workers[i].stats;
+    total.executed += stats->executed;
+    total.stolen += stats->stolen;
+    total.inlined += stats->inlined;
+    total.sleeps += stats->sleeps;
+  }
+  return total;
+}
+
+void frmwrk_job_system_print(const JobSystem *system) {
+  JobWorkerStats total = frmwrk_job_system_stats(system);
+  printf("[job_system] %u threads: executed=%llu stolen=%llu (%.1f%%) "
+         "inlined=%llu sleeps=%llu\n",
+         system->threadCount, (unsigned long long)total.executed,
+         (unsigned long long)total.stolen,
+         total.executed ? 100.0 * total.stolen / total.executed : 0.0,
+         (unsigned long long)total.inlined, (unsigned long long)total.sleeps);
+}
@@ -0,0 +1,113 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <stdatomic.h>
+#include "threading.h"
+
+#define JOB_SYSTEM_MAX_THREADS 64
+// Per-thread deque capacity, a power of two. Pushing to a full deque runs the
+// job inline instead.
+#define JOB_DEQUE_CAPACITY 1024
+// Jobs each thread can have in flight from its pool before further ones are
+// heap allocated.
+#define JOB_POOL_CAPACITY 1024
+
+typedef void (*JobFunction)(void *userdata);
+
+typedef struct JobDecl {
+  JobFunction function;
+  void *userdata;
+} JobDecl;
+
+// Number of unfinished jobs submitted against it. Starts zeroed and can be
+// reused once it is back at zero.
+typedef struct JobCounter {
+  atomic_uint value;
+} JobCounter;
+
+typedef struct Job {
+  JobDecl decl;
+  // Decremented when the job finishes. May be NULL.
+  JobCounter *counter;
+  // The job is held back until this is zero. May be NULL.
+  JobCounter *waitFor;
+  struct Job *nextWaiting;
+  // Pool slots are reused once set; heap jobs are freed instead.
+  atomic_bool finished;
+  bool heap;
+} Job;
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom, other
+// threads steal from the top.
+typedef struct JobDeque {
+  atomic_int_fast64_t top;
+  // Keeps thieves' writes to `top` off the owner's cache line.
+  char padding[64];
+  atomic_int_fast64_t bottom;
+  _Atomic(Job *) items[JOB_DEQUE_CAPACITY];
+} JobDeque;
+
+typedef struct JobWorkerStats {
+  uint64_t executed;
+  uint64_t stolen;
+  // Run on the submitting thread because its deque was full.
+  uint64_t inlined;
+  uint64_t sleeps;
+} JobWorkerStats;
+
+typedef struct JobSystem JobSystem;
+
+typedef struct JobWorker {
+  JobSystem *system;
+  uint32_t index;
+  // Unused by worker 0, which is the creating thread.
+  FrmwrkThread thread;
+  bool started;
+  JobDeque deque;
+  Job pool[JOB_POOL_CAPACITY];
+  uint32_t poolNext;
+  // xorshift state for picking steal victims.
+  uint32_t random;
+  // Only written by the worker's own thread; read them once it is idle.
+  JobWorkerStats stats;
+} JobWorker;
+
+// Work-stealing scheduler. Worker 0 is the thread that created the system,
+// which runs jobs while it waits on a counter; the others are threads of their
+// own that sleep when every deque is empty. Jobs are submitted and waited on
+// from the creating thread or from inside other jobs.
+struct JobSystem {
+  JobWorker *workers;
+  uint32_t threadCount;
+  // Jobs sitting in deques, so idle workers know whether to keep looking.
+  atomic_uint queued;
+  atomic_uint sleeping;
+  atomic_bool stopping;
+  FrmwrkMutex sleepMutex;
+  FrmwrkCondition wake;
+  // Jobs whose waitFor counter has not reached zero yet, released whenever
+  // any counter does.
+  FrmwrkMutex waitingMutex;
+  Job *waiting;
+};
+
+// threadCount includes the calling thread; 0 uses one per logical processor.
+JobSystem *frmwrk_create_job_system(uint32_t threadCount);
+// Stops the workers. Wait on everything submitted first.
+void frmwrk_drop_job_system(JobSystem *system);
+
+// Queues `count` jobs, adding them to `counter` when it is not NULL.
+void frmwrk_job_system_run(JobSystem *system, const JobDecl *jobs,
+                           uint32_t count, JobCounter *counter);
+// Same, but the jobs only start once `waitFor` is zero.
+void frmwrk_job_system_run_after(JobSystem *system, const JobDecl *jobs,
+                                 uint32_t count, JobCounter *waitFor,
+                                 JobCounter *counter);
+// Runs queued jobs on the calling thread until `counter` is zero.
+void frmwrk_job_system_wait(JobSystem *system, JobCounter *counter);
+
+// Totals over every worker.
+JobWorkerStats frmwrk_job_system_stats(const JobSystem *system);
+void frmwrk_job_system_print(const JobSystem *system);
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,630 @@
+#include "mipmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The integer box filter has SSE2 and NEON kernels. Kaiser and sRGB-aware
+// filtering run in float with one pixel per 4-lane vector, which keeps the
+// separable loops identical on every target.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define MIPMAP_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define MIPMAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const float srgb_to_linear_float[256] = {
+  0.00000000e+00f, 3.03526984e-04f, 6.07053967e-04f, 9.10580951e-04f,
+  1.21410793e-03f, 1.51763492e-03f, 1.82116190e-03f, 2.12468888e-03f,
+  2.42821587e-03f, 2.73174285e-03f, 3.03526984e-03f, 3.34653576e-03f,
+  3.67650732e-03f, 4.02471702e-03f, 4.39144204e-03f, 4.77695348e-03f,
+  5.18151670e-03f, 5.60539162e-03f, 6.04883302e-03f, 6.51209079e-03f,
+  6.99541019e-03f, 7.49903204e-03f, 8.02319299e-03f, 8.56812562e-03f,
+  9.13405870e-03f, 9.72121732e-03f, 1.03298230e-02f, 1.09600940e-02f,
+  1.16122452e-02f, 1.22864884e-02f, 1.29830323e-02f, 1.37020830e-02f,
+  1.44438436e-02f, 1.52085144e-02f, 1.59962934e-02f, 1.68073758e-02f,
+  1.76419545e-02f, 1.85002201e-02f, 1.93823610e-02f, 2.02885631e-02f,
+  2.12190104e-02f, 2.21738848e-02f, 2.31533662e-02f, 2.41576324e-02f,
+  2.51868596e-02f, 2.62412219e-02f, 2.73208916e-02f, 2.84260395e-02f,
+  2.95568344e-02f, 3.07134437e-02f, 3.18960331e-02f, 3.31047666e-02f,
+  3.43398068e-02f, 3.56013149e-02f, 3.68894504e-02f, 3.82043716e-02f,
+  3.95462353e-02f, 4.09151969e-02f, 4.23114106e-02f, 4.37350293e-02f,
+  4.51862044e-02f, 4.66650863e-02f, 4.81718242e-02f, 4.97065660e-02f,
+  5.12694584e-02f, 5.28606470e-02f, 5.44802764e-02f, 5.61284900e-02f,
+  5.78054302e-02f, 5.95112382e-02f, 6.12460542e-02f, 6.30100177e-02f,
+  6.48032667e-02f, 6.66259386e-02f, 6.84781698e-02f, 7.03600957e-02f,
+  7.22718507e-02f, 7.42135684e-02f, 7.61853815e-02f, 7.81874218e-02f,
+  8.02198203e-02f, 8.22827071e-02f, 8.43762115e-02f, 8.65004620e-02f,
+  8.86555863e-02f, 9.08417112e-02f, 9.30589628e-02f, 9.53074666e-02f,
+  9.75873471e-02f, 9.98987282e-02f, 1.02241733e-01f, 1.04616484e-01f,
+  1.07023103e-01f, 1.09461711e-01f, 1.11932428e-01f, 1.14435374e-01f,
+  1.16970668e-01f, 1.19538428e-01f, 1.22138772e-01f, 1.24771818e-01f,
+  1.27437680e-01f, 1.30136477e-01f, 1.32868322e-01f, 1.35633330e-01f,
+  1.38431615e-01f, 1.41263291e-01f, 1.44128471e-01f, 1.47027266e-01f,
+  1.49959790e-01f, 1.52926152e-01f, 1.55926464e-01f, 1.58960835e-01f,
+  1.62029376e-01f, 1.65132195e-01f, 1.68269400e-01f, 1.71441101e-01f,
+  1.74647404e-01f, 1.77888416e-01f, 1.81164244e-01f, 1.84474995e-01f,
+  1.87820772e-01f, 1.91201683e-01f, 1.94617830e-01f, 1.98069320e-01f,
+  2.01556254e-01f, 2.05078736e-01f, 2.08636870e-01f, 2.12230757e-01f,
+  2.15860500e-01f, 2.19526200e-01f, 2.23227957e-01f, 2.26965874e-01f,
+  2.30740049e-01f, 2.34550582e-01f, 2.38397574e-01f, 2.42281122e-01f,
+  2.46201327e-01f, 2.50158285e-01f, 2.54152094e-01f, 2.58182853e-01f,
+  2.62250658e-01f, 2.66355605e-01f, 2.70497791e-01f, 2.74677312e-01f,
+  2.78894263e-01f, 2.83148740e-01f, 2.87440838e-01f, 2.91770650e-01f,
+  2.96138271e-01f, 3.00543794e-01f, 3.04987314e-01f, 3.09468923e-01f,
+  3.13988713e-01f, 3.18546778e-01f, 3.23143209e-01f, 3.27778098e-01f,
+  3.32451536e-01f, 3.37163615e-01f, 3.41914425e-01f, 3.46704056e-01f,
+  3.51532600e-01f, 3.56400144e-01f, 3.61306780e-01f, 3.66252596e-01f,
+  3.71237680e-01f, 3.76262123e-01f, 3.81326011e-01f, 3.86429434e-01f,
+  3.91572478e-01f, 3.96755231e-01f, 4.01977780e-01f, 4.07240212e-01f,
+  4.12542613e-01f, 4.17885071e-01f, 4.23267670e-01f, 4.28690497e-01f,
+  4.34153636e-01f, 4.39657174e-01f, 4.45201195e-01f, 4.50785783e-01f,
+  4.56411023e-01f, 4.62077000e-01f, 4.67783796e-01f, 4.73531496e-01f,
+  4.79320183e-01f, 4.85149940e-01f, 4.91020850e-01f, 4.96932995e-01f,
+  5.02886458e-01f, 5.08881321e-01f, 5.14917665e-01f, 5.20995573e-01f,
+  5.27115126e-01f, 5.33276404e-01f, 5.39479489e-01f, 5.45724461e-01f,
+  5.52011402e-01f, 5.58340390e-01f, 5.64711506e-01f, 5.71124829e-01f,
+  5.77580440e-01f, 5.84078418e-01f, 5.90618841e-01f, 5.97201788e-01f,
+  6.03827339e-01f, 6.10495571e-01f, 6.17206562e-01f, 6.23960392e-01f,
+  6.30757136e-01f, 6.37596874e-01f, 6.44479682e-01f, 6.51405637e-01f,
+  6.58374817e-01f, 6.65387298e-01f, 6.72443157e-01f, 6.79542470e-01f,
+  6.86685312e-01f, 6.93871761e-01f, 7.01101892e-01f, 7.08375780e-01f,
+  7.15693501e-01f, 7.23055129e-01f, 7.30460740e-01f, 7.37910409e-01f,
+  7.45404210e-01f, 7.52942217e-01f, 7.60524505e-01f, 7.68151147e-01f,
+  7.75822218e-01f, 7.83537792e-01f, 7.91297940e-01f, 7.99102738e-01f,
+  8.06952258e-01f, 8.14846572e-01f, 8.22785754e-01f, 8.30769877e-01f,
+  8.38799012e-01f, 8.46873232e-01f, 8.54992608e-01f, 8.63157213e-01f,
+  8.71367119e-01f, 8.79622397e-01f, 8.87923118e-01f, 8.96269353e-01f,
+  9.04661174e-01f, 9.13098652e-01f, 9.21581856e-01f, 9.30110858e-01f,
+  9.38685728e-01f, 9.47306537e-01f, 9.55973353e-01f, 9.64686248e-01f,
+  9.73445290e-01f, 9.82250550e-01f, 9.91102097e-01f, 1.00000000e+00f,
+};
+// Midpoints between consecutive entries of srgb_to_linear_float, so a search
+// over them rounds to the nearest sRGB code in linear space.
+static const float linear_to_srgb_threshold[256] = {
+  0.00000000e+00f, 1.51763492e-04f, 4.55290475e-04f, 7.58817459e-04f,
+  1.06234444e-03f, 1.36587143e-03f, 1.66939841e-03f, 1.97292539e-03f,
+  2.27645238e-03f, 2.57997936e-03f, 2.88350634e-03f, 3.19090280e-03f,
+  3.51152154e-03f, 3.85061217e-03f, 4.20807953e-03f, 4.58419776e-03f,
+  4.97923509e-03f, 5.39345416e-03f, 5.82711232e-03f, 6.28046191e-03f,
+  6.75375049e-03f, 7.24722112e-03f, 7.76111251e-03f, 8.29565930e-03f,
+  8.85109216e-03f, 9.42763801e-03f, 1.00255202e-02f, 1.06449585e-02f,
+  1.12861696e-02f, 1.19493668e-02f, 1.26347603e-02f, 1.33425577e-02f,
+  1.40729633e-02f, 1.48261790e-02f, 1.56024039e-02f, 1.64018346e-02f,
+  1.72246651e-02f, 1.80710873e-02f, 1.89412905e-02f, 1.98354620e-02f,
+  2.07537867e-02f, 2.16964476e-02f, 2.26636255e-02f, 2.36554993e-02f,
+  2.46722460e-02f, 2.57140408e-02f, 2.67810568e-02f, 2.78734656e-02f,
+  2.89914370e-02f, 3.01351391e-02f, 3.13047384e-02f, 3.25003998e-02f,
+  3.37222867e-02f, 3.49705608e-02f, 3.62453826e-02f, 3.75469110e-02f,
+  3.88753034e-02f, 4.02307161e-02f, 4.16133038e-02f, 4.30232199e-02f,
+  4.44606168e-02f, 4.59256454e-02f, 4.74184553e-02f, 4.89391951e-02f,
+  5.04880122e-02f, 5.20650527e-02f, 5.36704617e-02f, 5.53043832e-02f,
+  5.69669601e-02f, 5.86583342e-02f, 6.03786462e-02f, 6.21280359e-02f,
+  6.39066422e-02f, 6.57146027e-02f, 6.75520542e-02f, 6.94191328e-02f,
+  7.13159732e-02f, 7.32427095e-02f, 7.51994749e-02f, 7.71864016e-02f,
+  7.92036211e-02f, 8.12512637e-02f, 8.33294593e-02f, 8.54383368e-02f,
+  8.75780242e-02f, 8.97486487e-02f, 9.19503370e-02f, 9.41832147e-02f,
+  9.64474069e-02f, 9.87430377e-02f, 1.01070231e-01f, 1.03429109e-01f,
+  1.05819794e-01f, 1.08242407e-01f, 1.10697069e-01f, 1.13183901e-01f,
+  1.15703021e-01f, 1.18254548e-01f, 1.20838600e-01f, 1.23455295e-01f,
+  1.26104749e-01f, 1.28787079e-01f, 1.31502399e-01f, 1.34250826e-01f,
+  1.37032472e-01f, 1.39847453e-01f, 1.42695881e-01f, 1.45577869e-01f,
+  1.48493528e-01f, 1.51442971e-01f, 1.54426308e-01f, 1.57443649e-01f,
+  1.60495105e-01f, 1.63580785e-01f, 1.66700797e-01f, 1.69855250e-01f,
+  1.73044252e-01f, 1.76267910e-01f, 1.79526330e-01f, 1.82819619e-01f,
+  1.86147883e-01f, 1.89511228e-01f, 1.92909757e-01f, 1.96343575e-01f,
+  1.99812787e-01f, 2.03317495e-01f, 2.06857803e-01f, 2.10433814e-01f,
+  2.14045629e-01f, 2.17693350e-01f, 2.21377079e-01f, 2.25096915e-01f,
+  2.28852961e-01f, 2.32645315e-01f, 2.36474078e-01f, 2.40339348e-01f,
+  2.44241225e-01f, 2.48179806e-01f, 2.52155190e-01f, 2.56167474e-01f,
+  2.60216755e-01f, 2.64303131e-01f, 2.68426698e-01f, 2.72587552e-01f,
+  2.76785788e-01f, 2.81021502e-01f, 2.85294789e-01f, 2.89605744e-01f,
+  2.93954460e-01f, 2.98341033e-01f, 3.02765554e-01f, 3.07228118e-01f,
+  3.11728818e-01f, 3.16267746e-01f, 3.20844994e-01f, 3.25460654e-01f,
+  3.30114817e-01f, 3.34807576e-01f, 3.39539020e-01f, 3.44309241e-01f,
+  3.49118328e-01f, 3.53966372e-01f, 3.58853462e-01f, 3.63779688e-01f,
+  3.68745138e-01f, 3.73749902e-01f, 3.78794067e-01f, 3.83877723e-01f,
+  3.89000956e-01f, 3.94163854e-01f, 3.99366505e-01f, 4.04608996e-01f,
+  4.09891413e-01f, 4.15213842e-01f, 4.20576370e-01f, 4.25979083e-01f,
+  4.31422066e-01f, 4.36905405e-01f, 4.42429184e-01f, 4.47993489e-01f,
+  4.53598403e-01f, 4.59244011e-01f, 4.64930398e-01f, 4.70657646e-01f,
+  4.76425840e-01f, 4.82235062e-01f, 4.88085395e-01f, 4.93976922e-01f,
+  4.99909727e-01f, 5.05883889e-01f, 5.11899493e-01f, 5.17956619e-01f,
+  5.24055349e-01f, 5.30195765e-01f, 5.36377947e-01f, 5.42601975e-01f,
+  5.48867931e-01f, 5.55175896e-01f, 5.61525948e-01f, 5.67918168e-01f,
+  5.74352635e-01f, 5.80829429e-01f, 5.87348629e-01f, 5.93910315e-01f,
+  6.00514564e-01f, 6.07161455e-01f, 6.13851067e-01f, 6.20583477e-01f,
+  6.27358764e-01f, 6.34177005e-01f, 6.41038278e-01f, 6.47942660e-01f,
+  6.54890227e-01f, 6.61881058e-01f, 6.68915228e-01f, 6.75992813e-01f,
+  6.83113891e-01f, 6.90278537e-01f, 6.97486827e-01f, 7.04738836e-01f,
+  7.12034640e-01f, 7.19374315e-01f, 7.26757935e-01f, 7.34185574e-01f,
+  7.41657309e-01f, 7.49173213e-01f, 7.56733361e-01f, 7.64337826e-01f,
+  7.71986683e-01f, 7.79680005e-01f, 7.87417866e-01f, 7.95200339e-01f,
+  8.03027498e-01f, 8.10899415e-01f, 8.18816163e-01f, 8.26777816e-01f,
+  8.34784444e-01f, 8.42836122e-01f, 8.50932920e-01f, 8.59074911e-01f,
+  8.67262166e-01f, 8.75494758e-01f, 8.83772757e-01f, 8.92096236e-01f,
+  9.00465264e-01f, 9.08879913e-01f, 9.17340254e-01f, 9.25846357e-01f,
+  9.34398293e-01f, 9.42996133e-01f, 9.51639945e-01f, 9.60329801e-01f,
+  9.69065769e-01f, 9.77847920e-01f, 9.86676324e-01f, 9.95551049e-01f,
+};
+
+uint32_t frmwrk_mip_level_count(uint32_t width, uint32_t height) {
+  uint32_t size = width > height ? width : height;
+  uint32_t levels = 1;
+  while (size > 1) {
+    size >>= 1;
+    levels++;
+  }
+  return levels;
+}
+
+static uint32_t mip_extent(uint32_t size, uint32_t level) {
+  size >>= level;
+  return size ? size : 1;
+}
+
+size_t frmwrk_mip_chain_size(uint32_t width, uint32_t height,
+                             uint32_t levelCount) {
+  size_t size = 0;
+  for (uint32_t level = 0; level < levelCount; level++)
+    size += (size_t)mip_extent(width, level) * mip_extent(height, level) * 4;
+  return size;
+}
+
+static uint32_t clamp_index(int32_t i, uint32_t count) {
+  if (i < 0)
+    return 0;
+  return (uint32_t)i < count ? (uint32_t)i : count - 1;
+}
+
+// Integer 2x2 box filter. The second tap is clamped on odd or single-pixel
+// sides, so a 1-wide source still averages its two rows.
+
+static void box_row_scalar(uint8_t *dst, const uint8_t *row0,
+                           const uint8_t *row1, uint32_t srcWidth,
+                           uint32_t first, uint32_t dstWidth) {
+  for (uint32_t x = first; x < dstWidth; x++) {
+    uint32_t x0 = x * 2 * 4;
+    uint32_t x1 = clamp_index(x * 2 + 1, srcWidth) * 4;
+    for (uint32_t c = 0; c < 4; c++)
+      dst[x * 4 + c] = (uint8_t)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] +
+                                  row1[x1 + c] + 2) >> 2);
+  }
+}
+
+#if defined(MIPMAP_SSE2)
+
+// Adds the two pixels held in each half of eight 16-bit lanes.
+static inline __m128i pair_sum_sse2(__m128i px16) {
+  return _mm_add_epi16(px16, _mm_srli_si128(px16, 8));
+}
+
+// Four destination pixels from eight source pixels of each row.
+static inline __m128i box_quad_sse2(const uint8_t *row0, const uint8_t *row1) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi16(2);
+  __m128i a0 = _mm_loadu_si128((const __m128i *)row0);
+  __m128i b0 = _mm_loadu_si128((const __m128i *)(row0 + 16));
+  __m128i a1 = _mm_loadu_si128((const __m128i *)row1);
+  __m128i b1 = _mm_loadu_si128((const __m128i *)(row1 + 16));
+
+  __m128i a_lo = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero),
+                               _mm_unpacklo_epi8(a1, zero));
+  __m128i a_hi = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero),
+                               _mm_unpackhi_epi8(a1, zero));
+  __m128i b_lo = _mm_add_epi16(_mm_unpacklo_epi8(b0, zero),
+                               _mm_unpacklo_epi8(b1, zero));
+  __m128i b_hi = _mm_add_epi16(_mm_unpackhi_epi8(b0, zero),
+                               _mm_unpackhi_epi8(b1, zero));
+
+  __m128i d01 = _mm_unpacklo_epi64(pair_sum_sse2(a_lo), pair_sum_sse2(a_hi));
+  __m128i d23 = _mm_unpacklo_epi64(pair_sum_sse2(b_lo), pair_sum_sse2(b_hi));
+  d01 = _mm_srli_epi16(_mm_add_epi16(d01, round), 2);
+  d23 = _mm_srli_epi16(_mm_add_epi16(d23, round), 2);
+  return _mm_packus_epi16(d01, d23);
+}
+
+#elif defined(MIPMAP_NEON)
+
+static inline uint8x16_t box_quad_neon(const uint8_t *row0,
+                                       const uint8_t *row1) {
+  // De-interleave even and odd pixels so the horizontal pairs line up.
+  uint32x4x2_t p0 = vld2q_u32((const uint32_t *)row0);
+  uint32x4x2_t p1 = vld2q_u32((const uint32_t *)row1);
+  uint8x16_t e0 = vreinterpretq_u8_u32(p0.val[0]);
+  uint8x16_t o0 = vreinterpretq_u8_u32(p0.val[1]);
+  uint8x16_t e1 = vreinterpretq_u8_u32(p1.val[0]);
+  uint8x16_t o1 = vreinterpretq_u8_u32(p1.val[1]);
+
+  uint16x8_t lo = vaddq_u16(vaddl_u8(vget_low_u8(e0), vget_low_u8(o0)),
+                            vaddl_u8(vget_low_u8(e1), vget_low_u8(o1)));
+  uint16x8_t hi = vaddq_u16(vaddl_u8(vget_high_u8(e0), vget_high_u8(o0)),
+                            vaddl_u8(vget_high_u8(e1), vget_high_u8(o1)));
+  return vcombine_u8(vrshrn_n_u16(lo, 2), vrshrn_n_u16(hi, 2));
+}
+
+#endif
+
+static void box_rgba8(uint8_t *dst, const uint8_t *src, uint32_t srcWidth,
+                      uint32_t srcHeight) {
+  uint32_t dstWidth = mip_extent(srcWidth, 1);
+  uint32_t dstHeight = mip_extent(srcHeight, 1);
+  size_t srcPitch = (size_t)srcWidth * 4;
+
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    const uint8_t *row0 = src + srcPitch * (y * 2);
+    const uint8_t *row1 = src + srcPitch * clamp_index(y * 2 + 1, srcHeight);
+    uint8_t *out = dst + (size_t)dstWidth * 4 * y;
+    uint32_t x = 0;
+    // With two or more source columns no horizontal tap needs clamping.
+    if (srcWidth >= 2) {
+#if defined(MIPMAP_SSE2)
+      for (; x + 4 <= dstWidth; x += 4)
+        _mm_storeu_si128((__m128i *)(out + x * 4),
+                         box_quad_sse2(row0 + x * 8, row1 + x * 8));
+#elif defined(MIPMAP_NEON)
+      for (; x + 4 <= dstWidth; x += 4)
+        vst1q_u8(out + x * 4, box_quad_neon(row0 + x * 8, row1 + x * 8));
+#endif
+    }
+    box_row_scalar(out, row0, row1, srcWidth, x, dstWidth);
+  }
+}
+
+// Separable float filtering. Each pixel is one 4-lane vector.
+
+#if defined(MIPMAP_SSE2)
+typedef __m128 F32x4;
+#define f32x4_zero() _mm_setzero_ps()
+#define f32x4_load(p) _mm_loadu_ps(p)
+#define f32x4_store(p, v) _mm_storeu_ps(p, v)
+#define f32x4_madd(acc, v, w) _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w)))
+#elif defined(MIPMAP_NEON)
+typedef float32x4_t F32x4;
+#define f32x4_zero() vdupq_n_f32(0.0f)
+#define f32x4_load(p) vld1q_f32(p)
+#define f32x4_store(p, v) vst1q_f32(p, v)
+#define f32x4_madd(acc, v, w) vmlaq_n_f32(acc, v, w)
+#else
+typedef struct F32x4 {
+  float v[4];
+} F32x4;
+static inline F32x4 f32x4_zero(void) {
+  return (F32x4){{0.0f, 0.0f, 0.0f, 0.0f}};
+}
+static inline F32x4 f32x4_load(const float *p) {
+  return (F32x4){{p[0], p[1], p[2], p[3]}};
+}
+static inline void f32x4_store(float *p, F32x4 v) {
+  memcpy(p, v.v, sizeof(v.v));
+}
+static inline F32x4 f32x4_madd(F32x4 acc, F32x4 v, float w) {
+  for (int i = 0; i < 4; i++)
+    acc.v[i] += v.v[i] * w;
+  return acc;
+}
+#endif
+
+typedef struct MipKernel {
+  // Offset of the first tap from 2 * x.
+  int32_t first;
+  uint32_t taps;
+  const float *weights;
+} MipKernel;
+
+static const float box_weights[2] = {0.5f, 0.5f};
+// Kaiser window (alpha 4, radius 3) over sinc(d / 2), normalized, sampled at
+// the source pixel centers around each destination pixel.
+static const float kaiser_weights[6] = {
+    -0.02099248f, 0.09450233f, 0.42649015f,
+    0.42649015f,  0.09450233f, -0.02099248f,
+};
+
+static void decode_row(float *dst, const uint8_t *src, uint32_t count,
+                       bool srgb) {
+  const float scale = 1.0f / 255.0f;
+  for (uint32_t i = 0; i < count * 4; i += 4) {
+    if (srgb) {
+      dst[i + 0] = srgb_to_linear_float[src[i + 0]];
+      dst[i + 1] = srgb_to_linear_float[src[i + 1]];
+      dst[i + 2] = srgb_to_linear_float[src[i + 2]];
+    } else {
+      dst[i + 0] = src[i + 0] * scale;
+      dst[i + 1] = src[i + 1] * scale;
+      dst[i + 2] = src[i + 2] * scale;
+    }
+    dst[i + 3] = src[i + 3] * scale;
+  }
+}
+
+static uint8_t encode_unorm(float v) {
+  if (v <= 0.0f)
+    return 0;
+  if (v >= 1.0f)
+    return 255;
+  return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+static uint8_t encode_srgb(float v) {
+  uint32_t code = 0;
+  for (uint32_t step = 128; step; step >>= 1) {
+    if (code + step < 256 && v >= linear_to_srgb_threshold[code + step])
+      code += step;
+  }
+  return (uint8_t)code;
+}
+
+static bool filter_rgba8(uint8_t *dst, const uint8_t *src, uint32_t srcWidth,
+                         uint32_t srcHeight, MipKernel kernel, bool srgb) {
+  uint32_t dstWidth = mip_extent(srcWidth, 1);
+  uint32_t dstHeight = mip_extent(srcHeight, 1);
+  size_t srcPitch = (size_t)srcWidth * 4;
+
+  float *decoded = malloc(sizeof(float) * 4 * srcWidth);
+  float *column = malloc(sizeof(float) * 4 * srcWidth);
+  if (!decoded || !column) {
+    free(decoded);
+    free(column);
+    return false;
+  }
+
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    // Vertical taps into one float row, then horizontal taps out of it.
+    for (uint32_t x = 0; x < srcWidth; x++)
+      f32x4_store(column + x * 4, f32x4_zero());
+    for (uint32_t k = 0; k < kernel.taps; k++) {
+      uint32_t sy = clamp_index((int32_t)(y * 2) + kernel.first + (int32_t)k,
+                                srcHeight);
+      decode_row(decoded, src + srcPitch * sy, srcWidth, srgb);
+      float w = kernel.weights[k];
+      for (uint32_t x = 0; x < srcWidth; x++) {
+        F32x4 acc = f32x4_load(column + x * 4);
+        f32x4_store(column + x * 4,
+                    f32x4_madd(acc, f32x4_load(decoded + x * 4), w));
+      }
+    }
+
+    uint8_t *out = dst + (size_t)dstWidth * 4 * y;
+    for (uint32_t x = 0; x < dstWidth; x++) {
+      F32x4 acc = f32x4_zero();
+      for (uint32_t k = 0; k < kernel.taps; k++) {
+        uint32_t sx = clamp_index(
+            (int32_t)(x * 2) + kernel.first + (int32_t)k, srcWidth);
+        acc = f32x4_madd(acc, f32x4_load(column + sx * 4), kernel.weights[k]);
+      }
+      float px[4];
+      f32x4_store(px, acc);
+      for (uint32_t c = 0; c < 3; c++)
+        out[x * 4 + c] = srgb ? encode_srgb(px[c]) : encode_unorm(px[c]);
+      out[x * 4 + 3] = encode_unorm(px[3]);
+    }
+  }
+
+  free(decoded);
+  free(column);
+  return true;
+}
+
+void frmwrk_mip_downsample_rgba(uint8_t *dst, const uint8_t *src,
+                                uint32_t srcWidth, uint32_t srcHeight,
+                                MipFilter filter, bool srgb) {
+  if (filter == MipFilter_Box && !srgb) {
+    box_rgba8(dst, src, srcWidth, srcHeight);
+    return;
+  }
+
+  MipKernel kernel = filter == MipFilter_Kaiser
+                         ? (MipKernel){-2, 6, kaiser_weights}
+                         : (MipKernel){0, 2, box_weights};
+  // Without scratch memory the plain box filter is still better than nothing.
+  if (!filter_rgba8(dst, src, srcWidth, srcHeight, kernel, srgb))
+    box_rgba8(dst, src, srcWidth, srcHeight);
+}
+
+void frmwrk_generate_mip_chain(uint8_t *chain, uint32_t width, uint32_t height,
+                               uint32_t levelCount, MipFilter filter,
+                               bool srgb) {
+  uint8_t *src = chain;
+  for (uint32_t level = 1; level < levelCount; level++) {
+    uint32_t w = mip_extent(width, level - 1);
+    uint32_t h = mip_extent(height, level - 1);
+    uint8_t *dst = src + (size_t)w * h * 4;
+    frmwrk_mip_downsample_rgba(dst, src, w, h, filter, srgb);
+    src = dst;
+  }
+}
+
+MipmapGenerator *frmwrk_create_mipmap_generator(WGPUDevice device,
+                                                const char *shaderPath) {
+  WGPUShaderModule shader_module =
+      frmwrk_load_shader_module(device, shaderPath);
+  if (!shader_module) {
+    printf("[mipmap] could not load %s, falling back to CPU mips\n",
+           shaderPath);
+    return NULL;
+  }
+
+  MipmapGenerator *generator = calloc(1, sizeof(MipmapGenerator));
+  if (!generator) {
+    wgpuShaderModuleDrop(shader_module);
+    return NULL;
+  }
+  generator->device = device;
+  generator->queue = wgpuDeviceGetQueue(device);
+
+  WGPUBindGroupLayoutEntry entries[] = {
+    (WGPUBindGroupLayoutEntry){
+      .binding = 0,
+      .texture = (WGPUTextureBindingLayout){
+        .sampleType = WGPUTextureSampleType_UnfilterableFloat,
+        .viewDimension = WGPUTextureViewDimension_2D
+      },
+      .visibility = WGPUShaderStage_Compute
+    },
+    (WGPUBindGroupLayoutEntry){
+      .binding = 1,
+      .storageTexture = (WGPUStorageTextureBindingLayout){
+        .access = WGPUStorageTextureAccess_WriteOnly,
+        .format = WGPUTextureFormat_RGBA8Unorm,
+        .viewDimension = WGPUTextureViewDimension_2D
+      },
+      .visibility = WGPUShaderStage_Compute
+    }
+  };
+  generator->bindGroupLayout = wgpuDeviceCreateBindGroupLayout(
+      device, &(const WGPUBindGroupLayoutDescriptor){
+                  .label = "mipmap_bind_group_layout",
+                  .entries = entries,
+                  .entryCount = 2
+              });
+
+  WGPUPipelineLayout pipeline_layout = wgpuDeviceCreatePipelineLayout(
+      device, &(const WGPUPipelineLayoutDescriptor){
+                  .label = "mipmap_pipeline_layout",
+                  .bindGroupLayouts = &generator->bindGroupLayout,
+                  .bindGroupLayoutCount = 1
+              });
+  generator->pipeline = wgpuDeviceCreateComputePipeline(
+      device, &(const WGPUComputePipelineDescriptor){
+                  .label = "mipmap_pipeline",
+                  .layout = pipeline_layout,
+                  .compute = (WGPUProgrammableStageDescriptor){
+                    .module = shader_module,
+                    .entryPoint = "cs_main"
+                  }
+              });
+  wgpuPipelineLayoutDrop(pipeline_layout);
+  wgpuShaderModuleDrop(shader_module);
+
+  if (!generator->bindGroupLayout || !generator->pipeline) {
+    frmwrk_drop_mipmap_generator(generator);
+    return NULL;
+  }
+  return generator;
+}
+
+void frmwrk_drop_mipmap_generator(MipmapGenerator *generator) {
+  if (!generator)
+    return;
+  if (generator->pipeline)
+    wgpuComputePipelineDrop(generator->pipeline);
+  if (generator->bindGroupLayout)
+    wgpuBindGroupLayoutDrop(generator->bindGroupLayout);
+  if (generator->queue)
+    wgpuQueueDrop(generator->queue);
+  free(generator->pending);
+  free(generator);
+}
+
+bool frmwrk_mipmap_generator_supports(WGPUTextureFormat format) {
+  return format == WGPUTextureFormat_RGBA8Unorm;
+}
+
+bool frmwrk_mipmap_generator_queue(MipmapGenerator *generator,
+                                   const Texture2D *texture) {
+  if (texture->mipLevelCount <= 1)
+    return true;
+  if (!frmwrk_mipmap_generator_supports(texture->format))
+    return false;
+
+  if (generator->pendingCount == generator->pendingCapacity) {
+    uint32_t capacity =
+        generator->pendingCapacity ? generator->pendingCapacity * 2 : 16;
+    PendingMipmap *pending =
+        realloc(generator->pending, sizeof(PendingMipmap) * capacity);
+    if (!pending)
+      return false;
+    generator->pending = pending;
+    generator->pendingCapacity = capacity;
+  }
+  generator->pending[generator->pendingCount++] = (PendingMipmap){
+    .texture = texture->texture,
+    .width = texture->w,
+    .height = texture->h,
+    .levelCount = texture->mipLevelCount
+  };
+  return true;
+}
+
+static WGPUTextureView create_level_view(WGPUTexture texture, uint32_t level) {
+  return wgpuTextureCreateView(
+      texture, &(const WGPUTextureViewDescriptor){
+                   .label = "mipmap_level_view",
+                   .format = WGPUTextureFormat_RGBA8Unorm,
+                   .dimension = WGPUTextureViewDimension_2D,
+                   .aspect = WGPUTextureAspect_All,
+                   .baseMipLevel = level,
+                   .mipLevelCount = 1,
+                   .baseArrayLayer = 0,
+                   .arrayLayerCount = 1
+               });
+}
+
+void frmwrk_mipmap_generator_record(MipmapGenerator *generator,
+                                    WGPUCommandEncoder encoder) {
+  for (uint32_t i = 0; i < generator->pendingCount; i++) {
+    const PendingMipmap *pending = &generator->pending[i];
+
+    // The pass refers to its views and bind groups until it ends, so they are
+    // dropped afterwards. A 32-bit extent has at most 32 levels.
+    WGPUTextureView views[32];
+    WGPUBindGroup bind_groups[32];
+    views[0] = create_level_view(pending->texture, 0);
+
+    WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(
+        encoder, &(const WGPUComputePassDescriptor){
+                     .label = "mipmap_pass",
+                 });
+    wgpuComputePassEncoderSetPipeline(pass, generator->pipeline);
+    for (uint32_t level = 1; level < pending->levelCount; level++) {
+      views[level] = create_level_view(pending->texture, level);
+      bind_groups[level] = wgpuDeviceCreateBindGroup(
+          generator->device,
+          &(const WGPUBindGroupDescriptor){
+              .label = "mipmap_bind_group",
+              .layout = generator->bindGroupLayout,
+              .entries = (const WGPUBindGroupEntry[]){
+                  (const WGPUBindGroupEntry){
+                      .binding = 0, .textureView = views[level - 1]},
+                  (const WGPUBindGroupEntry){
+                      .binding = 1, .textureView = views[level]},
+              },
+              .entryCount = 2
+          });
+
+      // Each dispatch is its own usage scope, so a level is complete before
+      // the next dispatch reads it.
+      wgpuComputePassEncoderSetBindGroup(pass, 0, bind_groups[level], 0, NULL);
+      wgpuComputePassEncoderDispatchWorkgroups(
+          pass, (mip_extent(pending->width, level) + 7) / 8,
+          (mip_extent(pending->height, level) + 7) / 8, 1);
+    }
+    wgpuComputePassEncoderEnd(pass);
+    // wgpuComputePassEncoderEnd() drops pass
+
+    for (uint32_t level = 1; level < pending->levelCount; level++) {
+      wgpuBindGroupDrop(bind_groups[level]);
+      wgpuTextureViewDrop(views[level]);
+    }
+    wgpuTextureViewDrop(views[0]);
+  }
+  generator->pendingCount = 0;
+}
+
+void frmwrk_mipmap_generator_flush(MipmapGenerator *generator) {
+  if (generator->pendingCount == 0)
+    return;
+
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
+      generator->device, &(const WGPUCommandEncoderDescriptor){
+                             .label = "mipmap_encoder",
+                         });
+  frmwrk_mipmap_generator_record(generator, encoder);
+  WGPUCommandBuffer command_buffer = wgpuCommandEncoderFinish(
+      encoder, &(const WGPUCommandBufferDescriptor){
+                   .label = "mipmap_command_buffer",
+               });
+  wgpuQueueSubmit(generator->queue, 1, &command_buffer);
+}
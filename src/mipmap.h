@@ -0,0 +1,69 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include "framework.h"
+
+typedef enum MipFilter {
+  // 2x2 average; integer SIMD fast path for linear formats.
+  MipFilter_Box,
+  // 6-tap Kaiser-windowed sinc, sharper than box at the cost of more taps.
+  MipFilter_Kaiser,
+} MipFilter;
+
+// Levels in a full chain down to 1x1.
+uint32_t frmwrk_mip_level_count(uint32_t width, uint32_t height);
+// Bytes needed for `levelCount` tightly packed RGBA8 levels, level 0 first.
+size_t frmwrk_mip_chain_size(uint32_t width, uint32_t height,
+                             uint32_t levelCount);
+
+// Halves one tightly packed RGBA8 image (each side rounded down, never below
+// 1). With `srgb` the color channels are filtered in linear space.
+void frmwrk_mip_downsample_rgba(uint8_t *dst, const uint8_t *src,
+                                uint32_t srcWidth, uint32_t srcHeight,
+                                MipFilter filter, bool srgb);
+// Fills levels 1..levelCount-1 of a chain laid out as by frmwrk_mip_chain_size;
+// level 0 must already be in place at the start of `chain`.
+void frmwrk_generate_mip_chain(uint8_t *chain, uint32_t width, uint32_t height,
+                               uint32_t levelCount, MipFilter filter,
+                               bool srgb);
+
+typedef struct PendingMipmap {
+  WGPUTexture texture;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levelCount;
+} PendingMipmap;
+
+// Queues textures whose level 0 has been uploaded and records compute passes
+// that box-filter the rest of the chain on the GPU.
+struct MipmapGenerator {
+  WGPUDevice device;
+  WGPUQueue queue;
+  WGPUComputePipeline pipeline;
+  WGPUBindGroupLayout bindGroupLayout;
+
+  PendingMipmap *pending;
+  uint32_t pendingCount;
+  uint32_t pendingCapacity;
+};
+
+// Returns NULL if `shaderPath` fails to load; callers then use the CPU path.
+MipmapGenerator *frmwrk_create_mipmap_generator(WGPUDevice device,
+                                                const char *shaderPath);
+void frmwrk_drop_mipmap_generator(MipmapGenerator *generator);
+
+// Storage writes need a storage-capable, non-sRGB format; others must use the
+// CPU path.
+bool frmwrk_mipmap_generator_supports(WGPUTextureFormat format);
+// `texture` must stay alive until the generator has recorded it.
+bool frmwrk_mipmap_generator_queue(MipmapGenerator *generator,
+                                   const Texture2D *texture);
+// Records every queued chain into `encoder`. Call after
+// frmwrk_upload_ring_record so level 0 is copied before it is read.
+void frmwrk_mipmap_generator_record(MipmapGenerator *generator,
+                                    WGPUCommandEncoder encoder);
+// Records and submits the queued chains on their own, for textures created
+// outside the frame loop.
+void frmwrk_mipmap_generator_flush(MipmapGenerator *generator);
+
+#endif // MIPMAP_H
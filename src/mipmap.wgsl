@@ -0,0 +1,23 @@
+// Writes one mip level from the level above it with a 2x2 box filter. Odd
+// source sizes clamp the second tap, matching the CPU path.
+
+@group(0) @binding(0) var src: texture_2d<f32>;
+@group(0) @binding(1) var dst: texture_storage_2d<rgba8unorm, write>;
+
+@compute @workgroup_size(8, 8)
+fn cs_main(@builtin(global_invocation_id) id: vec3<u32>) {
+    let dst_size = vec2<u32>(textureDimensions(dst));
+    if (id.x >= dst_size.x || id.y >= dst_size.y) {
+        return;
+    }
+
+    let src_max = vec2<i32>(textureDimensions(src, 0)) - vec2<i32>(1, 1);
+    let p0 = vec2<i32>(id.xy) * 2;
+    let p1 = min(p0 + vec2<i32>(1, 1), src_max);
+
+    let sum = textureLoad(src, p0, 0) +
+              textureLoad(src, vec2<i32>(p1.x, p0.y), 0) +
+              textureLoad(src, vec2<i32>(p0.x, p1.y), 0) +
+              textureLoad(src, p1, 0);
+    textureStore(dst, vec2<i32>(id.xy), sum * 0.25);
+}
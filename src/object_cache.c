@@ -0,0 +1,528 @@
+#include "object_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *type_names[ObjectCacheType_Count] = {
+  "samplers",
+  "bindGroupLayouts",
+  "pipelineLayouts",
+  "bindGroups",
+  "renderPipelines",
+  "computePipelines",
+};
+
+// Serializes descriptors into the cache's scratch buffer. Values are written
+// one field at a time so padding never reaches the key.
+typedef struct KeyWriter {
+  ObjectCache *cache;
+  size_t size;
+  // A chained extension we cannot canonicalize; the object is not shared.
+  bool chained;
+  bool failed;
+} KeyWriter;
+
+static void put(KeyWriter *writer, const void *data, size_t size) {
+  ObjectCache *cache = writer->cache;
+  if (writer->failed)
+    return;
+  if (writer->size + size > cache->scratchCapacity) {
+    size_t capacity = cache->scratchCapacity ? cache->scratchCapacity * 2 : 256;
+    while (capacity < writer->size + size)
+      capacity *= 2;
+    unsigned char *scratch = realloc(cache->scratch, capacity);
+    if (!scratch) {
+      writer->failed = true;
+      return;
+    }
+    cache->scratch = scratch;
+    cache->scratchCapacity = capacity;
+  }
+  memcpy(cache->scratch + writer->size, data, size);
+  writer->size += size;
+}
+
+static void put_u32(KeyWriter *writer, uint32_t value) {
+  put(writer, &value, sizeof(value));
+}
+
+static void put_u64(KeyWriter *writer, uint64_t value) {
+  put(writer, &value, sizeof(value));
+}
+
+static void put_f32(KeyWriter *writer, float value) {
+  put(writer, &value, sizeof(value));
+}
+
+static void put_f64(KeyWriter *writer, double value) {
+  put(writer, &value, sizeof(value));
+}
+
+static void put_handle(KeyWriter *writer, const void *handle) {
+  put_u64(writer, (uint64_t)(uintptr_t)handle);
+}
+
+static void put_string(KeyWriter *writer, const char *string) {
+  if (!string) {
+    put_u32(writer, UINT32_MAX);
+    return;
+  }
+  uint32_t length = (uint32_t)strlen(string);
+  put_u32(writer, length);
+  put(writer, string, length);
+}
+
+static void put_chain(KeyWriter *writer, const WGPUChainedStruct *chain) {
+  if (chain)
+    writer->chained = true;
+}
+
+static void put_stage(KeyWriter *writer, WGPUShaderModule module,
+                      const char *entryPoint, uint32_t constantCount,
+                      const WGPUConstantEntry *constants) {
+  put_handle(writer, module);
+  put_string(writer, entryPoint);
+  put_u32(writer, constantCount);
+  for (uint32_t i = 0; i < constantCount; i++) {
+    put_chain(writer, constants[i].nextInChain);
+    put_string(writer, constants[i].key);
+    put_f64(writer, constants[i].value);
+  }
+}
+
+static void put_blend_component(KeyWriter *writer,
+                                const WGPUBlendComponent *component) {
+  put_u32(writer, component->operation);
+  put_u32(writer, component->srcFactor);
+  put_u32(writer, component->dstFactor);
+}
+
+static void put_stencil_face(KeyWriter *writer,
+                             const WGPUStencilFaceState *face) {
+  put_u32(writer, face->compare);
+  put_u32(writer, face->failOp);
+  put_u32(writer, face->depthFailOp);
+  put_u32(writer, face->passOp);
+}
+
+static void *create_object(WGPUDevice device, ObjectCacheType type,
+                           const void *descriptor) {
+  switch (type) {
+  case ObjectCacheType_Sampler:
+    return wgpuDeviceCreateSampler(device, descriptor);
+  case ObjectCacheType_BindGroupLayout:
+    return wgpuDeviceCreateBindGroupLayout(device, descriptor);
+  case ObjectCacheType_PipelineLayout:
+    return wgpuDeviceCreatePipelineLayout(device, descriptor);
+  case ObjectCacheType_BindGroup:
+    return wgpuDeviceCreateBindGroup(device, descriptor);
+  case ObjectCacheType_RenderPipeline:
+    return wgpuDeviceCreateRenderPipeline(device, descriptor);
+  case ObjectCacheType_ComputePipeline:
+    return wgpuDeviceCreateComputePipeline(device, descriptor);
+  default:
+    return NULL;
+  }
+}
+
+static void drop_object(ObjectCacheType type, void *object) {
+  switch (type) {
+  case ObjectCacheType_Sampler:
+    wgpuSamplerDrop(object);
+    break;
+  case ObjectCacheType_BindGroupLayout:
+    wgpuBindGroupLayoutDrop(object);
+    break;
+  case ObjectCacheType_PipelineLayout:
+    wgpuPipelineLayoutDrop(object);
+    break;
+  case ObjectCacheType_BindGroup:
+    wgpuBindGroupDrop(object);
+    break;
+  case ObjectCacheType_RenderPipeline:
+    wgpuRenderPipelineDrop(object);
+    break;
+  case ObjectCacheType_ComputePipeline:
+    wgpuComputePipelineDrop(object);
+    break;
+  default:
+    break;
+  }
+}
+
+static uint64_t hash_handle(const void *object) {
+  return frmwrk_hash_bytes(&object, sizeof(object), FRMWRK_HASH_SEED);
+}
+
+static void index_entry(ObjectCache *cache, uint32_t index) {
+  uint32_t mask = cache->bucketCount - 1;
+  const ObjectCacheEntry *entry = &cache->entries[index];
+  if (entry->key) {
+    uint32_t bucket = (uint32_t)entry->hash & mask;
+    while (cache->keyBuckets[bucket])
+      bucket = (bucket + 1) & mask;
+    cache->keyBuckets[bucket] = index + 1;
+  }
+  uint32_t bucket = (uint32_t)hash_handle(entry->object) & mask;
+  while (cache->objectBuckets[bucket])
+    bucket = (bucket + 1) & mask;
+  cache->objectBuckets[bucket] = index + 1;
+}
+
+// Rebuilds both tables with at least `bucketCount` buckets.
+static bool reindex(ObjectCache *cache, uint32_t bucketCount) {
+  uint32_t *key_buckets = calloc(bucketCount, sizeof(uint32_t));
+  uint32_t *object_buckets = calloc(bucketCount, sizeof(uint32_t));
+  if (!key_buckets || !object_buckets) {
+    free(key_buckets);
+    free(object_buckets);
+    return false;
+  }
+  free(cache->keyBuckets);
+  free(cache->objectBuckets);
+  cache->keyBuckets = key_buckets;
+  cache->objectBuckets = object_buckets;
+  cache->bucketCount = bucketCount;
+  for (uint32_t i = 0; i < cache->entryCount; i++)
+    index_entry(cache, i);
+  return true;
+}
+
+static ObjectCacheEntry *find_key(const ObjectCache *cache, uint64_t hash,
+                                  size_t size) {
+  if (cache->bucketCount == 0)
+    return NULL;
+  uint32_t mask = cache->bucketCount - 1;
+  for (uint32_t bucket = (uint32_t)hash & mask;; bucket = (bucket + 1) & mask) {
+    uint32_t index = cache->keyBuckets[bucket];
+    if (index == 0)
+      return NULL;
+    ObjectCacheEntry *entry = &cache->entries[index - 1];
+    if (entry->hash == hash && entry->keySize == size &&
+        memcmp(entry->key, cache->scratch, size) == 0)
+      return entry;
+  }
+}
+
+static ObjectCacheEntry *find_object(const ObjectCache *cache,
+                                     const void *object) {
+  if (cache->bucketCount == 0)
+    return NULL;
+  uint32_t mask = cache->bucketCount - 1;
+  for (uint32_t bucket = (uint32_t)hash_handle(object) & mask;;
+       bucket = (bucket + 1) & mask) {
+    uint32_t index = cache->objectBuckets[bucket];
+    if (index == 0)
+      return NULL;
+    if (cache->entries[index - 1].object == object)
+      return &cache->entries[index - 1];
+  }
+}
+
+static bool insert(ObjectCache *cache, const ObjectCacheEntry *entry) {
+  if (cache->entryCount == cache->entryCapacity) {
+    uint32_t capacity = cache->entryCapacity ? cache->entryCapacity * 2 : 32;
+    ObjectCacheEntry *entries =
+        realloc(cache->entries, sizeof(ObjectCacheEntry) * capacity);
+    if (!entries)
+      return false;
+    cache->entries = entries;
+    cache->entryCapacity = capacity;
+  }
+  // Keep the tables at most half full so probes stay short.
+  if ((cache->entryCount + 1) * 2 > cache->bucketCount) {
+    uint32_t bucket_count = cache->bucketCount ? cache->bucketCount * 2 : 64;
+    if (!reindex(cache, bucket_count))
+      return false;
+  }
+  cache->entries[cache->entryCount] = *entry;
+  index_entry(cache, cache->entryCount);
+  cache->entryCount++;
+  cache->stats.live[entry->type]++;
+  return true;
+}
+
+static void *acquire(ObjectCache *cache, ObjectCacheType type,
+                     const KeyWriter *writer, const void *descriptor) {
+  bool shared = !writer->chained && !writer->failed;
+  uint64_t hash = 0;
+  if (shared) {
+    hash = frmwrk_hash_bytes(cache->scratch, writer->size, FRMWRK_HASH_SEED);
+    ObjectCacheEntry *entry = find_key(cache, hash, writer->size);
+    if (entry) {
+      entry->refCount++;
+      cache->stats.hits[type]++;
+      return entry->object;
+    }
+  }
+
+  cache->stats.misses[type]++;
+  void *object = create_object(cache->device, type, descriptor);
+  if (!object)
+    return NULL;
+
+  // Without a key copy the object still works, it just is not shared.
+  unsigned char *key = shared ? malloc(writer->size) : NULL;
+  if (key)
+    memcpy(key, cache->scratch, writer->size);
+  ObjectCacheEntry entry = {
+    .type = type,
+    .hash = hash,
+    .key = key,
+    .keySize = key ? (uint32_t)writer->size : 0,
+    .object = object,
+    .refCount = 1
+  };
+  if (!insert(cache, &entry)) {
+    drop_object(type, object);
+    free(key);
+    return NULL;
+  }
+  return object;
+}
+
+static KeyWriter begin_key(ObjectCache *cache, ObjectCacheType type,
+                           const WGPUChainedStruct *chain) {
+  KeyWriter writer = {.cache = cache};
+  put_u32(&writer, type);
+  put_chain(&writer, chain);
+  return writer;
+}
+
+ObjectCache *frmwrk_create_object_cache(WGPUDevice device) {
+  ObjectCache *cache = calloc(1, sizeof(ObjectCache));
+  if (!cache)
+    return NULL;
+  cache->device = device;
+  return cache;
+}
+
+void frmwrk_drop_object_cache(ObjectCache *cache) {
+  if (!cache)
+    return;
+  // Dependents were created after what they reference, so go newest first.
+  for (uint32_t i = cache->entryCount; i-- > 0;) {
+    drop_object(cache->entries[i].type, cache->entries[i].object);
+    free(cache->entries[i].key);
+  }
+  free(cache->entries);
+  free(cache->keyBuckets);
+  free(cache->objectBuckets);
+  free(cache->scratch);
+  free(cache);
+}
+
+WGPUSampler frmwrk_object_cache_sampler(ObjectCache *cache,
+                                        const WGPUSamplerDescriptor *descriptor) {
+  KeyWriter writer =
+      begin_key(cache, ObjectCacheType_Sampler, descriptor->nextInChain);
+  put_u32(&writer, descriptor->addressModeU);
+  put_u32(&writer, descriptor->addressModeV);
+  put_u32(&writer, descriptor->addressModeW);
+  put_u32(&writer, descriptor->magFilter);
+  put_u32(&writer, descriptor->minFilter);
+  put_u32(&writer, descriptor->mipmapFilter);
+  put_f32(&writer, descriptor->lodMinClamp);
+  put_f32(&writer, descriptor->lodMaxClamp);
+  put_u32(&writer, descriptor->compare);
+  put_u32(&writer, descriptor->maxAnisotropy);
+  return acquire(cache, ObjectCacheType_Sampler, &writer, descriptor);
+}
+
+WGPUBindGroupLayout frmwrk_object_cache_bind_group_layout(
+    ObjectCache *cache, const WGPUBindGroupLayoutDescriptor *descriptor) {
+  KeyWriter writer = begin_key(cache, ObjectCacheType_BindGroupLayout,
+                               descriptor->nextInChain);
+  put_u32(&writer, descriptor->entryCount);
+  for (uint32_t i = 0; i < descriptor->entryCount; i++) {
+    const WGPUBindGroupLayoutEntry *entry = &descriptor->entries[i];
+    put_chain(&writer, entry->nextInChain);
+    put_u32(&writer, entry->binding);
+    put_u32(&writer, entry->visibility);
+    put_chain(&writer, entry->buffer.nextInChain);
+    put_u32(&writer, entry->buffer.type);
+    put_u32(&writer, entry->buffer.hasDynamicOffset);
+    put_u64(&writer, entry->buffer.minBindingSize);
+    put_chain(&writer, entry->sampler.nextInChain);
+    put_u32(&writer, entry->sampler.type);
+    put_chain(&writer, entry->texture.nextInChain);
+    put_u32(&writer, entry->texture.sampleType);
+    put_u32(&writer, entry->texture.viewDimension);
+    put_u32(&writer, entry->texture.multisampled);
+    put_chain(&writer, entry->storageTexture.nextInChain);
+    put_u32(&writer, entry->storageTexture.access);
+    put_u32(&writer, entry->storageTexture.format);
+    put_u32(&writer, entry->storageTexture.viewDimension);
+    put_u32(&writer, entry->count);
+  }
+  return acquire(cache, ObjectCacheType_BindGroupLayout, &writer, descriptor);
+}
+
+WGPUPipelineLayout frmwrk_object_cache_pipeline_layout(
+    ObjectCache *cache, const WGPUPipelineLayoutDescriptor *descriptor) {
+  KeyWriter writer = begin_key(cache, ObjectCacheType_PipelineLayout,
+                               descriptor->nextInChain);
+  put_u32(&writer, descriptor->bindGroupLayoutCount);
+  for (uint32_t i = 0; i < descriptor->bindGroupLayoutCount; i++)
+    put_handle(&writer, descriptor->bindGroupLayouts[i]);
+  return acquire(cache, ObjectCacheType_PipelineLayout, &writer, descriptor);
+}
+
+WGPUBindGroup frmwrk_object_cache_bind_group(
+    ObjectCache *cache, const WGPUBindGroupDescriptor *descriptor) {
+  KeyWriter writer =
+      begin_key(cache, ObjectCacheType_BindGroup, descriptor->nextInChain);
+  put_handle(&writer, descriptor->layout);
+  put_u32(&writer, descriptor->entryCount);
+  for (uint32_t i = 0; i < descriptor->entryCount; i++) {
+    const WGPUBindGroupEntry *entry = &descriptor->entries[i];
+    put_chain(&writer, entry->nextInChain);
+    put_u32(&writer, entry->binding);
+    put_handle(&writer, entry->buffer);
+    put_u64(&writer, entry->offset);
+    put_u64(&writer, entry->size);
+    put_handle(&writer, entry->sampler);
+    put_handle(&writer, entry->textureView);
+    put_u32(&writer, entry->textureViewArrayLength);
+    for (uint32_t j = 0; j < entry->textureViewArrayLength; j++)
+      put_handle(&writer, entry->textureViewArray[j]);
+  }
+  return acquire(cache, ObjectCacheType_BindGroup, &writer, descriptor);
+}
+
+WGPURenderPipeline frmwrk_object_cache_render_pipeline(
+    ObjectCache *cache, const WGPURenderPipelineDescriptor *descriptor) {
+  KeyWriter writer = begin_key(cache, ObjectCacheType_RenderPipeline,
+                               descriptor->nextInChain);
+  put_handle(&writer, descriptor->layout);
+
+  const WGPUVertexState *vertex = &descriptor->vertex;
+  put_chain(&writer, vertex->nextInChain);
+  put_stage(&writer, vertex->module, vertex->entryPoint, vertex->constantCount,
+            vertex->constants);
+  put_u32(&writer, vertex->bufferCount);
+  for (uint32_t i = 0; i < vertex->bufferCount; i++) {
+    const WGPUVertexBufferLayout *buffer = &vertex->buffers[i];
+    put_u64(&writer, buffer->arrayStride);
+    put_u32(&writer, buffer->stepMode);
+    put_u32(&writer, buffer->attributeCount);
+    for (uint32_t j = 0; j < buffer->attributeCount; j++) {
+      put_u32(&writer, buffer->attributes[j].format);
+      put_u64(&writer, buffer->attributes[j].offset);
+      put_u32(&writer, buffer->attributes[j].shaderLocation);
+    }
+  }
+
+  const WGPUPrimitiveState *primitive = &descriptor->primitive;
+  put_chain(&writer, primitive->nextInChain);
+  put_u32(&writer, primitive->topology);
+  put_u32(&writer, primitive->stripIndexFormat);
+  put_u32(&writer, primitive->frontFace);
+  put_u32(&writer, primitive->cullMode);
+
+  const WGPUDepthStencilState *depth_stencil = descriptor->depthStencil;
+  put_u32(&writer, depth_stencil != NULL);
+  if (depth_stencil) {
+    put_chain(&writer, depth_stencil->nextInChain);
+    put_u32(&writer, depth_stencil->format);
+    put_u32(&writer, depth_stencil->depthWriteEnabled);
+    put_u32(&writer, depth_stencil->depthCompare);
+    put_stencil_face(&writer, &depth_stencil->stencilFront);
+    put_stencil_face(&writer, &depth_stencil->stencilBack);
+    put_u32(&writer, depth_stencil->stencilReadMask);
+    put_u32(&writer, depth_stencil->stencilWriteMask);
+    put_u32(&writer, (uint32_t)depth_stencil->depthBias);
+    put_f32(&writer, depth_stencil->depthBiasSlopeScale);
+    put_f32(&writer, depth_stencil->depthBiasClamp);
+  }
+
+  const WGPUMultisampleState *multisample = &descriptor->multisample;
+  put_chain(&writer, multisample->nextInChain);
+  put_u32(&writer, multisample->count);
+  put_u32(&writer, multisample->mask);
+  put_u32(&writer, multisample->alphaToCoverageEnabled);
+
+  const WGPUFragmentState *fragment = descriptor->fragment;
+  put_u32(&writer, fragment != NULL);
+  if (fragment) {
+    put_chain(&writer, fragment->nextInChain);
+    put_stage(&writer, fragment->module, fragment->entryPoint,
+              fragment->constantCount, fragment->constants);
+    put_u32(&writer, fragment->targetCount);
+    for (uint32_t i = 0; i < fragment->targetCount; i++) {
+      const WGPUColorTargetState *target = &fragment->targets[i];
+      put_chain(&writer, target->nextInChain);
+      put_u32(&writer, target->format);
+      put_u32(&writer, target->blend != NULL);
+      if (target->blend) {
+        put_blend_component(&writer, &target->blend->color);
+        put_blend_component(&writer, &target->blend->alpha);
+      }
+      put_u32(&writer, target->writeMask);
+    }
+  }
+  return acquire(cache, ObjectCacheType_RenderPipeline, &writer, descriptor);
+}
+
+WGPUComputePipeline frmwrk_object_cache_compute_pipeline(
+    ObjectCache *cache, const WGPUComputePipelineDescriptor *descriptor) {
+  KeyWriter writer = begin_key(cache, ObjectCacheType_ComputePipeline,
+                               descriptor->nextInChain);
+  put_handle(&writer, descriptor->layout);
+  const WGPUProgrammableStageDescriptor *compute = &descriptor->compute;
+  put_chain(&writer, compute->nextInChain);
+  put_stage(&writer, compute->module, compute->entryPoint,
+            compute->constantCount, compute->constants);
+  return acquire(cache, ObjectCacheType_ComputePipeline, &writer, descriptor);
+}
+
+void frmwrk_object_cache_release(ObjectCache *cache, const void *object) {
+  if (!object)
+    return;
+  ObjectCacheEntry *entry = find_object(cache, object);
+  if (entry && entry->refCount > 0)
+    entry->refCount--;
+}
+
+uint32_t frmwrk_object_cache_trim(ObjectCache *cache) {
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < cache->entryCount; i++) {
+    ObjectCacheEntry *entry = &cache->entries[i];
+    if (entry->refCount > 0) {
+      cache->entries[kept++] = *entry;
+      continue;
+    }
+    drop_object(entry->type, entry->object);
+    free(entry->key);
+    cache->stats.live[entry->type]--;
+  }
+  uint32_t trimmed = cache->entryCount - kept;
+  if (trimmed == 0)
+    return 0;
+  cache->entryCount = kept;
+  cache->stats.trimmed += trimmed;
+  // Shrinking never needs more buckets, so rebuilding in place cannot fail.
+  memset(cache->keyBuckets, 0, sizeof(uint32_t) * cache->bucketCount);
+  memset(cache->objectBuckets, 0, sizeof(uint32_t) * cache->bucketCount);
+  for (uint32_t i = 0; i < cache->entryCount; i++)
+    index_entry(cache, i);
+  return trimmed;
+}
+
+void frmwrk_object_cache_print(const ObjectCache *cache) {
+  const ObjectCacheStats *stats = &cache->stats;
+  uint64_t hits = 0, misses = 0;
+  for (int type = 0; type < ObjectCacheType_Count; type++) {
+    if (stats->hits[type] == 0 && stats->misses[type] == 0)
+      continue;
+    printf("[object_cache] %-16s hits=%llu misses=%llu live=%u\n",
+           type_names[type], (unsigned long long)stats->hits[type],
+           (unsigned long long)stats->misses[type], stats->live[type]);
+    hits += stats->hits[type];
+    misses += stats->misses[type];
+  }
+  printf("[object_cache] hit rate %.1f%% (%llu/%llu), trimmed=%llu\n",
+         hits + misses ? 100.0 * hits / (hits + misses) : 0.0,
+         (unsigned long long)hits, (unsigned long long)(hits + misses),
+         (unsigned long long)stats->trimmed);
+}
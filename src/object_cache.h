@@ -0,0 +1,88 @@
+#ifndef OBJECT_CACHE_H
+#define OBJECT_CACHE_H
+
+#include "framework.h"
+
+typedef enum ObjectCacheType {
+  ObjectCacheType_Sampler,
+  ObjectCacheType_BindGroupLayout,
+  ObjectCacheType_PipelineLayout,
+  ObjectCacheType_BindGroup,
+  ObjectCacheType_RenderPipeline,
+  ObjectCacheType_ComputePipeline,
+  ObjectCacheType_Count
+} ObjectCacheType;
+
+typedef struct ObjectCacheEntry {
+  ObjectCacheType type;
+  // Canonical serialization of the descriptor and its hash. Entries built from
+  // descriptors with chained extensions have no key and are never shared.
+  uint64_t hash;
+  unsigned char *key;
+  uint32_t keySize;
+  void *object;
+  uint32_t refCount;
+} ObjectCacheEntry;
+
+typedef struct ObjectCacheStats {
+  uint64_t hits[ObjectCacheType_Count];
+  uint64_t misses[ObjectCacheType_Count];
+  uint32_t live[ObjectCacheType_Count];
+  uint64_t trimmed;
+} ObjectCacheStats;
+
+// Shares samplers, layouts, bind groups and pipelines between identical
+// descriptors. Each descriptor is serialized field by field into a canonical
+// key (labels are skipped, strings compared by content, objects it references
+// by handle) that indexes an open-addressing table, so a hit costs one
+// serialization and no allocation.
+//
+// Because referenced objects are keyed by handle, release everything built
+// from an object and trim before dropping it, or a new object reusing the
+// handle could match stale entries.
+typedef struct ObjectCache {
+  WGPUDevice device;
+
+  ObjectCacheEntry *entries;
+  uint32_t entryCount;
+  uint32_t entryCapacity;
+  // Power-of-two tables of entry index + 1 (0 is empty), probed linearly. One
+  // is keyed by descriptor hash, the other by object handle for releases.
+  uint32_t *keyBuckets;
+  uint32_t *objectBuckets;
+  uint32_t bucketCount;
+
+  // Serialization scratch, reused across lookups.
+  unsigned char *scratch;
+  size_t scratchCapacity;
+
+  ObjectCacheStats stats;
+} ObjectCache;
+
+ObjectCache *frmwrk_create_object_cache(WGPUDevice device);
+// Drops every cached object whether or not it is still referenced.
+void frmwrk_drop_object_cache(ObjectCache *cache);
+
+// Each returns a shared object with its reference count bumped, creating it on
+// a miss. Pair every successful call with frmwrk_object_cache_release.
+WGPUSampler frmwrk_object_cache_sampler(ObjectCache *cache,
+                                        const WGPUSamplerDescriptor *descriptor);
+WGPUBindGroupLayout frmwrk_object_cache_bind_group_layout(
+    ObjectCache *cache, const WGPUBindGroupLayoutDescriptor *descriptor);
+WGPUPipelineLayout frmwrk_object_cache_pipeline_layout(
+    ObjectCache *cache, const WGPUPipelineLayoutDescriptor *descriptor);
+WGPUBindGroup frmwrk_object_cache_bind_group(
+    ObjectCache *cache, const WGPUBindGroupDescriptor *descriptor);
+WGPURenderPipeline frmwrk_object_cache_render_pipeline(
+    ObjectCache *cache, const WGPURenderPipelineDescriptor *descriptor);
+WGPUComputePipeline frmwrk_object_cache_compute_pipeline(
+    ObjectCache *cache, const WGPUComputePipelineDescriptor *descriptor);
+
+// Drops a reference. Unreferenced objects stay cached for the next identical
+// request until frmwrk_object_cache_trim. NULL is ignored.
+void frmwrk_object_cache_release(ObjectCache *cache, const void *object);
+// Drops every unreferenced object and returns how many went.
+uint32_t frmwrk_object_cache_trim(ObjectCache *cache);
+void frmwrk_object_cache_print(const ObjectCache *cache);
+
+#endif // OBJECT_CACHE_H
@@ -0,0 +1,514 @@
+#include "pixel_convert.h"
+#include <string.h>
+
+// Kernels are dispatched at runtime: AVX2 when the CPU has it, otherwise SSE2
+// (the x86-64 baseline) or NEON on ARM, with scalar loops for the tails and
+// for other targets. sRGB conversion is a byte lookup on every target since
+// a 256-entry table beats gathering from it.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define CONVERT_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define CONVERT_AVX2 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#define CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(CONVERT_AVX2)
+static bool has_avx2(void) {
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+const char *frmwrk_convert_isa(void) {
+#if defined(CONVERT_AVX2)
+  if (has_avx2())
+    return "avx2";
+#endif
+#if defined(CONVERT_SSE2)
+  return "sse2";
+#elif defined(CONVERT_NEON)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
+
+static const uint8_t srgb_to_linear_lut[256] = {
+    0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,   1,   1,   1,   1,   1,
+    1,   1,   2,   2,   2,   2,   2,   2,   2,   2,   3,   3,   3,   3,   3,   3,
+    4,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,   6,   7,   7,   7,
+    8,   8,   8,   8,   9,   9,   9,  10,  10,  10,  11,  11,  12,  12,  12,  13,
+   13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  17,  18,  18,  19,  19,  20,
+   20,  21,  22,  22,  23,  23,  24,  24,  25,  25,  26,  27,  27,  28,  29,  29,
+   30,  30,  31,  32,  32,  33,  34,  35,  35,  36,  37,  37,  38,  39,  40,  41,
+   41,  42,  43,  44,  45,  45,  46,  47,  48,  49,  50,  51,  51,  52,  53,  54,
+   55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,
+   71,  72,  73,  74,  76,  77,  78,  79,  80,  81,  82,  84,  85,  86,  87,  88,
+   90,  91,  92,  93,  95,  96,  97,  99, 100, 101, 103, 104, 105, 107, 108, 109,
+  111, 112, 114, 115, 116, 118, 119, 121, 122, 124, 125, 127, 128, 130, 131, 133,
+  134, 136, 138, 139, 141, 142, 144, 146, 147, 149, 151, 152, 154, 156, 157, 159,
+  161, 163, 164, 166, 168, 170, 171, 173, 175, 177, 179, 181, 183, 184, 186, 188,
+  190, 192, 194, 196, 198, 200, 202, 204, 206, 208, 210, 212, 214, 216, 218, 220,
+  222, 224, 226, 229, 231, 233, 235, 237, 239, 242, 244, 246, 248, 250, 253, 255,
+};
+static const uint8_t linear_to_srgb_lut[256] = {
+    0,  13,  22,  28,  34,  38,  42,  46,  50,  53,  56,  59,  61,  64,  66,  69,
+   71,  73,  75,  77,  79,  81,  83,  85,  86,  88,  90,  92,  93,  95,  96,  98,
+   99, 101, 102, 104, 105, 106, 108, 109, 110, 112, 113, 114, 115, 117, 118, 119,
+  120, 121, 122, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136,
+  137, 138, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148, 148, 149, 150, 151,
+  152, 153, 154, 155, 155, 156, 157, 158, 159, 159, 160, 161, 162, 163, 163, 164,
+  165, 166, 167, 167, 168, 169, 170, 170, 171, 172, 173, 173, 174, 175, 175, 176,
+  177, 178, 178, 179, 180, 180, 181, 182, 182, 183, 184, 185, 185, 186, 187, 187,
+  188, 189, 189, 190, 190, 191, 192, 192, 193, 194, 194, 195, 196, 196, 197, 197,
+  198, 199, 199, 200, 200, 201, 202, 202, 203, 203, 204, 205, 205, 206, 206, 207,
+  208, 208, 209, 209, 210, 210, 211, 212, 212, 213, 213, 214, 214, 215, 215, 216,
+  216, 217, 218, 218, 219, 219, 220, 220, 221, 221, 222, 222, 223, 223, 224, 224,
+  225, 226, 226, 227, 227, 228, 228, 229, 229, 230, 230, 231, 231, 232, 232, 233,
+  233, 234, 234, 235, 235, 236, 236, 237, 237, 238, 238, 238, 239, 239, 240, 240,
+  241, 241, 242, 242, 243, 243, 244, 244, 245, 245, 246, 246, 246, 247, 247, 248,
+  248, 249, 249, 250, 250, 251, 251, 251, 252, 252, 253, 253, 254, 254, 255, 255,
+};
+
+// Exact round(t / 255) for t <= 255 * 255.
+static inline uint8_t div255(uint32_t t) {
+  t += 128;
+  return (uint8_t)((t + (t >> 8)) >> 8);
+}
+
+// Scalar kernels, also used for the tails of the SIMD loops.
+
+static void grey_to_rgba_scalar(uint8_t *dst, const uint8_t *src,
+                                uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i * 4 + 0] = src[i];
+    dst[i * 4 + 1] = src[i];
+    dst[i * 4 + 2] = src[i];
+    dst[i * 4 + 3] = 255;
+  }
+}
+
+static void grey_alpha_to_rgba_scalar(uint8_t *dst, const uint8_t *src,
+                                      uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i * 4 + 0] = src[i * 2];
+    dst[i * 4 + 1] = src[i * 2];
+    dst[i * 4 + 2] = src[i * 2];
+    dst[i * 4 + 3] = src[i * 2 + 1];
+  }
+}
+
+static void rgb_to_rgba_scalar(uint8_t *dst, const uint8_t *src,
+                               uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    dst[i * 4 + 0] = src[i * 3 + 0];
+    dst[i * 4 + 1] = src[i * 3 + 1];
+    dst[i * 4 + 2] = src[i * 3 + 2];
+    dst[i * 4 + 3] = 255;
+  }
+}
+
+static void premultiply_scalar(uint8_t *rgba, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t *p = rgba + i * 4;
+    p[0] = div255(p[0] * p[3]);
+    p[1] = div255(p[1] * p[3]);
+    p[2] = div255(p[2] * p[3]);
+  }
+}
+
+static void swizzle_scalar(uint8_t *rgba, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t r = rgba[i * 4];
+    rgba[i * 4] = rgba[i * 4 + 2];
+    rgba[i * 4 + 2] = r;
+  }
+}
+
+#if defined(CONVERT_SSE2)
+
+static void grey_to_rgba_sse2(uint8_t *dst, const uint8_t *src,
+                              uint32_t count) {
+  const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    __m128i g = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i lo = _mm_unpacklo_epi8(g, g);
+    __m128i hi = _mm_unpackhi_epi8(g, g);
+    __m128i *out = (__m128i *)(dst + i * 4);
+    _mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+    _mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+    _mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+    _mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+  }
+  grey_to_rgba_scalar(dst + i * 4, src + i, count - i);
+}
+
+// Expands 32-bit lanes holding `g | a << 8` into `g | g << 8 | g << 16 | a << 24`.
+static inline __m128i grey_alpha_lanes_sse2(__m128i ga) {
+  __m128i g = _mm_and_si128(ga, _mm_set1_epi32(0xFF));
+  __m128i a = _mm_slli_epi32(_mm_and_si128(ga, _mm_set1_epi32(0xFF00)), 16);
+  __m128i ggg = _mm_or_si128(_mm_or_si128(g, _mm_slli_epi32(g, 8)),
+                             _mm_slli_epi32(g, 16));
+  return _mm_or_si128(ggg, a);
+}
+
+static void grey_alpha_to_rgba_sse2(uint8_t *dst, const uint8_t *src,
+                                    uint32_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m128i ga = _mm_loadu_si128((const __m128i *)(src + i * 2));
+    __m128i *out = (__m128i *)(dst + i * 4);
+    _mm_storeu_si128(out + 0, grey_alpha_lanes_sse2(_mm_unpacklo_epi16(ga, zero)));
+    _mm_storeu_si128(out + 1, grey_alpha_lanes_sse2(_mm_unpackhi_epi16(ga, zero)));
+  }
+  grey_alpha_to_rgba_scalar(dst + i * 4, src + i * 2, count - i);
+}
+
+// SSE2 has no byte shuffle, so each group of four pixels (12 source bytes) is
+// spread into its 32-bit lanes with whole-register byte shifts: pixel k moves
+// up by k bytes, then a per-lane mask keeps its RGB.
+static void rgb_to_rgba_sse2(uint8_t *dst, const uint8_t *src,
+                             uint32_t count) {
+  const __m128i lane0 = _mm_setr_epi32(0x00FFFFFF, 0, 0, 0);
+  const __m128i lane1 = _mm_setr_epi32(0, 0x00FFFFFF, 0, 0);
+  const __m128i lane2 = _mm_setr_epi32(0, 0, 0x00FFFFFF, 0);
+  const __m128i lane3 = _mm_setr_epi32(0, 0, 0, 0x00FFFFFF);
+  const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+  uint32_t i = 0;
+  // Each iteration reads 16 bytes for 12 used ones, so stop while at least
+  // two more pixels remain behind it.
+  for (; i + 6 <= count; i += 4) {
+    __m128i px = _mm_loadu_si128((const __m128i *)(src + i * 3));
+    __m128i rgba = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(px, lane0),
+                     _mm_and_si128(_mm_slli_si128(px, 1), lane1)),
+        _mm_or_si128(_mm_and_si128(_mm_slli_si128(px, 2), lane2),
+                     _mm_and_si128(_mm_slli_si128(px, 3), lane3)));
+    _mm_storeu_si128((__m128i *)(dst + i * 4), _mm_or_si128(rgba, alpha));
+  }
+  rgb_to_rgba_scalar(dst + i * 4, src + i * 3, count - i);
+}
+
+static inline __m128i premultiply_half_sse2(__m128i px16) {
+  __m128i a = _mm_shufflelo_epi16(px16, _MM_SHUFFLE(3, 3, 3, 3));
+  a = _mm_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+  __m128i t = _mm_add_epi16(_mm_mullo_epi16(px16, a), _mm_set1_epi16(128));
+  return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void premultiply_sse2(uint8_t *rgba, uint32_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha_mask = _mm_set1_epi32((int)0xFF000000u);
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i *p = (__m128i *)(rgba + i * 4);
+    __m128i px = _mm_loadu_si128(p);
+    __m128i lo = premultiply_half_sse2(_mm_unpacklo_epi8(px, zero));
+    __m128i hi = premultiply_half_sse2(_mm_unpackhi_epi8(px, zero));
+    __m128i color = _mm_andnot_si128(alpha_mask, _mm_packus_epi16(lo, hi));
+    _mm_storeu_si128(p, _mm_or_si128(color, _mm_and_si128(px, alpha_mask)));
+  }
+  premultiply_scalar(rgba + i * 4, count - i);
+}
+
+static void swizzle_sse2(uint8_t *rgba, uint32_t count) {
+  const __m128i ga_mask = _mm_set1_epi32((int)0xFF00FF00u);
+  const __m128i byte_mask = _mm_set1_epi32(0xFF);
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i *p = (__m128i *)(rgba + i * 4);
+    __m128i px = _mm_loadu_si128(p);
+    __m128i b = _mm_and_si128(_mm_srli_epi32(px, 16), byte_mask);
+    __m128i r = _mm_slli_epi32(_mm_and_si128(px, byte_mask), 16);
+    _mm_storeu_si128(p, _mm_or_si128(_mm_and_si128(px, ga_mask),
+                                     _mm_or_si128(r, b)));
+  }
+  swizzle_scalar(rgba + i * 4, count - i);
+}
+
+#endif // CONVERT_SSE2
+
+#if defined(CONVERT_AVX2)
+
+TARGET_AVX2 static void grey_to_rgba_avx2(uint8_t *dst, const uint8_t *src,
+                                          uint32_t count) {
+  const __m256i spread = _mm256_set1_epi32(0x00010101);
+  const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + i)));
+    __m256i px = _mm256_or_si256(_mm256_mullo_epi32(g, spread), alpha);
+    _mm256_storeu_si256((__m256i *)(dst + i * 4), px);
+  }
+  grey_to_rgba_scalar(dst + i * 4, src + i, count - i);
+}
+
+TARGET_AVX2 static void rgb_to_rgba_avx2(uint8_t *dst, const uint8_t *src,
+                                         uint32_t count) {
+  // Each 128-bit lane expands four pixels (12 source bytes).
+  const __m256i shuffle = _mm256_setr_epi8(
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+  uint32_t i = 0;
+  // Each iteration reads 28 bytes for 24 used ones, so stop while at least
+  // two more pixels remain behind it.
+  for (; i + 10 <= count; i += 8) {
+    const uint8_t *s = src + i * 3;
+    __m256i px = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)s)),
+        _mm_loadu_si128((const __m128i *)(s + 12)), 1);
+    px = _mm256_or_si256(_mm256_shuffle_epi8(px, shuffle), alpha);
+    _mm256_storeu_si256((__m256i *)(dst + i * 4), px);
+  }
+  rgb_to_rgba_sse2(dst + i * 4, src + i * 3, count - i);
+}
+
+TARGET_AVX2 static void premultiply_avx2(uint8_t *rgba, uint32_t count) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i alpha_mask = _mm256_set1_epi32((int)0xFF000000u);
+  const __m256i bias = _mm256_set1_epi16(128);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i *p = (__m256i *)(rgba + i * 4);
+    __m256i px = _mm256_loadu_si256(p);
+    // Unpack and pack both work per 128-bit lane, so pixel order survives.
+    __m256i halves[2] = {_mm256_unpacklo_epi8(px, zero),
+                         _mm256_unpackhi_epi8(px, zero)};
+    for (int h = 0; h < 2; h++) {
+      __m256i a = _mm256_shufflelo_epi16(halves[h], _MM_SHUFFLE(3, 3, 3, 3));
+      a = _mm256_shufflehi_epi16(a, _MM_SHUFFLE(3, 3, 3, 3));
+      __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(halves[h], a), bias);
+      halves[h] = _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+    }
+    __m256i color =
+        _mm256_andnot_si256(alpha_mask, _mm256_packus_epi16(halves[0], halves[1]));
+    _mm256_storeu_si256(p, _mm256_or_si256(color, _mm256_and_si256(px, alpha_mask)));
+  }
+  premultiply_scalar(rgba + i * 4, count - i);
+}
+
+TARGET_AVX2 static void swizzle_avx2(uint8_t *rgba, uint32_t count) {
+  const __m256i shuffle = _mm256_setr_epi8(
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+      2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+  uint32_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256i *p = (__m256i *)(rgba + i * 4);
+    _mm256_storeu_si256(p, _mm256_shuffle_epi8(_mm256_loadu_si256(p), shuffle));
+  }
+  swizzle_scalar(rgba + i * 4, count - i);
+}
+
+#endif // CONVERT_AVX2
+
+#if defined(CONVERT_NEON)
+
+static void grey_to_rgba_neon(uint8_t *dst, const uint8_t *src,
+                              uint32_t count) {
+  const uint8x16_t alpha = vdupq_n_u8(255);
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16_t g = vld1q_u8(src + i);
+    vst4q_u8(dst + i * 4, (uint8x16x4_t){{g, g, g, alpha}});
+  }
+  grey_to_rgba_scalar(dst + i * 4, src + i, count - i);
+}
+
+static void grey_alpha_to_rgba_neon(uint8_t *dst, const uint8_t *src,
+                                    uint32_t count) {
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x2_t ga = vld2q_u8(src + i * 2);
+    vst4q_u8(dst + i * 4, (uint8x16x4_t){{ga.val[0], ga.val[0], ga.val[0], ga.val[1]}});
+  }
+  grey_alpha_to_rgba_scalar(dst + i * 4, src + i * 2, count - i);
+}
+
+static void rgb_to_rgba_neon(uint8_t *dst, const uint8_t *src,
+                             uint32_t count) {
+  const uint8x16_t alpha = vdupq_n_u8(255);
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+    vst4q_u8(dst + i * 4, (uint8x16x4_t){{rgb.val[0], rgb.val[1], rgb.val[2], alpha}});
+  }
+  rgb_to_rgba_scalar(dst + i * 4, src + i * 3, count - i);
+}
+
+// (t + ((t + 128) >> 8) + 128) >> 8, i.e. div255 on eight lanes.
+static inline uint8x8_t premultiply_neon_half(uint8x8_t c, uint8x8_t a) {
+  uint16x8_t t = vmull_u8(c, a);
+  return vraddhn_u16(t, vrshrq_n_u16(t, 8));
+}
+
+static void premultiply_neon(uint8_t *rgba, uint32_t count) {
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t px = vld4q_u8(rgba + i * 4);
+    for (int c = 0; c < 3; c++) {
+      px.val[c] = vcombine_u8(
+          premultiply_neon_half(vget_low_u8(px.val[c]), vget_low_u8(px.val[3])),
+          premultiply_neon_half(vget_high_u8(px.val[c]), vget_high_u8(px.val[3])));
+    }
+    vst4q_u8(rgba + i * 4, px);
+  }
+  premultiply_scalar(rgba + i * 4, count - i);
+}
+
+static void swizzle_neon(uint8_t *rgba, uint32_t count) {
+  uint32_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    uint8x16x4_t px = vld4q_u8(rgba + i * 4);
+    uint8x16_t r = px.val[0];
+    px.val[0] = px.val[2];
+    px.val[2] = r;
+    vst4q_u8(rgba + i * 4, px);
+  }
+  swizzle_scalar(rgba + i * 4, count - i);
+}
+
+#endif // CONVERT_NEON
+
+void frmwrk_convert_grey_to_rgba(uint8_t *dst, const uint8_t *src, uint32_t count) {
+#if defined(CONVERT_AVX2)
+  if (has_avx2()) {
+    grey_to_rgba_avx2(dst, src, count);
+    return;
+  }
+#endif
+#if defined(CONVERT_SSE2)
+  grey_to_rgba_sse2(dst, src, count);
+#elif defined(CONVERT_NEON)
+  grey_to_rgba_neon(dst, src, count);
+#else
+  grey_to_rgba_scalar(dst, src, count);
+#endif
+}
+
+void frmwrk_convert_grey_alpha_to_rgba(uint8_t *dst, const uint8_t *src, uint32_t count) {
+#if defined(CONVERT_SSE2)
+  grey_alpha_to_rgba_sse2(dst, src, count);
+#elif defined(CONVERT_NEON)
+  grey_alpha_to_rgba_neon(dst, src, count);
+#else
+  grey_alpha_to_rgba_scalar(dst, src, count);
+#endif
+}
+
+void frmwrk_convert_rgb_to_rgba(uint8_t *dst, const uint8_t *src, uint32_t count) {
+#if defined(CONVERT_AVX2)
+  if (has_avx2()) {
+    rgb_to_rgba_avx2(dst, src, count);
+    return;
+  }
+#endif
+#if defined(CONVERT_SSE2)
+  rgb_to_rgba_sse2(dst, src, count);
+#elif defined(CONVERT_NEON)
+  rgb_to_rgba_neon(dst, src, count);
+#else
+  rgb_to_rgba_scalar(dst, src, count);
+#endif
+}
+
+void frmwrk_convert_premultiply_alpha(uint8_t *rgba, uint32_t count) {
+#if defined(CONVERT_AVX2)
+  if (has_avx2()) {
+    premultiply_avx2(rgba, count);
+    return;
+  }
+#endif
+#if defined(CONVERT_SSE2)
+  premultiply_sse2(rgba, count);
+#elif defined(CONVERT_NEON)
+  premultiply_neon(rgba, count);
+#else
+  premultiply_scalar(rgba, count);
+#endif
+}
+
+void frmwrk_convert_swizzle_bgra(uint8_t *rgba, uint32_t count) {
+#if defined(CONVERT_AVX2)
+  if (has_avx2()) {
+    swizzle_avx2(rgba, count);
+    return;
+  }
+#endif
+#if defined(CONVERT_SSE2)
+  swizzle_sse2(rgba, count);
+#elif defined(CONVERT_NEON)
+  swizzle_neon(rgba, count);
+#else
+  swizzle_scalar(rgba, count);
+#endif
+}
+
+static void apply_lut(uint8_t *rgba, uint32_t count, const uint8_t *lut) {
+  for (uint32_t i = 0; i < count; i++) {
+    uint8_t *p = rgba + i * 4;
+    p[0] = lut[p[0]];
+    p[1] = lut[p[1]];
+    p[2] = lut[p[2]];
+  }
+}
+
+void frmwrk_convert_srgb_to_linear(uint8_t *rgba, uint32_t count) {
+  apply_lut(rgba, count, srgb_to_linear_lut);
+}
+
+void frmwrk_convert_linear_to_srgb(uint8_t *rgba, uint32_t count) {
+  apply_lut(rgba, count, linear_to_srgb_lut);
+}
+
+uint32_t frmwrk_convert_aligned_row_pitch(uint32_t width) {
+  return (width * 4 + PIXEL_CONVERT_ROW_ALIGNMENT - 1) &
+         ~(uint32_t)(PIXEL_CONVERT_ROW_ALIGNMENT - 1);
+}
+
+bool frmwrk_convert_image_to_rgba(uint8_t *dst, uint32_t dstBytesPerRow,
+                                  const uint8_t *src, uint32_t width,
+                                  uint32_t height, uint32_t srcChannels,
+                                  uint32_t flags) {
+  if (srcChannels < 1 || srcChannels > 4 || dstBytesPerRow < width * 4)
+    return false;
+
+  for (uint32_t y = 0; y < height; y++) {
+    const uint8_t *s = src + (size_t)y * width * srcChannels;
+    uint8_t *d = dst + (size_t)y * dstBytesPerRow;
+
+    switch (srcChannels) {
+    case 1:
+      frmwrk_convert_grey_to_rgba(d, s, width);
+      break;
+    case 2:
+      frmwrk_convert_grey_alpha_to_rgba(d, s, width);
+      break;
+    case 3:
+      frmwrk_convert_rgb_to_rgba(d, s, width);
+      break;
+    default:
+      if (d != s)
+        memmove(d, s, (size_t)width * 4);
+      break;
+    }
+
+    if (flags & PixelConvert_SrgbToLinear)
+      frmwrk_convert_srgb_to_linear(d, width);
+    if (flags & PixelConvert_PremultiplyAlpha)
+      frmwrk_convert_premultiply_alpha(d, width);
+    if (flags & PixelConvert_LinearToSrgb)
+      frmwrk_convert_linear_to_srgb(d, width);
+    if (flags & PixelConvert_SwizzleBGRA)
+      frmwrk_convert_swizzle_bgra(d, width);
+  }
+  return true;
+}
@@ -0,0 +1,42 @@
+#ifndef PIXEL_CONVERT_H
+#define PIXEL_CONVERT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Operations applied after expanding source pixels to RGBA8, in this order.
+typedef enum PixelConvertFlags {
+  PixelConvert_None = 0,
+  PixelConvert_SrgbToLinear = 1 << 0,
+  PixelConvert_PremultiplyAlpha = 1 << 1,
+  PixelConvert_LinearToSrgb = 1 << 2,
+  // Swap R and B for BGRA8 textures.
+  PixelConvert_SwizzleBGRA = 1 << 3,
+} PixelConvertFlags;
+
+#define PIXEL_CONVERT_ROW_ALIGNMENT 256
+
+// Row kernels. `count` is in pixels; destination rows are RGBA8.
+void frmwrk_convert_grey_to_rgba(uint8_t *dst, const uint8_t *src, uint32_t count);
+void frmwrk_convert_grey_alpha_to_rgba(uint8_t *dst, const uint8_t *src, uint32_t count);
+void frmwrk_convert_rgb_to_rgba(uint8_t *dst, const uint8_t *src, uint32_t count);
+// In-place kernels on RGBA8 rows. sRGB conversions leave alpha untouched.
+void frmwrk_convert_premultiply_alpha(uint8_t *rgba, uint32_t count);
+void frmwrk_convert_swizzle_bgra(uint8_t *rgba, uint32_t count);
+void frmwrk_convert_srgb_to_linear(uint8_t *rgba, uint32_t count);
+void frmwrk_convert_linear_to_srgb(uint8_t *rgba, uint32_t count);
+
+// Row pitch for `width` RGBA8 pixels padded to the 256-byte bytesPerRow
+// alignment required by buffer-to-texture copies.
+uint32_t frmwrk_convert_aligned_row_pitch(uint32_t width);
+// Expands 1-4 channel pixels to RGBA8 rows `dstBytesPerRow` apart, applying
+// `flags` (PixelConvertFlags) to each row while it is still in cache.
+bool frmwrk_convert_image_to_rgba(uint8_t *dst, uint32_t dstBytesPerRow,
+                                  const uint8_t *src, uint32_t width,
+                                  uint32_t height, uint32_t srcChannels,
+                                  uint32_t flags);
+
+// Instruction set the kernels dispatched to: "avx2", "sse2", "neon" or "scalar".
+const char *frmwrk_convert_isa(void);
+
+#endif // PIXEL_CONVERT_H
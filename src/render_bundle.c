@@ -0,0 +1,89 @@
+#include "render_bundle.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+StaticBundle *frmwrk_create_static_bundle(WGPUDevice device,
+                                          WGPUTextureFormat colorFormat,
+                                          uint32_t sampleCount,
+                                          const char *label) {
+  StaticBundle *bundle = calloc(1, sizeof(StaticBundle));
+  if (!bundle)
+    return NULL;
+  bundle->device = device;
+  bundle->label = label;
+  bundle->colorFormat = colorFormat;
+  bundle->sampleCount = sampleCount;
+  return bundle;
+}
+
+void frmwrk_drop_static_bundle(StaticBundle *bundle) {
+  if (!bundle)
+    return;
+  frmwrk_static_bundle_invalidate(bundle);
+  free(bundle);
+}
+
+void frmwrk_static_bundle_invalidate(StaticBundle *bundle) {
+  // Passes already encoded with the bundle keep their own reference.
+  if (bundle->bundle)
+    wgpuRenderBundleDrop(bundle->bundle);
+  bundle->bundle = NULL;
+}
+
+WGPURenderBundle frmwrk_static_bundle_get(StaticBundle *bundle, uint64_t key,
+                                          RenderBundleRecordCallback record,
+                                          void *userdata) {
+  if (bundle->bundle && bundle->key == key) {
+    bundle->stats.replays++;
+    return bundle->bundle;
+  }
+  frmwrk_static_bundle_invalidate(bundle);
+
+  WGPURenderBundleEncoder encoder = wgpuDeviceCreateRenderBundleEncoder(
+      bundle->device, &(const WGPURenderBundleEncoderDescriptor){
+                          .label = bundle->label,
+                          .colorFormatsCount = 1,
+                          .colorFormats = &bundle->colorFormat,
+                          .depthStencilFormat = WGPUTextureFormat_Undefined,
+                          .sampleCount = bundle->sampleCount,
+                      });
+  if (!encoder) {
+    bundle->stats.failures++;
+    return NULL;
+  }
+  record(encoder, userdata);
+  // wgpuRenderBundleEncoderFinish() drops encoder
+  bundle->bundle = wgpuRenderBundleEncoderFinish(
+      encoder, &(const WGPURenderBundleDescriptor){.label = bundle->label});
+  if (!bundle->bundle) {
+    bundle->stats.failures++;
+    return NULL;
+  }
+  bundle->key = key;
+  bundle->stats.records++;
+  return bundle->bundle;
+}
+
+bool frmwrk_static_bundle_execute(StaticBundle *bundle,
+                                  WGPURenderPassEncoder pass, uint64_t key,
+                                  RenderBundleRecordCallback record,
+                                  void *userdata) {
+  WGPURenderBundle render_bundle =
+      frmwrk_static_bundle_get(bundle, key, record, userdata);
+  if (!render_bundle)
+    return false;
+  wgpuRenderPassEncoderExecuteBundles(pass, 1, &render_bundle);
+  return true;
+}
+
+void frmwrk_static_bundle_print(const StaticBundle *bundle) {
+  const RenderBundleStats *stats = &bundle->stats;
+  uint64_t uses = stats->records + stats->replays;
+  printf("[render_bundle] %s: records=%llu replays=%llu failures=%llu "
+         "(%.1f%% replayed)\n",
+         bundle->label ? bundle->label : "bundle",
+         (unsigned long long)stats->records,
+         (unsigned long long)stats->replays,
+         (unsigned long long)stats->failures,
+         uses ? 100.0 * stats->replays / uses : 0.0);
+}
@@ -0,0 +1,61 @@
+#ifndef RENDER_BUNDLE_H
+#define RENDER_BUNDLE_H
+
+#include "framework.h"
+
+// Records the draw commands for the bundle into `encoder`.
+typedef void (*RenderBundleRecordCallback)(WGPURenderBundleEncoder encoder,
+                                           void *userdata);
+
+typedef struct RenderBundleStats {
+  uint64_t records;
+  uint64_t replays;
+  uint64_t failures;
+} RenderBundleStats;
+
+// A draw sequence recorded once into a WGPURenderBundle and replayed into
+// every pass until its inputs change. The inputs are summarized by a key the
+// caller builds from whatever the recording reads (handles, generation
+// counters, draw counts); a different key re-records it. Only the commands are
+// frozen, so buffers the bundle binds can still be rewritten every frame.
+//
+// Like the object cache, handles in the key can be reused by new objects once
+// the old ones are dropped, so call frmwrk_static_bundle_invalidate when
+// replacing an object the bundle references unless its key also carries a
+// counter that changes with it.
+typedef struct StaticBundle {
+  WGPUDevice device;
+  const char *label;
+  // Attachment layout of the passes the bundle is executed in.
+  WGPUTextureFormat colorFormat;
+  uint32_t sampleCount;
+
+  WGPURenderBundle bundle;
+  uint64_t key;
+
+  RenderBundleStats stats;
+} StaticBundle;
+
+StaticBundle *frmwrk_create_static_bundle(WGPUDevice device,
+                                          WGPUTextureFormat colorFormat,
+                                          uint32_t sampleCount,
+                                          const char *label);
+void frmwrk_drop_static_bundle(StaticBundle *bundle);
+
+// Forces the next frmwrk_static_bundle_get to re-record.
+void frmwrk_static_bundle_invalidate(StaticBundle *bundle);
+// Returns the bundle recorded for `key`, recording it through `record` first
+// when the key changed or the bundle was invalidated. NULL if recording fails.
+WGPURenderBundle frmwrk_static_bundle_get(StaticBundle *bundle, uint64_t key,
+                                          RenderBundleRecordCallback record,
+                                          void *userdata);
+// Executes the bundle for `key` in `pass`. Returns false without touching
+// `pass` when it could not be recorded, so callers can encode directly.
+bool frmwrk_static_bundle_execute(StaticBundle *bundle,
+                                  WGPURenderPassEncoder pass, uint64_t key,
+                                  RenderBundleRecordCallback record,
+                                  void *userdata);
+
+void frmwrk_static_bundle_print(const StaticBundle *bundle);
+
+#endif // RENDER_BUNDLE_H
@@ -0,0 +1,1488 @@
+// Replays a trace recorded with `wgpu-test --capture` against a headless
+// device, looping it to measure how long the same work takes to issue and to
+// run. See capture.h for the trace format.
+//
+// Each loop re-creates every object the trace creates and drops whatever it
+// left alive at the end, so loops are independent. Frames render into an
+// offscreen texture in place of the swapchain, and copies the app made out of
+// mapped staging memory are fed from the trace through a staging buffer of
+// the replay's own.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "framework.h"
+
+#define LOG_PREFIX "[replay]"
+#define REPLAY_STAGING_SIZE (16ull << 20)
+#define REPLAY_STAGING_ALIGNMENT 256
+#define REPLAY_SCRATCH_SIZE (64u << 10)
+#define REPLAY_MAX_ERRORS_PRINTED 8
+
+typedef struct ReplayOptions {
+  const char *path;
+  uint32_t loops;
+} ReplayOptions;
+
+typedef struct ReplayObject {
+  CaptureObjectType type;
+  void *handle;
+} ReplayObject;
+
+typedef struct ReplayReader {
+  const unsigned char *data;
+  size_t size;
+  size_t position;
+  bool failed;
+} ReplayReader;
+
+typedef struct ReplayTimes {
+  uint64_t count;
+  double sumMs;
+  double minMs;
+  double maxMs;
+} ReplayTimes;
+
+typedef struct Replay {
+  WGPUInstance instance;
+  WGPUAdapter adapter;
+  WGPUDevice device;
+  WGPUQueue queue;
+
+  // Indexed by trace id.
+  ReplayObject *objects;
+  uint32_t objectCapacity;
+
+  // Stands in for the swapchain.
+  WGPUTexture target;
+  uint32_t targetWidth;
+  uint32_t targetHeight;
+  WGPUTextureFormat targetFormat;
+
+  // Source of the copies recorded with their data. Space is only reused once
+  // everything that may copy from it has been submitted.
+  WGPUBuffer staging;
+  uint64_t stagingSize;
+  uint64_t stagingUsed;
+  // Command encoders and command buffers not yet submitted.
+  uint32_t openEncoders;
+  unsigned char *padded;
+  size_t paddedCapacity;
+
+  // Arrays decoded for the record being replayed. Chunks outgrown during a
+  // record are kept until it is done since earlier arrays point into them.
+  unsigned char *scratch;
+  size_t scratchUsed;
+  size_t scratchCapacity;
+  unsigned char **retired;
+  uint32_t retiredCount;
+  uint32_t retiredCapacity;
+
+  uint64_t errors;
+  // Records naming objects the trace never created, or that failed.
+  uint64_t skipped;
+  ReplayTimes frames;
+  ReplayTimes loops;
+} Replay;
+
+static void handle_request_adapter(WGPURequestAdapterStatus status,
+                                   WGPUAdapter adapter, char const *message,
+                                   void *userdata) {
+  if (status == WGPURequestAdapterStatus_Success) {
+    Replay *replay = userdata;
+    replay->adapter = adapter;
+  } else {
+    printf(LOG_PREFIX " request_adapter status=%#.8x message=%s\n", status,
+           message);
+  }
+}
+
+static void handle_request_device(WGPURequestDeviceStatus status,
+                                  WGPUDevice device, char const *message,
+                                  void *userdata) {
+  if (status == WGPURequestDeviceStatus_Success) {
+    Replay *replay = userdata;
+    replay->device = device;
+  } else {
+    printf(LOG_PREFIX " request_device status=%#.8x message=%s\n", status,
+           message);
+  }
+}
+
+static void handle_uncaptured_error(WGPUErrorType type, char const *message,
+                                    void *userdata) {
+  Replay *replay = userdata;
+  if (replay->errors++ < REPLAY_MAX_ERRORS_PRINTED)
+    printf(LOG_PREFIX " uncaptured_error type=%#.8x message=%s\n", type,
+           message);
+}
+
+static void add_time(ReplayTimes *times, double ms) {
+  if (times->count == 0 || ms < times->minMs)
+    times->minMs = ms;
+  if (times->count == 0 || ms > times->maxMs)
+    times->maxMs = ms;
+  times->sumMs += ms;
+  times->count++;
+}
+
+#pragma region reading
+static const void *get(ReplayReader *reader, size_t size) {
+  if (reader->failed || size > reader->size - reader->position) {
+    reader->failed = true;
+    return NULL;
+  }
+  const void *data = reader->data + reader->position;
+  reader->position += size;
+  return data;
+}
+
+static uint32_t get_u32(ReplayReader *reader) {
+  uint32_t value = 0;
+  const void *data = get(reader, sizeof(value));
+  if (data)
+    memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static int32_t get_i32(ReplayReader *reader) {
+  int32_t value = 0;
+  const void *data = get(reader, sizeof(value));
+  if (data)
+    memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static uint64_t get_u64(ReplayReader *reader) {
+  uint64_t value = 0;
+  const void *data = get(reader, sizeof(value));
+  if (data)
+    memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static float get_f32(ReplayReader *reader) {
+  float value = 0.0f;
+  const void *data = get(reader, sizeof(value));
+  if (data)
+    memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static double get_f64(ReplayReader *reader) {
+  double value = 0.0;
+  const void *data = get(reader, sizeof(value));
+  if (data)
+    memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+static const void *get_bytes(ReplayReader *reader, uint32_t *size) {
+  *size = get_u32(reader);
+  return get(reader, *size);
+}
+
+// Points into the trace, which keeps each string's NUL.
+static const char *get_string(ReplayReader *reader) {
+  uint32_t size;
+  const char *string = get_bytes(reader, &size);
+  if (!size)
+    return NULL;
+  if (string && string[size - 1] != '\0') {
+    reader->failed = true;
+    return NULL;
+  }
+  return string;
+}
+
+static void *scratch_alloc(Replay *replay, size_t size) {
+  size = (size + 15) & ~(size_t)15;
+  if (replay->scratchUsed + size > replay->scratchCapacity) {
+    size_t capacity = replay->scratchCapacity ? replay->scratchCapacity * 2
+                                              : REPLAY_SCRATCH_SIZE;
+    while (capacity < size)
+      capacity *= 2;
+    if (replay->scratch && replay->retiredCount == replay->retiredCapacity) {
+      uint32_t retired_capacity =
+          replay->retiredCapacity ? replay->retiredCapacity * 2 : 8;
+      unsigned char **retired = realloc(
+          replay->retired, retired_capacity * sizeof(unsigned char *));
+      if (!retired)
+        return NULL;
+      replay->retired = retired;
+      replay->retiredCapacity = retired_capacity;
+    }
+    unsigned char *chunk = malloc(capacity);
+    if (!chunk)
+      return NULL;
+    if (replay->scratch)
+      replay->retired[replay->retiredCount++] = replay->scratch;
+    replay->scratch = chunk;
+    replay->scratchCapacity = capacity;
+    replay->scratchUsed = 0;
+  }
+  void *data = replay->scratch + replay->scratchUsed;
+  replay->scratchUsed += size;
+  memset(data, 0, size);
+  return data;
+}
+
+// Room for `count` items, or NULL (and a failed reader) when it cannot be
+// had. A count the record cannot possibly hold is a corrupt trace.
+static void *get_array(Replay *replay, ReplayReader *reader, uint32_t count,
+                       size_t itemSize) {
+  if (count == 0)
+    return NULL;
+  if (count > reader->size - reader->position) {
+    reader->failed = true;
+    return NULL;
+  }
+  void *items = scratch_alloc(replay, count * itemSize);
+  if (!items)
+    reader->failed = true;
+  return items;
+}
+
+static void scratch_reset(Replay *replay) {
+  for (uint32_t i = 0; i < replay->retiredCount; i++)
+    free(replay->retired[i]);
+  replay->retiredCount = 0;
+  replay->scratchUsed = 0;
+}
+#pragma endregion
+
+#pragma region objects
+static bool set_object(Replay *replay, uint32_t id, CaptureObjectType type,
+                       void *handle) {
+  if (id == 0 || !handle) {
+    replay->skipped++;
+    return false;
+  }
+  if (id >= replay->objectCapacity) {
+    uint32_t capacity = replay->objectCapacity ? replay->objectCapacity : 1024;
+    while (capacity <= id)
+      capacity *= 2;
+    ReplayObject *objects =
+        realloc(replay->objects, capacity * sizeof(ReplayObject));
+    if (!objects)
+      return false;
+    memset(objects + replay->objectCapacity, 0,
+           (capacity - replay->objectCapacity) * sizeof(ReplayObject));
+    replay->objects = objects;
+    replay->objectCapacity = capacity;
+  }
+  replay->objects[id] = (ReplayObject){type, handle};
+  return true;
+}
+
+static ReplayObject *find_object(Replay *replay, uint32_t id) {
+  if (id == 0 || id >= replay->objectCapacity || !replay->objects[id].handle)
+    return NULL;
+  return &replay->objects[id];
+}
+
+// Id 0 reads as NULL; an id naming nothing of `type` counts as skipped, and
+// reads as NULL too.
+static void *get_object(Replay *replay, ReplayReader *reader,
+                        CaptureObjectType type) {
+  uint32_t id = get_u32(reader);
+  if (id == 0)
+    return NULL;
+  ReplayObject *object = find_object(replay, id);
+  if (!object || object->type != type) {
+    replay->skipped++;
+    return NULL;
+  }
+  return object->handle;
+}
+
+static ReplayObject *get_encoder(Replay *replay, ReplayReader *reader) {
+  ReplayObject *object = find_object(replay, get_u32(reader));
+  if (!object)
+    replay->skipped++;
+  return object;
+}
+
+// Forgets an object the call just made has released.
+static void *take_object(Replay *replay, uint32_t id, CaptureObjectType type) {
+  ReplayObject *object = find_object(replay, id);
+  if (!object || object->type != type) {
+    replay->skipped++;
+    return NULL;
+  }
+  void *handle = object->handle;
+  *object = (ReplayObject){0};
+  return handle;
+}
+
+static void drop_object(Replay *replay, uint32_t id) {
+  ReplayObject *object = find_object(replay, id);
+  if (!object)
+    return;
+  void *handle = object->handle;
+  switch (object->type) {
+  case CaptureObjectType_Buffer:
+    wgpuBufferDrop(handle);
+    break;
+  case CaptureObjectType_Texture:
+    wgpuTextureDrop(handle);
+    break;
+  case CaptureObjectType_TextureView:
+    wgpuTextureViewDrop(handle);
+    break;
+  case CaptureObjectType_Sampler:
+    wgpuSamplerDrop(handle);
+    break;
+  case CaptureObjectType_ShaderModule:
+    wgpuShaderModuleDrop(handle);
+    break;
+  case CaptureObjectType_BindGroupLayout:
+    wgpuBindGroupLayoutDrop(handle);
+    break;
+  case CaptureObjectType_PipelineLayout:
+    wgpuPipelineLayoutDrop(handle);
+    break;
+  case CaptureObjectType_RenderPipeline:
+    wgpuRenderPipelineDrop(handle);
+    break;
+  case CaptureObjectType_ComputePipeline:
+    wgpuComputePipelineDrop(handle);
+    break;
+  case CaptureObjectType_BindGroup:
+    wgpuBindGroupDrop(handle);
+    break;
+  case CaptureObjectType_CommandEncoder:
+    wgpuCommandEncoderDrop(handle);
+    replay->openEncoders--;
+    break;
+  case CaptureObjectType_CommandBuffer:
+    wgpuCommandBufferDrop(handle);
+    replay->openEncoders--;
+    break;
+  case CaptureObjectType_RenderPassEncoder:
+    wgpuRenderPassEncoderDrop(handle);
+    break;
+  case CaptureObjectType_ComputePassEncoder:
+    wgpuComputePassEncoderDrop(handle);
+    break;
+  case CaptureObjectType_RenderBundleEncoder:
+    wgpuRenderBundleEncoderDrop(handle);
+    break;
+  case CaptureObjectType_RenderBundle:
+    wgpuRenderBundleDrop(handle);
+    break;
+  default:
+    break;
+  }
+  *object = (ReplayObject){0};
+}
+
+// Newest first, so passes go before their encoders and views before their
+// textures.
+static void drop_all_objects(Replay *replay) {
+  for (uint32_t id = replay->objectCapacity; id-- > 1;)
+    drop_object(replay, id);
+  replay->openEncoders = 0;
+  replay->stagingUsed = 0;
+}
+#pragma endregion
+
+#pragma region decoding
+static bool get_copy_buffer(Replay *replay, ReplayReader *reader,
+                            WGPUImageCopyBuffer *copy) {
+  *copy = (WGPUImageCopyBuffer){
+    .buffer = get_object(replay, reader, CaptureObjectType_Buffer),
+  };
+  copy->layout.offset = get_u64(reader);
+  copy->layout.bytesPerRow = get_u32(reader);
+  copy->layout.rowsPerImage = get_u32(reader);
+  return copy->buffer != NULL;
+}
+
+static bool get_copy_texture(Replay *replay, ReplayReader *reader,
+                             WGPUImageCopyTexture *copy) {
+  *copy = (WGPUImageCopyTexture){
+    .texture = get_object(replay, reader, CaptureObjectType_Texture),
+  };
+  copy->mipLevel = get_u32(reader);
+  copy->origin.x = get_u32(reader);
+  copy->origin.y = get_u32(reader);
+  copy->origin.z = get_u32(reader);
+  copy->aspect = get_u32(reader);
+  return copy->texture != NULL;
+}
+
+static WGPUExtent3D get_extent(ReplayReader *reader) {
+  WGPUExtent3D extent;
+  extent.width = get_u32(reader);
+  extent.height = get_u32(reader);
+  extent.depthOrArrayLayers = get_u32(reader);
+  return extent;
+}
+
+static WGPUProgrammableStageDescriptor get_stage(Replay *replay,
+                                                 ReplayReader *reader) {
+  WGPUProgrammableStageDescriptor stage = {
+    .module = get_object(replay, reader, CaptureObjectType_ShaderModule),
+  };
+  stage.entryPoint = get_string(reader);
+  stage.constantCount = get_u32(reader);
+  WGPUConstantEntry *constants =
+      get_array(replay, reader, stage.constantCount, sizeof(WGPUConstantEntry));
+  for (uint32_t i = 0; constants && i < stage.constantCount; i++) {
+    constants[i].key = get_string(reader);
+    constants[i].value = get_f64(reader);
+  }
+  stage.constants = constants;
+  return stage;
+}
+
+static WGPUBlendComponent get_blend_component(ReplayReader *reader) {
+  WGPUBlendComponent component;
+  component.operation = get_u32(reader);
+  component.srcFactor = get_u32(reader);
+  component.dstFactor = get_u32(reader);
+  return component;
+}
+
+static WGPUStencilFaceState get_stencil_face(ReplayReader *reader) {
+  WGPUStencilFaceState face;
+  face.compare = get_u32(reader);
+  face.failOp = get_u32(reader);
+  face.depthFailOp = get_u32(reader);
+  face.passOp = get_u32(reader);
+  return face;
+}
+
+// Puts `size` bytes from the trace into the staging buffer for a copy to read.
+static bool stage_data(Replay *replay, const void *data, uint64_t size,
+                       uint64_t *offset) {
+  // Queue writes come in multiples of four bytes.
+  uint64_t padded = (size + 3) & ~3ull;
+  uint64_t start = (replay->stagingUsed + REPLAY_STAGING_ALIGNMENT - 1) &
+                   ~(uint64_t)(REPLAY_STAGING_ALIGNMENT - 1);
+  if (!replay->staging || start + padded > replay->stagingSize) {
+    uint64_t capacity =
+        replay->stagingSize ? replay->stagingSize * 2 : REPLAY_STAGING_SIZE;
+    while (capacity < padded)
+      capacity *= 2;
+    WGPUBuffer staging = wgpuDeviceCreateBuffer(
+        replay->device, &(const WGPUBufferDescriptor){
+                            .label = "replay_staging",
+                            .usage = WGPUBufferUsage_CopySrc |
+                                     WGPUBufferUsage_CopyDst,
+                            .size = capacity,
+                        });
+    if (!staging)
+      return false;
+    // Copies already recorded from the old buffer keep it alive.
+    if (replay->staging)
+      wgpuBufferDrop(replay->staging);
+    replay->staging = staging;
+    replay->stagingSize = capacity;
+    start = 0;
+  }
+  if (padded != size) {
+    if (padded > replay->paddedCapacity) {
+      unsigned char *copy = realloc(replay->padded, padded);
+      if (!copy)
+        return false;
+      replay->padded = copy;
+      replay->paddedCapacity = padded;
+    }
+    memcpy(replay->padded, data, size);
+    memset(replay->padded + size, 0, padded - size);
+    data = replay->padded;
+  }
+  wgpuQueueWriteBuffer(replay->queue, replay->staging, start, data, padded);
+  replay->stagingUsed = start + padded;
+  *offset = start;
+  return true;
+}
+
+static bool set_target(Replay *replay, uint32_t width, uint32_t height,
+                       WGPUTextureFormat format) {
+  if (replay->target && replay->targetWidth == width &&
+      replay->targetHeight == height && replay->targetFormat == format)
+    return true;
+  if (replay->target)
+    wgpuTextureDrop(replay->target);
+  replay->target = wgpuDeviceCreateTexture(
+      replay->device,
+      &(const WGPUTextureDescriptor){
+          .label = "replay_target",
+          .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+          .dimension = WGPUTextureDimension_2D,
+          .size = {width, height, 1},
+          .format = format,
+          .mipLevelCount = 1,
+          .sampleCount = 1,
+      });
+  replay->targetWidth = width;
+  replay->targetHeight = height;
+  replay->targetFormat = format;
+  return replay->target != NULL;
+}
+#pragma endregion
+
+// Issues one record. Returns false if it is malformed.
+static bool replay_record(Replay *replay, CaptureOp op, ReplayReader *reader) {
+  WGPUDevice device = replay->device;
+  switch (op) {
+  case CaptureOp_Device:
+  case CaptureOp_FrameEnd:
+    break;
+
+  case CaptureOp_CreateBuffer: {
+    uint32_t id = get_u32(reader);
+    WGPUBufferDescriptor descriptor = {0};
+    descriptor.usage = get_u32(reader);
+    descriptor.size = get_u64(reader);
+    descriptor.mappedAtCreation = get_u32(reader);
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_Buffer,
+                 wgpuDeviceCreateBuffer(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreateTexture: {
+    uint32_t id = get_u32(reader);
+    WGPUTextureDescriptor descriptor = {0};
+    descriptor.usage = get_u32(reader);
+    descriptor.dimension = get_u32(reader);
+    descriptor.size = get_extent(reader);
+    descriptor.format = get_u32(reader);
+    descriptor.mipLevelCount = get_u32(reader);
+    descriptor.sampleCount = get_u32(reader);
+    descriptor.viewFormatCount = get_u32(reader);
+    WGPUTextureFormat *view_formats = get_array(
+        replay, reader, descriptor.viewFormatCount, sizeof(WGPUTextureFormat));
+    for (size_t i = 0; view_formats && i < descriptor.viewFormatCount; i++)
+      view_formats[i] = get_u32(reader);
+    descriptor.viewFormats = view_formats;
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_Texture,
+                 wgpuDeviceCreateTexture(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreateTextureView: {
+    uint32_t id = get_u32(reader);
+    WGPUTexture texture = get_object(replay, reader, CaptureObjectType_Texture);
+    WGPUTextureViewDescriptor descriptor = {0};
+    bool has_descriptor = get_u32(reader);
+    if (has_descriptor) {
+      descriptor.format = get_u32(reader);
+      descriptor.dimension = get_u32(reader);
+      descriptor.baseMipLevel = get_u32(reader);
+      descriptor.mipLevelCount = get_u32(reader);
+      descriptor.baseArrayLayer = get_u32(reader);
+      descriptor.arrayLayerCount = get_u32(reader);
+      descriptor.aspect = get_u32(reader);
+    }
+    if (!reader->failed && texture)
+      set_object(replay, id, CaptureObjectType_TextureView,
+                 wgpuTextureCreateView(texture,
+                                       has_descriptor ? &descriptor : NULL));
+    break;
+  }
+
+  case CaptureOp_CreateSampler: {
+    uint32_t id = get_u32(reader);
+    WGPUSamplerDescriptor descriptor = {0};
+    bool has_descriptor = get_u32(reader);
+    if (has_descriptor) {
+      descriptor.addressModeU = get_u32(reader);
+      descriptor.addressModeV = get_u32(reader);
+      descriptor.addressModeW = get_u32(reader);
+      descriptor.magFilter = get_u32(reader);
+      descriptor.minFilter = get_u32(reader);
+      descriptor.mipmapFilter = get_u32(reader);
+      descriptor.lodMinClamp = get_f32(reader);
+      descriptor.lodMaxClamp = get_f32(reader);
+      descriptor.compare = get_u32(reader);
+      descriptor.maxAnisotropy = (uint16_t)get_u32(reader);
+    }
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_Sampler,
+                 wgpuDeviceCreateSampler(device,
+                                         has_descriptor ? &descriptor : NULL));
+    break;
+  }
+
+  case CaptureOp_CreateShaderModule: {
+    uint32_t id = get_u32(reader);
+    const char *code = get_string(reader);
+    if (!reader->failed && code)
+      set_object(replay, id, CaptureObjectType_ShaderModule,
+                 frmwrk_create_shader_module(device, NULL, code));
+    break;
+  }
+
+  case CaptureOp_CreateBindGroupLayout: {
+    uint32_t id = get_u32(reader);
+    WGPUBindGroupLayoutDescriptor descriptor = {0};
+    descriptor.entryCount = get_u32(reader);
+    WGPUBindGroupLayoutEntry *entries =
+        get_array(replay, reader, descriptor.entryCount,
+                  sizeof(WGPUBindGroupLayoutEntry));
+    for (uint32_t i = 0; entries && i < descriptor.entryCount; i++) {
+      WGPUBindGroupLayoutEntry *entry = &entries[i];
+      entry->binding = get_u32(reader);
+      entry->visibility = get_u32(reader);
+      entry->buffer.type = get_u32(reader);
+      entry->buffer.hasDynamicOffset = get_u32(reader);
+      entry->buffer.minBindingSize = get_u64(reader);
+      entry->sampler.type = get_u32(reader);
+      entry->texture.sampleType = get_u32(reader);
+      entry->texture.viewDimension = get_u32(reader);
+      entry->texture.multisampled = get_u32(reader);
+      entry->storageTexture.access = get_u32(reader);
+      entry->storageTexture.format = get_u32(reader);
+      entry->storageTexture.viewDimension = get_u32(reader);
+      entry->count = get_u32(reader);
+    }
+    descriptor.entries = entries;
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_BindGroupLayout,
+                 wgpuDeviceCreateBindGroupLayout(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreatePipelineLayout: {
+    uint32_t id = get_u32(reader);
+    WGPUPipelineLayoutDescriptor descriptor = {0};
+    descriptor.bindGroupLayoutCount = get_u32(reader);
+    WGPUBindGroupLayout *layouts =
+        get_array(replay, reader, descriptor.bindGroupLayoutCount,
+                  sizeof(WGPUBindGroupLayout));
+    for (uint32_t i = 0; layouts && i < descriptor.bindGroupLayoutCount; i++)
+      layouts[i] =
+          get_object(replay, reader, CaptureObjectType_BindGroupLayout);
+    descriptor.bindGroupLayouts = layouts;
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_PipelineLayout,
+                 wgpuDeviceCreatePipelineLayout(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreateRenderPipeline: {
+    uint32_t id = get_u32(reader);
+    WGPURenderPipelineDescriptor descriptor = {0};
+    descriptor.layout =
+        get_object(replay, reader, CaptureObjectType_PipelineLayout);
+    WGPUProgrammableStageDescriptor vertex = get_stage(replay, reader);
+    descriptor.vertex.module = vertex.module;
+    descriptor.vertex.entryPoint = vertex.entryPoint;
+    descriptor.vertex.constantCount = vertex.constantCount;
+    descriptor.vertex.constants = vertex.constants;
+    descriptor.vertex.bufferCount = get_u32(reader);
+    WGPUVertexBufferLayout *buffers =
+        get_array(replay, reader, descriptor.vertex.bufferCount,
+                  sizeof(WGPUVertexBufferLayout));
+    for (uint32_t i = 0; buffers && i < descriptor.vertex.bufferCount; i++) {
+      buffers[i].arrayStride = get_u64(reader);
+      buffers[i].stepMode = get_u32(reader);
+      buffers[i].attributeCount = get_u32(reader);
+      WGPUVertexAttribute *attributes =
+          get_array(replay, reader, buffers[i].attributeCount,
+                    sizeof(WGPUVertexAttribute));
+      for (uint32_t j = 0; attributes && j < buffers[i].attributeCount; j++) {
+        attributes[j].format = get_u32(reader);
+        attributes[j].offset = get_u64(reader);
+        attributes[j].shaderLocation = get_u32(reader);
+      }
+      buffers[i].attributes = attributes;
+    }
+    descriptor.vertex.buffers = buffers;
+    descriptor.primitive.topology = get_u32(reader);
+    descriptor.primitive.stripIndexFormat = get_u32(reader);
+    descriptor.primitive.frontFace = get_u32(reader);
+    descriptor.primitive.cullMode = get_u32(reader);
+    descriptor.multisample.count = get_u32(reader);
+    descriptor.multisample.mask = get_u32(reader);
+    descriptor.multisample.alphaToCoverageEnabled = get_u32(reader);
+
+    WGPUDepthStencilState depth_stencil = {0};
+    if (get_u32(reader)) {
+      depth_stencil.format = get_u32(reader);
+      depth_stencil.depthWriteEnabled = get_u32(reader);
+      depth_stencil.depthCompare = get_u32(reader);
+      depth_stencil.stencilFront = get_stencil_face(reader);
+      depth_stencil.stencilBack = get_stencil_face(reader);
+      depth_stencil.stencilReadMask = get_u32(reader);
+      depth_stencil.stencilWriteMask = get_u32(reader);
+      depth_stencil.depthBias = get_i32(reader);
+      depth_stencil.depthBiasSlopeScale = get_f32(reader);
+      depth_stencil.depthBiasClamp = get_f32(reader);
+      descriptor.depthStencil = &depth_stencil;
+    }
+
+    WGPUFragmentState fragment = {0};
+    if (get_u32(reader)) {
+      WGPUProgrammableStageDescriptor stage = get_stage(replay, reader);
+      fragment.module = stage.module;
+      fragment.entryPoint = stage.entryPoint;
+      fragment.constantCount = stage.constantCount;
+      fragment.constants = stage.constants;
+      fragment.targetCount = get_u32(reader);
+      WGPUColorTargetState *targets = get_array(
+          replay, reader, fragment.targetCount, sizeof(WGPUColorTargetState));
+      for (uint32_t i = 0; targets && i < fragment.targetCount; i++) {
+        targets[i].format = get_u32(reader);
+        if (get_u32(reader)) {
+          WGPUBlendState *blend =
+              get_array(replay, reader, 1, sizeof(WGPUBlendState));
+          if (blend) {
+            blend->color = get_blend_component(reader);
+            blend->alpha = get_blend_component(reader);
+          }
+          targets[i].blend = blend;
+        }
+        targets[i].writeMask = get_u32(reader);
+      }
+      fragment.targets = targets;
+      descriptor.fragment = &fragment;
+    }
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_RenderPipeline,
+                 wgpuDeviceCreateRenderPipeline(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreateComputePipeline: {
+    uint32_t id = get_u32(reader);
+    WGPUComputePipelineDescriptor descriptor = {0};
+    descriptor.layout =
+        get_object(replay, reader, CaptureObjectType_PipelineLayout);
+    descriptor.compute = get_stage(replay, reader);
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_ComputePipeline,
+                 wgpuDeviceCreateComputePipeline(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreateBindGroup: {
+    uint32_t id = get_u32(reader);
+    WGPUBindGroupDescriptor descriptor = {0};
+    descriptor.layout =
+        get_object(replay, reader, CaptureObjectType_BindGroupLayout);
+    descriptor.entryCount = get_u32(reader);
+    WGPUBindGroupEntry *entries = get_array(
+        replay, reader, descriptor.entryCount, sizeof(WGPUBindGroupEntry));
+    for (uint32_t i = 0; entries && i < descriptor.entryCount; i++) {
+      WGPUBindGroupEntry *entry = &entries[i];
+      entry->binding = get_u32(reader);
+      switch (get_u32(reader)) {
+      case CaptureBinding_Buffer:
+        entry->buffer = get_object(replay, reader, CaptureObjectType_Buffer);
+        entry->offset = get_u64(reader);
+        entry->size = get_u64(reader);
+        break;
+      case CaptureBinding_Sampler:
+        entry->sampler = get_object(replay, reader, CaptureObjectType_Sampler);
+        break;
+      case CaptureBinding_TextureView:
+        entry->textureView =
+            get_object(replay, reader, CaptureObjectType_TextureView);
+        break;
+      case CaptureBinding_TextureViewArray: {
+        entry->textureViewArrayLength = get_u32(reader);
+        WGPUTextureView *views =
+            get_array(replay, reader, entry->textureViewArrayLength,
+                      sizeof(WGPUTextureView));
+        for (uint32_t j = 0; views && j < entry->textureViewArrayLength; j++)
+          views[j] = get_object(replay, reader, CaptureObjectType_TextureView);
+        entry->textureViewArray = views;
+        break;
+      }
+      default:
+        reader->failed = true;
+        break;
+      }
+    }
+    descriptor.entries = entries;
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_BindGroup,
+                 wgpuDeviceCreateBindGroup(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_CreateCommandEncoder: {
+    uint32_t id = get_u32(reader);
+    if (reader->failed)
+      break;
+    if (set_object(replay, id, CaptureObjectType_CommandEncoder,
+                   wgpuDeviceCreateCommandEncoder(
+                       device, &(const WGPUCommandEncoderDescriptor){0})))
+      replay->openEncoders++;
+    break;
+  }
+
+  case CaptureOp_FinishCommandEncoder: {
+    uint32_t encoder_id = get_u32(reader);
+    uint32_t id = get_u32(reader);
+    if (reader->failed)
+      break;
+    WGPUCommandEncoder encoder =
+        take_object(replay, encoder_id, CaptureObjectType_CommandEncoder);
+    if (!encoder)
+      break;
+    // The encoder's count carries over to its command buffer.
+    WGPUCommandBuffer commands = wgpuCommandEncoderFinish(
+        encoder, &(const WGPUCommandBufferDescriptor){0});
+    if (!set_object(replay, id, CaptureObjectType_CommandBuffer, commands)) {
+      if (commands)
+        wgpuCommandBufferDrop(commands);
+      replay->openEncoders--;
+    }
+    break;
+  }
+
+  case CaptureOp_CreateRenderBundleEncoder: {
+    uint32_t id = get_u32(reader);
+    WGPURenderBundleEncoderDescriptor descriptor = {0};
+    descriptor.colorFormatsCount = get_u32(reader);
+    WGPUTextureFormat *formats =
+        get_array(replay, reader, descriptor.colorFormatsCount,
+                  sizeof(WGPUTextureFormat));
+    for (uint32_t i = 0; formats && i < descriptor.colorFormatsCount; i++)
+      formats[i] = get_u32(reader);
+    descriptor.colorFormats = formats;
+    descriptor.depthStencilFormat = get_u32(reader);
+    descriptor.sampleCount = get_u32(reader);
+    descriptor.depthReadOnly = get_u32(reader);
+    descriptor.stencilReadOnly = get_u32(reader);
+    if (!reader->failed)
+      set_object(replay, id, CaptureObjectType_RenderBundleEncoder,
+                 wgpuDeviceCreateRenderBundleEncoder(device, &descriptor));
+    break;
+  }
+
+  case CaptureOp_FinishRenderBundleEncoder: {
+    uint32_t encoder_id = get_u32(reader);
+    uint32_t id = get_u32(reader);
+    if (reader->failed)
+      break;
+    WGPURenderBundleEncoder encoder =
+        take_object(replay, encoder_id, CaptureObjectType_RenderBundleEncoder);
+    if (!encoder)
+      break;
+    WGPURenderBundle bundle = wgpuRenderBundleEncoderFinish(
+        encoder, &(const WGPURenderBundleDescriptor){0});
+    if (!set_object(replay, id, CaptureObjectType_RenderBundle, bundle) &&
+        bundle)
+      wgpuRenderBundleDrop(bundle);
+    break;
+  }
+
+  case CaptureOp_CopyBufferToBuffer: {
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPUBuffer source = get_object(replay, reader, CaptureObjectType_Buffer);
+    uint64_t source_offset = get_u64(reader);
+    WGPUBuffer destination =
+        get_object(replay, reader, CaptureObjectType_Buffer);
+    uint64_t destination_offset = get_u64(reader);
+    uint64_t size = get_u64(reader);
+    if (!reader->failed && encoder && source && destination)
+      wgpuCommandEncoderCopyBufferToBuffer(encoder, source, source_offset,
+                                           destination, destination_offset,
+                                           size);
+    break;
+  }
+
+  case CaptureOp_CopyBufferToTexture: {
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPUImageCopyBuffer source;
+    WGPUImageCopyTexture destination;
+    bool valid = get_copy_buffer(replay, reader, &source);
+    valid &= get_copy_texture(replay, reader, &destination);
+    WGPUExtent3D extent = get_extent(reader);
+    if (!reader->failed && encoder && valid)
+      wgpuCommandEncoderCopyBufferToTexture(encoder, &source, &destination,
+                                            &extent);
+    break;
+  }
+
+  case CaptureOp_CopyTextureToBuffer: {
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPUImageCopyTexture source;
+    WGPUImageCopyBuffer destination;
+    bool valid = get_copy_texture(replay, reader, &source);
+    valid &= get_copy_buffer(replay, reader, &destination);
+    WGPUExtent3D extent = get_extent(reader);
+    if (!reader->failed && encoder && valid)
+      wgpuCommandEncoderCopyTextureToBuffer(encoder, &source, &destination,
+                                            &extent);
+    break;
+  }
+
+  case CaptureOp_CopyTextureToTexture: {
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPUImageCopyTexture source;
+    WGPUImageCopyTexture destination;
+    bool valid = get_copy_texture(replay, reader, &source);
+    valid &= get_copy_texture(replay, reader, &destination);
+    WGPUExtent3D extent = get_extent(reader);
+    if (!reader->failed && encoder && valid)
+      wgpuCommandEncoderCopyTextureToTexture(encoder, &source, &destination,
+                                             &extent);
+    break;
+  }
+
+  case CaptureOp_CopyDataToBuffer: {
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPUBuffer destination =
+        get_object(replay, reader, CaptureObjectType_Buffer);
+    uint64_t destination_offset = get_u64(reader);
+    uint32_t size;
+    const void *data = get_bytes(reader, &size);
+    uint64_t offset;
+    if (!reader->failed && encoder && destination &&
+        stage_data(replay, data, size, &offset))
+      wgpuCommandEncoderCopyBufferToBuffer(encoder, replay->staging, offset,
+                                           destination, destination_offset,
+                                           size);
+    break;
+  }
+
+  case CaptureOp_CopyDataToTexture: {
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPUImageCopyBuffer source = {0};
+    source.layout.bytesPerRow = get_u32(reader);
+    source.layout.rowsPerImage = get_u32(reader);
+    WGPUImageCopyTexture destination;
+    bool valid = get_copy_texture(replay, reader, &destination);
+    WGPUExtent3D extent = get_extent(reader);
+    uint32_t size;
+    const void *data = get_bytes(reader, &size);
+    if (!reader->failed && encoder && valid &&
+        stage_data(replay, data, size, &source.layout.offset)) {
+      source.buffer = replay->staging;
+      wgpuCommandEncoderCopyBufferToTexture(encoder, &source, &destination,
+                                            &extent);
+    }
+    break;
+  }
+
+  case CaptureOp_BeginRenderPass: {
+    uint32_t id = get_u32(reader);
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    WGPURenderPassDescriptor descriptor = {0};
+    descriptor.colorAttachmentCount = get_u32(reader);
+    WGPURenderPassColorAttachment *attachments =
+        get_array(replay, reader, descriptor.colorAttachmentCount,
+                  sizeof(WGPURenderPassColorAttachment));
+    for (uint32_t i = 0; attachments && i < descriptor.colorAttachmentCount;
+         i++) {
+      WGPURenderPassColorAttachment *attachment = &attachments[i];
+      attachment->view =
+          get_object(replay, reader, CaptureObjectType_TextureView);
+      attachment->resolveTarget =
+          get_object(replay, reader, CaptureObjectType_TextureView);
+      attachment->loadOp = get_u32(reader);
+      attachment->storeOp = get_u32(reader);
+      attachment->clearValue.r = get_f64(reader);
+      attachment->clearValue.g = get_f64(reader);
+      attachment->clearValue.b = get_f64(reader);
+      attachment->clearValue.a = get_f64(reader);
+    }
+    descriptor.colorAttachments = attachments;
+    WGPURenderPassDepthStencilAttachment depth_stencil = {0};
+    if (get_u32(reader)) {
+      depth_stencil.view =
+          get_object(replay, reader, CaptureObjectType_TextureView);
+      depth_stencil.depthLoadOp = get_u32(reader);
+      depth_stencil.depthStoreOp = get_u32(reader);
+      depth_stencil.depthClearValue = get_f32(reader);
+      depth_stencil.depthReadOnly = get_u32(reader);
+      depth_stencil.stencilLoadOp = get_u32(reader);
+      depth_stencil.stencilStoreOp = get_u32(reader);
+      depth_stencil.stencilClearValue = get_u32(reader);
+      depth_stencil.stencilReadOnly = get_u32(reader);
+      descriptor.depthStencilAttachment = &depth_stencil;
+    }
+    if (!reader->failed && encoder)
+      set_object(replay, id, CaptureObjectType_RenderPassEncoder,
+                 wgpuCommandEncoderBeginRenderPass(encoder, &descriptor));
+    break;
+  }
+
+  case CaptureOp_BeginComputePass: {
+    uint32_t id = get_u32(reader);
+    WGPUCommandEncoder encoder =
+        get_object(replay, reader, CaptureObjectType_CommandEncoder);
+    if (!reader->failed && encoder)
+      set_object(replay, id, CaptureObjectType_ComputePassEncoder,
+                 wgpuCommandEncoderBeginComputePass(
+                     encoder, &(const WGPUComputePassDescriptor){0}));
+    break;
+  }
+
+  case CaptureOp_SetPipeline: {
+    ReplayObject *encoder = get_encoder(replay, reader);
+    bool compute =
+        encoder && encoder->type == CaptureObjectType_ComputePassEncoder;
+    void *pipeline = get_object(replay, reader,
+                                compute ? CaptureObjectType_ComputePipeline
+                                        : CaptureObjectType_RenderPipeline);
+    if (reader->failed || !encoder || !pipeline)
+      break;
+    if (encoder->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderSetPipeline(encoder->handle, pipeline);
+    else if (encoder->type == CaptureObjectType_RenderBundleEncoder)
+      wgpuRenderBundleEncoderSetPipeline(encoder->handle, pipeline);
+    else if (compute)
+      wgpuComputePassEncoderSetPipeline(encoder->handle, pipeline);
+    break;
+  }
+
+  case CaptureOp_SetBindGroup: {
+    ReplayObject *encoder = get_encoder(replay, reader);
+    uint32_t group_index = get_u32(reader);
+    WGPUBindGroup group =
+        get_object(replay, reader, CaptureObjectType_BindGroup);
+    uint32_t offset_count = get_u32(reader);
+    uint32_t *offsets =
+        get_array(replay, reader, offset_count, sizeof(uint32_t));
+    for (uint32_t i = 0; offsets && i < offset_count; i++)
+      offsets[i] = get_u32(reader);
+    if (reader->failed || !encoder || !group)
+      break;
+    if (encoder->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderSetBindGroup(encoder->handle, group_index, group,
+                                        offset_count, offsets);
+    else if (encoder->type == CaptureObjectType_RenderBundleEncoder)
+      wgpuRenderBundleEncoderSetBindGroup(encoder->handle, group_index, group,
+                                          offset_count, offsets);
+    else if (encoder->type == CaptureObjectType_ComputePassEncoder)
+      wgpuComputePassEncoderSetBindGroup(encoder->handle, group_index, group,
+                                         offset_count, offsets);
+    break;
+  }
+
+  case CaptureOp_SetVertexBuffer: {
+    ReplayObject *encoder = get_encoder(replay, reader);
+    uint32_t slot = get_u32(reader);
+    WGPUBuffer buffer = get_object(replay, reader, CaptureObjectType_Buffer);
+    uint64_t offset = get_u64(reader);
+    uint64_t size = get_u64(reader);
+    if (reader->failed || !encoder || !buffer)
+      break;
+    if (encoder->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderSetVertexBuffer(encoder->handle, slot, buffer,
+                                           offset, size);
+    else if (encoder->type == CaptureObjectType_RenderBundleEncoder)
+      wgpuRenderBundleEncoderSetVertexBuffer(encoder->handle, slot, buffer,
+                                             offset, size);
+    break;
+  }
+
+  case CaptureOp_SetIndexBuffer: {
+    ReplayObject *encoder = get_encoder(replay, reader);
+    WGPUBuffer buffer = get_object(replay, reader, CaptureObjectType_Buffer);
+    WGPUIndexFormat format = get_u32(reader);
+    uint64_t offset = get_u64(reader);
+    uint64_t size = get_u64(reader);
+    if (reader->failed || !encoder || !buffer)
+      break;
+    if (encoder->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderSetIndexBuffer(encoder->handle, buffer, format,
+                                          offset, size);
+    else if (encoder->type == CaptureObjectType_RenderBundleEncoder)
+      wgpuRenderBundleEncoderSetIndexBuffer(encoder->handle, buffer, format,
+                                            offset, size);
+    break;
+  }
+
+  case CaptureOp_Draw: {
+    ReplayObject *encoder = get_encoder(replay, reader);
+    uint32_t vertex_count = get_u32(reader);
+    uint32_t instance_count = get_u32(reader);
+    uint32_t first_vertex = get_u32(reader);
+    uint32_t first_instance = get_u32(reader);
+    if (reader->failed || !encoder)
+      break;
+    if (encoder->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderDraw(encoder->handle, vertex_count, instance_count,
+                                first_vertex, first_instance);
+    else if (encoder->type == CaptureObjectType_RenderBundleEncoder)
+      wgpuRenderBundleEncoderDraw(encoder->handle, vertex_count,
+                                  instance_count, first_vertex,
+                                  first_instance);
+    break;
+  }
+
+  case CaptureOp_DrawIndexed: {
+    ReplayObject *encoder = get_encoder(replay, reader);
+    uint32_t index_count = get_u32(reader);
+    uint32_t instance_count = get_u32(reader);
+    uint32_t first_index = get_u32(reader);
+    int32_t base_vertex = get_i32(reader);
+    uint32_t first_instance = get_u32(reader);
+    if (reader->failed || !encoder)
+      break;
+    if (encoder->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderDrawIndexed(encoder->handle, index_count,
+                                       instance_count, first_index,
+                                       base_vertex, first_instance);
+    else if (encoder->type == CaptureObjectType_RenderBundleEncoder)
+      wgpuRenderBundleEncoderDrawIndexed(encoder->handle, index_count,
+                                         instance_count, first_index,
+                                         base_vertex, first_instance);
+    break;
+  }
+
+  case CaptureOp_Dispatch: {
+    WGPUComputePassEncoder pass =
+        get_object(replay, reader, CaptureObjectType_ComputePassEncoder);
+    uint32_t x = get_u32(reader);
+    uint32_t y = get_u32(reader);
+    uint32_t z = get_u32(reader);
+    if (!reader->failed && pass)
+      wgpuComputePassEncoderDispatchWorkgroups(pass, x, y, z);
+    break;
+  }
+
+  case CaptureOp_ExecuteBundles: {
+    WGPURenderPassEncoder pass =
+        get_object(replay, reader, CaptureObjectType_RenderPassEncoder);
+    uint32_t bundle_count = get_u32(reader);
+    WGPURenderBundle *bundles =
+        get_array(replay, reader, bundle_count, sizeof(WGPURenderBundle));
+    uint32_t found = 0;
+    for (uint32_t i = 0; bundles && i < bundle_count; i++) {
+      WGPURenderBundle bundle =
+          get_object(replay, reader, CaptureObjectType_RenderBundle);
+      if (bundle)
+        bundles[found++] = bundle;
+    }
+    if (!reader->failed && pass)
+      wgpuRenderPassEncoderExecuteBundles(pass, found, bundles);
+    break;
+  }
+
+  case CaptureOp_EndPass: {
+    ReplayObject *pass = get_encoder(replay, reader);
+    if (reader->failed || !pass)
+      break;
+    // Ending drops the pass.
+    if (pass->type == CaptureObjectType_RenderPassEncoder)
+      wgpuRenderPassEncoderEnd(pass->handle);
+    else if (pass->type == CaptureObjectType_ComputePassEncoder)
+      wgpuComputePassEncoderEnd(pass->handle);
+    else
+      break;
+    *pass = (ReplayObject){0};
+    break;
+  }
+
+  case CaptureOp_WriteBuffer: {
+    WGPUBuffer buffer = get_object(replay, reader, CaptureObjectType_Buffer);
+    uint64_t offset = get_u64(reader);
+    uint32_t size;
+    const void *data = get_bytes(reader, &size);
+    if (!reader->failed && buffer)
+      wgpuQueueWriteBuffer(replay->queue, buffer, offset, data, size);
+    break;
+  }
+
+  case CaptureOp_WriteTexture: {
+    WGPUImageCopyTexture destination;
+    bool valid = get_copy_texture(replay, reader, &destination);
+    WGPUTextureDataLayout layout = {0};
+    layout.offset = get_u64(reader);
+    layout.bytesPerRow = get_u32(reader);
+    layout.rowsPerImage = get_u32(reader);
+    WGPUExtent3D extent = get_extent(reader);
+    uint32_t size;
+    const void *data = get_bytes(reader, &size);
+    if (!reader->failed && valid)
+      wgpuQueueWriteTexture(replay->queue, &destination, data, size, &layout,
+                            &extent);
+    break;
+  }
+
+  case CaptureOp_UnmapBuffer: {
+    WGPUBuffer buffer = get_object(replay, reader, CaptureObjectType_Buffer);
+    uint64_t offset = get_u64(reader);
+    uint32_t size;
+    const void *data = get_bytes(reader, &size);
+    if (reader->failed || !buffer)
+      break;
+    void *mapping = wgpuBufferGetMappedRange(buffer, offset, size);
+    if (mapping)
+      memcpy(mapping, data, size);
+    wgpuBufferUnmap(buffer);
+    break;
+  }
+
+  case CaptureOp_Submit: {
+    uint32_t count = get_u32(reader);
+    WGPUCommandBuffer *commands =
+        get_array(replay, reader, count, sizeof(WGPUCommandBuffer));
+    uint32_t found = 0;
+    for (uint32_t i = 0; commands && i < count; i++) {
+      WGPUCommandBuffer buffer = take_object(replay, get_u32(reader),
+                                             CaptureObjectType_CommandBuffer);
+      if (buffer)
+        commands[found++] = buffer;
+    }
+    if (reader->failed)
+      break;
+    // Submitting drops the command buffers.
+    wgpuQueueSubmit(replay->queue, found, commands);
+    replay->openEncoders -= found;
+    if (replay->openEncoders == 0)
+      replay->stagingUsed = 0;
+    break;
+  }
+
+  case CaptureOp_AcquireTarget: {
+    uint32_t id = get_u32(reader);
+    uint32_t width = get_u32(reader);
+    uint32_t height = get_u32(reader);
+    WGPUTextureFormat format = get_u32(reader);
+    if (reader->failed)
+      break;
+    if (set_target(replay, width, height, format))
+      set_object(replay, id, CaptureObjectType_TextureView,
+                 wgpuTextureCreateView(replay->target, NULL));
+    else
+      replay->skipped++;
+    break;
+  }
+
+  case CaptureOp_Drop: {
+    uint32_t id = get_u32(reader);
+    if (!reader->failed)
+      drop_object(replay, id);
+    break;
+  }
+
+  default:
+    // Unknown records are skipped whole, so a newer trace still replays.
+    replay->skipped++;
+    break;
+  }
+  return !reader->failed;
+}
+
+// Reads the next record's header; `record` then covers its payload.
+static bool next_record(ReplayReader *reader, CaptureOp *op,
+                        ReplayReader *record) {
+  const CaptureRecordHeader *data = get(reader, sizeof(CaptureRecordHeader));
+  if (!data)
+    return false;
+  CaptureRecordHeader header;
+  memcpy(&header, data, sizeof(header));
+  const unsigned char *payload = get(reader, header.size);
+  if (!payload)
+    return false;
+  *op = header.op;
+  *record = (ReplayReader){.data = payload, .size = header.size};
+  return true;
+}
+
+static bool replay_loop(Replay *replay, const FrmwrkMappedFile *file,
+                        uint32_t loop) {
+  ReplayReader reader = {
+    .data = (const unsigned char *)file->data,
+    .size = file->size,
+    .position = 2 * sizeof(uint32_t),
+  };
+  uint32_t frames = 0;
+  uint64_t start = frmwrk_time_ns();
+  uint64_t frame_start = start;
+  while (reader.position < reader.size) {
+    CaptureOp op;
+    ReplayReader record;
+    if (!next_record(&reader, &op, &record) ||
+        !replay_record(replay, op, &record)) {
+      printf(LOG_PREFIX " malformed record at byte %zu\n", reader.position);
+      return false;
+    }
+    scratch_reset(replay);
+    if (op == CaptureOp_FrameEnd) {
+      uint64_t now = frmwrk_time_ns();
+      // The first loop compiles every pipeline, so it is reported on its own.
+      if (loop > 0)
+        add_time(&replay->frames, (now - frame_start) / 1e6);
+      frame_start = now;
+      frames++;
+      wgpuDevicePoll(replay->device, false, NULL);
+    }
+  }
+  drop_all_objects(replay);
+  wgpuDevicePoll(replay->device, true, NULL);
+  double ms = (frmwrk_time_ns() - start) / 1e6;
+  if (loop > 0)
+    add_time(&replay->loops, ms);
+  printf(LOG_PREFIX " loop %u: %u frames in %.2f ms%s\n", loop, frames, ms,
+         loop == 0 ? " (warm-up)" : "");
+  return true;
+}
+
+static bool create_device(Replay *replay, const FrmwrkMappedFile *file) {
+  ReplayReader reader = {
+    .data = (const unsigned char *)file->data,
+    .size = file->size,
+  };
+  uint32_t magic = get_u32(&reader);
+  uint32_t version = get_u32(&reader);
+  if (magic != CAPTURE_MAGIC || version != CAPTURE_VERSION) {
+    printf(LOG_PREFIX " not a version %u trace\n", CAPTURE_VERSION);
+    return false;
+  }
+
+  // The trace starts with the device's features.
+  CaptureOp op;
+  ReplayReader record;
+  if (!next_record(&reader, &op, &record) || op != CaptureOp_Device) {
+    printf(LOG_PREFIX " trace does not start with its device\n");
+    return false;
+  }
+  uint32_t recorded_count = get_u32(&record);
+
+  replay->instance = wgpuCreateInstance(&(const WGPUInstanceDescriptor){0});
+  if (!replay->instance)
+    return false;
+  wgpuInstanceRequestAdapter(replay->instance,
+                             &(const WGPURequestAdapterOptions){0},
+                             handle_request_adapter, replay);
+  if (!replay->adapter)
+    return false;
+
+  WGPUFeatureName features[CAPTURE_MAX_FEATURES];
+  uint32_t feature_count = 0;
+  for (uint32_t i = 0; i < recorded_count && !record.failed; i++) {
+    WGPUFeatureName feature = get_u32(&record);
+    if (feature_count == CAPTURE_MAX_FEATURES)
+      break;
+    if (wgpuAdapterHasFeature(replay->adapter, feature))
+      features[feature_count++] = feature;
+    else
+      printf(LOG_PREFIX " adapter lacks feature %#.8x the trace used\n",
+             feature);
+  }
+
+  WGPUSupportedLimits adapter_limits = {0};
+  if (!wgpuAdapterGetLimits(replay->adapter, &adapter_limits))
+    return false;
+  wgpuAdapterRequestDevice(replay->adapter, &(WGPUDeviceDescriptor){
+    .requiredFeaturesCount = feature_count,
+    .requiredFeatures = features,
+    .requiredLimits = &(const WGPURequiredLimits){
+      .limits = adapter_limits.limits
+    }
+  }, handle_request_device, replay);
+  if (!replay->device)
+    return false;
+  replay->queue = wgpuDeviceGetQueue(replay->device);
+  wgpuDeviceSetUncapturedErrorCallback(replay->device, handle_uncaptured_error,
+                                       replay);
+  return replay->queue != NULL;
+}
+
+static void drop_replay(Replay *replay) {
+  if (replay->device) {
+    drop_all_objects(replay);
+    wgpuDevicePoll(replay->device, true, NULL);
+  }
+  if (replay->target)
+    wgpuTextureDrop(replay->target);
+  if (replay->staging)
+    wgpuBufferDrop(replay->staging);
+  if (replay->queue)
+    wgpuQueueDrop(replay->queue);
+  if (replay->device)
+    wgpuDeviceDrop(replay->device);
+  if (replay->adapter)
+    wgpuAdapterDrop(replay->adapter);
+  if (replay->instance)
+    wgpuInstanceDrop(replay->instance);
+  scratch_reset(replay);
+  free(replay->scratch);
+  free(replay->retired);
+  free(replay->padded);
+  free(replay->objects);
+}
+
+static void print_times(const char *name, const ReplayTimes *times) {
+  if (times->count == 0)
+    return;
+  printf(LOG_PREFIX " %s: mean %.3f ms, min %.3f ms, max %.3f ms over %llu\n",
+         name, times->sumMs / times->count, times->minMs, times->maxMs,
+         (unsigned long long)times->count);
+}
+
+static void print_usage(const char *program) {
+  printf("usage: %s TRACE.fcap [--loops N]\n", program);
+}
+
+static bool parse_args(ReplayOptions *options, int argc, char *argv[]) {
+  options->loops = 10;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (strcmp(arg, "--loops") == 0 && i + 1 < argc) {
+      options->loops = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strncmp(arg, "--", 2) != 0 && !options->path) {
+      options->path = arg;
+    } else {
+      printf(LOG_PREFIX " unknown option '%s'\n", arg);
+      return false;
+    }
+  }
+  return options->path && options->loops > 0;
+}
+
+int main(int argc, char *argv[]) {
+  ReplayOptions options = {0};
+  if (!parse_args(&options, argc, argv)) {
+    print_usage(argv[0]);
+    return 1;
+  }
+
+  FrmwrkMappedFile file;
+  if (!frmwrk_map_file(options.path, &file)) {
+    printf(LOG_PREFIX " could not read %s\n", options.path);
+    return 1;
+  }
+
+  frmwrk_setup_logging(WGPULogLevel_Warn);
+  Replay replay = {0};
+  int ret = 1;
+  if (!create_device(&replay, &file)) {
+    printf(LOG_PREFIX " could not create a device for the trace\n");
+    goto cleanup_and_exit;
+  }
+
+  printf(LOG_PREFIX " %s: %.1f MiB, %u loops\n", options.path,
+         file.size / (1024.0 * 1024.0), options.loops);
+  ret = 0;
+  for (uint32_t loop = 0; loop < options.loops && ret == 0; loop++) {
+    if (!replay_loop(&replay, &file, loop))
+      ret = 1;
+  }
+  print_times("frame issue", &replay.frames);
+  print_times("loop with GPU wait", &replay.loops);
+  if (replay.skipped)
+    printf(LOG_PREFIX " %llu records skipped for missing objects\n",
+           (unsigned long long)replay.skipped);
+  if (replay.errors) {
+    printf(LOG_PREFIX " %llu validation errors\n",
+           (unsigned long long)replay.errors);
+    ret = 1;
+  }
+
+cleanup_and_exit:
+  drop_replay(&replay);
+  frmwrk_unmap_file(&file);
+  return ret;
+}
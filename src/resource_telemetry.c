@@ -0,0 +1,256 @@
+#include "resource_telemetry.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *counter_names[TelemetryCounter_Count] = {
+  "adapters",
+  "devices",
+  "pipelineLayouts",
+  "shaderModules",
+  "bindGroupLayouts",
+  "bindGroups",
+  "commandBuffers",
+  "renderBundles",
+  "renderPipelines",
+  "computePipelines",
+  "querySets",
+  "buffers",
+  "textures",
+  "textureViews",
+  "samplers",
+  "surfaces",
+};
+
+// Where each hub counter lives in a WGPUHubReport, in TelemetryCounter order.
+static const size_t hub_offsets[TelemetryCounter_Surfaces] = {
+  offsetof(WGPUHubReport, adapters),
+  offsetof(WGPUHubReport, devices),
+  offsetof(WGPUHubReport, pipelineLayouts),
+  offsetof(WGPUHubReport, shaderModules),
+  offsetof(WGPUHubReport, bindGroupLayouts),
+  offsetof(WGPUHubReport, bindGroups),
+  offsetof(WGPUHubReport, commandBuffers),
+  offsetof(WGPUHubReport, renderBundles),
+  offsetof(WGPUHubReport, renderPipelines),
+  offsetof(WGPUHubReport, computePipelines),
+  offsetof(WGPUHubReport, querySets),
+  offsetof(WGPUHubReport, buffers),
+  offsetof(WGPUHubReport, textures),
+  offsetof(WGPUHubReport, textureViews),
+  offsetof(WGPUHubReport, samplers),
+};
+
+const char *frmwrk_telemetry_counter_name(TelemetryCounter counter) {
+  return counter < TelemetryCounter_Count ? counter_names[counter]
+                                          : "unknown_counter";
+}
+
+static const WGPUHubReport *backend_hub(const WGPUGlobalReport *report) {
+  switch (report->backendType) {
+  case WGPUBackendType_D3D11:
+    return &report->dx11;
+  case WGPUBackendType_D3D12:
+    return &report->dx12;
+  case WGPUBackendType_Metal:
+    return &report->metal;
+  case WGPUBackendType_Vulkan:
+    return &report->vulkan;
+  case WGPUBackendType_OpenGL:
+    return &report->gl;
+  default:
+    return NULL;
+  }
+}
+
+ResourceTelemetry *frmwrk_create_resource_telemetry(WGPUInstance instance,
+                                                    uint32_t interval) {
+  ResourceTelemetry *telemetry = calloc(1, sizeof(ResourceTelemetry));
+  if (!telemetry)
+    return NULL;
+  telemetry->instance = instance;
+  telemetry->interval = interval ? interval : RESOURCE_TELEMETRY_DEFAULT_INTERVAL;
+  telemetry->leakRises = RESOURCE_TELEMETRY_LEAK_RISES;
+  return telemetry;
+}
+
+void frmwrk_drop_resource_telemetry(ResourceTelemetry *telemetry) {
+  free(telemetry);
+}
+
+static const TelemetrySample *sample_at(const ResourceTelemetry *telemetry,
+                                        uint64_t index) {
+  return &telemetry->samples[index % RESOURCE_TELEMETRY_CAPACITY];
+}
+
+static void raise_alarm(ResourceTelemetry *telemetry, TelemetryCounter counter,
+                        const TelemetrySample *sample) {
+  const TelemetryTrend *trend = &telemetry->trends[counter];
+  TelemetryAlarm alarm = (TelemetryAlarm){
+    .counter = counter,
+    .fromFrame = trend->baselineFrame,
+    .toFrame = sample->frame,
+    .fromValue = trend->baseline,
+    .toValue = sample->values[counter]
+  };
+  printf("[resource_telemetry] possible leak: %s rose %u times from %u to %u "
+         "between frames %llu and %llu\n",
+         counter_names[counter], trend->rises, alarm.fromValue, alarm.toValue,
+         (unsigned long long)alarm.fromFrame,
+         (unsigned long long)alarm.toFrame);
+  if (telemetry->alarmCount < RESOURCE_TELEMETRY_MAX_ALARMS)
+    telemetry->alarms[telemetry->alarmCount++] = alarm;
+  else
+    telemetry->droppedAlarms++;
+}
+
+// Counters that stay flat keep their streak; only a fall resets it.
+static void update_trends(ResourceTelemetry *telemetry,
+                          const TelemetrySample *previous,
+                          const TelemetrySample *sample) {
+  for (int counter = 0; counter < TelemetryCounter_Count; counter++) {
+    TelemetryTrend *trend = &telemetry->trends[counter];
+    uint32_t value = sample->values[counter];
+    if (!previous || value < previous->values[counter]) {
+      *trend = (TelemetryTrend){
+        .baseline = value,
+        .baselineFrame = sample->frame
+      };
+    } else if (value > previous->values[counter]) {
+      trend->rises++;
+      if (trend->rises >= telemetry->leakRises && !trend->alarmed) {
+        raise_alarm(telemetry, (TelemetryCounter)counter, sample);
+        trend->alarmed = true;
+      }
+    }
+  }
+}
+
+const TelemetrySample *
+frmwrk_resource_telemetry_sample(ResourceTelemetry *telemetry, uint64_t frame) {
+  uint64_t start = frmwrk_time_ns();
+  WGPUGlobalReport report;
+  wgpuGenerateReport(telemetry->instance, &report);
+
+  TelemetrySample *sample =
+      &telemetry->samples[telemetry->sampleCount % RESOURCE_TELEMETRY_CAPACITY];
+  *sample = (TelemetrySample){.frame = frame, .timeNs = start};
+  telemetry->backendType = report.backendType;
+  const WGPUHubReport *hub = backend_hub(&report);
+  if (hub) {
+    for (int counter = 0; counter < TelemetryCounter_Surfaces; counter++) {
+      const WGPUStorageReport *storage =
+          (const WGPUStorageReport *)((const char *)hub + hub_offsets[counter]);
+      sample->values[counter] = (uint32_t)storage->numOccupied;
+    }
+  }
+  sample->values[TelemetryCounter_Surfaces] =
+      (uint32_t)report.surfaces.numOccupied;
+
+  update_trends(telemetry,
+                telemetry->sampleCount
+                    ? sample_at(telemetry, telemetry->sampleCount - 1)
+                    : NULL,
+                sample);
+  telemetry->sampleCount++;
+  telemetry->sampleNs += frmwrk_time_ns() - start;
+  return sample;
+}
+
+bool frmwrk_resource_telemetry_update(ResourceTelemetry *telemetry,
+                                      uint64_t frame) {
+  if (frame % telemetry->interval != 0)
+    return false;
+  frmwrk_resource_telemetry_sample(telemetry, frame);
+  return true;
+}
+
+const TelemetrySample *
+frmwrk_resource_telemetry_latest(const ResourceTelemetry *telemetry) {
+  if (telemetry->sampleCount == 0)
+    return NULL;
+  return sample_at(telemetry, telemetry->sampleCount - 1);
+}
+
+bool frmwrk_resource_telemetry_diff(const ResourceTelemetry *telemetry,
+                                    int64_t diff[TelemetryCounter_Count]) {
+  if (telemetry->sampleCount < 2)
+    return false;
+  const TelemetrySample *latest = sample_at(telemetry, telemetry->sampleCount - 1);
+  const TelemetrySample *previous =
+      sample_at(telemetry, telemetry->sampleCount - 2);
+  for (int counter = 0; counter < TelemetryCounter_Count; counter++)
+    diff[counter] =
+        (int64_t)latest->values[counter] - (int64_t)previous->values[counter];
+  return true;
+}
+
+void frmwrk_resource_telemetry_print(const ResourceTelemetry *telemetry) {
+  const TelemetrySample *latest = frmwrk_resource_telemetry_latest(telemetry);
+  if (!latest) {
+    printf("[resource_telemetry] no samples\n");
+    return;
+  }
+  int64_t diff[TelemetryCounter_Count] = {0};
+  frmwrk_resource_telemetry_diff(telemetry, diff);
+
+  printf("[resource_telemetry] frame %llu, %llu samples, %.3f ms/sample\n",
+         (unsigned long long)latest->frame,
+         (unsigned long long)telemetry->sampleCount,
+         telemetry->sampleNs / 1e6 / telemetry->sampleCount);
+  for (int counter = 0; counter < TelemetryCounter_Count; counter++) {
+    if (latest->values[counter] == 0 && diff[counter] == 0)
+      continue;
+    printf("[resource_telemetry] %-18s %8u %+8lld%s\n", counter_names[counter],
+           latest->values[counter], (long long)diff[counter],
+           telemetry->trends[counter].alarmed ? "  (leaking?)" : "");
+  }
+  if (telemetry->alarmCount + telemetry->droppedAlarms > 0)
+    printf("[resource_telemetry] %u leak alarms\n",
+           telemetry->alarmCount + telemetry->droppedAlarms);
+}
+
+bool frmwrk_resource_telemetry_dump(const ResourceTelemetry *telemetry,
+                                    const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    perror("fopen");
+    return false;
+  }
+
+  fprintf(file, "{\n  \"interval\": %u,\n  \"backendType\": %d,\n",
+          telemetry->interval, (int)telemetry->backendType);
+  fprintf(file, "  \"counters\": [");
+  for (int counter = 0; counter < TelemetryCounter_Count; counter++)
+    fprintf(file, "%s\"%s\"", counter ? ", " : "", counter_names[counter]);
+  fprintf(file, "],\n  \"samples\": [\n");
+
+  uint64_t count = telemetry->sampleCount < RESOURCE_TELEMETRY_CAPACITY
+                       ? telemetry->sampleCount
+                       : RESOURCE_TELEMETRY_CAPACITY;
+  uint64_t first = telemetry->sampleCount - count;
+  for (uint64_t i = first; i < telemetry->sampleCount; i++) {
+    const TelemetrySample *sample = sample_at(telemetry, i);
+    fprintf(file, "    {\"frame\": %llu, \"timeNs\": %llu, \"values\": [",
+            (unsigned long long)sample->frame,
+            (unsigned long long)sample->timeNs);
+    for (int counter = 0; counter < TelemetryCounter_Count; counter++)
+      fprintf(file, "%s%u", counter ? ", " : "", sample->values[counter]);
+    fprintf(file, "]}%s\n", i + 1 < telemetry->sampleCount ? "," : "");
+  }
+
+  fprintf(file, "  ],\n  \"alarms\": [\n");
+  for (uint32_t i = 0; i < telemetry->alarmCount; i++) {
+    const TelemetryAlarm *alarm = &telemetry->alarms[i];
+    fprintf(file,
+            "    {\"counter\": \"%s\", \"fromFrame\": %llu, \"toFrame\": %llu, "
+            "\"fromValue\": %u, \"toValue\": %u}%s\n",
+            counter_names[alarm->counter], (unsigned long long)alarm->fromFrame,
+            (unsigned long long)alarm->toFrame, alarm->fromValue,
+            alarm->toValue, i + 1 < telemetry->alarmCount ? "," : "");
+  }
+  fprintf(file, "  ],\n  \"droppedAlarms\": %u\n}\n", telemetry->droppedAlarms);
+
+  fclose(file);
+  return true;
+}
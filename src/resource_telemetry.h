@@ -0,0 +1,104 @@
+#ifndef RESOURCE_TELEMETRY_H
+#define RESOURCE_TELEMETRY_H
+
+#include "framework.h"
+
+// Samples kept, oldest overwritten first.
+#define RESOURCE_TELEMETRY_CAPACITY 1024
+#define RESOURCE_TELEMETRY_DEFAULT_INTERVAL 60
+// Rises without a fall in between before a counter is reported as leaking.
+#define RESOURCE_TELEMETRY_LEAK_RISES 8
+#define RESOURCE_TELEMETRY_MAX_ALARMS 64
+
+// Live objects per registry of the active backend's hub, plus surfaces.
+typedef enum TelemetryCounter {
+  TelemetryCounter_Adapters,
+  TelemetryCounter_Devices,
+  TelemetryCounter_PipelineLayouts,
+  TelemetryCounter_ShaderModules,
+  TelemetryCounter_BindGroupLayouts,
+  TelemetryCounter_BindGroups,
+  TelemetryCounter_CommandBuffers,
+  TelemetryCounter_RenderBundles,
+  TelemetryCounter_RenderPipelines,
+  TelemetryCounter_ComputePipelines,
+  TelemetryCounter_QuerySets,
+  TelemetryCounter_Buffers,
+  TelemetryCounter_Textures,
+  TelemetryCounter_TextureViews,
+  TelemetryCounter_Samplers,
+  TelemetryCounter_Surfaces,
+  TelemetryCounter_Count
+} TelemetryCounter;
+
+typedef struct TelemetrySample {
+  uint64_t frame;
+  uint64_t timeNs;
+  // numOccupied of each registry.
+  uint32_t values[TelemetryCounter_Count];
+} TelemetrySample;
+
+typedef struct TelemetryAlarm {
+  TelemetryCounter counter;
+  // Where the unbroken growth started and the sample that crossed the limit.
+  uint64_t fromFrame;
+  uint64_t toFrame;
+  uint32_t fromValue;
+  uint32_t toValue;
+} TelemetryAlarm;
+
+// Growth since the counter last fell.
+typedef struct TelemetryTrend {
+  uint32_t rises;
+  uint32_t baseline;
+  uint64_t baselineFrame;
+  bool alarmed;
+} TelemetryTrend;
+
+// Periodic snapshots of wgpuGenerateReport. Each sample keeps one number per
+// registry, so the whole history fits in a fixed ring, and every sample is
+// compared with the previous one: a counter that keeps rising without ever
+// falling back raises one alarm until it drops again.
+typedef struct ResourceTelemetry {
+  WGPUInstance instance;
+  uint32_t interval;
+  uint32_t leakRises;
+  WGPUBackendType backendType;
+
+  TelemetrySample samples[RESOURCE_TELEMETRY_CAPACITY];
+  uint64_t sampleCount;
+  TelemetryTrend trends[TelemetryCounter_Count];
+  TelemetryAlarm alarms[RESOURCE_TELEMETRY_MAX_ALARMS];
+  uint32_t alarmCount;
+  // Alarms raised past the array's end, counted but not kept.
+  uint32_t droppedAlarms;
+  uint64_t sampleNs;
+} ResourceTelemetry;
+
+// interval 0 uses RESOURCE_TELEMETRY_DEFAULT_INTERVAL.
+ResourceTelemetry *frmwrk_create_resource_telemetry(WGPUInstance instance,
+                                                    uint32_t interval);
+void frmwrk_drop_resource_telemetry(ResourceTelemetry *telemetry);
+
+// Call once per frame; samples every `interval` frames. Returns true when it
+// took a sample.
+bool frmwrk_resource_telemetry_update(ResourceTelemetry *telemetry,
+                                      uint64_t frame);
+// Samples right away, outside the interval.
+const TelemetrySample *
+frmwrk_resource_telemetry_sample(ResourceTelemetry *telemetry, uint64_t frame);
+// The most recent sample, or NULL before the first.
+const TelemetrySample *
+frmwrk_resource_telemetry_latest(const ResourceTelemetry *telemetry);
+// Latest sample minus the one before it. False until there are two.
+bool frmwrk_resource_telemetry_diff(const ResourceTelemetry *telemetry,
+                                    int64_t diff[TelemetryCounter_Count]);
+
+const char *frmwrk_telemetry_counter_name(TelemetryCounter counter);
+// The latest values with their change since the previous sample, then alarms.
+void frmwrk_resource_telemetry_print(const ResourceTelemetry *telemetry);
+// Writes every sample in the ring and the alarms as JSON.
+bool frmwrk_resource_telemetry_dump(const ResourceTelemetry *telemetry,
+                                    const char *path);
+
+#endif // RESOURCE_TELEMETRY_H
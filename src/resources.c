@@ -0,0 +1,295 @@
+#include "resources.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stb_image.h"
+
+static const char *type_names[ResourceType_Count] = {
+  "textures",
+  "buffers",
+  "samplers",
+  "bindGroups",
+};
+
+static uint32_t make_handle(uint32_t index, uint32_t generation) {
+  return (generation << RESOURCE_INDEX_BITS) | index;
+}
+
+static ResourceSlot *resolve(const ResourcePool *pool, uint32_t id) {
+  uint32_t index = id & (RESOURCE_MAX_SLOTS - 1);
+  uint32_t generation = id >> RESOURCE_INDEX_BITS;
+  if (id == 0 || index >= pool->slotCount)
+    return NULL;
+  ResourceSlot *slot = &pool->slots[index];
+  return slot->live && slot->generation == generation ? slot : NULL;
+}
+
+static void drop_object(ResourceType type, ResourceSlot *slot) {
+  switch (type) {
+  case ResourceType_Texture:
+    if (slot->texture.view)
+      wgpuTextureViewDrop(slot->texture.view);
+    if (slot->texture.texture)
+      wgpuTextureDrop(slot->texture.texture);
+    break;
+  case ResourceType_Buffer:
+    wgpuBufferDrop(slot->buffer);
+    break;
+  case ResourceType_Sampler:
+    wgpuSamplerDrop(slot->sampler);
+    break;
+  case ResourceType_BindGroup:
+    wgpuBindGroupDrop(slot->bindGroup);
+    break;
+  default:
+    break;
+  }
+}
+
+ResourceRegistry *frmwrk_create_resource_registry(WGPUDevice device) {
+  ResourceRegistry *registry = calloc(1, sizeof(ResourceRegistry));
+  if (!registry)
+    return NULL;
+  registry->device = device;
+  registry->queue = wgpuDeviceGetQueue(device);
+  return registry;
+}
+
+void frmwrk_drop_resource_registry(ResourceRegistry *registry) {
+  if (!registry)
+    return;
+
+  // Also runs any outstanding work-done callbacks, which point at us.
+  wgpuDevicePoll(registry->device, true, NULL);
+
+  for (uint32_t i = 0; i < registry->deferredCount; i++)
+    drop_object(registry->deferred[i].type, &registry->deferred[i].slot);
+  free(registry->deferred);
+
+  for (int type = 0; type < ResourceType_Count; type++) {
+    ResourcePool *pool = &registry->pools[type];
+    for (uint32_t i = 0; i < pool->slotCount; i++) {
+      if (pool->slots[i].live)
+        drop_object(type, &pool->slots[i]);
+    }
+    free(pool->slots);
+    free(pool->freeSlots);
+  }
+  if (registry->queue)
+    wgpuQueueDrop(registry->queue);
+  free(registry);
+}
+
+static uint32_t add(ResourceRegistry *registry, ResourceType type,
+                    const ResourceSlot *object) {
+  ResourcePool *pool = &registry->pools[type];
+  uint32_t index;
+  if (pool->freeCount > 0) {
+    index = pool->freeSlots[--pool->freeCount];
+    registry->stats.recycledSlots++;
+  } else {
+    if (pool->slotCount == RESOURCE_MAX_SLOTS)
+      return 0;
+    if (pool->slotCount == pool->slotCapacity) {
+      uint32_t capacity = pool->slotCapacity ? pool->slotCapacity * 2 : 64;
+      ResourceSlot *slots =
+          realloc(pool->slots, sizeof(ResourceSlot) * capacity);
+      if (!slots)
+        return 0;
+      pool->slots = slots;
+      uint32_t *free_slots =
+          realloc(pool->freeSlots, sizeof(uint32_t) * capacity);
+      if (!free_slots)
+        return 0;
+      pool->freeSlots = free_slots;
+      pool->slotCapacity = capacity;
+    }
+    index = pool->slotCount++;
+    pool->slots[index].generation = 1;
+  }
+
+  ResourceSlot *slot = &pool->slots[index];
+  uint32_t generation = slot->generation;
+  *slot = *object;
+  slot->generation = generation;
+  slot->live = true;
+  pool->liveCount++;
+  registry->stats.live[type]++;
+  return make_handle(index, generation);
+}
+
+static void release(ResourceRegistry *registry, ResourceType type,
+                    uint32_t id) {
+  ResourcePool *pool = &registry->pools[type];
+  ResourceSlot *slot = resolve(pool, id);
+  if (!slot)
+    return;
+
+  if (registry->deferredCount == registry->deferredCapacity) {
+    uint32_t capacity =
+        registry->deferredCapacity ? registry->deferredCapacity * 2 : 64;
+    DeferredRelease *deferred =
+        realloc(registry->deferred, sizeof(DeferredRelease) * capacity);
+    if (!deferred) {
+      // Better to stall than to drop something the GPU may still read.
+      printf("[resources] deferred queue full, waiting for the GPU\n");
+      wgpuDevicePoll(registry->device, true, NULL);
+      drop_object(type, slot);
+      registry->stats.destroyed++;
+      goto recycle;
+    }
+    registry->deferred = deferred;
+    registry->deferredCapacity = capacity;
+  }
+  registry->deferred[registry->deferredCount++] = (DeferredRelease){
+    .type = type,
+    .slot = *slot,
+    .frame = registry->frame
+  };
+  registry->stats.deferred = registry->deferredCount;
+
+recycle:
+  // The slot is free right away; only the object itself waits.
+  slot->live = false;
+  slot->generation = (slot->generation + 1) & RESOURCE_GENERATION_MASK;
+  if (slot->generation == 0)
+    slot->generation = 1;
+  pool->freeSlots[pool->freeCount++] = (uint32_t)(slot - pool->slots);
+  pool->liveCount--;
+  registry->stats.live[type]--;
+  registry->stats.released++;
+}
+
+TextureId frmwrk_resources_add_texture(ResourceRegistry *registry,
+                                       Texture2D *texture) {
+  if (texture->data) {
+    stbi_image_free(texture->data);
+    texture->data = NULL;
+  }
+  ResourceSlot object = {.texture = *texture};
+  return add(registry, ResourceType_Texture, &object);
+}
+
+BufferId frmwrk_resources_add_buffer(ResourceRegistry *registry,
+                                     WGPUBuffer buffer) {
+  ResourceSlot object = {.buffer = buffer};
+  return add(registry, ResourceType_Buffer, &object);
+}
+
+SamplerId frmwrk_resources_add_sampler(ResourceRegistry *registry,
+                                       WGPUSampler sampler) {
+  ResourceSlot object = {.sampler = sampler};
+  return add(registry, ResourceType_Sampler, &object);
+}
+
+BindGroupId frmwrk_resources_add_bind_group(ResourceRegistry *registry,
+                                            WGPUBindGroup bindGroup) {
+  ResourceSlot object = {.bindGroup = bindGroup};
+  return add(registry, ResourceType_BindGroup, &object);
+}
+
+const Texture2D *frmwrk_resources_texture(const ResourceRegistry *registry,
+                                          TextureId id) {
+  ResourceSlot *slot = resolve(&registry->pools[ResourceType_Texture], id);
+  return slot ? &slot->texture : NULL;
+}
+
+WGPUBuffer frmwrk_resources_buffer(const ResourceRegistry *registry,
+                                   BufferId id) {
+  ResourceSlot *slot = resolve(&registry->pools[ResourceType_Buffer], id);
+  return slot ? slot->buffer : NULL;
+}
+
+WGPUSampler frmwrk_resources_sampler(const ResourceRegistry *registry,
+                                     SamplerId id) {
+  ResourceSlot *slot = resolve(&registry->pools[ResourceType_Sampler], id);
+  return slot ? slot->sampler : NULL;
+}
+
+WGPUBindGroup frmwrk_resources_bind_group(const ResourceRegistry *registry,
+                                          BindGroupId id) {
+  ResourceSlot *slot = resolve(&registry->pools[ResourceType_BindGroup], id);
+  return slot ? slot->bindGroup : NULL;
+}
+
+void frmwrk_resources_release_texture(ResourceRegistry *registry,
+                                      TextureId id) {
+  release(registry, ResourceType_Texture, id);
+}
+
+void frmwrk_resources_release_buffer(ResourceRegistry *registry, BufferId id) {
+  release(registry, ResourceType_Buffer, id);
+}
+
+void frmwrk_resources_release_sampler(ResourceRegistry *registry,
+                                      SamplerId id) {
+  release(registry, ResourceType_Sampler, id);
+}
+
+void frmwrk_resources_release_bind_group(ResourceRegistry *registry,
+                                         BindGroupId id) {
+  release(registry, ResourceType_BindGroup, id);
+}
+
+static void handle_work_done(WGPUQueueWorkDoneStatus status, void *userdata) {
+  UNUSED(status)
+  ResourceFence *fence = userdata;
+  // Work-done callbacks fire in submission order, so everything released up
+  // to and including this frame is finished with.
+  if (fence->frame + 1 > fence->registry->retiredFrame)
+    fence->registry->retiredFrame = fence->frame + 1;
+  fence->pending = false;
+}
+
+void frmwrk_resources_frame_submitted(ResourceRegistry *registry) {
+  // Fence releases not yet covered by a callback, from this frame or from
+  // earlier ones that found every fence busy. Releases are appended in frame
+  // order, so the last one is the newest.
+  bool needs_fence =
+      registry->deferredCount > 0 &&
+      registry->deferred[registry->deferredCount - 1].frame >=
+          registry->fencedFrame;
+  for (uint32_t i = 0; needs_fence && i < RESOURCE_MAX_FENCES; i++) {
+    ResourceFence *fence = &registry->fences[i];
+    if (fence->pending)
+      continue;
+    *fence = (ResourceFence){
+      .registry = registry,
+      .frame = registry->frame,
+      .pending = true
+    };
+    wgpuQueueOnSubmittedWorkDone(registry->queue, handle_work_done, fence);
+    registry->fencedFrame = registry->frame + 1;
+    break;
+  }
+  registry->frame++;
+
+  wgpuDevicePoll(registry->device, false, NULL);
+  // Releases are appended in frame order, so retired ones form a prefix.
+  uint32_t retired = 0;
+  while (retired < registry->deferredCount &&
+         registry->deferred[retired].frame < registry->retiredFrame) {
+    DeferredRelease *release = &registry->deferred[retired];
+    drop_object(release->type, &release->slot);
+    retired++;
+  }
+  if (retired > 0) {
+    memmove(registry->deferred, registry->deferred + retired,
+            sizeof(DeferredRelease) * (registry->deferredCount - retired));
+    registry->deferredCount -= retired;
+    registry->stats.destroyed += retired;
+  }
+  registry->stats.deferred = registry->deferredCount;
+}
+
+void frmwrk_resources_print(const ResourceRegistry *registry) {
+  const ResourceStats *stats = &registry->stats;
+  printf("[resources] live:");
+  for (int type = 0; type < ResourceType_Count; type++)
+    printf(" %s=%u", type_names[type], stats->live[type]);
+  printf("\n[resources] deferred=%u released=%llu destroyed=%llu "
+         "recycledSlots=%llu\n",
+         stats->deferred, (unsigned long long)stats->released,
+         (unsigned long long)stats->destroyed,
+         (unsigned long long)stats->recycledSlots);
+}
@@ -0,0 +1,135 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include "framework.h"
+
+// Handles pack a slot index with the slot's generation, so a handle to a
+// released resource stops resolving as soon as it is released, even after its
+// slot has been recycled. 0 is never a valid handle.
+#define RESOURCE_INDEX_BITS 20
+#define RESOURCE_MAX_SLOTS (1u << RESOURCE_INDEX_BITS)
+#define RESOURCE_GENERATION_MASK ((1u << (32 - RESOURCE_INDEX_BITS)) - 1)
+// Outstanding work-done callbacks. While all are busy, releases wait for the
+// next frame with a free one.
+#define RESOURCE_MAX_FENCES 8
+
+typedef uint32_t TextureId;
+typedef uint32_t BufferId;
+typedef uint32_t SamplerId;
+typedef uint32_t BindGroupId;
+
+typedef enum ResourceType {
+  ResourceType_Texture,
+  ResourceType_Buffer,
+  ResourceType_Sampler,
+  ResourceType_BindGroup,
+  ResourceType_Count
+} ResourceType;
+
+typedef struct ResourceSlot {
+  // A Texture2D for textures, otherwise the WGPU object itself.
+  union {
+    Texture2D texture;
+    WGPUBuffer buffer;
+    WGPUSampler sampler;
+    WGPUBindGroup bindGroup;
+  };
+  uint32_t generation;
+  bool live;
+} ResourceSlot;
+
+typedef struct ResourcePool {
+  ResourceSlot *slots;
+  uint32_t slotCount;
+  uint32_t slotCapacity;
+  uint32_t *freeSlots;
+  uint32_t freeCount;
+  uint32_t liveCount;
+} ResourcePool;
+
+// A released object waiting for the submissions that may still use it.
+typedef struct DeferredRelease {
+  ResourceType type;
+  ResourceSlot slot;
+  // Frame the release happened in; see ResourceRegistry::frame.
+  uint64_t frame;
+} DeferredRelease;
+
+typedef struct ResourceRegistry ResourceRegistry;
+
+typedef struct ResourceFence {
+  ResourceRegistry *registry;
+  uint64_t frame;
+  bool pending;
+} ResourceFence;
+
+typedef struct ResourceStats {
+  uint32_t live[ResourceType_Count];
+  uint32_t deferred;
+  uint64_t released;
+  uint64_t destroyed;
+  uint64_t recycledSlots;
+} ResourceStats;
+
+// Owns textures, buffers, samplers and bind groups behind generational
+// handles. Released objects are only dropped once wgpuQueueOnSubmittedWorkDone
+// confirms every submission made up to the release has retired.
+struct ResourceRegistry {
+  WGPUDevice device;
+  WGPUQueue queue;
+  ResourcePool pools[ResourceType_Count];
+
+  DeferredRelease *deferred;
+  uint32_t deferredCount;
+  uint32_t deferredCapacity;
+  ResourceFence fences[RESOURCE_MAX_FENCES];
+  // Counts frmwrk_resources_frame_submitted calls. Releases made in frame F
+  // can go once the work-done callback registered at the end of F has fired,
+  // which moves `retiredFrame` past F.
+  uint64_t frame;
+  uint64_t retiredFrame;
+  // Releases made before this frame are covered by a registered callback.
+  uint64_t fencedFrame;
+
+  ResourceStats stats;
+};
+
+ResourceRegistry *frmwrk_create_resource_registry(WGPUDevice device);
+// Waits for the GPU, then drops every deferred and still-live object.
+void frmwrk_drop_resource_registry(ResourceRegistry *registry);
+
+// The registry takes ownership of the texture and its view. Its CPU `data` is
+// freed right away since the upload has already been made.
+TextureId frmwrk_resources_add_texture(ResourceRegistry *registry,
+                                       Texture2D *texture);
+BufferId frmwrk_resources_add_buffer(ResourceRegistry *registry,
+                                     WGPUBuffer buffer);
+SamplerId frmwrk_resources_add_sampler(ResourceRegistry *registry,
+                                       WGPUSampler sampler);
+BindGroupId frmwrk_resources_add_bind_group(ResourceRegistry *registry,
+                                            WGPUBindGroup bindGroup);
+
+// NULL for stale or invalid handles.
+const Texture2D *frmwrk_resources_texture(const ResourceRegistry *registry,
+                                          TextureId id);
+WGPUBuffer frmwrk_resources_buffer(const ResourceRegistry *registry,
+                                   BufferId id);
+WGPUSampler frmwrk_resources_sampler(const ResourceRegistry *registry,
+                                     SamplerId id);
+WGPUBindGroup frmwrk_resources_bind_group(const ResourceRegistry *registry,
+                                          BindGroupId id);
+
+// Invalidate the handle now and drop the object once the GPU is done with
+// it. Stale handles are ignored.
+void frmwrk_resources_release_texture(ResourceRegistry *registry, TextureId id);
+void frmwrk_resources_release_buffer(ResourceRegistry *registry, BufferId id);
+void frmwrk_resources_release_sampler(ResourceRegistry *registry, SamplerId id);
+void frmwrk_resources_release_bind_group(ResourceRegistry *registry,
+                                         BindGroupId id);
+
+// Call after each frame's wgpuQueueSubmit: fences the frame's releases and
+// drops whatever earlier frames have retired. Never blocks.
+void frmwrk_resources_frame_submitted(ResourceRegistry *registry);
+void frmwrk_resources_print(const ResourceRegistry *registry);
+
+#endif // RESOURCES_H
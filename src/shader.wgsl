@@ -1,21 +1,38 @@
+#ifndef ALPHA_CUTOFF
+#define ALPHA_CUTOFF 0.5
+#endif
+
 struct VertexOutputs {
     //The position of the vertex
     @builtin(position) position: vec4<f32>,
     //The texture cooridnate of the vertex
-    @location(0) tex_coord: vec2<f32>
+    @location(0) tex_coord: vec2<f32>,
+    @location(1) tint: vec4<f32>,
+    @location(2) @interpolate(flat) texture_index: u32
 }
 
 struct FragmentInputs {
-    @location(0) tex_coord: vec2<f32>
+    @location(0) tex_coord: vec2<f32>,
+    @location(1) tint: vec4<f32>,
+    @location(2) @interpolate(flat) texture_index: u32
+}
+
+#include "sprite_streams.wgsl"
+
+//Per-draw parameters, bound from the uniform ring with a dynamic offset
+struct DrawParams {
+    tint: vec4<f32>
 }
+@group(2) @binding(0) var<uniform> draw: DrawParams;
 
 @vertex
 fn vs_main(
-    @builtin(vertex_index) VertexIndex : u32
+    @builtin(vertex_index) VertexIndex : u32,
+    @builtin(instance_index) InstanceIndex : u32
 ) -> VertexOutputs {
     var output: VertexOutputs;
 
-    var pos = array<vec2<f32>, 4> (
+    var corners = array<vec2<f32>, 4> (
       vec2<f32>(-0.5, -0.5),
       vec2<f32>(0.5, -0.5),
       vec2<f32>(0.5, 0.5),
@@ -29,22 +46,40 @@ fn vs_main(
       vec2<f32>(0.0, 1.0)
     );
 
-    output.position = vec4<f32>(pos[VertexIndex], 0.0, 1.0);
-    output.tex_coord = UVs[VertexIndex];
+    let transform = transforms[InstanceIndex];
+    let rotation = rotations[InstanceIndex];
+    let cos_r = cos(rotation);
+    let sin_r = sin(rotation);
+    let local = corners[VertexIndex] * transform.zw;
+    let pixel = transform.xy + vec2<f32>(local.x * cos_r - local.y * sin_r,
+                                         local.x * sin_r + local.y * cos_r);
+
+    let uv_rect = uv_rects[InstanceIndex];
+    output.position = vec4<f32>(pixel * viewport.transform.xy + viewport.transform.zw, 0.0, 1.0);
+    output.tex_coord = mix(uv_rect.xy, uv_rect.zw, UVs[VertexIndex]);
+    output.tint = unpack4x8unorm(tints[InstanceIndex]) * draw.tint;
+    output.texture_index = texture_indices[InstanceIndex];
 
     return output;
 }
 
-//The texture we're sampling
-@group(0) @binding(0) var t: binding_array<texture_2d<f32>, 2>;
+//Every texture in the texture table, indexed by slot
+#ifdef TEXTURE_TABLE_SIZE
+@group(0) @binding(0) var t: binding_array<texture_2d<f32>, TEXTURE_TABLE_SIZE>;
+#else
+@group(0) @binding(0) var t: binding_array<texture_2d<f32>>;
+#endif
 //The sampler we're using to sample the texture
 @group(0) @binding(1) var s: sampler;
 
 @fragment
 fn fs_main(input: FragmentInputs) -> @location(0) vec4<f32> {
-    var index: i32 = 0;
-    if (input.tex_coord.x > 0.5){
-        index = 1;
+    let color = textureSample(t[input.texture_index], s, input.tex_coord) * input.tint;
+#if ALPHA_TEST
+    //Cut out instead of blending, e.g. for foliage drawn out of order
+    if (color.a < ALPHA_CUTOFF) {
+        discard;
     }
-    return textureSample(t[index], s, input.tex_coord);
-}
\ No newline at end of file
+#endif
+    return color;
+}
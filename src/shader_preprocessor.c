@@ -0,0 +1,626 @@
+#include "shader_preprocessor.h"
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Macro values may name other macros; this bounds expansion of cycles.
+#define MAX_EXPANSION_DEPTH 8
+
+typedef struct Macro {
+  char *name;
+  char *value;
+} Macro;
+
+typedef struct Conditional {
+  // Whether lines in the current branch are emitted, parents included.
+  bool active;
+  bool parentActive;
+  // Whether any branch of this #if has been taken yet.
+  bool taken;
+  bool sawElse;
+} Conditional;
+
+typedef struct Preprocessor {
+  Macro *macros;
+  uint32_t macroCount;
+  uint32_t macroCapacity;
+
+  char *output;
+  size_t outputSize;
+  size_t outputCapacity;
+
+  ShaderSource *source;
+  // Files that said #pragma once.
+  char **onceFiles;
+  uint32_t onceCount;
+
+  // Location for error messages.
+  const char *path;
+  uint32_t line;
+  bool failed;
+} Preprocessor;
+
+typedef struct ExprParser {
+  Preprocessor *preprocessor;
+  const char *cursor;
+  int depth;
+} ExprParser;
+
+static void error(Preprocessor *preprocessor, const char *format, ...) {
+  if (preprocessor->failed)
+    return;
+  preprocessor->failed = true;
+  printf("[shader_preprocessor] %s:%u: ", preprocessor->path,
+         preprocessor->line);
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+}
+
+static char *copy_string(const char *string, size_t length) {
+  char *copy = malloc(length + 1);
+  if (copy) {
+    memcpy(copy, string, length);
+    copy[length] = 0;
+  }
+  return copy;
+}
+
+static void emit(Preprocessor *preprocessor, const char *text, size_t length) {
+  if (preprocessor->failed)
+    return;
+  if (preprocessor->outputSize + length + 1 > preprocessor->outputCapacity) {
+    size_t capacity =
+        preprocessor->outputCapacity ? preprocessor->outputCapacity * 2 : 4096;
+    while (capacity < preprocessor->outputSize + length + 1)
+      capacity *= 2;
+    char *output = realloc(preprocessor->output, capacity);
+    if (!output) {
+      error(preprocessor, "out of memory");
+      return;
+    }
+    preprocessor->output = output;
+    preprocessor->outputCapacity = capacity;
+  }
+  memcpy(preprocessor->output + preprocessor->outputSize, text, length);
+  preprocessor->outputSize += length;
+  preprocessor->output[preprocessor->outputSize] = 0;
+}
+
+static bool is_identifier_start(char c) {
+  return isalpha((unsigned char)c) || c == '_';
+}
+
+static bool is_identifier_char(char c) {
+  return isalnum((unsigned char)c) || c == '_';
+}
+
+static const char *skip_spaces(const char *cursor, const char *end) {
+  while (cursor < end && (*cursor == ' ' || *cursor == '\t'))
+    cursor++;
+  return cursor;
+}
+
+static Macro *find_macro(Preprocessor *preprocessor, const char *name,
+                         size_t length) {
+  for (uint32_t i = 0; i < preprocessor->macroCount; i++) {
+    Macro *macro = &preprocessor->macros[i];
+    if (strlen(macro->name) == length && memcmp(macro->name, name, length) == 0)
+      return macro;
+  }
+  return NULL;
+}
+
+static void define(Preprocessor *preprocessor, const char *name,
+                   size_t nameLength, const char *value, size_t valueLength) {
+  if (valueLength == 0) {
+    value = "1";
+    valueLength = 1;
+  }
+  char *value_copy = copy_string(value, valueLength);
+  if (!value_copy) {
+    error(preprocessor, "out of memory");
+    return;
+  }
+  Macro *macro = find_macro(preprocessor, name, nameLength);
+  if (macro) {
+    free(macro->value);
+    macro->value = value_copy;
+    return;
+  }
+
+  if (preprocessor->macroCount == preprocessor->macroCapacity) {
+    uint32_t capacity =
+        preprocessor->macroCapacity ? preprocessor->macroCapacity * 2 : 16;
+    Macro *macros = realloc(preprocessor->macros, sizeof(Macro) * capacity);
+    if (!macros) {
+      free(value_copy);
+      error(preprocessor, "out of memory");
+      return;
+    }
+    preprocessor->macros = macros;
+    preprocessor->macroCapacity = capacity;
+  }
+  char *name_copy = copy_string(name, nameLength);
+  if (!name_copy) {
+    free(value_copy);
+    error(preprocessor, "out of memory");
+    return;
+  }
+  preprocessor->macros[preprocessor->macroCount++] =
+      (Macro){.name = name_copy, .value = value_copy};
+}
+
+static void undefine(Preprocessor *preprocessor, const char *name,
+                     size_t length) {
+  Macro *macro = find_macro(preprocessor, name, length);
+  if (!macro)
+    return;
+  free(macro->name);
+  free(macro->value);
+  *macro = preprocessor->macros[--preprocessor->macroCount];
+}
+
+// Copies `text` to the output with macros substituted. Comments are copied
+// verbatim.
+static void expand(Preprocessor *preprocessor, const char *text,
+                   const char *end, int depth) {
+  const char *run = text;
+  const char *cursor = text;
+  while (cursor < end) {
+    if (cursor + 1 < end && cursor[0] == '/' && cursor[1] == '/')
+      break;
+    if (isdigit((unsigned char)*cursor)) {
+      // Numbers like 0x1f or 2u are not identifiers.
+      while (cursor < end && (is_identifier_char(*cursor) || *cursor == '.'))
+        cursor++;
+      continue;
+    }
+    if (!is_identifier_start(*cursor)) {
+      cursor++;
+      continue;
+    }
+    const char *name = cursor;
+    while (cursor < end && is_identifier_char(*cursor))
+      cursor++;
+    Macro *macro = find_macro(preprocessor, name, cursor - name);
+    if (!macro)
+      continue;
+    if (depth >= MAX_EXPANSION_DEPTH) {
+      error(preprocessor, "macro '%s' expands recursively", macro->name);
+      return;
+    }
+    emit(preprocessor, run, name - run);
+    expand(preprocessor, macro->value, macro->value + strlen(macro->value),
+           depth + 1);
+    run = cursor;
+  }
+  emit(preprocessor, run, end - run);
+}
+
+static int64_t parse_expression(ExprParser *parser, int minPrecedence);
+
+static void skip_expression_spaces(ExprParser *parser) {
+  while (*parser->cursor == ' ' || *parser->cursor == '\t')
+    parser->cursor++;
+}
+
+// Evaluates a macro's value as an expression of its own.
+static int64_t evaluate_string(Preprocessor *preprocessor, const char *text,
+                               int depth) {
+  if (depth >= MAX_EXPANSION_DEPTH) {
+    error(preprocessor, "macro expands recursively in #if");
+    return 0;
+  }
+  ExprParser parser = {
+    .preprocessor = preprocessor,
+    .cursor = text,
+    .depth = depth
+  };
+  int64_t value = parse_expression(&parser, 0);
+  skip_expression_spaces(&parser);
+  if (*parser.cursor && *parser.cursor != '/')
+    error(preprocessor, "unexpected '%s' in #if", parser.cursor);
+  return value;
+}
+
+static int64_t parse_unary(ExprParser *parser) {
+  Preprocessor *preprocessor = parser->preprocessor;
+  skip_expression_spaces(parser);
+  char c = *parser->cursor;
+  if (c == '!' || c == '~' || c == '-' || c == '+') {
+    parser->cursor++;
+    int64_t value = parse_unary(parser);
+    return c == '!' ? !value : c == '~' ? ~value : c == '-' ? -value : value;
+  }
+  if (c == '(') {
+    parser->cursor++;
+    int64_t value = parse_expression(parser, 0);
+    skip_expression_spaces(parser);
+    if (*parser->cursor != ')') {
+      error(preprocessor, "missing ')' in #if");
+      return 0;
+    }
+    parser->cursor++;
+    return value;
+  }
+  if (isdigit((unsigned char)c)) {
+    char *end;
+    int64_t value = strtoll(parser->cursor, &end, 0);
+    // WGSL literal suffixes.
+    while (*end == 'u' || *end == 'i')
+      end++;
+    parser->cursor = end;
+    return value;
+  }
+  if (is_identifier_start(c)) {
+    const char *name = parser->cursor;
+    while (is_identifier_char(*parser->cursor))
+      parser->cursor++;
+    size_t length = parser->cursor - name;
+    if (length == 7 && memcmp(name, "defined", 7) == 0) {
+      skip_expression_spaces(parser);
+      bool parenthesized = *parser->cursor == '(';
+      if (parenthesized)
+        parser->cursor++;
+      skip_expression_spaces(parser);
+      const char *macro = parser->cursor;
+      while (is_identifier_char(*parser->cursor))
+        parser->cursor++;
+      if (parser->cursor == macro) {
+        error(preprocessor, "expected a name after 'defined'");
+        return 0;
+      }
+      bool defined =
+          find_macro(preprocessor, macro, parser->cursor - macro) != NULL;
+      skip_expression_spaces(parser);
+      if (parenthesized) {
+        if (*parser->cursor != ')') {
+          error(preprocessor, "missing ')' after 'defined'");
+          return 0;
+        }
+        parser->cursor++;
+      }
+      return defined;
+    }
+    Macro *macro = find_macro(preprocessor, name, length);
+    return macro ? evaluate_string(preprocessor, macro->value, parser->depth + 1)
+                 : 0;
+  }
+  if (*parser->cursor)
+    error(preprocessor, "unexpected '%s' in #if", parser->cursor);
+  else
+    error(preprocessor, "missing expression in #if");
+  return 0;
+}
+
+typedef struct BinaryOperator {
+  const char *token;
+  int precedence;
+} BinaryOperator;
+
+// Two-character tokens come first so '<<' is not read as '<'.
+static const BinaryOperator binary_operators[] = {
+  {"||", 1}, {"&&", 2}, {"==", 6}, {"!=", 6}, {"<=", 7}, {">=", 7},
+  {"<<", 8}, {">>", 8}, {"|", 3},  {"^", 4},  {"&", 5},  {"<", 7},
+  {">", 7},  {"+", 9},  {"-", 9},  {"*", 10}, {"/", 10}, {"%", 10},
+};
+
+static const BinaryOperator *match_operator(const char *cursor) {
+  for (size_t i = 0;
+       i < sizeof(binary_operators) / sizeof(binary_operators[0]); i++) {
+    const BinaryOperator *op = &binary_operators[i];
+    if (strncmp(cursor, op->token, strlen(op->token)) == 0)
+      return op;
+  }
+  return NULL;
+}
+
+static int64_t apply(Preprocessor *preprocessor, const char *token,
+                     int64_t lhs, int64_t rhs) {
+  switch (token[0]) {
+  case '|':
+    return token[1] ? lhs || rhs : lhs | rhs;
+  case '&':
+    return token[1] ? lhs && rhs : lhs & rhs;
+  case '^':
+    return lhs ^ rhs;
+  case '=':
+    return lhs == rhs;
+  case '!':
+    return lhs != rhs;
+  case '<':
+    return token[1] == '<' ? lhs << rhs : token[1] ? lhs <= rhs : lhs < rhs;
+  case '>':
+    return token[1] == '>' ? lhs >> rhs : token[1] ? lhs >= rhs : lhs > rhs;
+  case '+':
+    return lhs + rhs;
+  case '-':
+    return lhs - rhs;
+  case '*':
+    return lhs * rhs;
+  default:
+    if (rhs == 0) {
+      error(preprocessor, "division by zero in #if");
+      return 0;
+    }
+    return token[0] == '/' ? lhs / rhs : lhs % rhs;
+  }
+}
+
+// Precedence climbing over the operators above; all are left-associative.
+static int64_t parse_expression(ExprParser *parser, int minPrecedence) {
+  int64_t lhs = parse_unary(parser);
+  for (;;) {
+    skip_expression_spaces(parser);
+    const BinaryOperator *op = match_operator(parser->cursor);
+    if (!op || op->precedence < minPrecedence ||
+        parser->preprocessor->failed)
+      return lhs;
+    parser->cursor += strlen(op->token);
+    int64_t rhs = parse_expression(parser, op->precedence + 1);
+    lhs = apply(parser->preprocessor, op->token, lhs, rhs);
+  }
+}
+
+static bool evaluate(Preprocessor *preprocessor, const char *text,
+                     const char *end) {
+  char *expression = copy_string(text, end - text);
+  if (!expression) {
+    error(preprocessor, "out of memory");
+    return false;
+  }
+  bool value = evaluate_string(preprocessor, expression, 0) != 0;
+  free(expression);
+  return value;
+}
+
+static bool has_file(char **files, uint32_t count, const char *path) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (strcmp(files[i], path) == 0)
+      return true;
+  }
+  return false;
+}
+
+static bool push_file(Preprocessor *preprocessor, char ***files,
+                      uint32_t *count, const char *path) {
+  char **grown = realloc(*files, sizeof(char *) * (*count + 1));
+  char *copy = grown ? copy_string(path, strlen(path)) : NULL;
+  if (grown)
+    *files = grown;
+  if (!copy) {
+    error(preprocessor, "out of memory");
+    return false;
+  }
+  (*files)[(*count)++] = copy;
+  return true;
+}
+
+static void process_file(Preprocessor *preprocessor, const char *path,
+                         int depth);
+
+// Joins `include` onto the directory of `from`, unless it is absolute.
+static char *resolve_include(const char *from, const char *include,
+                             size_t length) {
+  bool absolute = include[0] == '/' || include[0] == '\\' ||
+                  (length > 1 && include[1] == ':');
+  size_t directory = 0;
+  if (!absolute) {
+    for (size_t i = 0; from[i]; i++) {
+      if (from[i] == '/' || from[i] == '\\')
+        directory = i + 1;
+    }
+  }
+  char *resolved = malloc(directory + length + 1);
+  if (resolved) {
+    memcpy(resolved, from, directory);
+    memcpy(resolved + directory, include, length);
+    resolved[directory + length] = 0;
+  }
+  return resolved;
+}
+
+static void directive(Preprocessor *preprocessor, const char *cursor,
+                      const char *end, Conditional *stack, int *stackSize,
+                      int depth) {
+  const char *name = skip_spaces(cursor, end);
+  const char *rest = name;
+  while (rest < end && is_identifier_char(*rest))
+    rest++;
+  size_t name_length = rest - name;
+  rest = skip_spaces(rest, end);
+#define IS(directive)                                                          \
+  (name_length == sizeof(directive) - 1 &&                                     \
+   memcmp(name, directive, name_length) == 0)
+
+  bool active = *stackSize == 0 || stack[*stackSize - 1].active;
+  if (IS("if") || IS("ifdef") || IS("ifndef")) {
+    if (*stackSize == SHADER_PREPROCESSOR_MAX_IF_DEPTH) {
+      error(preprocessor, "#if nested too deeply");
+      return;
+    }
+    bool value = false;
+    if (active) {
+      if (IS("if")) {
+        value = evaluate(preprocessor, rest, end);
+      } else {
+        const char *macro = rest;
+        while (rest < end && is_identifier_char(*rest))
+          rest++;
+        value = (find_macro(preprocessor, macro, rest - macro) != NULL) ==
+                IS("ifdef");
+      }
+    }
+    stack[(*stackSize)++] = (Conditional){
+      .active = active && value,
+      .parentActive = active,
+      .taken = value
+    };
+  } else if (IS("elif") || IS("else") || IS("endif")) {
+    if (*stackSize == 0) {
+      error(preprocessor, "#%.*s without #if", (int)name_length, name);
+      return;
+    }
+    Conditional *top = &stack[*stackSize - 1];
+    if (IS("endif")) {
+      (*stackSize)--;
+    } else if (top->sawElse) {
+      error(preprocessor, "#%.*s after #else", (int)name_length, name);
+    } else if (IS("else")) {
+      top->sawElse = true;
+      top->active = top->parentActive && !top->taken;
+      top->taken = true;
+    } else {
+      bool value = top->parentActive && !top->taken &&
+                   evaluate(preprocessor, rest, end);
+      top->active = value;
+      top->taken |= value;
+    }
+  } else if (!active) {
+    // Anything else in a skipped branch is ignored, even if malformed.
+  } else if (IS("define")) {
+    const char *macro = rest;
+    while (rest < end && is_identifier_char(*rest))
+      rest++;
+    if (rest == macro) {
+      error(preprocessor, "#define needs a name");
+      return;
+    }
+    const char *value = skip_spaces(rest, end);
+    const char *value_end = value;
+    while (value_end < end &&
+           !(value_end + 1 < end && value_end[0] == '/' && value_end[1] == '/'))
+      value_end++;
+    while (value_end > value && isspace((unsigned char)value_end[-1]))
+      value_end--;
+    define(preprocessor, macro, rest - macro, value, value_end - value);
+  } else if (IS("undef")) {
+    const char *macro = rest;
+    while (rest < end && is_identifier_char(*rest))
+      rest++;
+    undefine(preprocessor, macro, rest - macro);
+  } else if (IS("pragma")) {
+    if (end - rest >= 4 && memcmp(rest, "once", 4) == 0 &&
+        !has_file(preprocessor->onceFiles, preprocessor->onceCount,
+                  preprocessor->path))
+      push_file(preprocessor, &preprocessor->onceFiles,
+                &preprocessor->onceCount, preprocessor->path);
+  } else if (IS("include")) {
+    const char *close = rest < end && *rest == '"'
+                            ? memchr(rest + 1, '"', end - rest - 1)
+                            : NULL;
+    if (!close) {
+      error(preprocessor, "#include expects \"file\"");
+      return;
+    }
+    if (depth + 1 >= SHADER_PREPROCESSOR_MAX_INCLUDE_DEPTH) {
+      error(preprocessor, "#include nested too deeply");
+      return;
+    }
+    char *include = resolve_include(preprocessor->path, rest + 1,
+                                    close - rest - 1);
+    if (!include) {
+      error(preprocessor, "out of memory");
+      return;
+    }
+    const char *path = preprocessor->path;
+    uint32_t line = preprocessor->line;
+    process_file(preprocessor, include, depth + 1);
+    preprocessor->path = path;
+    preprocessor->line = line;
+    free(include);
+  } else {
+    error(preprocessor, "unknown directive #%.*s", (int)name_length, name);
+  }
+#undef IS
+}
+
+static void process_file(Preprocessor *preprocessor, const char *path,
+                         int depth) {
+  if (has_file(preprocessor->onceFiles, preprocessor->onceCount, path))
+    return;
+  ShaderSource *source = preprocessor->source;
+  if (!has_file(source->files, source->fileCount, path) &&
+      !push_file(preprocessor, &source->files, &source->fileCount, path))
+    return;
+
+  FrmwrkMappedFile file;
+  preprocessor->path = path;
+  preprocessor->line = 0;
+  if (!frmwrk_map_file(path, &file)) {
+    error(preprocessor, "could not read file");
+    return;
+  }
+
+  Conditional stack[SHADER_PREPROCESSOR_MAX_IF_DEPTH];
+  int stack_size = 0;
+  const char *cursor = file.data;
+  const char *file_end = file.data + file.size;
+  while (cursor < file_end && !preprocessor->failed) {
+    const char *line_end = memchr(cursor, '\n', file_end - cursor);
+    const char *next = line_end ? line_end + 1 : file_end;
+    if (!line_end)
+      line_end = file_end;
+    if (line_end > cursor && line_end[-1] == '\r')
+      line_end--;
+    preprocessor->line++;
+
+    const char *start = skip_spaces(cursor, line_end);
+    if (start < line_end && *start == '#') {
+      directive(preprocessor, start + 1, line_end, stack, &stack_size, depth);
+      preprocessor->path = path;
+    } else if (stack_size == 0 || stack[stack_size - 1].active) {
+      expand(preprocessor, cursor, line_end, 0);
+    }
+    emit(preprocessor, "\n", 1);
+    cursor = next;
+  }
+  if (stack_size > 0)
+    error(preprocessor, "missing #endif");
+  frmwrk_unmap_file(&file);
+}
+
+bool frmwrk_preprocess_shader(const char *path, const ShaderDefine *defines,
+                              uint32_t defineCount, ShaderSource *source) {
+  *source = (ShaderSource){0};
+  Preprocessor preprocessor = {.source = source, .path = path};
+  for (uint32_t i = 0; i < defineCount; i++) {
+    const char *value = defines[i].value ? defines[i].value : "1";
+    define(&preprocessor, defines[i].name, strlen(defines[i].name), value,
+           strlen(value));
+  }
+  process_file(&preprocessor, path, 0);
+  // An empty file still yields an (empty) string.
+  emit(&preprocessor, "", 0);
+
+  for (uint32_t i = 0; i < preprocessor.macroCount; i++) {
+    free(preprocessor.macros[i].name);
+    free(preprocessor.macros[i].value);
+  }
+  free(preprocessor.macros);
+  for (uint32_t i = 0; i < preprocessor.onceCount; i++)
+    free(preprocessor.onceFiles[i]);
+  free(preprocessor.onceFiles);
+
+  source->code = preprocessor.output;
+  if (preprocessor.failed || !source->code) {
+    // Keep the file list so a watcher can retry once the error is fixed.
+    free(source->code);
+    source->code = NULL;
+    return false;
+  }
+  return true;
+}
+
+void frmwrk_free_shader_source(ShaderSource *source) {
+  free(source->code);
+  for (uint32_t i = 0; i < source->fileCount; i++)
+    free(source->files[i]);
+  free(source->files);
+  *source = (ShaderSource){0};
+}
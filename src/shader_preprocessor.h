@@ -0,0 +1,41 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include "framework.h"
+
+#define SHADER_PREPROCESSOR_MAX_INCLUDE_DEPTH 16
+#define SHADER_PREPROCESSOR_MAX_IF_DEPTH 32
+
+typedef struct ShaderDefine {
+  const char *name;
+  // NULL defines `name` as 1.
+  const char *value;
+} ShaderDefine;
+
+typedef struct ShaderSource {
+  char *code;
+  // Every file that was read, the root first, so callers can watch them.
+  char **files;
+  uint32_t fileCount;
+} ShaderSource;
+
+// Expands a WGSL file with a small C-style preprocessor:
+//
+//   #include "file"      relative to the including file; #pragma once skips
+//                        files already included
+//   #define NAME value   object-like macros, substituted as whole identifiers;
+//                        the value defaults to 1
+//   #undef NAME
+//   #if / #elif EXPR     integer expressions with defined(NAME), ! ~ * / % + -
+//                        << >> < <= > >= == != & ^ | && || and parentheses;
+//                        undefined names are 0
+//   #ifdef / #ifndef / #else / #endif
+//
+// `defines` are applied before the first line. Directive and skipped lines
+// become empty lines, so validation errors in a file without includes point at
+// its own line numbers. Errors are printed with file and line; returns false.
+bool frmwrk_preprocess_shader(const char *path, const ShaderDefine *defines,
+                              uint32_t defineCount, ShaderSource *source);
+void frmwrk_free_shader_source(ShaderSource *source);
+
+#endif // SHADER_PREPROCESSOR_H
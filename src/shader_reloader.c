@@ -0,0 +1,444 @@
+#include "shader_reloader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static void handle_compile_error(WGPUErrorType type, char const *message,
+                                 void *userdata) {
+  bool *failed = userdata;
+  if (type != WGPUErrorType_NoError) {
+    printf("[shader_reloader] %s\n", message);
+    *failed = true;
+  }
+}
+
+// Validation errors are caught in an error scope rather than reaching the
+// uncaptured error handler, and yield NULL. Scopes are device-wide and would
+// also catch errors from frames being encoded, so this only runs on the render
+// thread, between frames.
+static WGPUShaderModule create_module(WGPUDevice device, const char *path,
+                                      const char *code) {
+  bool failed = false;
+  wgpuDevicePushErrorScope(device, WGPUErrorFilter_Validation);
+  WGPUShaderModule module = frmwrk_create_shader_module(device, path, code);
+  wgpuDevicePopErrorScope(device, handle_compile_error, &failed);
+  if (failed && module) {
+    wgpuShaderModuleDrop(module);
+    module = NULL;
+  }
+  return module;
+}
+
+static void stat_file(const char *path, int64_t *modified, int64_t *size) {
+  struct stat info;
+  if (stat(path, &info) == 0) {
+    *modified = (int64_t)info.st_mtime;
+    *size = (int64_t)info.st_size;
+  } else {
+    *modified = -1;
+    *size = -1;
+  }
+}
+
+static const char *base_name(const char *path) {
+  const char *name = path;
+  for (const char *c = path; *c; c++) {
+    if (*c == '/' || *c == '\\')
+      name = c + 1;
+  }
+  return name;
+}
+
+// Editors usually save by writing a new file and renaming it over the old
+// one, which ends a watch on the file itself, so watch its directory.
+static void watch_file(ShaderReloader *reloader, WatchedFile *file) {
+  stat_file(file->path, &file->modified, &file->size);
+  file->watch = -1;
+#if defined(__linux__)
+  if (reloader->inotifyFd == -1)
+    return;
+  size_t directory_length = (size_t)(file->name - file->path);
+  char *directory = malloc(directory_length + 2);
+  if (!directory)
+    return;
+  if (directory_length == 0) {
+    strcpy(directory, ".");
+  } else {
+    memcpy(directory, file->path, directory_length);
+    directory[directory_length] = 0;
+  }
+  file->watch = inotify_add_watch(reloader->inotifyFd, directory,
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+  free(directory);
+#else
+  UNUSED(reloader)
+#endif
+}
+
+static void free_files(WatchedShader *shader) {
+  for (uint32_t i = 0; i < shader->fileCount; i++)
+    free(shader->files[i].path);
+  free(shader->files);
+  shader->files = NULL;
+  shader->fileCount = 0;
+}
+
+// Replaces the shader's file list with the files `source` read, taking the
+// paths. Call with the mutex held. Keeps the old list if `source` has none,
+// so a variant whose root could not be read is still watched.
+static void set_files(ShaderReloader *reloader, WatchedShader *shader,
+                      ShaderSource *source) {
+  if (source->fileCount == 0)
+    return;
+  WatchedFile *files = calloc(source->fileCount, sizeof(WatchedFile));
+  if (!files)
+    return;
+  free_files(shader);
+  for (uint32_t i = 0; i < source->fileCount; i++) {
+    files[i].path = source->files[i];
+    files[i].name = base_name(files[i].path);
+    watch_file(reloader, &files[i]);
+  }
+  shader->files = files;
+  shader->fileCount = source->fileCount;
+  source->fileCount = 0;
+}
+
+static bool is_stopping(ShaderReloader *reloader) {
+  frmwrk_mutex_lock(&reloader->mutex);
+  bool stopping = reloader->stopping;
+  frmwrk_mutex_unlock(&reloader->mutex);
+  return stopping;
+}
+
+// Preprocesses every variant flagged as changed, without holding the lock
+// while reading files, and leaves the code for the render thread to compile.
+static void preprocess_changed(ShaderReloader *reloader) {
+  for (uint32_t i = 0;; i++) {
+    frmwrk_mutex_lock(&reloader->mutex);
+    if (i >= reloader->shaderCount) {
+      frmwrk_mutex_unlock(&reloader->mutex);
+      break;
+    }
+    WatchedShader variant = reloader->shaders[i];
+    reloader->shaders[i].changed = false;
+    frmwrk_mutex_unlock(&reloader->mutex);
+    if (!variant.changed)
+      continue;
+
+    ShaderSource source;
+    bool preprocessed = frmwrk_preprocess_shader(
+        variant.path, variant.defines, variant.defineCount, &source);
+    frmwrk_mutex_lock(&reloader->mutex);
+    WatchedShader *shader = &reloader->shaders[i];
+    // Includes may have been added or removed.
+    set_files(reloader, shader, &source);
+    if (preprocessed) {
+      // A newer save replaces code the render thread has not picked up.
+      free(shader->pendingCode);
+      shader->pendingCode = source.code;
+      source.code = NULL;
+    } else {
+      reloader->failures++;
+      printf("[shader_reloader] %s failed to preprocess, keeping the previous "
+             "version\n",
+             shader->path);
+    }
+    frmwrk_mutex_unlock(&reloader->mutex);
+    frmwrk_free_shader_source(&source);
+  }
+}
+
+#if defined(__linux__)
+static void watch_inotify(ShaderReloader *reloader) {
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (!is_stopping(reloader)) {
+    struct pollfd descriptor = {.fd = reloader->inotifyFd, .events = POLLIN};
+    if (poll(&descriptor, 1, SHADER_RELOADER_POLL_MS) <= 0)
+      continue;
+    ssize_t length = read(reloader->inotifyFd, buffer, sizeof(buffer));
+    if (length <= 0)
+      continue;
+
+    frmwrk_mutex_lock(&reloader->mutex);
+    for (char *cursor = buffer; cursor < buffer + length;) {
+      const struct inotify_event *event = (const void *)cursor;
+      cursor += sizeof(struct inotify_event) + event->len;
+      if (event->len == 0)
+        continue;
+      for (uint32_t i = 0; i < reloader->shaderCount; i++) {
+        WatchedShader *shader = &reloader->shaders[i];
+        for (uint32_t j = 0; j < shader->fileCount; j++) {
+          const WatchedFile *file = &shader->files[j];
+          if (file->watch == event->wd && strcmp(file->name, event->name) == 0)
+            shader->changed = true;
+        }
+      }
+    }
+    frmwrk_mutex_unlock(&reloader->mutex);
+    preprocess_changed(reloader);
+  }
+}
+#endif
+
+static void watch_polling(ShaderReloader *reloader) {
+  while (!is_stopping(reloader)) {
+    frmwrk_thread_sleep_ms(SHADER_RELOADER_POLL_MS);
+    frmwrk_mutex_lock(&reloader->mutex);
+    for (uint32_t i = 0; i < reloader->shaderCount; i++) {
+      WatchedShader *shader = &reloader->shaders[i];
+      for (uint32_t j = 0; j < shader->fileCount; j++) {
+        WatchedFile *file = &shader->files[j];
+        int64_t modified, size;
+        stat_file(file->path, &modified, &size);
+        if (modified != file->modified || size != file->size) {
+          file->modified = modified;
+          file->size = size;
+          shader->changed |= modified != -1;
+        }
+      }
+    }
+    frmwrk_mutex_unlock(&reloader->mutex);
+    preprocess_changed(reloader);
+  }
+}
+
+static void watcher(void *userdata) {
+  ShaderReloader *reloader = userdata;
+#if defined(__linux__)
+  if (reloader->inotifyFd != -1) {
+    watch_inotify(reloader);
+    return;
+  }
+#endif
+  watch_polling(reloader);
+}
+
+ShaderReloader *frmwrk_create_shader_reloader(WGPUDevice device) {
+  ShaderReloader *reloader = calloc(1, sizeof(ShaderReloader));
+  if (!reloader)
+    return NULL;
+  reloader->device = device;
+  reloader->inotifyFd = -1;
+  frmwrk_mutex_init(&reloader->mutex);
+  return reloader;
+}
+
+static void free_variant(WatchedShader *shader) {
+  if (shader->module)
+    wgpuShaderModuleDrop(shader->module);
+  free(shader->pendingCode);
+  free_files(shader);
+  free(shader->defines);
+  free(shader->key);
+}
+
+void frmwrk_drop_shader_reloader(ShaderReloader *reloader) {
+  if (!reloader)
+    return;
+  if (reloader->running) {
+    frmwrk_mutex_lock(&reloader->mutex);
+    reloader->stopping = true;
+    frmwrk_mutex_unlock(&reloader->mutex);
+    frmwrk_thread_join(reloader->thread);
+  }
+#if defined(__linux__)
+  if (reloader->inotifyFd != -1)
+    close(reloader->inotifyFd);
+#endif
+  for (uint32_t i = 0; i < reloader->shaderCount; i++)
+    free_variant(&reloader->shaders[i]);
+  free(reloader->shaders);
+  frmwrk_mutex_destroy(&reloader->mutex);
+  free(reloader);
+}
+
+static int compare_defines(const void *a, const void *b) {
+  return strcmp(((const ShaderDefine *)a)->name,
+                ((const ShaderDefine *)b)->name);
+}
+
+// Builds a variant's key, "path\0NAME\0VALUE\0..." with the defines sorted by
+// name, plus a define array pointing into it. One allocation holds both.
+static bool make_variant(WatchedShader *shader, const char *path,
+                         const ShaderDefine *defines, uint32_t defineCount) {
+  ShaderDefine *sorted = malloc(sizeof(ShaderDefine) * (defineCount + 1));
+  if (!sorted)
+    return false;
+  size_t size = strlen(path) + 1;
+  for (uint32_t i = 0; i < defineCount; i++) {
+    sorted[i].name = defines[i].name;
+    sorted[i].value = defines[i].value ? defines[i].value : "1";
+    size += strlen(sorted[i].name) + strlen(sorted[i].value) + 2;
+  }
+  qsort(sorted, defineCount, sizeof(ShaderDefine), compare_defines);
+
+  char *key = malloc(size);
+  if (!key) {
+    free(sorted);
+    return false;
+  }
+  char *cursor = key;
+  memcpy(cursor, path, strlen(path) + 1);
+  cursor += strlen(path) + 1;
+  for (uint32_t i = 0; i < defineCount; i++) {
+    const char *name = sorted[i].name;
+    const char *value = sorted[i].value;
+    sorted[i].name = strcpy(cursor, name);
+    cursor += strlen(name) + 1;
+    sorted[i].value = strcpy(cursor, value);
+    cursor += strlen(value) + 1;
+  }
+
+  *shader = (WatchedShader){
+    .path = key,
+    .defines = sorted,
+    .defineCount = defineCount,
+    .key = key,
+    .keySize = size,
+    .hash = frmwrk_hash_bytes(key, size, FRMWRK_HASH_SEED)
+  };
+  return true;
+}
+
+uint32_t frmwrk_shader_reloader_variant(ShaderReloader *reloader,
+                                        const char *path,
+                                        const ShaderDefine *defines,
+                                        uint32_t defineCount) {
+  WatchedShader variant;
+  if (!make_variant(&variant, path, defines, defineCount))
+    return SHADER_RELOADER_INVALID;
+
+  // Only this thread adds variants, so the lookup needs no lock.
+  for (uint32_t i = 0; i < reloader->shaderCount; i++) {
+    const WatchedShader *shader = &reloader->shaders[i];
+    if (shader->hash == variant.hash && shader->keySize == variant.keySize &&
+        memcmp(shader->key, variant.key, variant.keySize) == 0) {
+      free_variant(&variant);
+      reloader->variantHits++;
+      return i;
+    }
+  }
+  reloader->variantMisses++;
+
+  ShaderSource source;
+  if (frmwrk_preprocess_shader(path, variant.defines, defineCount, &source))
+    variant.module = create_module(reloader->device, path, source.code);
+  if (!variant.module) {
+    frmwrk_free_shader_source(&source);
+    free_variant(&variant);
+    return SHADER_RELOADER_INVALID;
+  }
+
+  frmwrk_mutex_lock(&reloader->mutex);
+  if (reloader->shaderCount == reloader->shaderCapacity) {
+    uint32_t capacity =
+        reloader->shaderCapacity ? reloader->shaderCapacity * 2 : 4;
+    WatchedShader *shaders =
+        realloc(reloader->shaders, sizeof(WatchedShader) * capacity);
+    if (!shaders) {
+      frmwrk_mutex_unlock(&reloader->mutex);
+      frmwrk_free_shader_source(&source);
+      free_variant(&variant);
+      return SHADER_RELOADER_INVALID;
+    }
+    reloader->shaders = shaders;
+    reloader->shaderCapacity = capacity;
+  }
+  uint32_t index = reloader->shaderCount++;
+  reloader->shaders[index] = variant;
+  set_files(reloader, &reloader->shaders[index], &source);
+  frmwrk_mutex_unlock(&reloader->mutex);
+  frmwrk_free_shader_source(&source);
+  return index;
+}
+
+uint32_t frmwrk_shader_reloader_add(ShaderReloader *reloader,
+                                    const char *path) {
+  return frmwrk_shader_reloader_variant(reloader, path, NULL, 0);
+}
+
+WGPUShaderModule frmwrk_shader_reloader_module(const ShaderReloader *reloader,
+                                               uint32_t shader) {
+  // The render thread is the only writer of `module`, so no lock is needed.
+  return shader < reloader->shaderCount ? reloader->shaders[shader].module
+                                        : NULL;
+}
+
+bool frmwrk_shader_reloader_start(ShaderReloader *reloader) {
+  if (reloader->running)
+    return true;
+#if defined(__linux__)
+  reloader->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (reloader->inotifyFd == -1)
+    perror("inotify_init1");
+  // Files of variants added before now were never given watches.
+  frmwrk_mutex_lock(&reloader->mutex);
+  for (uint32_t i = 0; i < reloader->shaderCount; i++) {
+    WatchedShader *shader = &reloader->shaders[i];
+    for (uint32_t j = 0; j < shader->fileCount; j++)
+      watch_file(reloader, &shader->files[j]);
+  }
+  frmwrk_mutex_unlock(&reloader->mutex);
+#endif
+  if (!frmwrk_thread_create(&reloader->thread, watcher, reloader)) {
+    printf("[shader_reloader] could not start the watcher thread\n");
+    return false;
+  }
+  reloader->running = true;
+  printf("[shader_reloader] watching %u shader variant(s)%s\n",
+         reloader->shaderCount,
+         reloader->inotifyFd != -1 ? " with inotify" : "");
+  return true;
+}
+
+uint32_t frmwrk_shader_reloader_update(ShaderReloader *reloader) {
+  if (!reloader->running)
+    return 0;
+  uint32_t swapped = 0;
+  // Only this thread adds variants, so the count is stable without the lock.
+  for (uint32_t i = 0; i < reloader->shaderCount; i++) {
+    frmwrk_mutex_lock(&reloader->mutex);
+    WatchedShader *shader = &reloader->shaders[i];
+    char *code = shader->pendingCode;
+    shader->pendingCode = NULL;
+    frmwrk_mutex_unlock(&reloader->mutex);
+    if (!code)
+      continue;
+
+    WGPUShaderModule module =
+        create_module(reloader->device, shader->path, code);
+    free(code);
+    if (!module) {
+      // The watcher counts preprocessing failures.
+      frmwrk_mutex_lock(&reloader->mutex);
+      reloader->failures++;
+      frmwrk_mutex_unlock(&reloader->mutex);
+      printf("[shader_reloader] %s failed to compile, keeping the previous "
+             "version\n",
+             shader->path);
+      continue;
+    }
+    printf("[shader_reloader] recompiled %s\n", shader->path);
+    wgpuShaderModuleDrop(shader->module);
+    shader->module = module;
+    shader->version++;
+    swapped++;
+  }
+  reloader->reloads += swapped;
+  return swapped;
+}
+
+void frmwrk_shader_reloader_print(const ShaderReloader *reloader) {
+  printf("[shader_reloader] variants=%u hits=%u misses=%u reloads=%u "
+         "failures=%u\n",
+         reloader->shaderCount, reloader->variantHits, reloader->variantMisses,
+         reloader->reloads, reloader->failures);
+}
@@ -0,0 +1,104 @@
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include "framework.h"
+#include "shader_preprocessor.h"
+#include "threading.h"
+
+#define SHADER_RELOADER_INVALID UINT32_MAX
+// How often the watcher checks for changes (and for shutdown).
+#define SHADER_RELOADER_POLL_MS 250
+
+// A file a shader was built from: its root or one of its includes.
+typedef struct WatchedFile {
+  char *path;
+  // Points into `path`.
+  const char *name;
+  // Change detection: an inotify watch on the file's directory on Linux,
+  // otherwise the last seen modification time and size.
+  int watch;
+  int64_t modified;
+  int64_t size;
+} WatchedFile;
+
+// One permutation of a shader file: the file preprocessed with a define set.
+typedef struct WatchedShader {
+  // Stable for the reloader's lifetime, so the watcher can use them unlocked.
+  char *path;
+  ShaderDefine *defines;
+  uint32_t defineCount;
+  // The path and the defines sorted by name, NUL-separated, and their hash.
+  // Requests for the same permutation share one entry.
+  char *key;
+  size_t keySize;
+  uint64_t hash;
+
+  // Files read by the last preprocess; replaced after every compile.
+  WatchedFile *files;
+  uint32_t fileCount;
+
+  // Module the render thread draws with; only touched by the render thread.
+  WGPUShaderModule module;
+  // Preprocessed by the watcher, waiting to be compiled at the next frame
+  // boundary.
+  char *pendingCode;
+  uint32_t version;
+  bool changed;
+} WatchedShader;
+
+// Owns WGSL shader modules built from files and caches them per permutation,
+// so specialized variants are compiled once instead of branching at runtime.
+// Once started it also watches every file a variant was built from on a
+// background thread. The watcher preprocesses changed variants; the render
+// thread compiles them at a frame boundary, where the device-wide error scope
+// that validates them cannot catch errors from a frame, and rebuilds whatever
+// depends on them. A variant that fails to preprocess or validate is discarded
+// and the previous module stays in use.
+typedef struct ShaderReloader {
+  WGPUDevice device;
+
+  FrmwrkMutex mutex;
+  WatchedShader *shaders;
+  uint32_t shaderCount;
+  uint32_t shaderCapacity;
+
+  FrmwrkThread thread;
+  bool running;
+  bool stopping;
+  int inotifyFd;
+
+  uint32_t variantHits;
+  uint32_t variantMisses;
+  uint32_t reloads;
+  uint32_t failures;
+} ShaderReloader;
+
+ShaderReloader *frmwrk_create_shader_reloader(WGPUDevice device);
+void frmwrk_drop_shader_reloader(ShaderReloader *reloader);
+
+// Returns the index of `path` preprocessed with `defines`, compiling it on
+// first request, or SHADER_RELOADER_INVALID if it does not build. Define order
+// does not matter.
+uint32_t frmwrk_shader_reloader_variant(ShaderReloader *reloader,
+                                        const char *path,
+                                        const ShaderDefine *defines,
+                                        uint32_t defineCount);
+// The variant without defines.
+uint32_t frmwrk_shader_reloader_add(ShaderReloader *reloader,
+                                    const char *path);
+// Current module for `shader`, owned by the reloader. It changes only in
+// frmwrk_shader_reloader_update.
+WGPUShaderModule frmwrk_shader_reloader_module(const ShaderReloader *reloader,
+                                               uint32_t shader);
+
+// Starts watching every variant's files (and those of variants added later)
+// on a background thread. Without a call to this the reloader is just a
+// variant cache.
+bool frmwrk_shader_reloader_start(ShaderReloader *reloader);
+// Call at a frame boundary: compiles the variants the watcher preprocessed
+// since the last call, swaps in the ones that validate, dropping the modules
+// they replace, and returns how many changed. Never waits for the watcher.
+uint32_t frmwrk_shader_reloader_update(ShaderReloader *reloader);
+void frmwrk_shader_reloader_print(const ShaderReloader *reloader);
+
+#endif // SHADER_RELOADER_H
@@ -0,0 +1,345 @@
+#include "sprite_batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "upload_ring.h"
+
+// Bytes per sprite in each stream, in binding order: transforms, rotations,
+// uvRects, textureIndices, tints.
+static const uint32_t stream_strides[SPRITE_BATCH_STREAM_COUNT] = {16, 4, 16,
+                                                                   4, 4};
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static const void *stream_data(const SpriteBatch *batch, uint32_t stream) {
+  switch (stream) {
+  case 0:
+    return batch->transforms;
+  case 1:
+    return batch->rotations;
+  case 2:
+    return batch->uvRects;
+  case 3:
+    return batch->textureIndices;
+  default:
+    return batch->tints;
+  }
+}
+
+static void write_buffer(SpriteBatch *batch, WGPUBuffer buffer,
+                         uint64_t offset, const void *data, uint64_t size) {
+  if (batch->uploadRing)
+    frmwrk_upload_ring_write_buffer(batch->uploadRing, buffer, offset, data,
+                                    size);
+  else
+    wgpuQueueWriteBuffer(batch->queue, buffer, offset, data, size);
+}
+
+SpriteBatch *frmwrk_create_sprite_batch(WGPUDevice device,
+                                        UploadRing *uploadRing,
+                                        BufferArena *arena,
+                                        uint32_t initialCapacity) {
+  SpriteBatch *batch = calloc(1, sizeof(SpriteBatch));
+  if (!batch)
+    return NULL;
+  batch->device = device;
+  batch->queue = wgpuDeviceGetQueue(device);
+  batch->uploadRing = uploadRing;
+  batch->arena = arena;
+  batch->arenaGeneration = arena->generation;
+
+  WGPUBindGroupLayoutEntry entries[1 + SPRITE_BATCH_STREAM_COUNT];
+  entries[0] = (WGPUBindGroupLayoutEntry){
+    .binding = 0,
+    .buffer = (WGPUBufferBindingLayout){
+      .type = WGPUBufferBindingType_Uniform,
+      .minBindingSize = sizeof(batch->viewport)
+    },
+    .visibility = WGPUShaderStage_Vertex
+  };
+  for (uint32_t i = 0; i < SPRITE_BATCH_STREAM_COUNT; i++) {
+    entries[1 + i] = (WGPUBindGroupLayoutEntry){
+      .binding = 1 + i,
+      .buffer = (WGPUBufferBindingLayout){
+        .type = WGPUBufferBindingType_ReadOnlyStorage
+      },
+      .visibility = WGPUShaderStage_Vertex
+    };
+  }
+  batch->bindGroupLayout = wgpuDeviceCreateBindGroupLayout(
+      device, &(const WGPUBindGroupLayoutDescriptor){
+                  .label = "sprite_batch_bind_group_layout",
+                  .entries = entries,
+                  .entryCount = 1 + SPRITE_BATCH_STREAM_COUNT
+              });
+
+  batch->viewportBuffer = wgpuDeviceCreateBuffer(
+      device, &(const WGPUBufferDescriptor){
+                  .label = "sprite_batch_viewport",
+                  .size = sizeof(batch->viewport),
+                  .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst
+              });
+
+  // Two triangles over the corners 0..3 the vertex shader expands.
+  static const uint16_t indices[6] = {0, 1, 2, 3, 0, 2};
+  batch->indexAllocation =
+      frmwrk_buffer_arena_alloc(arena, sizeof(indices), 4);
+  if (!batch->bindGroupLayout || !batch->viewportBuffer ||
+      !frmwrk_buffer_arena_resolve(arena, batch->indexAllocation,
+                                   &batch->indexRange)) {
+    frmwrk_drop_sprite_batch(batch);
+    return NULL;
+  }
+  write_buffer(batch, batch->indexRange.buffer, batch->indexRange.offset,
+               indices, sizeof(indices));
+
+  if (initialCapacity &&
+      frmwrk_sprite_batch_alloc(batch, initialCapacity) == UINT32_MAX) {
+    frmwrk_drop_sprite_batch(batch);
+    return NULL;
+  }
+  batch->count = 0;
+  return batch;
+}
+
+void frmwrk_drop_sprite_batch(SpriteBatch *batch) {
+  if (!batch)
+    return;
+  if (batch->bindGroup)
+    wgpuBindGroupDrop(batch->bindGroup);
+  // Freeing stale or zero handles is a no-op.
+  frmwrk_buffer_arena_free(batch->arena, batch->streamAllocation);
+  frmwrk_buffer_arena_free(batch->arena, batch->indexAllocation);
+  if (batch->viewportBuffer)
+    wgpuBufferDrop(batch->viewportBuffer);
+  if (batch->bindGroupLayout)
+    wgpuBindGroupLayoutDrop(batch->bindGroupLayout);
+  if (batch->queue)
+    wgpuQueueDrop(batch->queue);
+  free(batch->transforms);
+  free(batch->rotations);
+  free(batch->uvRects);
+  free(batch->textureIndices);
+  free(batch->tints);
+  free(batch);
+}
+
+void frmwrk_sprite_batch_begin(SpriteBatch *batch, uint32_t width,
+                               uint32_t height) {
+  batch->count = 0;
+
+  // Pixels to clip space: scale in xy, offset in zw.
+  float viewport[4] = {2.0f / (float)width, -2.0f / (float)height, -1.0f,
+                       1.0f};
+  if (memcmp(viewport, batch->viewport, sizeof(viewport)) != 0) {
+    memcpy(batch->viewport, viewport, sizeof(viewport));
+    write_buffer(batch, batch->viewportBuffer, 0, batch->viewport,
+                 sizeof(batch->viewport));
+  }
+}
+
+static bool grow_streams(SpriteBatch *batch, uint32_t capacity) {
+  float *transforms = realloc(batch->transforms, sizeof(float) * 4 * capacity);
+  if (transforms)
+    batch->transforms = transforms;
+  float *rotations = realloc(batch->rotations, sizeof(float) * capacity);
+  if (rotations)
+    batch->rotations = rotations;
+  float *uvRects = realloc(batch->uvRects, sizeof(float) * 4 * capacity);
+  if (uvRects)
+    batch->uvRects = uvRects;
+  uint32_t *textureIndices =
+      realloc(batch->textureIndices, sizeof(uint32_t) * capacity);
+  if (textureIndices)
+    batch->textureIndices = textureIndices;
+  uint32_t *tints = realloc(batch->tints, sizeof(uint32_t) * capacity);
+  if (tints)
+    batch->tints = tints;
+
+  // Streams that did grow are still valid at the old capacity.
+  if (!transforms || !rotations || !uvRects || !textureIndices || !tints)
+    return false;
+  batch->capacity = capacity;
+  return true;
+}
+
+uint32_t frmwrk_sprite_batch_alloc(SpriteBatch *batch, uint32_t count) {
+  if (count > UINT32_MAX - 1 - batch->count)
+    return UINT32_MAX;
+  if (batch->count + count > batch->capacity) {
+    uint32_t capacity = batch->capacity ? batch->capacity : 1024;
+    while (capacity < batch->count + count)
+      capacity *= 2;
+    if (!grow_streams(batch, capacity))
+      return UINT32_MAX;
+  }
+  uint32_t first = batch->count;
+  batch->count += count;
+  return first;
+}
+
+bool frmwrk_sprite_batch_add(SpriteBatch *batch, const Sprite *sprite) {
+  uint32_t i = frmwrk_sprite_batch_alloc(batch, 1);
+  if (i == UINT32_MAX)
+    return false;
+  batch->transforms[i * 4 + 0] = sprite->x;
+  batch->transforms[i * 4 + 1] = sprite->y;
+  batch->transforms[i * 4 + 2] = sprite->w;
+  batch->transforms[i * 4 + 3] = sprite->h;
+  batch->rotations[i] = sprite->rotation;
+  batch->uvRects[i * 4 + 0] = sprite->u0;
+  batch->uvRects[i * 4 + 1] = sprite->v0;
+  batch->uvRects[i * 4 + 2] = sprite->u1;
+  batch->uvRects[i * 4 + 3] = sprite->v1;
+  batch->textureIndices[i] = sprite->textureIndex;
+  batch->tints[i] = sprite->tint;
+  return true;
+}
+
+static WGPUBindGroup create_bind_group(SpriteBatch *batch,
+                                       const BufferArenaRange *streams,
+                                       const uint64_t *offsets,
+                                       uint32_t capacity) {
+  WGPUBindGroupEntry entries[1 + SPRITE_BATCH_STREAM_COUNT];
+  entries[0] = (WGPUBindGroupEntry){
+    .binding = 0,
+    .buffer = batch->viewportBuffer,
+    .offset = 0,
+    .size = sizeof(batch->viewport)
+  };
+  for (uint32_t i = 0; i < SPRITE_BATCH_STREAM_COUNT; i++) {
+    entries[1 + i] = (WGPUBindGroupEntry){
+      .binding = 1 + i,
+      .buffer = streams->buffer,
+      .offset = streams->offset + offsets[i],
+      .size = (uint64_t)stream_strides[i] * capacity
+    };
+  }
+  return wgpuDeviceCreateBindGroup(
+      batch->device, &(const WGPUBindGroupDescriptor){
+                         .label = "sprite_batch_bind_group",
+                         .layout = batch->bindGroupLayout,
+                         .entries = entries,
+                         .entryCount = 1 + SPRITE_BATCH_STREAM_COUNT
+                     });
+}
+
+static void replace_bind_group(SpriteBatch *batch, WGPUBindGroup bind_group) {
+  if (batch->bindGroup)
+    wgpuBindGroupDrop(batch->bindGroup);
+  batch->bindGroup = bind_group;
+  batch->bindGroupGeneration++;
+}
+
+// Resolves the ranges again after the arena has moved allocations around.
+static bool refresh_ranges(SpriteBatch *batch) {
+  if (!frmwrk_buffer_arena_resolve(batch->arena, batch->indexAllocation,
+                                   &batch->indexRange))
+    return false;
+  if (batch->streamAllocation) {
+    if (!frmwrk_buffer_arena_resolve(batch->arena, batch->streamAllocation,
+                                     &batch->streamRange))
+      return false;
+    WGPUBindGroup bind_group =
+        create_bind_group(batch, &batch->streamRange, batch->streamOffsets,
+                          batch->gpuCapacity);
+    if (!bind_group)
+      return false;
+    replace_bind_group(batch, bind_group);
+  } else {
+    // Bundles also hold the index range.
+    batch->bindGroupGeneration++;
+  }
+  batch->arenaGeneration = batch->arena->generation;
+  return true;
+}
+
+// Allocates stream storage for at least `count` sprites and rebuilds the bind
+// group over its streams.
+static bool grow_gpu(SpriteBatch *batch, uint32_t count) {
+  uint32_t capacity = batch->gpuCapacity ? batch->gpuCapacity : 1024;
+  while (capacity < count)
+    capacity *= 2;
+
+  uint64_t size = 0;
+  uint64_t offsets[SPRITE_BATCH_STREAM_COUNT];
+  for (uint32_t i = 0; i < SPRITE_BATCH_STREAM_COUNT; i++) {
+    offsets[i] = size;
+    size = align_up(size + (uint64_t)stream_strides[i] * capacity,
+                    SPRITE_BATCH_STREAM_ALIGNMENT);
+  }
+
+  BufferArenaId allocation = frmwrk_buffer_arena_alloc(
+      batch->arena, size, SPRITE_BATCH_STREAM_ALIGNMENT);
+  BufferArenaRange range;
+  if (!frmwrk_buffer_arena_resolve(batch->arena, allocation, &range))
+    return false;
+  WGPUBindGroup bind_group = create_bind_group(batch, &range, offsets,
+                                               capacity);
+  if (!bind_group) {
+    frmwrk_buffer_arena_free(batch->arena, allocation);
+    return false;
+  }
+
+  // The old streams stay readable by frames still in flight.
+  frmwrk_buffer_arena_free(batch->arena, batch->streamAllocation);
+  replace_bind_group(batch, bind_group);
+  batch->streamAllocation = allocation;
+  batch->streamRange = range;
+  memcpy(batch->streamOffsets, offsets, sizeof(offsets));
+  batch->gpuCapacity = capacity;
+  return true;
+}
+
+bool frmwrk_sprite_batch_upload(SpriteBatch *batch) {
+  batch->uploadedCount = 0;
+  if (batch->arenaGeneration != batch->arena->generation &&
+      !refresh_ranges(batch)) {
+    printf("[sprite_batch] could not follow the arena's moved ranges\n");
+    return false;
+  }
+  if (batch->count == 0)
+    return true;
+  if (batch->count > batch->gpuCapacity && !grow_gpu(batch, batch->count)) {
+    printf("[sprite_batch] could not grow to %u sprites\n", batch->count);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < SPRITE_BATCH_STREAM_COUNT; i++)
+    write_buffer(batch, batch->streamRange.buffer,
+                 batch->streamRange.offset + batch->streamOffsets[i],
+                 stream_data(batch, i),
+                 (uint64_t)stream_strides[i] * batch->count);
+  batch->uploadedCount = batch->count;
+  return true;
+}
+
+void frmwrk_sprite_batch_draw(SpriteBatch *batch, WGPURenderPassEncoder pass,
+                              uint32_t groupIndex) {
+  if (batch->uploadedCount == 0)
+    return;
+  wgpuRenderPassEncoderSetBindGroup(pass, groupIndex, batch->bindGroup, 0,
+                                    NULL);
+  wgpuRenderPassEncoderSetIndexBuffer(pass, batch->indexRange.buffer,
+                                      WGPUIndexFormat_Uint16,
+                                      batch->indexRange.offset,
+                                      sizeof(uint16_t) * 6);
+  wgpuRenderPassEncoderDrawIndexed(pass, 6, batch->uploadedCount, 0, 0, 0);
+}
+
+void frmwrk_sprite_batch_record(SpriteBatch *batch,
+                                WGPURenderBundleEncoder encoder,
+                                uint32_t groupIndex) {
+  if (batch->uploadedCount == 0)
+    return;
+  wgpuRenderBundleEncoderSetBindGroup(encoder, groupIndex, batch->bindGroup, 0,
+                                      NULL);
+  wgpuRenderBundleEncoderSetIndexBuffer(encoder, batch->indexRange.buffer,
+                                        WGPUIndexFormat_Uint16,
+                                        batch->indexRange.offset,
+                                        sizeof(uint16_t) * 6);
+  wgpuRenderBundleEncoderDrawIndexed(encoder, 6, batch->uploadedCount, 0, 0,
+                                     0);
+}
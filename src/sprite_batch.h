@@ -0,0 +1,100 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include "buffer_arena.h"
+#include "framework.h"
+
+// Streams are bound at offsets into one arena allocation, which must respect
+// minStorageBufferOffsetAlignment (at most 256).
+#define SPRITE_BATCH_STREAM_ALIGNMENT 256
+#define SPRITE_BATCH_STREAM_COUNT 5
+#define SPRITE_TINT_WHITE 0xFFFFFFFFu
+
+typedef struct Sprite {
+  // Center and size in pixels, y down from the top-left of the viewport.
+  float x;
+  float y;
+  float w;
+  float h;
+  // Radians, clockwise on screen.
+  float rotation;
+  float u0;
+  float v0;
+  float u1;
+  float v1;
+  // Element of the texture binding array bound at group 0.
+  uint32_t textureIndex;
+  // RGBA8 with red in the lowest byte; multiplies the sampled color.
+  uint32_t tint;
+} Sprite;
+
+// Accumulates sprites in structure-of-arrays form, uploads every stream once
+// per frame and draws the whole batch as one instanced draw. Each stream is
+// uploaded as-is into its own region of a storage allocation, so the CPU never
+// interleaves the data. The index and stream ranges come from a BufferArena
+// and are resolved again whenever defragmentation moves them.
+typedef struct SpriteBatch {
+  WGPUDevice device;
+  WGPUQueue queue;
+  UploadRing *uploadRing;
+
+  WGPUBindGroupLayout bindGroupLayout;
+  WGPUBindGroup bindGroup;
+  WGPUBuffer viewportBuffer;
+  BufferArena *arena;
+  BufferArenaId indexAllocation;
+  BufferArenaId streamAllocation;
+  BufferArenaRange indexRange;
+  BufferArenaRange streamRange;
+  // The arena generation the ranges were resolved at.
+  uint32_t arenaGeneration;
+  // Bumped whenever `bindGroup` is replaced.
+  uint32_t bindGroupGeneration;
+  // Relative to the start of the stream allocation.
+  uint64_t streamOffsets[SPRITE_BATCH_STREAM_COUNT];
+  uint32_t gpuCapacity;
+  float viewport[4];
+
+  // One element (four floats for the vec4 streams) per sprite.
+  float *transforms;
+  float *rotations;
+  float *uvRects;
+  uint32_t *textureIndices;
+  uint32_t *tints;
+  uint32_t count;
+  uint32_t capacity;
+  // Sprites uploaded by the last frmwrk_sprite_batch_upload.
+  uint32_t uploadedCount;
+} SpriteBatch;
+
+// `arena` needs Index and Storage usage and must outlive the batch.
+SpriteBatch *frmwrk_create_sprite_batch(WGPUDevice device,
+                                        UploadRing *uploadRing,
+                                        BufferArena *arena,
+                                        uint32_t initialCapacity);
+void frmwrk_drop_sprite_batch(SpriteBatch *batch);
+
+// Empties the batch for a new frame drawn into a `width` x `height` target.
+void frmwrk_sprite_batch_begin(SpriteBatch *batch, uint32_t width,
+                               uint32_t height);
+bool frmwrk_sprite_batch_add(SpriteBatch *batch, const Sprite *sprite);
+// Appends `count` uninitialized sprites and returns the index of the first,
+// so callers can fill the stream arrays directly. UINT32_MAX on failure.
+uint32_t frmwrk_sprite_batch_alloc(SpriteBatch *batch, uint32_t count);
+// Uploads the streams. Call before frmwrk_upload_ring_record for the frame's
+// encoder so the copies land ahead of the draw. May replace `bindGroup`, when
+// the batch grows or the arena has moved its ranges.
+bool frmwrk_sprite_batch_upload(SpriteBatch *batch);
+// Binds the batch at `groupIndex` and draws everything uploaded. The caller
+// sets a pipeline whose layout includes `bindGroupLayout` there.
+void frmwrk_sprite_batch_draw(SpriteBatch *batch, WGPURenderPassEncoder pass,
+                              uint32_t groupIndex);
+// The same commands recorded into a render bundle. They only depend on
+// `bindGroup` and the index range, which change with `bindGroupGeneration`,
+// and `uploadedCount`, so a bundle keyed on both stays valid while the
+// sprites themselves move.
+void frmwrk_sprite_batch_record(SpriteBatch *batch,
+                                WGPURenderBundleEncoder encoder,
+                                uint32_t groupIndex);
+
+#endif // SPRITE_BATCH_H
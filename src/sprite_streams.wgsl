@@ -0,0 +1,15 @@
+#pragma once
+
+//Pixels to clip space: scale in xy, offset in zw
+struct Viewport {
+    transform: vec4<f32>
+}
+
+//Sprite streams written by the sprite batch, one element per instance
+@group(1) @binding(0) var<uniform> viewport: Viewport;
+//Center and size in pixels
+@group(1) @binding(1) var<storage, read> transforms: array<vec4<f32>>;
+@group(1) @binding(2) var<storage, read> rotations: array<f32>;
+@group(1) @binding(3) var<storage, read> uv_rects: array<vec4<f32>>;
+@group(1) @binding(4) var<storage, read> texture_indices: array<u32>;
+@group(1) @binding(5) var<storage, read> tints: array<u32>;
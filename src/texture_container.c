@@ -0,0 +1,251 @@
+#include "texture_container.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "block_compress.h"
+#include "mipmap.h"
+#include "upload_ring.h"
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+bool frmwrk_write_texture_container(const char *path, WGPUTextureFormat format,
+                                    uint32_t width, uint32_t height,
+                                    uint32_t levelCount,
+                                    const unsigned char *chain,
+                                    uint32_t flags) {
+  uint32_t block_size, block_bytes;
+  if (!frmwrk_texture_format_block_info(format, &block_size, &block_bytes) ||
+      levelCount == 0 ||
+      levelCount > TEXTURE_CONTAINER_MAX_LEVELS ||
+      levelCount > frmwrk_mip_level_count(width, height)) {
+    printf("[texture_container] cannot write %s: unsupported format or level "
+           "count\n",
+           path);
+    return false;
+  }
+
+  TextureContainerHeader header = (TextureContainerHeader){
+    .magic = TEXTURE_CONTAINER_MAGIC,
+    .version = TEXTURE_CONTAINER_VERSION,
+    .format = format,
+    .flags = flags,
+    .width = width,
+    .height = height,
+    .levelCount = levelCount
+  };
+  uint64_t data_start = align_up(sizeof(header), TEXTURE_CONTAINER_ALIGNMENT);
+  uint64_t offset = data_start;
+  for (uint32_t level = 0; level < levelCount; level++) {
+    TextureContainerLevel *entry = &header.levels[level];
+    entry->width = width >> level ? width >> level : 1;
+    entry->height = height >> level ? height >> level : 1;
+    uint64_t columns = (entry->width + block_size - 1) / block_size;
+    entry->bytesPerRow = (uint32_t)align_up(columns * block_bytes,
+                                            TEXTURE_CONTAINER_ALIGNMENT);
+    entry->rowCount = (entry->height + block_size - 1) / block_size;
+    entry->offset = offset;
+    entry->size = (uint64_t)entry->bytesPerRow * entry->rowCount;
+    offset += entry->size;
+  }
+  header.dataSize = offset - data_start;
+
+  // Padding is zeroed so the checksum and the file are deterministic.
+  unsigned char *data = calloc(1, offset);
+  if (!data) {
+    printf("[texture_container] out of memory writing %s\n", path);
+    return false;
+  }
+  for (uint32_t level = 0; level < levelCount; level++) {
+    const TextureContainerLevel *entry = &header.levels[level];
+    size_t row_size =
+        (size_t)(entry->width + block_size - 1) / block_size * block_bytes;
+    for (uint32_t y = 0; y < entry->rowCount; y++) {
+      memcpy(data + entry->offset + (size_t)y * entry->bytesPerRow, chain,
+             row_size);
+      chain += row_size;
+    }
+  }
+  if (flags & TextureContainer_Checksum)
+    header.checksum = frmwrk_hash_bytes(data + data_start, header.dataSize,
+                                        FRMWRK_HASH_SEED);
+  memcpy(data, &header, sizeof(header));
+
+  FILE *stream = fopen(path, "wb");
+  if (!stream) {
+    perror("fopen");
+    free(data);
+    return false;
+  }
+  bool written = fwrite(data, 1, offset, stream) == offset;
+  written &= fclose(stream) == 0;
+  free(data);
+  if (!written)
+    printf("[texture_container] failed to write %s\n", path);
+  return written;
+}
+
+static bool validate(const char *path, const TextureContainer *container,
+                     bool verify) {
+  const TextureContainerHeader *header = container->header;
+  size_t file_size = container->file.size;
+  if (file_size < sizeof(TextureContainerHeader) ||
+      header->magic != TEXTURE_CONTAINER_MAGIC) {
+    printf("[texture_container] %s is not a texture container\n", path);
+    return false;
+  }
+  if (header->version != TEXTURE_CONTAINER_VERSION) {
+    printf("[texture_container] %s has version %u, expected %u\n", path,
+           header->version, TEXTURE_CONTAINER_VERSION);
+    return false;
+  }
+  uint32_t block_size, block_bytes;
+  if (!frmwrk_texture_format_block_info(header->format, &block_size,
+                                        &block_bytes) ||
+      header->width == 0 || header->height == 0 ||
+      header->levelCount == 0 ||
+      header->levelCount > TEXTURE_CONTAINER_MAX_LEVELS ||
+      header->levelCount > frmwrk_mip_level_count(header->width,
+                                                  header->height)) {
+    printf("[texture_container] %s has an invalid header\n", path);
+    return false;
+  }
+
+  uint64_t data_start =
+      align_up(sizeof(TextureContainerHeader), TEXTURE_CONTAINER_ALIGNMENT);
+  if (file_size < data_start || header->dataSize > file_size - data_start) {
+    printf("[texture_container] %s is truncated\n", path);
+    return false;
+  }
+  for (uint32_t level = 0; level < header->levelCount; level++) {
+    const TextureContainerLevel *entry = &header->levels[level];
+    uint32_t width = header->width >> level ? header->width >> level : 1;
+    uint32_t height = header->height >> level ? header->height >> level : 1;
+    uint64_t columns = (width + block_size - 1) / block_size;
+    uint32_t rows = (height + block_size - 1) / block_size;
+    bool valid =
+        entry->width == width && entry->height == height &&
+        entry->offset % TEXTURE_CONTAINER_ALIGNMENT == 0 &&
+        entry->bytesPerRow % TEXTURE_CONTAINER_ALIGNMENT == 0 &&
+        entry->bytesPerRow >= columns * block_bytes &&
+        entry->rowCount >= rows &&
+        entry->size == (uint64_t)entry->bytesPerRow * entry->rowCount &&
+        entry->offset >= data_start &&
+        entry->offset <= data_start + header->dataSize &&
+        entry->size <= data_start + header->dataSize - entry->offset;
+    if (!valid) {
+      printf("[texture_container] %s has an invalid level %u\n", path, level);
+      return false;
+    }
+  }
+
+  if (verify && (header->flags & TextureContainer_Checksum)) {
+    uint64_t checksum =
+        frmwrk_hash_bytes(container->file.data + data_start, header->dataSize,
+                          FRMWRK_HASH_SEED);
+    if (checksum != header->checksum) {
+      printf("[texture_container] %s failed its checksum\n", path);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool frmwrk_open_texture_container(const char *path, bool verify,
+                                   TextureContainer *container) {
+  *container = (TextureContainer){0};
+  if (!frmwrk_map_file(path, &container->file))
+    return false;
+  // Mappings are page aligned and copies come from malloc, so the header can
+  // be read in place.
+  container->header = (const TextureContainerHeader *)container->file.data;
+  if (!validate(path, container, verify)) {
+    frmwrk_close_texture_container(container);
+    return false;
+  }
+  return true;
+}
+
+void frmwrk_close_texture_container(TextureContainer *container) {
+  frmwrk_unmap_file(&container->file);
+  container->header = NULL;
+}
+
+const unsigned char *
+frmwrk_texture_container_level(const TextureContainer *container,
+                               uint32_t level) {
+  return (const unsigned char *)container->file.data +
+         container->header->levels[level].offset;
+}
+
+void frmwrk_texture_container_prefetch(const TextureContainer *container) {
+#if !defined(_WIN32)
+  if (!container->file.copied)
+    posix_madvise((void *)container->file.data, container->file.size,
+                  POSIX_MADV_WILLNEED);
+#else
+  UNUSED(container)
+#endif
+}
+
+Texture2D frmwrk_texture_container_upload(WGPUDevice device,
+                                          UploadRing *uploadRing,
+                                          const TextureContainer *container,
+                                          const char *label) {
+  const TextureContainerHeader *header = container->header;
+  Texture2D result = frmwrk_create_texture2D(
+      device, header->width, header->height, header->format,
+      header->levelCount, label);
+  if (!result.texture)
+    return result;
+
+  uint32_t block_size, block_bytes;
+  frmwrk_texture_format_block_info(header->format, &block_size, &block_bytes);
+  WGPUQueue queue = uploadRing ? NULL : wgpuDeviceGetQueue(device);
+  for (uint32_t level = 0; level < header->levelCount; level++) {
+    const TextureContainerLevel *entry = &header->levels[level];
+    const unsigned char *data = frmwrk_texture_container_level(container, level);
+    if (uploadRing) {
+      frmwrk_upload_ring_write_texture_blocks(
+          uploadRing, result.texture, level, (WGPUOrigin3D){0, 0, 0},
+          entry->width, entry->height, block_size, block_bytes, data,
+          entry->bytesPerRow);
+      continue;
+    }
+    wgpuQueueWriteTexture(
+        queue,
+        &(const WGPUImageCopyTexture){
+            .texture = result.texture,
+            .aspect = WGPUTextureAspect_All,
+            .mipLevel = level,
+            .origin = (WGPUOrigin3D){0, 0, 0}
+        },
+        data, entry->size,
+        &(const WGPUTextureDataLayout){
+            .bytesPerRow = entry->bytesPerRow,
+            .rowsPerImage = entry->rowCount
+        },
+        &(const WGPUExtent3D){
+            (entry->width + block_size - 1) / block_size * block_size,
+            entry->rowCount * block_size, 1});
+  }
+  if (queue)
+    wgpuQueueDrop(queue);
+  return result;
+}
+
+Texture2D frmwrk_load_texture_container(WGPUDevice device,
+                                        UploadRing *uploadRing,
+                                        const char *path) {
+  TextureContainer container;
+  if (!frmwrk_open_texture_container(path, true, &container))
+    return (Texture2D){0};
+  Texture2D texture =
+      frmwrk_texture_container_upload(device, uploadRing, &container, path);
+  frmwrk_close_texture_container(&container);
+  return texture;
+}
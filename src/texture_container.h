@@ -0,0 +1,87 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+#include "framework.h"
+
+// "FTEX" read as a little-endian uint32_t.
+#define TEXTURE_CONTAINER_MAGIC 0x58455446u
+#define TEXTURE_CONTAINER_VERSION 1
+#define TEXTURE_CONTAINER_MAX_LEVELS 16
+// Level offsets and row pitches are multiples of this, the bytesPerRow
+// alignment of buffer-to-texture copies, so rows can be copied as they are.
+#define TEXTURE_CONTAINER_ALIGNMENT 256
+
+typedef enum TextureContainerFlags {
+  TextureContainer_None = 0,
+  // `checksum` holds frmwrk_hash_bytes of everything after the header.
+  TextureContainer_Checksum = 1 << 0,
+} TextureContainerFlags;
+
+typedef struct TextureContainerLevel {
+  // From the start of the file.
+  uint64_t offset;
+  uint64_t size;
+  uint32_t width;
+  uint32_t height;
+  uint32_t bytesPerRow;
+  // Rows of texels, or of blocks for compressed formats.
+  uint32_t rowCount;
+} TextureContainerLevel;
+
+// On-disk header, little-endian, followed by the levels' pixel data.
+typedef struct TextureContainerHeader {
+  uint32_t magic;
+  uint32_t version;
+  // A WGPUTextureFormat, already in the layout the texture expects.
+  uint32_t format;
+  uint32_t flags;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levelCount;
+  uint32_t reserved;
+  uint64_t dataSize;
+  uint64_t checksum;
+  TextureContainerLevel levels[TEXTURE_CONTAINER_MAX_LEVELS];
+} TextureContainerHeader;
+
+// A cooked texture mapped into memory. Level data points into the mapping.
+typedef struct TextureContainer {
+  FrmwrkMappedFile file;
+  const TextureContainerHeader *header;
+} TextureContainer;
+
+// Writes a chain laid out as by frmwrk_texture_chain_size (tightly packed
+// rows of texels or blocks, level 0 first) with each row padded to the copy
+// alignment. Holds any format frmwrk_texture_format_block_info knows.
+bool frmwrk_write_texture_container(const char *path, WGPUTextureFormat format,
+                                    uint32_t width, uint32_t height,
+                                    uint32_t levelCount,
+                                    const unsigned char *chain,
+                                    uint32_t flags);
+
+// Maps `path` and validates the header and level ranges against the file
+// size. With `verify` the checksum is checked too, when the file has one,
+// which reads the whole file. Prints the reason and returns false on failure.
+bool frmwrk_open_texture_container(const char *path, bool verify,
+                                   TextureContainer *container);
+void frmwrk_close_texture_container(TextureContainer *container);
+const unsigned char *
+frmwrk_texture_container_level(const TextureContainer *container,
+                               uint32_t level);
+// Hints the OS to start reading the level data in, so the pages are resident
+// by the time the upload touches them.
+void frmwrk_texture_container_prefetch(const TextureContainer *container);
+
+// Creates a texture with every level the container holds and uploads them
+// straight from the mapping, through `uploadRing` when it is not NULL. The
+// container can be closed once this returns.
+Texture2D frmwrk_texture_container_upload(WGPUDevice device,
+                                          UploadRing *uploadRing,
+                                          const TextureContainer *container,
+                                          const char *label);
+// Opens, uploads and closes `path`. Returns a zeroed Texture2D on failure.
+Texture2D frmwrk_load_texture_container(WGPUDevice device,
+                                        UploadRing *uploadRing,
+                                        const char *path);
+
+#endif // TEXTURE_CONTAINER_H
@@ -0,0 +1,530 @@
+#include "texture_loader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mipmap.h"
+#include "pixel_convert.h"
+#include "stb_image.h"
+
+static bool queue_reserve(TextureLoadQueue *queue, uint32_t count) {
+  if (count > queue->capacity) {
+    uint32_t capacity = queue->capacity ? queue->capacity : 16;
+    while (capacity < count)
+      capacity *= 2;
+    TextureLoadEntry **items = malloc(sizeof(TextureLoadEntry *) * capacity);
+    if (!items)
+      return false;
+    for (uint32_t i = 0; i < queue->count; i++)
+      items[i] = queue->items[(queue->head + i) % queue->capacity];
+    free(queue->items);
+    queue->items = items;
+    queue->head = 0;
+    queue->capacity = capacity;
+  }
+  return true;
+}
+
+static bool queue_push(TextureLoadQueue *queue, TextureLoadEntry *entry) {
+  if (!queue_reserve(queue, queue->count + 1))
+    return false;
+  queue->items[(queue->head + queue->count) % queue->capacity] = entry;
+  queue->count++;
+  return true;
+}
+
+static TextureLoadEntry *queue_peek(const TextureLoadQueue *queue) {
+  return queue->count ? queue->items[queue->head] : NULL;
+}
+
+static TextureLoadEntry *queue_pop(TextureLoadQueue *queue) {
+  if (queue->count == 0)
+    return NULL;
+  TextureLoadEntry *entry = queue->items[queue->head];
+  queue->head = (queue->head + 1) % queue->capacity;
+  queue->count--;
+  return entry;
+}
+
+static void lru_remove(TextureLoader *loader, TextureLoadEntry *entry) {
+  if (entry->lruPrev)
+    entry->lruPrev->lruNext = entry->lruNext;
+  else
+    loader->lruHead = entry->lruNext;
+  if (entry->lruNext)
+    entry->lruNext->lruPrev = entry->lruPrev;
+  else
+    loader->lruTail = entry->lruPrev;
+  entry->lruPrev = NULL;
+  entry->lruNext = NULL;
+}
+
+static void lru_push_front(TextureLoader *loader, TextureLoadEntry *entry) {
+  entry->lruPrev = NULL;
+  entry->lruNext = loader->lruHead;
+  if (loader->lruHead)
+    loader->lruHead->lruPrev = entry;
+  else
+    loader->lruTail = entry;
+  loader->lruHead = entry;
+}
+
+static bool is_container(const char *path) {
+  size_t length = strlen(path);
+  return length >= 5 && strcmp(path + length - 5, ".ftex") == 0;
+}
+
+// Maps a cooked container. Verifying its checksum reads the whole file here,
+// off the render thread; without one the pages are only prefetched.
+static void open_container(TextureLoadEntry *entry) {
+  TextureContainer container;
+  if (!frmwrk_open_texture_container(entry->path, true, &container))
+    return;
+  if (!(container.header->flags & TextureContainer_Checksum))
+    frmwrk_texture_container_prefetch(&container);
+  entry->container = container;
+  entry->w = container.header->width;
+  entry->h = container.header->height;
+}
+
+static void decode_worker(void *userdata) {
+  TextureLoader *loader = userdata;
+
+  frmwrk_mutex_lock(&loader->mutex);
+  for (;;) {
+    while (loader->decodeQueue.count == 0 && !loader->stopping)
+      frmwrk_condition_wait(&loader->workAvailable, &loader->mutex);
+    if (loader->stopping)
+      break;
+    TextureLoadEntry *entry = queue_pop(&loader->decodeQueue);
+    bool compress = loader->compress;
+    BlockFormat block_format = loader->blockFormat;
+    BlockQuality block_quality = loader->blockQuality;
+    uint32_t atlas_max_size = loader->atlas ? loader->atlasMaxSize : 0;
+    frmwrk_mutex_unlock(&loader->mutex);
+
+    if (is_container(entry->path)) {
+      open_container(entry);
+      frmwrk_mutex_lock(&loader->mutex);
+      queue_push(&loader->uploadQueue, entry);
+      continue;
+    }
+
+    int w = 0, h = 0, channels = 0;
+    unsigned char *pixels = NULL;
+    uint32_t levels = 1;
+    WGPUTextureFormat format = WGPUTextureFormat_RGBA8Unorm;
+    size_t size = 0;
+    unsigned char *decoded = stbi_load(entry->path, &w, &h, &channels, 0);
+    if (decoded) {
+      // The atlas holds one uncompressed level.
+      bool packed = (uint32_t)w <= atlas_max_size &&
+                    (uint32_t)h <= atlas_max_size;
+      compress = compress && !packed && w % 4 == 0 && h % 4 == 0;
+      // Without a GPU generator the chain is filtered here, off the render
+      // thread, and uploaded level by level. Compressed chains always are.
+      if (!packed && (!loader->mipmapGenerator || compress))
+        levels = frmwrk_mip_level_count(w, h);
+      size = frmwrk_mip_chain_size(w, h, levels);
+      pixels = malloc(size);
+      if (pixels) {
+        frmwrk_convert_image_to_rgba(pixels, w * 4, decoded, w, h, channels,
+                                     PixelConvert_None);
+        frmwrk_generate_mip_chain(pixels, w, h, levels, MipFilter_Box, false);
+      }
+      stbi_image_free(decoded);
+      if (pixels && compress) {
+        // The workers already run one per core, so each encodes on its own.
+        WGPUTextureFormat block_texture_format =
+            frmwrk_block_texture_format(block_format, false);
+        size_t block_size =
+            frmwrk_texture_chain_size(block_texture_format, w, h, levels);
+        unsigned char *blocks = malloc(block_size);
+        if (blocks) {
+          frmwrk_compress_mip_chain(blocks, pixels, w, h, levels, block_format,
+                                    block_quality, 1);
+          free(pixels);
+          pixels = blocks;
+          format = block_texture_format;
+          size = block_size;
+        }
+      }
+    } else {
+      printf("[texture_loader] failed to decode %s: %s\n", entry->path,
+             stbi_failure_reason());
+    }
+
+    frmwrk_mutex_lock(&loader->mutex);
+    entry->pixels = pixels;
+    entry->pixelLevels = levels;
+    entry->format = format;
+    entry->pixelSize = size;
+    entry->w = w;
+    entry->h = h;
+    // Failures go through the upload queue too so the render thread retires
+    // them. Space was reserved when the load was queued, so this cannot fail.
+    queue_push(&loader->uploadQueue, entry);
+  }
+  frmwrk_mutex_unlock(&loader->mutex);
+}
+
+TextureLoader *frmwrk_create_texture_loader(WGPUDevice device,
+                                            ResourceRegistry *resources,
+                                            UploadRing *uploadRing,
+                                            MipmapGenerator *mipmapGenerator,
+                                            uint32_t workerCount) {
+  TextureLoader *loader = calloc(1, sizeof(TextureLoader));
+  if (!loader)
+    return NULL;
+
+  loader->device = device;
+  loader->queue = wgpuDeviceGetQueue(device);
+  loader->resources = resources;
+  loader->uploadRing = uploadRing;
+  loader->mipmapGenerator = mipmapGenerator;
+  frmwrk_mutex_init(&loader->mutex);
+  frmwrk_condition_init(&loader->workAvailable);
+
+  static const unsigned char placeholder_pixel[4] = {128, 128, 128, 255};
+  loader->placeholder =
+      frmwrk_create_texture2D(device, 1, 1, WGPUTextureFormat_RGBA8Unorm, 1,
+                              "texture_loader_placeholder");
+  frmwrk_write_texture2D(loader->queue, uploadRing, &loader->placeholder,
+                         placeholder_pixel);
+
+  if (workerCount == 0)
+    workerCount = frmwrk_cpu_count();
+  loader->workers = malloc(sizeof(FrmwrkThread) * workerCount);
+  if (loader->workers) {
+    for (uint32_t i = 0; i < workerCount; i++) {
+      if (!frmwrk_thread_create(&loader->workers[i], decode_worker, loader))
+        break;
+      loader->workerCount++;
+    }
+  }
+  if (loader->workerCount == 0) {
+    printf("[texture_loader] could not start any decode workers\n");
+    frmwrk_drop_texture_loader(loader);
+    return NULL;
+  }
+  return loader;
+}
+
+void frmwrk_drop_texture_loader(TextureLoader *loader) {
+  if (!loader)
+    return;
+
+  frmwrk_mutex_lock(&loader->mutex);
+  loader->stopping = true;
+  frmwrk_condition_broadcast(&loader->workAvailable);
+  frmwrk_mutex_unlock(&loader->mutex);
+  for (uint32_t i = 0; i < loader->workerCount; i++)
+    frmwrk_thread_join(loader->workers[i]);
+  free(loader->workers);
+
+  for (uint32_t i = 0; i < loader->entryCount; i++) {
+    TextureLoadEntry *entry = loader->entries[i];
+    free(entry->pixels);
+    frmwrk_close_texture_container(&entry->container);
+    frmwrk_resources_release_texture(loader->resources, entry->texture);
+    free(entry->path);
+    free(entry);
+  }
+  free(loader->entries);
+  free(loader->decodeQueue.items);
+  free(loader->uploadQueue.items);
+
+  if (loader->placeholder.view)
+    wgpuTextureViewDrop(loader->placeholder.view);
+  if (loader->placeholder.texture)
+    wgpuTextureDrop(loader->placeholder.texture);
+  if (loader->queue)
+    wgpuQueueDrop(loader->queue);
+  frmwrk_condition_destroy(&loader->workAvailable);
+  frmwrk_mutex_destroy(&loader->mutex);
+  free(loader);
+}
+
+void frmwrk_texture_loader_compress(TextureLoader *loader, BlockFormat format,
+                                    BlockQuality quality) {
+  frmwrk_mutex_lock(&loader->mutex);
+  loader->compress = true;
+  loader->blockFormat = format;
+  loader->blockQuality = quality;
+  frmwrk_mutex_unlock(&loader->mutex);
+}
+
+void frmwrk_texture_loader_use_atlas(TextureLoader *loader, Atlas *atlas,
+                                     uint32_t maxSize) {
+  frmwrk_mutex_lock(&loader->mutex);
+  loader->atlas = atlas;
+  loader->atlasMaxSize = maxSize;
+  frmwrk_mutex_unlock(&loader->mutex);
+}
+
+static bool queue_decode(TextureLoader *loader, TextureLoadEntry *entry) {
+  frmwrk_mutex_lock(&loader->mutex);
+  bool queued =
+      queue_reserve(&loader->uploadQueue, loader->pendingCount + 1) &&
+      queue_push(&loader->decodeQueue, entry);
+  if (queued)
+    frmwrk_condition_signal(&loader->workAvailable);
+  frmwrk_mutex_unlock(&loader->mutex);
+  if (queued) {
+    entry->state = TextureLoadState_Loading;
+    loader->pendingCount++;
+  }
+  return queued;
+}
+
+TextureHandle frmwrk_texture_loader_load(TextureLoader *loader,
+                                         const char *path) {
+  if (loader->entryCount == loader->entryCapacity) {
+    uint32_t capacity = loader->entryCapacity ? loader->entryCapacity * 2 : 16;
+    TextureLoadEntry **entries =
+        realloc(loader->entries, sizeof(TextureLoadEntry *) * capacity);
+    if (!entries)
+      return 0;
+    loader->entries = entries;
+    loader->entryCapacity = capacity;
+  }
+
+  TextureLoadEntry *entry = calloc(1, sizeof(TextureLoadEntry));
+  if (!entry)
+    return 0;
+  size_t length = strlen(path);
+  entry->path = malloc(length + 1);
+  if (!entry->path) {
+    free(entry);
+    return 0;
+  }
+  memcpy(entry->path, path, length + 1);
+  if (!queue_decode(loader, entry)) {
+    free(entry->path);
+    free(entry);
+    return 0;
+  }
+
+  loader->entries[loader->entryCount++] = entry;
+  return loader->entryCount;
+}
+
+static void release_resident(TextureLoader *loader, TextureLoadEntry *entry) {
+  frmwrk_resources_release_texture(loader->resources, entry->texture);
+  lru_remove(loader, entry);
+  loader->residentBytes -= entry->residentBytes;
+  entry->residentBytes = 0;
+  entry->texture = 0;
+}
+
+// Evicts from the cold end of the list. Textures touched since the previous
+// update may still be drawn this frame, so the budget is left exceeded rather
+// than evict them.
+static uint32_t enforce_residency_budget(TextureLoader *loader) {
+  if (loader->residencyBudget == 0)
+    return 0;
+  uint32_t evicted = 0;
+  while (loader->residentBytes > loader->residencyBudget) {
+    TextureLoadEntry *victim = loader->lruTail;
+    if (!victim || victim->lastUsedFrame >= loader->frame) {
+      loader->stats.overBudgetUpdates++;
+      break;
+    }
+    release_resident(loader, victim);
+    victim->state = TextureLoadState_Evicted;
+    loader->stats.evictions++;
+    evicted++;
+  }
+  return evicted;
+}
+
+uint32_t frmwrk_texture_loader_update(TextureLoader *loader,
+                                      uint64_t budgetBytes) {
+  uint32_t finished = 0;
+  uint64_t spent = 0;
+
+  for (;;) {
+    frmwrk_mutex_lock(&loader->mutex);
+    TextureLoadEntry *entry = queue_peek(&loader->uploadQueue);
+    uint64_t size = 0;
+    if (entry && entry->container.header)
+      size = entry->container.header->dataSize;
+    else if (entry)
+      size = entry->pixelSize;
+    if (entry && (finished == 0 || spent + size <= budgetBytes))
+      queue_pop(&loader->uploadQueue);
+    else
+      entry = NULL;
+    frmwrk_mutex_unlock(&loader->mutex);
+    if (!entry)
+      break;
+
+    Texture2D texture = {0};
+    if (entry->pixels && entry->pixelLevels == 1 &&
+        entry->format == WGPUTextureFormat_RGBA8Unorm && loader->atlas &&
+        (uint32_t)entry->w <= loader->atlasMaxSize &&
+        (uint32_t)entry->h <= loader->atlasMaxSize)
+      entry->atlasRegion = frmwrk_atlas_insert(loader->atlas, entry->pixels,
+                                               entry->w, entry->h);
+    if (entry->atlasRegion) {
+      free(entry->pixels);
+      entry->pixels = NULL;
+    } else if (entry->container.header) {
+      texture = frmwrk_texture_container_upload(
+          loader->device, loader->uploadRing, &entry->container, entry->path);
+      frmwrk_close_texture_container(&entry->container);
+    } else if (entry->pixels) {
+      bool compressed = entry->format != WGPUTextureFormat_RGBA8Unorm;
+      // Only short of a full chain when it was decoded for a full atlas.
+      uint32_t levels = loader->mipmapGenerator
+                            ? frmwrk_mip_level_count(entry->w, entry->h)
+                            : entry->pixelLevels;
+      texture = frmwrk_create_texture2D(loader->device, entry->w, entry->h,
+                                        entry->format, levels, entry->path);
+      frmwrk_write_texture2D_levels(loader->queue, loader->uploadRing,
+                                    &texture, entry->pixels,
+                                    entry->pixelLevels);
+      if (loader->mipmapGenerator && !compressed)
+        frmwrk_mipmap_generator_queue(loader->mipmapGenerator, &texture);
+      free(entry->pixels);
+      entry->pixels = NULL;
+    }
+    // Both upload paths have copied the data by the time they return, so
+    // nothing stays behind on the CPU.
+    uint64_t resident_bytes = frmwrk_texture_chain_size(
+        texture.format, texture.w, texture.h, texture.mipLevelCount);
+    if (texture.view)
+      entry->texture = frmwrk_resources_add_texture(loader->resources, &texture);
+    else if (texture.texture)
+      wgpuTextureDrop(texture.texture);
+    if (entry->atlasRegion) {
+      entry->state = TextureLoadState_Ready;
+      loader->stats.packed++;
+    } else if (entry->texture) {
+      entry->state = TextureLoadState_Ready;
+      entry->residentBytes = resident_bytes;
+      entry->lastUsedFrame = loader->frame;
+      lru_push_front(loader, entry);
+      loader->residentBytes += resident_bytes;
+      if (loader->residentBytes > loader->stats.peakResidentBytes)
+        loader->stats.peakResidentBytes = loader->residentBytes;
+      loader->stats.uploads++;
+    } else {
+      entry->state = TextureLoadState_Failed;
+    }
+    spent += size;
+    loader->pendingCount--;
+    finished++;
+  }
+
+  finished += enforce_residency_budget(loader);
+  loader->frame++;
+  return finished;
+}
+
+static const TextureLoadEntry *get_entry(const TextureLoader *loader,
+                                         TextureHandle handle) {
+  if (handle == 0 || handle > loader->entryCount)
+    return NULL;
+  return loader->entries[handle - 1];
+}
+
+TextureLoadState frmwrk_texture_loader_state(const TextureLoader *loader,
+                                             TextureHandle handle) {
+  const TextureLoadEntry *entry = get_entry(loader, handle);
+  return entry ? entry->state : TextureLoadState_Failed;
+}
+
+WGPUTextureView frmwrk_texture_loader_view(const TextureLoader *loader,
+                                           TextureHandle handle) {
+  const TextureLoadEntry *entry = get_entry(loader, handle);
+  if (entry && entry->atlasRegion) {
+    const AtlasRegion *region =
+        frmwrk_atlas_region(loader->atlas, entry->atlasRegion);
+    return entry->state == TextureLoadState_Ready
+               ? frmwrk_atlas_layer_view(loader->atlas, region->layer)
+               : loader->placeholder.view;
+  }
+  const Texture2D *texture =
+      entry ? frmwrk_resources_texture(loader->resources, entry->texture)
+            : NULL;
+  return texture ? texture->view : loader->placeholder.view;
+}
+
+void frmwrk_texture_loader_uv_rect(const TextureLoader *loader,
+                                   TextureHandle handle, float uv[4]) {
+  const TextureLoadEntry *entry = get_entry(loader, handle);
+  const AtlasRegion *region =
+      entry && entry->atlasRegion && entry->state == TextureLoadState_Ready
+          ? frmwrk_atlas_region(loader->atlas, entry->atlasRegion)
+          : NULL;
+  uv[0] = region ? region->u0 : 0.0f;
+  uv[1] = region ? region->v0 : 0.0f;
+  uv[2] = region ? region->u1 : 1.0f;
+  uv[3] = region ? region->v1 : 1.0f;
+}
+
+void frmwrk_texture_loader_unload(TextureLoader *loader, TextureHandle handle) {
+  TextureLoadEntry *entry = (TextureLoadEntry *)get_entry(loader, handle);
+  if (!entry)
+    return;
+  if (entry->state == TextureLoadState_Ready) {
+    // Packed images keep their region.
+    if (!entry->atlasRegion)
+      release_resident(loader, entry);
+  } else if (entry->state != TextureLoadState_Evicted) {
+    return;
+  }
+  entry->state = TextureLoadState_Unloaded;
+}
+
+bool frmwrk_texture_loader_reload(TextureLoader *loader, TextureHandle handle) {
+  TextureLoadEntry *entry = (TextureLoadEntry *)get_entry(loader, handle);
+  if (!entry || entry->state != TextureLoadState_Unloaded)
+    return false;
+  // Still packed, since atlas space is never given back.
+  if (entry->atlasRegion) {
+    entry->state = TextureLoadState_Ready;
+    return true;
+  }
+  return queue_decode(loader, entry);
+}
+
+void frmwrk_texture_loader_set_residency_budget(TextureLoader *loader,
+                                                uint64_t budgetBytes) {
+  loader->residencyBudget = budgetBytes;
+}
+
+void frmwrk_texture_loader_touch(TextureLoader *loader, TextureHandle handle) {
+  TextureLoadEntry *entry = (TextureLoadEntry *)get_entry(loader, handle);
+  if (!entry)
+    return;
+  // Packed images are not in the LRU list.
+  if (entry->state == TextureLoadState_Ready && !entry->atlasRegion) {
+    entry->lastUsedFrame = loader->frame;
+    if (loader->lruHead != entry) {
+      lru_remove(loader, entry);
+      lru_push_front(loader, entry);
+    }
+  } else if (entry->state == TextureLoadState_Evicted) {
+    if (queue_decode(loader, entry))
+      loader->stats.reloads++;
+  }
+}
+
+void frmwrk_texture_loader_print(const TextureLoader *loader) {
+  printf("[texture_loader] resident=%.2f MiB peak=%.2f MiB budget=%.2f MiB "
+         "uploads=%llu packed=%llu evictions=%llu reloads=%llu "
+         "over_budget=%llu\n",
+         loader->residentBytes / (1024.0 * 1024.0),
+         loader->stats.peakResidentBytes / (1024.0 * 1024.0),
+         loader->residencyBudget / (1024.0 * 1024.0),
+         (unsigned long long)loader->stats.uploads,
+         (unsigned long long)loader->stats.packed,
+         (unsigned long long)loader->stats.evictions,
+         (unsigned long long)loader->stats.reloads,
+         (unsigned long long)loader->stats.overBudgetUpdates);
+}
+
+bool frmwrk_texture_loader_busy(const TextureLoader *loader) {
+  return loader->pendingCount > 0;
+}
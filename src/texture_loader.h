@@ -0,0 +1,185 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "atlas.h"
+#include "block_compress.h"
+#include "framework.h"
+#include "resources.h"
+#include "texture_container.h"
+#include "threading.h"
+
+// Handle to a texture requested from a TextureLoader. 0 is never a valid handle.
+typedef uint32_t TextureHandle;
+
+typedef enum TextureLoadState {
+  TextureLoadState_Loading,
+  TextureLoadState_Ready,
+  TextureLoadState_Failed,
+  TextureLoadState_Unloaded,
+  // Dropped to stay within the residency budget; touching it loads it again.
+  TextureLoadState_Evicted,
+} TextureLoadState;
+
+typedef struct TextureLoadEntry {
+  char *path;
+  // Only written by the render thread.
+  TextureLoadState state;
+  // Decoded and converted pixels waiting for upload, owned by the entry until then.
+  // Written by a worker before the entry is pushed to the upload queue.
+  // Holds `pixelLevels` tightly packed mip levels of `format`, level 0 first:
+  // RGBA8, or blocks when the loader compresses.
+  unsigned char *pixels;
+  uint32_t pixelLevels;
+  WGPUTextureFormat format;
+  size_t pixelSize;
+  int32_t w;
+  int32_t h;
+  // Cooked (.ftex) files are mapped instead of decoded and uploaded straight
+  // from the mapping, with the levels they were cooked with.
+  TextureContainer container;
+  // Owned by the loader's resource registry once uploaded.
+  TextureId texture;
+  // Set instead of `texture` for images packed into the loader's atlas.
+  AtlasHandle atlasRegion;
+  // GPU bytes of the uploaded texture, every mip level included.
+  uint64_t residentBytes;
+  // TextureLoader::frame when last touched or uploaded.
+  uint64_t lastUsedFrame;
+  // Ready entries, most recently used first.
+  struct TextureLoadEntry *lruPrev;
+  struct TextureLoadEntry *lruNext;
+} TextureLoadEntry;
+
+// Ring of entry pointers shared between the render thread and the workers.
+typedef struct TextureLoadQueue {
+  TextureLoadEntry **items;
+  uint32_t head;
+  uint32_t count;
+  uint32_t capacity;
+} TextureLoadQueue;
+
+typedef struct TextureLoaderStats {
+  uint64_t uploads;
+  uint64_t evictions;
+  // Evicted textures touched again and queued for decoding.
+  uint64_t reloads;
+  // Images packed into the atlas rather than given a texture of their own.
+  uint64_t packed;
+  uint64_t peakResidentBytes;
+  // Updates that ended over budget because every texture was in use.
+  uint64_t overBudgetUpdates;
+} TextureLoaderStats;
+
+// Decodes images on a pool of worker threads and uploads them on the render
+// thread within a per-frame byte budget. Until a texture is uploaded its view
+// resolves to a 1x1 placeholder, so callers can bind handles right away.
+typedef struct TextureLoader {
+  WGPUDevice device;
+  WGPUQueue queue;
+  ResourceRegistry *resources;
+  UploadRing *uploadRing;
+  MipmapGenerator *mipmapGenerator;
+  Texture2D placeholder;
+
+  FrmwrkThread *workers;
+  uint32_t workerCount;
+  FrmwrkMutex mutex;
+  FrmwrkCondition workAvailable;
+  bool stopping;
+  TextureLoadQueue decodeQueue;
+  TextureLoadQueue uploadQueue;
+  // Read by the workers under `mutex` as they take each entry.
+  bool compress;
+  BlockFormat blockFormat;
+  BlockQuality blockQuality;
+  // Decoded images no larger than `atlasMaxSize` either way go into `atlas`,
+  // with a single level and uncompressed.
+  Atlas *atlas;
+  uint32_t atlasMaxSize;
+
+  // Only touched by the render thread; workers see entries through the queues.
+  TextureLoadEntry **entries;
+  uint32_t entryCount;
+  uint32_t entryCapacity;
+  uint32_t pendingCount;
+
+  // Bytes of every ready texture, kept under `residencyBudget` (0 for no
+  // limit) by evicting the least recently used ones not touched since the
+  // previous update.
+  uint64_t residencyBudget;
+  uint64_t residentBytes;
+  // Counts updates.
+  uint64_t frame;
+  TextureLoadEntry *lruHead;
+  TextureLoadEntry *lruTail;
+  TextureLoaderStats stats;
+} TextureLoader;
+
+// workerCount 0 uses one worker per logical processor. Uploads are staged
+// through `uploadRing` when it is not NULL. Every texture gets a full mip
+// chain: generated by `mipmapGenerator` after upload when it is not NULL,
+// otherwise box-filtered by the decode workers. Uploaded textures are added to
+// `resources`, which must outlive the loader.
+TextureLoader *frmwrk_create_texture_loader(WGPUDevice device,
+                                            ResourceRegistry *resources,
+                                            UploadRing *uploadRing,
+                                            MipmapGenerator *mipmapGenerator,
+                                            uint32_t workerCount);
+void frmwrk_drop_texture_loader(TextureLoader *loader);
+// Block-compresses images decoded from now on, with the whole chain built and
+// encoded by the workers (the mipmap generator cannot render into compressed
+// textures). Images that are not whole 4x4 blocks stay RGBA8. The device must
+// have WGPUFeatureName_TextureCompressionBC.
+void frmwrk_texture_loader_compress(TextureLoader *loader, BlockFormat format,
+                                    BlockQuality quality);
+
+// Packs decoded images up to `maxSize` texels wide and high into `atlas`,
+// which must outlive the loader. Their views are 2D views of an atlas layer,
+// sampled through frmwrk_texture_loader_uv_rect. Cooked containers keep their
+// own textures. Atlas space is never reclaimed, so packed images are not
+// evicted, and unloading one only hides it until it is reloaded.
+void frmwrk_texture_loader_use_atlas(TextureLoader *loader, Atlas *atlas,
+                                     uint32_t maxSize);
+
+// Queues `path` for decoding and returns immediately. Paths ending in .ftex
+// are read as texture containers.
+TextureHandle frmwrk_texture_loader_load(TextureLoader *loader,
+                                         const char *path);
+// Uploads decoded images until `budgetBytes` is spent (at least one per call so
+// a large image cannot starve), then evicts textures until the residency
+// budget is met. Returns how many textures became ready, failed or were
+// evicted, so callers know when to rebuild bind groups. Packing an image may
+// replace every atlas layer view, which is covered by the same count.
+uint32_t frmwrk_texture_loader_update(TextureLoader *loader,
+                                      uint64_t budgetBytes);
+
+TextureLoadState frmwrk_texture_loader_state(const TextureLoader *loader,
+                                             TextureHandle handle);
+// The uploaded view, or the placeholder while loading, after a failure or once
+// unloaded.
+WGPUTextureView frmwrk_texture_loader_view(const TextureLoader *loader,
+                                           TextureHandle handle);
+// The normalized rectangle to sample `handle`'s view with: its region for a
+// ready packed image, otherwise the whole view.
+void frmwrk_texture_loader_uv_rect(const TextureLoader *loader,
+                                   TextureHandle handle, float uv[4]);
+// Releases a ready or evicted texture through the resource registry; the GPU
+// copy is dropped once frames already submitted with it have retired.
+// frmwrk_texture_loader_reload brings it back under the same handle.
+void frmwrk_texture_loader_unload(TextureLoader *loader, TextureHandle handle);
+// Queues an unloaded texture for decoding again. Returns false for handles
+// that are not unloaded, or if it could not be queued.
+bool frmwrk_texture_loader_reload(TextureLoader *loader, TextureHandle handle);
+// Caps the GPU bytes of ready textures; 0 removes the limit. With a budget,
+// touch every texture drawn each frame: the rest may be evicted by the next
+// update.
+void frmwrk_texture_loader_set_residency_budget(TextureLoader *loader,
+                                                uint64_t budgetBytes);
+// Marks a texture as used this frame. An evicted texture is queued for
+// loading again and shows the placeholder until it is back.
+void frmwrk_texture_loader_touch(TextureLoader *loader, TextureHandle handle);
+void frmwrk_texture_loader_print(const TextureLoader *loader);
+// True while any requested texture is still decoding or awaiting upload.
+bool frmwrk_texture_loader_busy(const TextureLoader *loader);
+
+#endif // TEXTURE_LOADER_H
@@ -0,0 +1,171 @@
+#include "texture_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static WGPUBindGroupLayout create_layout(WGPUDevice device, uint32_t count) {
+  WGPUBindGroupLayoutEntry entries[] = {
+    (WGPUBindGroupLayoutEntry){
+      .binding = 0,
+      .texture = (WGPUTextureBindingLayout){
+        .multisampled = false,
+        .sampleType = WGPUTextureSampleType_Float,
+        .viewDimension = WGPUTextureViewDimension_2D
+      },
+      .visibility = WGPUShaderStage_Fragment,
+      .count = count
+    },
+    (WGPUBindGroupLayoutEntry){
+      .binding = 1,
+      .sampler = (WGPUSamplerBindingLayout){
+        .type = WGPUSamplerBindingType_Filtering
+      },
+      .visibility = WGPUShaderStage_Fragment
+    }
+  };
+  return wgpuDeviceCreateBindGroupLayout(
+      device, &(const WGPUBindGroupLayoutDescriptor){
+                  .label = "texture_table_bind_group_layout",
+                  .entries = entries,
+                  .entryCount = 2
+              });
+}
+
+// Reallocates the views and layout for `capacity` slots.
+static bool resize(TextureTable *table, uint32_t capacity) {
+  WGPUBindGroupLayout layout = create_layout(table->device, capacity);
+  if (!layout)
+    return false;
+  WGPUTextureView *views =
+      realloc(table->views, sizeof(WGPUTextureView) * capacity);
+  uint32_t *free_slots = realloc(table->freeSlots, sizeof(uint32_t) * capacity);
+  if (views)
+    table->views = views;
+  if (free_slots)
+    table->freeSlots = free_slots;
+  if (!views || !free_slots) {
+    wgpuBindGroupLayoutDrop(layout);
+    return false;
+  }
+
+  for (uint32_t i = table->capacity; i < capacity; i++)
+    table->views[i] = table->placeholder;
+  if (table->bindGroupLayout)
+    wgpuBindGroupLayoutDrop(table->bindGroupLayout);
+  table->bindGroupLayout = layout;
+  table->capacity = capacity;
+  table->generation++;
+  table->dirty = true;
+  return true;
+}
+
+TextureTable *frmwrk_create_texture_table(WGPUDevice device,
+                                          WGPUSampler sampler,
+                                          WGPUTextureView placeholder) {
+  TextureTable *table = calloc(1, sizeof(TextureTable));
+  if (!table)
+    return NULL;
+  table->device = device;
+  table->sampler = sampler;
+  table->placeholder = placeholder;
+
+  WGPUSupportedLimits limits = {0};
+  wgpuDeviceGetLimits(device, &limits);
+  table->maxSlots = limits.limits.maxSampledTexturesPerShaderStage;
+  if (table->maxSlots == 0)
+    table->maxSlots = TEXTURE_TABLE_INITIAL_CAPACITY;
+
+  uint32_t capacity = TEXTURE_TABLE_INITIAL_CAPACITY < table->maxSlots
+                          ? TEXTURE_TABLE_INITIAL_CAPACITY
+                          : table->maxSlots;
+  if (!resize(table, capacity)) {
+    frmwrk_drop_texture_table(table);
+    return NULL;
+  }
+  return table;
+}
+
+void frmwrk_drop_texture_table(TextureTable *table) {
+  if (!table)
+    return;
+  if (table->bindGroup)
+    wgpuBindGroupDrop(table->bindGroup);
+  if (table->bindGroupLayout)
+    wgpuBindGroupLayoutDrop(table->bindGroupLayout);
+  free(table->views);
+  free(table->freeSlots);
+  free(table);
+}
+
+uint32_t frmwrk_texture_table_add(TextureTable *table, WGPUTextureView view) {
+  uint32_t slot;
+  if (table->freeCount > 0) {
+    slot = table->freeSlots[--table->freeCount];
+  } else {
+    if (table->slotCount == table->capacity) {
+      uint32_t capacity = table->capacity * 2 < table->maxSlots
+                              ? table->capacity * 2
+                              : table->maxSlots;
+      if (capacity == table->capacity || !resize(table, capacity)) {
+        printf("[texture_table] out of slots (%u)\n", table->capacity);
+        return TEXTURE_TABLE_INVALID_SLOT;
+      }
+    }
+    slot = table->slotCount++;
+  }
+  frmwrk_texture_table_set(table, slot, view);
+  return slot;
+}
+
+void frmwrk_texture_table_set(TextureTable *table, uint32_t slot,
+                              WGPUTextureView view) {
+  if (slot >= table->slotCount)
+    return;
+  if (!view)
+    view = table->placeholder;
+  if (table->views[slot] == view)
+    return;
+  table->views[slot] = view;
+  table->dirty = true;
+}
+
+void frmwrk_texture_table_remove(TextureTable *table, uint32_t slot) {
+  if (slot >= table->slotCount)
+    return;
+  frmwrk_texture_table_set(table, slot, table->placeholder);
+  // The free list holds at most every handed-out slot, so it cannot overflow.
+  table->freeSlots[table->freeCount++] = slot;
+}
+
+WGPUBindGroup frmwrk_texture_table_bind_group(TextureTable *table) {
+  if (!table->dirty && table->bindGroup)
+    return table->bindGroup;
+
+  WGPUBindGroupEntry entries[] = {
+    (WGPUBindGroupEntry){
+      .binding = 0,
+      .textureViewArray = table->views,
+      .textureViewArrayLength = table->capacity
+    },
+    (WGPUBindGroupEntry){
+      .binding = 1,
+      .sampler = table->sampler
+    }
+  };
+  WGPUBindGroup bind_group = wgpuDeviceCreateBindGroup(
+      table->device, &(const WGPUBindGroupDescriptor){
+                         .label = "texture_table_bind_group",
+                         .layout = table->bindGroupLayout,
+                         .entries = entries,
+                         .entryCount = 2
+                     });
+  // Keep drawing with the previous group if the new one could not be built.
+  if (!bind_group)
+    return table->bindGroup;
+
+  if (table->bindGroup)
+    wgpuBindGroupDrop(table->bindGroup);
+  table->bindGroup = bind_group;
+  table->dirty = false;
+  table->rebuilds++;
+  return bind_group;
+}
@@ -0,0 +1,57 @@
+#ifndef TEXTURE_TABLE_H
+#define TEXTURE_TABLE_H
+
+#include "framework.h"
+
+#define TEXTURE_TABLE_INITIAL_CAPACITY 16
+#define TEXTURE_TABLE_INVALID_SLOT UINT32_MAX
+
+// Bindless texture registry: one binding array of texture views plus a
+// sampler, bound once as a single bind group. Slots are stable indices handed
+// out from a free list and passed to shaders per instance; unused slots point
+// at `placeholder`. The bind group is only rebuilt when a slot changes.
+typedef struct TextureTable {
+  WGPUDevice device;
+  WGPUSampler sampler;
+  WGPUTextureView placeholder;
+
+  WGPUBindGroupLayout bindGroupLayout;
+  WGPUBindGroup bindGroup;
+  bool dirty;
+
+  // `capacity` views, the binding array length of the current layout.
+  WGPUTextureView *views;
+  uint32_t capacity;
+  // Device limit on sampled textures per stage, which bounds `capacity`.
+  uint32_t maxSlots;
+  // Slots below `slotCount` have been handed out at least once.
+  uint32_t slotCount;
+  uint32_t *freeSlots;
+  uint32_t freeCount;
+
+  // Bumped whenever `bindGroupLayout` is replaced, so pipelines built against
+  // it can be rebuilt.
+  uint32_t generation;
+  uint32_t rebuilds;
+} TextureTable;
+
+// The table binds views at binding 0 and `sampler` at binding 1, visible to the
+// fragment stage. Neither `sampler` nor any view is owned by the table.
+TextureTable *frmwrk_create_texture_table(WGPUDevice device,
+                                          WGPUSampler sampler,
+                                          WGPUTextureView placeholder);
+void frmwrk_drop_texture_table(TextureTable *table);
+
+// Returns TEXTURE_TABLE_INVALID_SLOT once the device limit is reached. Growing
+// past the current capacity replaces the layout and bumps `generation`.
+uint32_t frmwrk_texture_table_add(TextureTable *table, WGPUTextureView view);
+void frmwrk_texture_table_set(TextureTable *table, uint32_t slot,
+                              WGPUTextureView view);
+// Points `slot` back at the placeholder and makes it available again. Remove
+// each slot at most once per add.
+void frmwrk_texture_table_remove(TextureTable *table, uint32_t slot);
+
+// The bind group for the current slots, rebuilt first if anything changed.
+WGPUBindGroup frmwrk_texture_table_bind_group(TextureTable *table);
+
+#endif // TEXTURE_TABLE_H
@@ -0,0 +1,160 @@
+#include "threading.h"
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+typedef struct ThreadStart {
+  FrmwrkThreadFunction function;
+  void *userdata;
+} ThreadStart;
+
+#if defined(_WIN32)
+static DWORD WINAPI thread_entry(LPVOID param) {
+#else
+static void *thread_entry(void *param) {
+#endif
+  ThreadStart start = *(ThreadStart *)param;
+  free(param);
+  start.function(start.userdata);
+  return 0;
+}
+
+bool frmwrk_thread_create(FrmwrkThread *thread, FrmwrkThreadFunction function,
+                          void *userdata) {
+  ThreadStart *start = malloc(sizeof(ThreadStart));
+  if (!start)
+    return false;
+  start->function = function;
+  start->userdata = userdata;
+
+#if defined(_WIN32)
+  *thread = CreateThread(NULL, 0, thread_entry, start, 0, NULL);
+  if (*thread == NULL) {
+#else
+  if (pthread_create(thread, NULL, thread_entry, start) != 0) {
+#endif
+    free(start);
+    return false;
+  }
+  return true;
+}
+
+void frmwrk_thread_join(FrmwrkThread thread) {
+#if defined(_WIN32)
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+#else
+  pthread_join(thread, NULL);
+#endif
+}
+
+void frmwrk_thread_yield(void) {
+#if defined(_WIN32)
+  SwitchToThread();
+#else
+  sched_yield();
+#endif
+}
+
+void frmwrk_thread_sleep_ms(uint32_t milliseconds) {
+#if defined(_WIN32)
+  Sleep(milliseconds);
+#else
+  usleep((useconds_t)milliseconds * 1000);
+#endif
+}
+
+uint64_t frmwrk_thread_id(void) {
+#if defined(_WIN32)
+  return (uint64_t)GetCurrentThreadId();
+#else
+  return (uint64_t)(uintptr_t)pthread_self();
+#endif
+}
+
+void frmwrk_mutex_init(FrmwrkMutex *mutex) {
+#if defined(_WIN32)
+  InitializeCriticalSection(mutex);
+#else
+  pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+void frmwrk_mutex_lock(FrmwrkMutex *mutex) {
+#if defined(_WIN32)
+  EnterCriticalSection(mutex);
+#else
+  pthread_mutex_lock(mutex);
+#endif
+}
+
+void frmwrk_mutex_unlock(FrmwrkMutex *mutex) {
+#if defined(_WIN32)
+  LeaveCriticalSection(mutex);
+#else
+  pthread_mutex_unlock(mutex);
+#endif
+}
+
+void frmwrk_mutex_destroy(FrmwrkMutex *mutex) {
+#if defined(_WIN32)
+  DeleteCriticalSection(mutex);
+#else
+  pthread_mutex_destroy(mutex);
+#endif
+}
+
+void frmwrk_condition_init(FrmwrkCondition *condition) {
+#if defined(_WIN32)
+  InitializeConditionVariable(condition);
+#else
+  pthread_cond_init(condition, NULL);
+#endif
+}
+
+void frmwrk_condition_wait(FrmwrkCondition *condition, FrmwrkMutex *mutex) {
+#if defined(_WIN32)
+  SleepConditionVariableCS(condition, mutex, INFINITE);
+#else
+  pthread_cond_wait(condition, mutex);
+#endif
+}
+
+void frmwrk_condition_signal(FrmwrkCondition *condition) {
+#if defined(_WIN32)
+  WakeConditionVariable(condition);
+#else
+  pthread_cond_signal(condition);
+#endif
+}
+
+void frmwrk_condition_broadcast(FrmwrkCondition *condition) {
+#if defined(_WIN32)
+  WakeAllConditionVariable(condition);
+#else
+  pthread_cond_broadcast(condition);
+#endif
+}
+
+void frmwrk_condition_destroy(FrmwrkCondition *condition) {
+#if defined(_WIN32)
+  // Win32 condition variables need no cleanup.
+  (void)condition;
+#else
+  pthread_cond_destroy(condition);
+#endif
+}
+
+uint32_t frmwrk_cpu_count(void) {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+#endif
+}
@@ -0,0 +1,47 @@
+#ifndef THREADING_H
+#define THREADING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Minimal thread, mutex and condition variable wrappers over Win32 and
+// pthreads so framework modules can run background work on either platform.
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef HANDLE FrmwrkThread;
+typedef CRITICAL_SECTION FrmwrkMutex;
+typedef CONDITION_VARIABLE FrmwrkCondition;
+#else
+#include <pthread.h>
+typedef pthread_t FrmwrkThread;
+typedef pthread_mutex_t FrmwrkMutex;
+typedef pthread_cond_t FrmwrkCondition;
+#endif
+
+typedef void (*FrmwrkThreadFunction)(void *userdata);
+
+bool frmwrk_thread_create(FrmwrkThread *thread, FrmwrkThreadFunction function,
+                          void *userdata);
+void frmwrk_thread_join(FrmwrkThread thread);
+void frmwrk_thread_yield(void);
+void frmwrk_thread_sleep_ms(uint32_t milliseconds);
+// Identifier of the calling thread, stable for its lifetime.
+uint64_t frmwrk_thread_id(void);
+
+void frmwrk_mutex_init(FrmwrkMutex *mutex);
+void frmwrk_mutex_lock(FrmwrkMutex *mutex);
+void frmwrk_mutex_unlock(FrmwrkMutex *mutex);
+void frmwrk_mutex_destroy(FrmwrkMutex *mutex);
+
+void frmwrk_condition_init(FrmwrkCondition *condition);
+void frmwrk_condition_wait(FrmwrkCondition *condition, FrmwrkMutex *mutex);
+void frmwrk_condition_signal(FrmwrkCondition *condition);
+void frmwrk_condition_broadcast(FrmwrkCondition *condition);
+void frmwrk_condition_destroy(FrmwrkCondition *condition);
+
+// Number of logical processors, at least 1.
+uint32_t frmwrk_cpu_count(void);
+
+#endif // THREADING_H
@@ -0,0 +1,163 @@
+#include "uniform_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+UniformRing *frmwrk_create_uniform_ring(WGPUDevice device,
+                                        uint64_t segmentSize,
+                                        uint32_t bindingSize) {
+  UniformRing *ring = calloc(1, sizeof(UniformRing));
+  if (!ring)
+    return NULL;
+
+  ring->device = device;
+  ring->queue = wgpuDeviceGetQueue(device);
+  ring->segmentSize = align_up(segmentSize, UNIFORM_RING_ALIGNMENT);
+  ring->bindingSize = bindingSize;
+  ring->current = UNIFORM_RING_FRAMES - 1;
+  for (uint32_t i = 0; i < UNIFORM_RING_FRAMES; i++)
+    ring->segments[i].ring = ring;
+
+  uint64_t size = ring->segmentSize * UNIFORM_RING_FRAMES;
+  ring->shadow = malloc(size);
+  ring->buffer = wgpuDeviceCreateBuffer(
+      device, &(const WGPUBufferDescriptor){
+                  .label = "uniform_ring",
+                  .size = size,
+                  .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst
+              });
+  ring->bindGroupLayout = wgpuDeviceCreateBindGroupLayout(
+      device, &(const WGPUBindGroupLayoutDescriptor){
+                  .label = "uniform_ring_bind_group_layout",
+                  .entryCount = 1,
+                  .entries = &(const WGPUBindGroupLayoutEntry){
+                      .binding = 0,
+                      .buffer = (WGPUBufferBindingLayout){
+                          .type = WGPUBufferBindingType_Uniform,
+                          .hasDynamicOffset = true,
+                          .minBindingSize = bindingSize
+                      },
+                      .visibility =
+                          WGPUShaderStage_Vertex | WGPUShaderStage_Fragment
+                  }
+              });
+  if (!ring->shadow || !ring->buffer || !ring->bindGroupLayout) {
+    frmwrk_drop_uniform_ring(ring);
+    return NULL;
+  }
+  ring->bindGroup = wgpuDeviceCreateBindGroup(
+      device, &(const WGPUBindGroupDescriptor){
+                  .label = "uniform_ring_bind_group",
+                  .layout = ring->bindGroupLayout,
+                  .entryCount = 1,
+                  .entries = &(const WGPUBindGroupEntry){
+                      .binding = 0,
+                      .buffer = ring->buffer,
+                      .offset = 0,
+                      .size = bindingSize
+                  }
+              });
+  if (!ring->bindGroup) {
+    frmwrk_drop_uniform_ring(ring);
+    return NULL;
+  }
+  return ring;
+}
+
+static bool any_in_flight(const UniformRing *ring) {
+  for (uint32_t i = 0; i < UNIFORM_RING_FRAMES; i++) {
+    if (ring->segments[i].inFlight)
+      return true;
+  }
+  return false;
+}
+
+void frmwrk_drop_uniform_ring(UniformRing *ring) {
+  if (!ring)
+    return;
+  // The work-done callbacks point into the ring.
+  while (any_in_flight(ring))
+    wgpuDevicePoll(ring->device, true, NULL);
+  if (ring->bindGroup)
+    wgpuBindGroupDrop(ring->bindGroup);
+  if (ring->bindGroupLayout)
+    wgpuBindGroupLayoutDrop(ring->bindGroupLayout);
+  if (ring->buffer)
+    wgpuBufferDrop(ring->buffer);
+  if (ring->queue)
+    wgpuQueueDrop(ring->queue);
+  free(ring->shadow);
+  free(ring);
+}
+
+static void handle_segment_work_done(WGPUQueueWorkDoneStatus status,
+                                     void *userdata) {
+  UNUSED(status)
+  UniformRingSegment *segment = userdata;
+  segment->inFlight = false;
+}
+
+void frmwrk_uniform_ring_begin_frame(UniformRing *ring) {
+  ring->current = (ring->current + 1) % UNIFORM_RING_FRAMES;
+  UniformRingSegment *segment = &ring->segments[ring->current];
+  if (segment->inFlight) {
+    ring->stats.stalls++;
+    while (segment->inFlight)
+      wgpuDevicePoll(ring->device, true, NULL);
+  }
+  segment->used = 0;
+}
+
+void *frmwrk_uniform_ring_alloc(UniformRing *ring, uint32_t size,
+                                uint32_t *offset) {
+  UniformRingSegment *segment = &ring->segments[ring->current];
+  // The bind group always exposes `bindingSize` bytes past the offset, so
+  // that much has to fit even for a smaller allocation.
+  uint64_t reach = size > ring->bindingSize ? size : ring->bindingSize;
+  if (segment->used + reach > ring->segmentSize) {
+    ring->stats.failures++;
+    return NULL;
+  }
+  uint64_t start = ring->segmentSize * ring->current + segment->used;
+  segment->used += align_up(size, UNIFORM_RING_ALIGNMENT);
+  if (segment->used > ring->stats.peakFrameBytes)
+    ring->stats.peakFrameBytes = segment->used;
+  ring->stats.allocations++;
+  ring->stats.allocatedBytes += size;
+  *offset = (uint32_t)start;
+  return ring->shadow + start;
+}
+
+void frmwrk_uniform_ring_flush(UniformRing *ring) {
+  const UniformRingSegment *segment = &ring->segments[ring->current];
+  if (segment->used == 0)
+    return;
+  // Alignment padding is written too so the segment goes in one copy.
+  uint64_t start = ring->segmentSize * ring->current;
+  wgpuQueueWriteBuffer(ring->queue, ring->buffer, start, ring->shadow + start,
+                       segment->used);
+  ring->stats.writes++;
+}
+
+void frmwrk_uniform_ring_submitted(UniformRing *ring) {
+  UniformRingSegment *segment = &ring->segments[ring->current];
+  if (segment->used == 0)
+    return;
+  segment->inFlight = true;
+  wgpuQueueOnSubmittedWorkDone(ring->queue, handle_segment_work_done, segment);
+}
+
+void frmwrk_uniform_ring_print(const UniformRing *ring) {
+  printf("[uniform_ring] %llu allocations (%llu bytes) in %llu writes, "
+         "peak %llu/%llu bytes per frame, %llu failed, %llu stalls\n",
+         (unsigned long long)ring->stats.allocations,
+         (unsigned long long)ring->stats.allocatedBytes,
+         (unsigned long long)ring->stats.writes,
+         (unsigned long long)ring->stats.peakFrameBytes,
+         (unsigned long long)ring->segmentSize,
+         (unsigned long long)ring->stats.failures,
+         (unsigned long long)ring->stats.stalls);
+}
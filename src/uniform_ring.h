@@ -0,0 +1,86 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "framework.h"
+
+// Frames whose data can be in flight at once; each has its own segment.
+#define UNIFORM_RING_FRAMES 3
+// minUniformBufferOffsetAlignment and minStorageBufferOffsetAlignment are at
+// most 256 on every backend, so sub-allocations always start on it.
+#define UNIFORM_RING_ALIGNMENT 256
+
+typedef struct UniformRing UniformRing;
+
+typedef struct UniformRingSegment {
+  UniformRing *ring;
+  // Bytes handed out this frame, each allocation rounded up to the alignment.
+  uint64_t used;
+  // Submitted and not yet reported done by wgpuQueueOnSubmittedWorkDone.
+  bool inFlight;
+} UniformRingSegment;
+
+typedef struct UniformRingStats {
+  uint64_t allocations;
+  uint64_t allocatedBytes;
+  uint64_t writes;
+  // Allocations that did not fit in the frame's segment.
+  uint64_t failures;
+  // begin_frame calls that had to wait for the GPU to retire the segment.
+  uint64_t stalls;
+  uint64_t peakFrameBytes;
+} UniformRingStats;
+
+// Per-draw data for a frame is carved linearly out of that frame's segment of
+// one buffer, mirrored in CPU memory, and written with a single
+// wgpuQueueWriteBuffer before the frame is submitted. Draws bind the ring's one
+// bind group with the allocation's offset as a dynamic offset, so no bind
+// group is created per draw. A segment is only reused once the frame that read
+// it has retired, which also keeps the CPU at most UNIFORM_RING_FRAMES frames
+// ahead of the GPU.
+//
+// Segments start at the same offsets every time around, so a frame that
+// allocates the same sizes in the same order gets the same offsets it got
+// UNIFORM_RING_FRAMES frames ago; render bundles can be kept per segment.
+struct UniformRing {
+  WGPUDevice device;
+  WGPUQueue queue;
+  WGPUBuffer buffer;
+  // Segment size, a multiple of the alignment.
+  uint64_t segmentSize;
+  // Bytes visible through the bind group from each dynamic offset.
+  uint32_t bindingSize;
+  unsigned char *shadow;
+
+  // Binding 0, a uniform buffer with a dynamic offset, visible to the vertex
+  // and fragment stages.
+  WGPUBindGroupLayout bindGroupLayout;
+  WGPUBindGroup bindGroup;
+
+  UniformRingSegment segments[UNIFORM_RING_FRAMES];
+  uint32_t current;
+
+  UniformRingStats stats;
+};
+
+// `bindingSize` is the largest struct a draw reads at one offset.
+UniformRing *frmwrk_create_uniform_ring(WGPUDevice device,
+                                        uint64_t segmentSize,
+                                        uint32_t bindingSize);
+void frmwrk_drop_uniform_ring(UniformRing *ring);
+
+// Moves to the next segment, waiting for the GPU if the frame that last used
+// it has not retired yet. Call once per frame before allocating.
+void frmwrk_uniform_ring_begin_frame(UniformRing *ring);
+// Reserves `size` bytes for this frame and returns CPU memory to fill in, or
+// NULL when the segment is full. `*offset` is the dynamic offset to bind.
+void *frmwrk_uniform_ring_alloc(UniformRing *ring, uint32_t size,
+                                uint32_t *offset);
+// Writes everything allocated this frame to the GPU. Call before the frame's
+// wgpuQueueSubmit.
+void frmwrk_uniform_ring_flush(UniformRing *ring);
+// Call after the frame's wgpuQueueSubmit to fence its segment.
+void frmwrk_uniform_ring_submitted(UniformRing *ring);
+
+void frmwrk_uniform_ring_print(const UniformRing *ring);
+
+#endif // UNIFORM_RING_H
@@ -0,0 +1,391 @@
+#include "upload_ring.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+UploadRing *frmwrk_create_upload_ring(WGPUDevice device, uint64_t pageSize) {
+  UploadRing *ring = calloc(1, sizeof(UploadRing));
+  if (!ring)
+    return NULL;
+
+  ring->device = device;
+  ring->queue = wgpuDeviceGetQueue(device);
+  ring->pageSize = align_up(pageSize, UPLOAD_RING_ALIGNMENT);
+
+  for (uint32_t i = 0; i < UPLOAD_RING_PAGE_COUNT; i++) {
+    UploadPage *page = &ring->pages[i];
+    page->ring = ring;
+    page->buffer = wgpuDeviceCreateBuffer(
+        device, &(const WGPUBufferDescriptor){
+                    .label = "upload_ring_page",
+                    .size = ring->pageSize,
+                    .usage = WGPUBufferUsage_MapWrite | WGPUBufferUsage_CopySrc,
+                    .mappedAtCreation = true
+                });
+    if (!page->buffer) {
+      frmwrk_drop_upload_ring(ring);
+      return NULL;
+    }
+    page->mapping = wgpuBufferGetMappedRange(page->buffer, 0, ring->pageSize);
+    page->state = UploadPageState_Writable;
+  }
+  return ring;
+}
+
+void frmwrk_drop_upload_ring(UploadRing *ring) {
+  if (!ring)
+    return;
+  for (uint32_t i = 0; i < UPLOAD_RING_PAGE_COUNT; i++) {
+    if (ring->pages[i].buffer)
+      wgpuBufferDrop(ring->pages[i].buffer);
+  }
+  for (uint32_t i = 0; i < ring->overflowCount; i++)
+    wgpuBufferDrop(ring->overflows[i].buffer);
+  free(ring->overflows);
+  if (ring->queue)
+    wgpuQueueDrop(ring->queue);
+  free(ring->copies);
+  free(ring);
+}
+
+static void handle_page_work_done(WGPUQueueWorkDoneStatus status,
+                                  void *userdata) {
+  UNUSED(status)
+  UploadPage *page = userdata;
+  page->state = UploadPageState_Retired;
+}
+
+static void handle_page_map(WGPUBufferMapAsyncStatus status, void *userdata) {
+  UploadPage *page = userdata;
+  if (status != WGPUBufferMapAsyncStatus_Success) {
+    // Try again on the next reclaim.
+    page->state = UploadPageState_Retired;
+    return;
+  }
+  page->mapping =
+      wgpuBufferGetMappedRange(page->buffer, 0, page->ring->pageSize);
+  page->used = 0;
+  page->state = UploadPageState_Writable;
+}
+
+// Starts remapping every page the queue has finished with. Never blocks.
+static void reclaim(UploadRing *ring) {
+  wgpuDevicePoll(ring->device, false, NULL);
+  for (uint32_t i = 0; i < UPLOAD_RING_PAGE_COUNT; i++) {
+    UploadPage *page = &ring->pages[i];
+    if (page->state != UploadPageState_Retired)
+      continue;
+    page->state = UploadPageState_Mapping;
+    wgpuBufferMapAsync(page->buffer, WGPUMapMode_Write, 0, ring->pageSize,
+                       handle_page_map, page);
+  }
+}
+
+static bool reserve_in_page(UploadRing *ring, uint64_t size, uint32_t *page_index,
+                            uint64_t *offset) {
+  for (uint32_t i = 0; i < UPLOAD_RING_PAGE_COUNT; i++) {
+    uint32_t index = (ring->current + i) % UPLOAD_RING_PAGE_COUNT;
+    UploadPage *page = &ring->pages[index];
+    if (page->state != UploadPageState_Writable)
+      continue;
+
+    uint64_t aligned = align_up(page->used, UPLOAD_RING_ALIGNMENT);
+    if (aligned + size > ring->pageSize)
+      continue;
+    page->used = aligned + size;
+    ring->current = index;
+    *page_index = index;
+    *offset = aligned;
+    return true;
+  }
+  return false;
+}
+
+// Stages an upload that fits in no page in a mapped buffer of its own, so it
+// stays ordered with the copies around it.
+static bool reserve_overflow(UploadRing *ring, uint64_t size,
+                             uint32_t *overflow_index) {
+  if (ring->overflowCount == ring->overflowCapacity) {
+    uint32_t capacity =
+        ring->overflowCapacity ? ring->overflowCapacity * 2 : 8;
+    UploadOverflow *overflows =
+        realloc(ring->overflows, sizeof(UploadOverflow) * capacity);
+    if (!overflows)
+      return false;
+    ring->overflows = overflows;
+    ring->overflowCapacity = capacity;
+  }
+
+  uint64_t buffer_size = align_up(size, 4);
+  WGPUBuffer buffer = wgpuDeviceCreateBuffer(
+      ring->device, &(const WGPUBufferDescriptor){
+                        .label = "upload_ring_overflow",
+                        .size = buffer_size,
+                        .usage = WGPUBufferUsage_MapWrite |
+                                 WGPUBufferUsage_CopySrc,
+                        .mappedAtCreation = true
+                    });
+  if (!buffer)
+    return false;
+  unsigned char *mapping = wgpuBufferGetMappedRange(buffer, 0, buffer_size);
+  if (!mapping) {
+    wgpuBufferDrop(buffer);
+    return false;
+  }
+  *overflow_index = ring->overflowCount;
+  ring->overflows[ring->overflowCount++] =
+      (UploadOverflow){.buffer = buffer, .mapping = mapping};
+  ring->stats.overflowBuffers++;
+  return true;
+}
+
+static UploadCopy *reserve(UploadRing *ring, uint64_t size) {
+  if (ring->copyCount == ring->copyCapacity) {
+    uint32_t capacity = ring->copyCapacity ? ring->copyCapacity * 2 : 64;
+    UploadCopy *copies = realloc(ring->copies, sizeof(UploadCopy) * capacity);
+    if (!copies)
+      return NULL;
+    ring->copies = copies;
+    ring->copyCapacity = capacity;
+  }
+
+  uint32_t page = UPLOAD_RING_OVERFLOW;
+  uint32_t overflow = 0;
+  uint64_t offset = 0;
+  bool in_page = size <= ring->pageSize &&
+                 reserve_in_page(ring, size, &page, &offset);
+  if (!in_page && size <= ring->pageSize) {
+    reclaim(ring);
+    in_page = reserve_in_page(ring, size, &page, &offset);
+  }
+  if (!in_page && !reserve_overflow(ring, size, &overflow)) {
+    ring->stats.failedWrites++;
+    printf("[upload_ring] out of staging memory, dropping a %llu byte "
+           "upload\n",
+           (unsigned long long)size);
+    return NULL;
+  }
+
+  UploadCopy *copy = &ring->copies[ring->copyCount++];
+  *copy = (UploadCopy){
+    .page = page,
+    .overflow = overflow,
+    .offset = offset,
+    .size = size
+  };
+  ring->stats.stagedBytes += size;
+  ring->stats.stagedCopies++;
+  return copy;
+}
+
+static unsigned char *copy_mapping(const UploadRing *ring,
+                                   const UploadCopy *copy) {
+  if (copy->page == UPLOAD_RING_OVERFLOW)
+    return ring->overflows[copy->overflow].mapping;
+  return ring->pages[copy->page].mapping + copy->offset;
+}
+
+static WGPUBuffer copy_source(const UploadRing *ring, const UploadCopy *copy) {
+  if (copy->page == UPLOAD_RING_OVERFLOW)
+    return ring->overflows[copy->overflow].buffer;
+  return ring->pages[copy->page].buffer;
+}
+
+// Reserves rows of whole blocks; the copy covers the region rounded up to
+// blocks, which WebGPU accepts for the edge of a level.
+static unsigned char *alloc_blocks(UploadRing *ring, WGPUTexture texture,
+                                   uint32_t mipLevel, WGPUOrigin3D origin,
+                                   uint32_t width, uint32_t height,
+                                   uint32_t blockSize, uint32_t blockBytes,
+                                   uint32_t *bytesPerRow) {
+  uint32_t columns = (width + blockSize - 1) / blockSize;
+  uint32_t rows = (height + blockSize - 1) / blockSize;
+  uint32_t pitch = (uint32_t)align_up((uint64_t)columns * blockBytes,
+                                      UPLOAD_RING_BYTES_PER_ROW_ALIGNMENT);
+  UploadCopy *copy = reserve(ring, (uint64_t)pitch * rows);
+  if (!copy)
+    return NULL;
+
+  copy->texture = texture;
+  copy->mipLevel = mipLevel;
+  copy->origin = origin;
+  copy->extent =
+      (WGPUExtent3D){columns * blockSize, rows * blockSize, 1};
+  copy->bytesPerRow = pitch;
+  copy->rowsPerImage = rows;
+  *bytesPerRow = pitch;
+  return copy_mapping(ring, copy);
+}
+
+unsigned char *frmwrk_upload_ring_alloc_texture(UploadRing *ring,
+                                                WGPUTexture texture,
+                                                uint32_t mipLevel,
+                                                WGPUOrigin3D origin,
+                                                uint32_t width, uint32_t height,
+                                                uint32_t bytesPerPixel,
+                                                uint32_t *bytesPerRow) {
+  return alloc_blocks(ring, texture, mipLevel, origin, width, height, 1,
+                      bytesPerPixel, bytesPerRow);
+}
+
+void frmwrk_upload_ring_write_texture(UploadRing *ring, WGPUTexture texture,
+                                      uint32_t mipLevel, WGPUOrigin3D origin,
+                                      uint32_t width, uint32_t height,
+                                      uint32_t bytesPerPixel,
+                                      const void *data,
+                                      uint32_t srcBytesPerRow) {
+  frmwrk_upload_ring_write_texture_blocks(ring, texture, mipLevel, origin,
+                                          width, height, 1, bytesPerPixel,
+                                          data, srcBytesPerRow);
+}
+
+void frmwrk_upload_ring_write_texture_blocks(UploadRing *ring,
+                                             WGPUTexture texture,
+                                             uint32_t mipLevel,
+                                             WGPUOrigin3D origin,
+                                             uint32_t width, uint32_t height,
+                                             uint32_t blockSize,
+                                             uint32_t blockBytes,
+                                             const void *data,
+                                             uint32_t srcBytesPerRow) {
+  uint32_t columns = (width + blockSize - 1) / blockSize;
+  uint32_t rows = (height + blockSize - 1) / blockSize;
+  uint32_t pitch;
+  unsigned char *staging =
+      alloc_blocks(ring, texture, mipLevel, origin, width, height, blockSize,
+                   blockBytes, &pitch);
+
+  if (!staging)
+    return;
+
+  const unsigned char *src = data;
+  // Sources already padded to the staging pitch, such as cooked containers,
+  // go in one copy.
+  if (srcBytesPerRow == pitch) {
+    memcpy(staging, src,
+           (size_t)pitch * (rows - 1) + (size_t)columns * blockBytes);
+    return;
+  }
+  for (uint32_t y = 0; y < rows; y++)
+    memcpy(staging + (size_t)y * pitch, src + (size_t)y * srcBytesPerRow,
+           (size_t)columns * blockBytes);
+}
+
+void frmwrk_upload_ring_write_buffer(UploadRing *ring, WGPUBuffer buffer,
+                                     uint64_t offset, const void *data,
+                                     uint64_t size) {
+  assert(size % 4 == 0 && offset % 4 == 0);
+  UploadCopy *copy = reserve(ring, size);
+  if (!copy)
+    return;
+
+  copy->buffer = buffer;
+  copy->bufferOffset = offset;
+  memcpy(copy_mapping(ring, copy), data, size);
+}
+
+void frmwrk_upload_ring_record(UploadRing *ring, WGPUCommandEncoder encoder) {
+  reclaim(ring);
+
+  for (uint32_t i = 0; i < ring->copyCount; i++) {
+    const UploadCopy *copy = &ring->copies[i];
+    WGPUBuffer staging = copy_source(ring, copy);
+
+    if (copy->texture) {
+      wgpuCommandEncoderCopyBufferToTexture(
+          encoder,
+          &(const WGPUImageCopyBuffer){
+              .buffer = staging,
+              .layout = (WGPUTextureDataLayout){
+                .offset = copy->offset,
+                .bytesPerRow = copy->bytesPerRow,
+                .rowsPerImage = copy->rowsPerImage
+              }
+          },
+          &(const WGPUImageCopyTexture){
+              .texture = copy->texture,
+              .aspect = WGPUTextureAspect_All,
+              .mipLevel = copy->mipLevel,
+              .origin = copy->origin
+          },
+          &copy->extent);
+    } else {
+      wgpuCommandEncoderCopyBufferToBuffer(encoder, staging, copy->offset,
+                                           copy->buffer, copy->bufferOffset,
+                                           copy->size);
+    }
+  }
+  ring->copyCount = 0;
+
+  for (uint32_t i = 0; i < UPLOAD_RING_PAGE_COUNT; i++) {
+    UploadPage *page = &ring->pages[i];
+    if (page->state != UploadPageState_Writable || page->used == 0)
+      continue;
+    wgpuBufferUnmap(page->buffer);
+    page->mapping = NULL;
+    page->state = UploadPageState_Recorded;
+  }
+  for (uint32_t i = 0; i < ring->overflowCount; i++) {
+    UploadOverflow *overflow = &ring->overflows[i];
+    if (overflow->recorded)
+      continue;
+    wgpuBufferUnmap(overflow->buffer);
+    overflow->mapping = NULL;
+    overflow->recorded = true;
+  }
+}
+
+void frmwrk_upload_ring_submitted(UploadRing *ring) {
+  bool any = false;
+  for (uint32_t i = 0; i < UPLOAD_RING_PAGE_COUNT; i++) {
+    UploadPage *page = &ring->pages[i];
+    if (page->state != UploadPageState_Recorded)
+      continue;
+    page->state = UploadPageState_InFlight;
+    wgpuQueueOnSubmittedWorkDone(ring->queue, handle_page_work_done, page);
+    any = true;
+  }
+  // The submission keeps what it copies from alive, so recorded overflow
+  // buffers can be dropped right away. They come before any staged since the
+  // copies were recorded, whose indices shift down past them.
+  uint32_t recorded = 0;
+  while (recorded < ring->overflowCount &&
+         ring->overflows[recorded].recorded) {
+    wgpuBufferDrop(ring->overflows[recorded].buffer);
+    recorded++;
+  }
+  if (recorded > 0) {
+    memmove(ring->overflows, ring->overflows + recorded,
+            sizeof(UploadOverflow) * (ring->overflowCount - recorded));
+    ring->overflowCount -= recorded;
+    for (uint32_t i = 0; i < ring->copyCount; i++) {
+      if (ring->copies[i].page == UPLOAD_RING_OVERFLOW)
+        ring->copies[i].overflow -= recorded;
+    }
+    any = true;
+  }
+  if (any)
+    ring->stats.submits++;
+}
+
+void frmwrk_upload_ring_flush(UploadRing *ring) {
+  if (ring->copyCount == 0)
+    return;
+
+  WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(
+      ring->device, &(const WGPUCommandEncoderDescriptor){
+                        .label = "upload_ring_encoder",
+                    });
+  frmwrk_upload_ring_record(ring, encoder);
+  WGPUCommandBuffer command_buffer = wgpuCommandEncoderFinish(
+      encoder, &(const WGPUCommandBufferDescriptor){
+                   .label = "upload_ring_command_buffer",
+               });
+  wgpuQueueSubmit(ring->queue, 1, &command_buffer);
+  frmwrk_upload_ring_submitted(ring);
+}
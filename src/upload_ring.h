@@ -0,0 +1,147 @@
+#ifndef UPLOAD_RING_H
+#define UPLOAD_RING_H
+
+#include "framework.h"
+
+// Staging memory is split into pages because WebGPU cannot submit work that
+// reads a buffer while any part of it is mapped. Pages are filled in ring
+// order; a page is unmapped when its copies are recorded and remapped once
+// wgpuQueueOnSubmittedWorkDone reports the submission retired.
+#define UPLOAD_RING_PAGE_COUNT 4
+// UploadCopy::page of copies staged in an overflow buffer of their own.
+#define UPLOAD_RING_OVERFLOW UINT32_MAX
+// Offsets into a page satisfy the copy alignment of every format we upload.
+#define UPLOAD_RING_ALIGNMENT 16
+#define UPLOAD_RING_BYTES_PER_ROW_ALIGNMENT 256
+
+typedef enum UploadPageState {
+  // Mapped and accepting writes.
+  UploadPageState_Writable,
+  // Unmapped with copies recorded, waiting for frmwrk_upload_ring_submitted.
+  UploadPageState_Recorded,
+  // Submitted; waiting for the queue to finish with it.
+  UploadPageState_InFlight,
+  // The queue is done; the page can be remapped.
+  UploadPageState_Retired,
+  UploadPageState_Mapping,
+} UploadPageState;
+
+typedef struct UploadPage {
+  UploadRing *ring;
+  WGPUBuffer buffer;
+  unsigned char *mapping;
+  uint64_t used;
+  UploadPageState state;
+  bool mapFailed;
+} UploadPage;
+
+// Staging for an upload that did not fit in any page, dropped once the
+// submission copying from it is made.
+typedef struct UploadOverflow {
+  WGPUBuffer buffer;
+  unsigned char *mapping;
+  // Unmapped with its copy recorded, waiting for frmwrk_upload_ring_submitted.
+  bool recorded;
+} UploadOverflow;
+
+typedef struct UploadCopy {
+  // UPLOAD_RING_OVERFLOW when staged in `overflow`.
+  uint32_t page;
+  uint32_t overflow;
+  uint64_t offset;
+  uint64_t size;
+  // Buffer destination when `texture` is NULL.
+  WGPUBuffer buffer;
+  uint64_t bufferOffset;
+  WGPUTexture texture;
+  uint32_t mipLevel;
+  WGPUOrigin3D origin;
+  WGPUExtent3D extent;
+  uint32_t bytesPerRow;
+  // In rows of blocks, which are rows of texels for uncompressed formats.
+  uint32_t rowsPerImage;
+} UploadCopy;
+
+typedef struct UploadRingStats {
+  uint64_t stagedBytes;
+  uint64_t stagedCopies;
+  uint64_t submits;
+  // Uploads staged in a buffer of their own because no page had room.
+  uint64_t overflowBuffers;
+  // Uploads dropped because not even an overflow buffer could be created.
+  uint64_t failedWrites;
+} UploadRingStats;
+
+struct UploadRing {
+  WGPUDevice device;
+  WGPUQueue queue;
+  uint64_t pageSize;
+  UploadPage pages[UPLOAD_RING_PAGE_COUNT];
+  uint32_t current;
+
+  UploadCopy *copies;
+  uint32_t copyCount;
+  uint32_t copyCapacity;
+
+  UploadOverflow *overflows;
+  uint32_t overflowCount;
+  uint32_t overflowCapacity;
+
+  UploadRingStats stats;
+};
+
+UploadRing *frmwrk_create_upload_ring(WGPUDevice device, uint64_t pageSize);
+void frmwrk_drop_upload_ring(UploadRing *ring);
+
+// Ordering: every upload becomes a copy recorded by frmwrk_upload_ring_record,
+// in the order the uploads were made. Uploads never go through
+// wgpuQueueWrite*, which would run ahead of every command buffer of the next
+// submit, and so ahead of copies recorded before them (the buffer arena's
+// defragmentation moves, say). When no page has room, the upload is staged in
+// a buffer of its own instead.
+
+// Reserves staging space for a `width` x `height` region of `texture`. Rows
+// must be written `*bytesPerRow` apart. Returns NULL only when no staging
+// memory can be had at all, in which case nothing is recorded.
+unsigned char *frmwrk_upload_ring_alloc_texture(UploadRing *ring,
+                                                WGPUTexture texture,
+                                                uint32_t mipLevel,
+                                                WGPUOrigin3D origin,
+                                                uint32_t width, uint32_t height,
+                                                uint32_t bytesPerPixel,
+                                                uint32_t *bytesPerRow);
+// Stages tightly packed rows (`srcBytesPerRow` apart) for `texture`.
+void frmwrk_upload_ring_write_texture(UploadRing *ring, WGPUTexture texture,
+                                      uint32_t mipLevel, WGPUOrigin3D origin,
+                                      uint32_t width, uint32_t height,
+                                      uint32_t bytesPerPixel,
+                                      const void *data,
+                                      uint32_t srcBytesPerRow);
+// Like frmwrk_upload_ring_write_texture for block-compressed formats: rows of
+// `blockSize` x `blockSize` blocks of `blockBytes` each, `srcBytesPerRow`
+// apart. `width` and `height` are in texels and may end mid-block at the edge
+// of a small mip level.
+void frmwrk_upload_ring_write_texture_blocks(UploadRing *ring,
+                                             WGPUTexture texture,
+                                             uint32_t mipLevel,
+                                             WGPUOrigin3D origin,
+                                             uint32_t width, uint32_t height,
+                                             uint32_t blockSize,
+                                             uint32_t blockBytes,
+                                             const void *data,
+                                             uint32_t srcBytesPerRow);
+// `size` and `offset` must be multiples of 4, as for wgpuQueueWriteBuffer.
+void frmwrk_upload_ring_write_buffer(UploadRing *ring, WGPUBuffer buffer,
+                                     uint64_t offset, const void *data,
+                                     uint64_t size);
+
+// Records every staged copy into `encoder`, which must be submitted before
+// calling frmwrk_upload_ring_submitted. Copies go first, so the encoder's
+// passes already see the uploaded data.
+void frmwrk_upload_ring_record(UploadRing *ring, WGPUCommandEncoder encoder);
+void frmwrk_upload_ring_submitted(UploadRing *ring);
+// Records and submits the staged copies on their own, for uploads made outside
+// the frame loop.
+void frmwrk_upload_ring_flush(UploadRing *ring);
+
+#endif // UPLOAD_RING_H